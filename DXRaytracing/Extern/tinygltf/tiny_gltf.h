@@ -5761,10 +5761,13 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
       }
 
       for (auto &attribute : primitive.attributes) {
-        model
-            ->bufferViews[size_t(
-                model->accessors[size_t(attribute.second)].bufferView)]
-            .target = TINYGLTF_TARGET_ARRAY_BUFFER;
+        auto bufferView =
+            model->accessors[size_t(attribute.second)].bufferView;
+        // bufferView could be null(-1) for sparse attributes
+        if (bufferView >= 0) {
+          model->bufferViews[size_t(bufferView)].target =
+              TINYGLTF_TARGET_ARRAY_BUFFER;
+        }
       }
 
       for (auto &target : primitive.targets) {
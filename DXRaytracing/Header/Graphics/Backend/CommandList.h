@@ -27,6 +27,8 @@ public:
 	void CopyBuffer(Buffer& intermediateBuffer, Buffer& destBuffer, const void* bufferData);
 	void CopyBufferRegion(Buffer& intermediateBuffer, std::size_t intermediateOffset, Buffer& destBuffer, std::size_t destOffset, std::size_t numBytes);
 	void CopyTexture(Buffer& intermediateBuffer, Texture& destTexture, const void* textureData);
+	/* Copy the mips [firstMip, firstMip + numMips), mipData holds them tightly packed and intermediateOffset has to be aligned to D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT */
+	void CopyTextureMips(Buffer& intermediateBuffer, std::size_t intermediateOffset, Texture& destTexture, uint32_t firstMip, uint32_t numMips, const void* mipData);
 	void ResolveTexture(const Texture& srcTexture, const Texture& destTexture);
 
 	void ResourceBarrier(uint32_t numBarriers, const D3D12_RESOURCE_BARRIER* barriers);
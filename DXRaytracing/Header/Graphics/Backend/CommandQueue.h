@@ -15,6 +15,7 @@ public:
 
 	uint64_t Signal();
 	bool IsFenceComplete() const;
+	bool IsFenceComplete(uint64_t fenceValue) const;
 	void WaitForFenceValue(uint64_t fenceValue) const;
 	void ResetCommandLists();
 
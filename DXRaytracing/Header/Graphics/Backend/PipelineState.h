@@ -6,6 +6,17 @@ class RootSignature;
 class Shader;
 class Buffer;
 
+// Local root constants of a hit group record, matches SubmeshConstants in ClosestHitDefault.hlsl
+struct HitGroupConstants
+{
+	uint32_t IndexOffset = 0;
+	// Offset of the base color texture SRV in the CBV_SRV_UAV descriptor heap
+	uint32_t BaseColorTextureIndex = 0;
+	float TexCoordDensity = 0.0f;
+	// Entry of the base color texture in the texture residency buffer, 0 for textures that are always fully resident
+	uint32_t BaseColorResidencyIndex = 0;
+};
+
 class PipelineState
 {
 public:
@@ -13,8 +24,13 @@ public:
 		const D3D12_SHADER_BYTECODE& missByteCode, const D3D12_SHADER_BYTECODE& closestHitByteCode);
 	~PipelineState();
 
+	/* Replace the hit group records, one per BLAS geometry, this must not be called while the shader table is in use by the GPU.
+	   Every record points at the texture residency buffer, which holds the most detailed resident mip of each streamed texture */
+	void SetHitGroupRecords(const std::vector<HitGroupConstants>& hitGroupConstants, D3D12_GPU_VIRTUAL_ADDRESS textureResidencyBuffer);
+
 	const Buffer& GetShaderTable() const { return *m_ShaderTable; }
 	uint32_t GetShaderTableRecordSize() const { return m_ShaderTableRecordSize; }
+	uint32_t GetNumHitGroupRecords() const { return m_NumHitGroupRecords; }
 
 	ComPtr<ID3D12StateObject> GetStateObject() const { return m_d3d12StateObject; };
 	D3D12_PRIMITIVE_TOPOLOGY GetPrimitiveTopology() const { return m_d3d12PrimitiveToplogy; }
@@ -23,7 +39,7 @@ private:
 	void CreateRootSignatures();
 	void CreateStateObject(const std::string& name, const D3D12_SHADER_BYTECODE& rayGenByteCode,
 		const D3D12_SHADER_BYTECODE& missByteCode, const D3D12_SHADER_BYTECODE& closestHitByteCode);
-	void CreateShaderTable();
+	void CreateShaderTable(const std::vector<HitGroupConstants>& hitGroupConstants, D3D12_GPU_VIRTUAL_ADDRESS textureResidencyBuffer);
 
 private:
 	ComPtr<ID3D12StateObject> m_d3d12StateObject;
@@ -32,6 +48,7 @@ private:
 
 	std::unique_ptr<Buffer> m_ShaderTable;
 	uint32_t m_ShaderTableRecordSize = 0;
+	uint32_t m_NumHitGroupRecords = 0;
 
 	ComPtr<ID3D12RootSignature> m_LocalRootSignature;
 	ComPtr<ID3D12RootSignature> m_GlobalRootSignature;
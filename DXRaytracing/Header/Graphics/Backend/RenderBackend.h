@@ -29,8 +29,10 @@ public:
 	static std::shared_ptr<DescriptorHeap> GetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type);
 
 	static std::shared_ptr<CommandList> GetCommandList(D3D12_COMMAND_LIST_TYPE type);
-	static void ExecuteCommandList(std::shared_ptr<CommandList> commandList);
+	/* Returns the fence value the command list completes with on its command queue */
+	static uint64_t ExecuteCommandList(std::shared_ptr<CommandList> commandList);
 	static void ExecuteCommandListAndWait(std::shared_ptr<CommandList> commandList);
+	static bool IsFenceComplete(D3D12_COMMAND_LIST_TYPE type, uint64_t fenceValue);
 	
 private:
 	std::shared_ptr<Device> m_Device;
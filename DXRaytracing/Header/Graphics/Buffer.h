@@ -49,6 +49,8 @@ public:
 	// Might be a good idea to have a larger upload heap on the command list to suballocate from for copying/staging.
 	void SetBufferData(const void* data, std::size_t byteSize = 0);
 	void SetBufferDataAtOffset(const void* data, std::size_t byteSize, std::size_t byteOffset);
+	/* Write the shader resource view of the buffer into another descriptor, next to the one the buffer owns */
+	void CreateShaderResourceView(D3D12_CPU_DESCRIPTOR_HANDLE descriptor);
 	bool IsValid() const;
 
 	D3D12_CPU_DESCRIPTOR_HANDLE GetDescriptorHandle(DescriptorType type) const;
@@ -59,11 +61,14 @@ public:
 	std::string GetName() const { return m_Name; }
 	void SetName(const std::string& name);
 	ComPtr<ID3D12Resource> GetD3D12Resource() const { return m_d3d12Resource; }
+	/* Persistently mapped memory of constant and upload buffers, null for the others */
+	void* GetCPUPointer() const { return m_CPUPtr; }
 	void SetD3D12Resource(ComPtr<ID3D12Resource> resource) { m_d3d12Resource = resource; }
 
 private:
 	void Create();
 	void CreateViews();
+	D3D12_SHADER_RESOURCE_VIEW_DESC GetShaderResourceViewDesc() const;
 
 private:
 	BufferDesc m_BufferDesc = {};
@@ -0,0 +1,36 @@
+#pragma once
+
+class Camera;
+struct ModelData;
+
+/*
+	Renders frames like Renderer does, without a device. The raygen, closest hit and miss shaders are mirrored on the CPU and trace
+	a BVH of the model into an RGBA8 frame, which makes it a reference for machines without a GPU.
+*/
+class CPURenderer
+{
+public:
+	/* Frames are rendered in tiles by numThreads workers, 0 uses the number of hardware threads and 1 renders on the calling thread */
+	static void Initialize(uint32_t resX, uint32_t resY, uint32_t numThreads = 0);
+	static void Finalize();
+
+	/* Build the BVH over the model and decode its base color textures, the model data is not referenced afterwards */
+	static void SetModel(const ModelData& model);
+
+	static void BeginScene(const Camera& sceneCamera);
+	/* Busy and idle time, rendered tiles and steals of every worker are set as "CPURenderer::Thread N ..." counters of the profiler */
+	static void Render();
+
+	static void OnWindowResize(uint32_t width, uint32_t height);
+	/* Write the last rendered frame to a PNG file */
+	static bool SaveFrame(const std::string& filepath);
+
+	static glm::vec2 GetResolution();
+	/* RGBA8 texels of the last rendered frame, row by row from the top */
+	static const std::vector<uint8_t>& GetFrame();
+
+private:
+	CPURenderer();
+	~CPURenderer();
+
+};
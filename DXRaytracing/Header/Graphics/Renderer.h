@@ -1,6 +1,7 @@
 #pragma once
 
 class Camera;
+struct Model;
 
 class Renderer
 {
@@ -13,6 +14,8 @@ public:
 	static void EndScene();
 
 	static void OnWindowResize(uint32_t width, uint32_t height);
+	/* Number of bytes of streamed texture mips uploaded per frame */
+	static void SetTextureUploadBudget(std::size_t numBytesPerFrame);
 	static void ToggleVSync();
 	
 	static glm::vec2 GetResolution();
@@ -22,7 +25,9 @@ private:
 	~Renderer();
 
 	static void CreateRenderPasses();
-	static void CreateBLAS();
+	static void SetModel(const Model& model);
+	static void CreateBLAS(const Model& model);
 	static void CreateTLAS();
+	static void CreateHitGroupRecords(const Model& model);
 
 };
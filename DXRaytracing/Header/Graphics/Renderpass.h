@@ -34,6 +34,7 @@ public:
 
 	void ResizeAttachments(uint32_t width, uint32_t height);
 
+	PipelineState& GetPipelineState() { return *m_PipelineState; }
 	const PipelineState& GetPipelineState() const { return *m_PipelineState; }
 	std::shared_ptr<Texture> GetColorAttachment() const { return m_ColorAttachment; }
 	std::shared_ptr<Texture> GetDepthStencilAttachment() const { return m_DepthStencilAttachment; }
@@ -7,6 +7,8 @@ struct ShaderDesc
 	std::string Filepath;
 	std::string EntryPoint;
 	std::string Target;
+	// Preprocessor defines passed to the compiler, either NAME or NAME=VALUE
+	std::vector<std::string> Defines;
 };
 
 class Shader
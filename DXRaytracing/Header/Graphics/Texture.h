@@ -1,5 +1,6 @@
 #pragma once
 #include "Graphics/Backend/DescriptorAllocation.h"
+#include "Graphics/TextureFormat.h"
 
 enum class TextureUsage : uint32_t
 {
@@ -20,28 +21,27 @@ inline TextureUsage operator|(TextureUsage lhs, TextureUsage rhs)
 	return static_cast<TextureUsage>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
 }
 
-enum class TextureFormat : uint32_t
-{
-	TEXTURE_FORMAT_UNSPECIFIED = 0,
-	TEXTURE_FORMAT_RGBA8_UNORM,
-	TEXTURE_FORMAT_RGBA16_FLOAT,
-	TEXTURE_FORMAT_DEPTH32
-};
-
 struct TextureDesc
 {
 	TextureDesc() = default;
-	TextureDesc(TextureUsage usage, TextureFormat format, uint32_t width, uint32_t height)
-		: Usage(usage), Format(format), Width(width), Height(height) {}
+	TextureDesc(TextureUsage usage, TextureFormat format, uint32_t width, uint32_t height, uint32_t mipLevels = 1)
+		: Usage(usage), Format(format), Width(width), Height(height), MipLevels(mipLevels) {}
 
 	TextureUsage Usage = TextureUsage::TEXTURE_USAGE_NONE;
 	TextureFormat Format = TextureFormat::TEXTURE_FORMAT_UNSPECIFIED;
 
 	uint32_t Width = 1;
 	uint32_t Height = 1;
+	// Initial data of a texture with more than one mip level holds every level, tightly packed from the largest to the smallest
+	uint32_t MipLevels = 1;
 };
 
 DXGI_FORMAT TextureFormatToDXGIFormat(TextureFormat format);
+bool IsBlockCompressed(TextureFormat format);
+/* Byte size of one row of texels, or of one row of 4x4 blocks for block compressed formats */
+std::size_t GetTextureRowPitch(TextureFormat format, uint32_t width);
+/* Number of texel rows, or of block rows for block compressed formats */
+uint32_t GetTextureNumRows(TextureFormat format, uint32_t height);
 D3D12_RESOURCE_STATES TextureUsageToDXGIResourceState(TextureUsage usage);
 
 class Texture
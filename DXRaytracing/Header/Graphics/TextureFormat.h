@@ -0,0 +1,14 @@
+#pragma once
+
+enum class TextureFormat : uint32_t
+{
+	TEXTURE_FORMAT_UNSPECIFIED = 0,
+	TEXTURE_FORMAT_RGBA8_UNORM,
+	TEXTURE_FORMAT_RGBA16_FLOAT,
+	TEXTURE_FORMAT_DEPTH32,
+	// Block compressed formats, the initial data holds 4x4 blocks and mip 0 has to be a multiple of 4 texels in size
+	TEXTURE_FORMAT_BC1_UNORM,
+	TEXTURE_FORMAT_BC3_UNORM,
+	TEXTURE_FORMAT_BC5_UNORM,
+	TEXTURE_FORMAT_BC7_UNORM
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+enum class MipResidency : uint32_t
+{
+	// Waits for its turn within the upload budget
+	MIP_RESIDENCY_QUEUED,
+	// The copy is recorded and completes with the fence value it was scheduled with
+	MIP_RESIDENCY_UPLOADING,
+	MIP_RESIDENCY_RESIDENT
+};
+
+struct MipUpload
+{
+	uint32_t TextureIndex = 0;
+	uint32_t MipLevel = 0;
+	std::size_t ByteSize = 0;
+};
+
+/*
+	Tracks which mips of streamed textures are resident, without touching the device.
+	Mips become resident from the coarsest to the finest, so a texture can always be sampled at its resident mip and coarser.
+	Textures are added with their whole mip chain built, every mip only waits for the upload budget.
+*/
+class TextureResidency
+{
+public:
+	/* Track a texture by the byte size of each of its mips, from the largest to the smallest. The last numTailMips mips form the mip tail,
+	   which is uploaded by the next schedule regardless of the budget. Returns the index of the texture */
+	uint32_t AddTexture(const std::vector<std::size_t>& mipByteSizes, uint32_t numTailMips);
+
+	/* Select the queued mips to upload next and mark them as uploading until fenceValue completes. The coarsest candidates of all textures
+	   go first. The first mip over the budget is still uploaded when nothing else fit, so mips larger than the budget do not stall streaming */
+	std::vector<MipUpload> ScheduleUploads(std::size_t byteBudget, uint64_t fenceValue);
+	/* Mark every upload scheduled with a fence value up to completedFenceValue as resident, returns the textures whose resident mip changed */
+	std::vector<uint32_t> CompleteUploads(uint64_t completedFenceValue);
+
+	/* Most detailed mip that is resident together with all coarser mips, the number of mips while nothing is resident */
+	uint32_t GetResidentMip(uint32_t textureIndex) const;
+	MipResidency GetMipResidency(uint32_t textureIndex, uint32_t mipLevel) const;
+	bool IsFullyResident(uint32_t textureIndex) const;
+
+	uint32_t GetNumTextures() const { return static_cast<uint32_t>(m_Textures.size()); }
+	std::size_t GetNumUploadingBytes() const { return m_NumUploadingBytes; }
+
+private:
+	struct TrackedTexture
+	{
+		std::vector<std::size_t> MipByteSizes;
+		std::vector<MipResidency> MipStates;
+		std::vector<uint64_t> MipFenceValues;
+
+		uint32_t NumTailMips = 1;
+		// Every mip from here to the smallest is uploading or resident, the next upload is the mip before it
+		uint32_t ScheduledMip = 0;
+		uint32_t ResidentMip = 0;
+	};
+
+	MipUpload ScheduleNextMip(uint32_t textureIndex, uint64_t fenceValue);
+
+private:
+	std::vector<TrackedTexture> m_Textures;
+	std::size_t m_NumUploadingBytes = 0;
+
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include "Graphics/TextureResidency.h"
+
+class Texture;
+class Buffer;
+class CommandList;
+
+struct TextureStreamerDesc
+{
+	// Number of bytes of finer mips uploaded per frame, the mip tail is always uploaded right away
+	std::size_t UploadBudget = 8 * 1024 * 1024;
+	// Mips up to this size in texels on their largest side form the mip tail
+	uint32_t MipTailSize = 64;
+	// Capacity of the residency buffer, which holds the resident mip of every streamed texture
+	uint32_t MaxTextures = 4096;
+};
+
+/*
+	Uploads textures that were created without initial data, smallest mips first, on the command list of the frame that renders with them.
+	The hit shader reads the resident mip of each texture from the residency buffer and never samples finer mips than that.
+*/
+class TextureStreamer
+{
+public:
+	TextureStreamer(const TextureStreamerDesc& desc);
+	~TextureStreamer();
+
+	/* Stream a texture, mipData holds every mip from the largest to the smallest and is kept alive by storage until all of them
+	   are uploaded. Returns the residency index of the texture */
+	uint32_t AddTexture(const std::shared_ptr<Texture>& texture, const void* mipData, std::shared_ptr<const void> storage);
+	/* Residency index of a streamed texture, 0 for textures that are not streamed and always fully resident */
+	uint32_t GetResidencyIndex(const Texture& texture) const;
+
+	/* Record this frame's mip uploads and residency buffer update, this has to be recorded before any work that samples the textures */
+	void Update(CommandList& commandList);
+
+	void SetUploadBudget(std::size_t numBytesPerFrame) { m_Desc.UploadBudget = numBytesPerFrame; }
+	bool IsStreaming() const { return m_NumStreamingTextures > 0; }
+	D3D12_GPU_VIRTUAL_ADDRESS GetResidencyBufferAddress() const;
+
+private:
+	struct PendingTexture
+	{
+		std::shared_ptr<Texture> Resource;
+		const unsigned char* MipData = nullptr;
+		std::shared_ptr<const void> Storage;
+		// Byte offset of each mip in the mip data
+		std::vector<std::size_t> MipOffsets;
+	};
+
+private:
+	TextureStreamerDesc m_Desc;
+	TextureResidency m_Residency;
+
+	// Indexed by the texture index of the residency state machine, the residency index is one higher
+	std::vector<PendingTexture> m_Textures;
+	std::unordered_map<const Texture*, uint32_t> m_ResidencyIndices;
+	uint32_t m_NumStreamingTextures = 0;
+
+	std::unique_ptr<Buffer> m_ResidencyBuffer;
+	std::vector<uint32_t> m_ResidentMips;
+	bool m_IsResidencyDirty = false;
+	uint64_t m_NumUpdates = 0;
+
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+class Camera;
+
+/* Contents of the view constant buffer, in the layout of ViewCB in RaygenDefault.hlsl */
+struct ViewData
+{
+	// Projection times the view matrix with its translation taken out, the ray origin is passed separately
+	glm::mat4 ViewProjection = glm::identity<glm::mat4>();
+	glm::vec4 ViewOriginAndTanHalfFovY = glm::vec4(0.0f);
+	glm::vec2 Resolution = glm::vec2(0.0f);
+
+	static ViewData FromCamera(const Camera& camera, const glm::vec2& resolution);
+
+	/* Primary ray through the center of a pixel, computed the way RaygenDefault.hlsl computes it. Pixel (0, 0) is the top left */
+	glm::vec3 GetRayOrigin() const { return glm::vec3(ViewOriginAndTanHalfFovY); }
+	glm::vec3 GetRayDirection(uint32_t x, uint32_t y) const;
+
+};
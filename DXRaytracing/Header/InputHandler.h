@@ -17,7 +17,9 @@ public:
 	static void OnMouseMoved(glm::vec2 newPosition);
 
 	static bool IsKeyPressed(KeyCode key);
+#ifdef _WIN32
 	static KeyCode WParamToKeyCode(WPARAM wParam);
+#endif
 
 	static float GetInputAxis1D(KeyCode up, KeyCode down);
 	static glm::vec2 GetInputAxis2D(KeyCode up, KeyCode down, KeyCode left, KeyCode right);
@@ -7,12 +7,24 @@
 */
 #include <iostream>
 #include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <array>
+#include <limits>
+#include <numeric>
 #include <chrono>
+#include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <future>
 #include <memory>
+#include <functional>
+#include <fstream>
 #include <queue>
 #include <vector>
+#include <algorithm>
 #include <unordered_map>
 #include <assert.h>
 
@@ -21,8 +33,10 @@
 	Windows includes
 
 */
+#ifdef _WIN32
 #include "WinIncludes.h"
 #define DX_CALL(hr) if (hr != S_OK) throw std::exception()
+#endif
 
 /*
 	
@@ -36,7 +50,7 @@
 
 #define ASSERT(x, y) if (!(x)) { LOG_ERR(y); assert(false); }
 
-constexpr boolean GPU_VALIDATION_ENABLED = false;
+constexpr bool GPU_VALIDATION_ENABLED = false;
 
 /*
 
@@ -0,0 +1,84 @@
+#pragma once
+
+struct AssetBudget
+{
+	// Unreferenced assets are evicted, least recently used first, while the resident bytes are above the budget.
+	// Referenced assets are never evicted, so the budget is exceeded while they alone do not fit
+	std::size_t MaxCPUByteSize = 256ull * 1024 * 1024;
+	std::size_t MaxGPUByteSize = 2048ull * 1024 * 1024;
+};
+
+/* Reloads an evicted resource from the CPU copy of its data, which is nullptr once that was evicted as well */
+using AssetReloadFunction = std::function<std::shared_ptr<void>(const std::shared_ptr<const void>& cpuData)>;
+
+struct AssetDesc
+{
+	std::shared_ptr<void> Resource;
+	std::size_t GPUByteSize = 0;
+
+	// Optional copy of the data the resource was created from, evicted on its own under the CPU budget
+	std::shared_ptr<const void> CPUData;
+	std::size_t CPUByteSize = 0;
+
+	// Without a reload function, or without CPU data and a source to reload from, an evicted asset is forgotten
+	AssetReloadFunction Reload;
+	bool IsReloadableFromSource = false;
+};
+
+struct AssetRegistryStats
+{
+	// Resident assets hold their resource, referenced assets have at least one live handle
+	uint32_t NumAssets = 0;
+	uint32_t NumResidentAssets = 0;
+	uint32_t NumReferencedAssets = 0;
+
+	std::size_t CPUByteSize = 0;
+	std::size_t GPUByteSize = 0;
+	AssetBudget Budget;
+
+	uint32_t NumHits = 0;
+	uint32_t NumMisses = 0;
+	uint32_t NumReloads = 0;
+	uint32_t NumEvictions = 0;
+	std::size_t NumBytesSaved = 0;
+	std::size_t NumBytesEvicted = 0;
+};
+
+struct AssetRegistryData;
+
+/*
+	Resources keyed by the hash of their content, shared by everything that loads the same content.
+	Handles are shared pointers to the resource, the registry tracks when the last copy of a handle is released and keeps the
+	asset around, least recently used first in line for eviction once the CPU or GPU memory of the registry is over its budget.
+	Every change publishes the budget and eviction stats as Profiler counters, prefixed with the name of the registry.
+*/
+class AssetRegistry
+{
+public:
+	AssetRegistry(const std::string& name, const AssetBudget& budget = AssetBudget());
+
+	/* Returns a handle to the resident asset, or nullptr. Every call counts as a hit or a miss */
+	template<typename T>
+	std::shared_ptr<T> Find(uint64_t contentHash) { return std::static_pointer_cast<T>(FindAsset(contentHash, false)); }
+	/* Like Find, but an evicted asset is reloaded on the calling thread, which therefore needs to be able to create it */
+	template<typename T>
+	std::shared_ptr<T> Acquire(uint64_t contentHash) { return std::static_pointer_cast<T>(FindAsset(contentHash, true)); }
+	/* Returns a handle to the inserted asset, or to the asset that is already resident under the same hash.
+	   Inserting an evicted asset counts as a reload */
+	template<typename T>
+	std::shared_ptr<T> Insert(uint64_t contentHash, const AssetDesc& desc) { return std::static_pointer_cast<T>(InsertAsset(contentHash, desc)); }
+
+	void SetBudget(const AssetBudget& budget);
+	/* Forgets every asset, handles keep their resource alive until they are released */
+	void Clear();
+
+	AssetRegistryStats GetStats() const;
+
+private:
+	std::shared_ptr<void> FindAsset(uint64_t contentHash, bool reload);
+	std::shared_ptr<void> InsertAsset(uint64_t contentHash, const AssetDesc& desc);
+
+	// Shared with the handles, which release their asset to the registry for as long as it exists
+	std::shared_ptr<AssetRegistryData> m_Data;
+
+};
@@ -0,0 +1,109 @@
+#pragma once
+#include "ResourceLoader.h"
+
+// Deepest leaf of any BVH the builders produce, with the root at depth 0. The traversal stacks are sized for it
+constexpr uint32_t BVH_MAX_DEPTH = 96;
+
+/* Binary BVH node, 32 bytes so two nodes share a cache line */
+struct BVHNode
+{
+	glm::vec3 BoundsMin = glm::vec3(0.0f);
+	// Index of the left child for an inner node, the right child directly follows it. First triangle for a leaf
+	uint32_t LeftFirst = 0;
+	glm::vec3 BoundsMax = glm::vec3(0.0f);
+	// 0 for an inner node
+	uint32_t NumTriangles = 0;
+
+	bool IsLeaf() const { return NumTriangles > 0; }
+};
+
+/* Empty until it is grown by the first position */
+struct BVHBounds
+{
+	glm::vec3 Min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 Max = glm::vec3(-std::numeric_limits<float>::max());
+
+	BVHBounds() = default;
+	explicit BVHBounds(const BVHNode& node)
+		: Min(node.BoundsMin), Max(node.BoundsMax) {}
+
+	void Grow(const glm::vec3& position)
+	{
+		Min = glm::min(Min, position);
+		Max = glm::max(Max, position);
+	}
+
+	void Grow(const BVHBounds& bounds)
+	{
+		Min = glm::min(Min, bounds.Min);
+		Max = glm::max(Max, bounds.Max);
+	}
+
+	// Half of the surface area, which is all the SAH needs since only ratios of areas are compared
+	float GetHalfArea() const
+	{
+		if (Min.x > Max.x)
+			return 0.0f;
+
+		glm::vec3 extent = Max - Min;
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+};
+
+struct BVHTriangle
+{
+	glm::vec3 V0;
+	glm::vec3 V1;
+	glm::vec3 V2;
+};
+
+struct BVH
+{
+	// The root is the first node, every leaf references a range of triangles
+	std::vector<BVHNode> Nodes;
+	// Triangle positions in leaf order
+	std::vector<BVHTriangle> Triangles;
+	// Triangle of the source index stream each triangle was built from, the first index of the triangle divided by 3
+	std::vector<uint32_t> TriangleIndices;
+};
+
+struct BVHBuildDesc
+{
+	// Nodes with more triangles are always split, smaller nodes only when the split lowers their SAH cost
+	uint32_t MaxLeafSize = 4;
+	// Nodes at this depth become leaves however many triangles they hold. Nodes close to it are split in half by count, which still
+	// reaches the maximum leaf size when the depth allows it. At most BVH_MAX_DEPTH
+	uint32_t MaxDepth = 64;
+	// Candidate split planes per axis are the borders between the bins
+	uint32_t NumBins = 16;
+	// Relative costs of visiting a node and of intersecting a triangle
+	float TraversalCost = 1.0f;
+	float IntersectionCost = 1.0f;
+};
+
+struct BVHBuildStats
+{
+	std::size_t NumNodes = 0;
+	std::size_t NumLeaves = 0;
+	std::size_t NumTriangles = 0;
+	uint32_t MaxDepth = 0;
+	uint32_t MaxLeafSize = 0;
+	float AverageLeafSize = 0.0f;
+
+	// Expected cost of a ray that hits the root, every node weighted by its surface area relative to the root
+	float SAHCost = 0.0f;
+	// In milliseconds, 0 for stats that were computed from an existing BVH
+	float BuildDuration = 0.0f;
+};
+
+class BVHBuilder
+{
+public:
+	/* Build a BVH over the triangles of every submesh with a binned SAH sweep, top down. The LOD indices that follow the submeshes
+	   in the index stream are left out. The result only depends on the input */
+	static BVHBuildStats Build(const Vertex* vertices, std::size_t numVertices, const void* indices, uint32_t indexByteSize,
+		const std::vector<Submesh>& submeshes, const BVHBuildDesc& desc, BVH& bvh);
+
+	static BVHBuildStats ComputeStats(const BVH& bvh, const BVHBuildDesc& desc = BVHBuildDesc());
+
+};
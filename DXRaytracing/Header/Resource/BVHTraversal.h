@@ -0,0 +1,51 @@
+#pragma once
+#include "Resource/BVHBuilder.h"
+
+enum class BVHTraversalKernel : uint32_t
+{
+	// One ray at a time
+	BVH_TRAVERSAL_KERNEL_SCALAR,
+	// Packets of 4 rays that traverse the BVH together, with SSE
+	BVH_TRAVERSAL_KERNEL_SSE_4,
+	// Packets of 8 rays with AVX2, only available when the tracer is compiled for AVX2
+	BVH_TRAVERSAL_KERNEL_AVX2_8
+};
+
+struct BVHRay
+{
+	glm::vec3 Origin = glm::vec3(0.0f);
+	float TMin = 0.0f;
+	glm::vec3 Direction = glm::vec3(0.0f, 0.0f, 1.0f);
+	float TMax = 1e+38f;
+};
+
+struct BVHHit
+{
+	static constexpr uint32_t INVALID_TRIANGLE = ~0u;
+
+	float T = std::numeric_limits<float>::max();
+	// Weights of V1 and V2 of the triangle, the attributes a DXR hit shader receives
+	glm::vec2 Barycentrics = glm::vec2(0.0f);
+	// Triangle in leaf order, BVH::TriangleIndices maps it back to the index stream
+	uint32_t Triangle = INVALID_TRIANGLE;
+
+	bool IsHit() const { return Triangle != INVALID_TRIANGLE; }
+};
+
+class BVHTraversal
+{
+public:
+	static bool IsKernelSupported(BVHTraversalKernel kernel);
+
+	/* Closest hit of a single ray between its TMin and TMax. Triangles are intersected watertight and from both sides */
+	static bool Intersect(const BVH& bvh, const BVHRay& ray, BVHHit& hit);
+	/* Any hit of a single ray, traversal stops at the first triangle between TMin and TMax */
+	static bool IsOccluded(const BVH& bvh, const BVHRay& ray);
+
+	/* Closest hits of an array of rays. The packet kernels trace consecutive rays together, which pays off when neighbouring rays are
+	   coherent, like the primary rays of neighbouring pixels. Every kernel finds the same hits up to ties between triangles */
+	static void Intersect(const BVH& bvh, const BVHRay* rays, std::size_t numRays, BVHTraversalKernel kernel, BVHHit* hits);
+	/* Any hits of an array of rays, occluded is set to 1 for every ray that hits a triangle and to 0 otherwise */
+	static void IsOccluded(const BVH& bvh, const BVHRay* rays, std::size_t numRays, BVHTraversalKernel kernel, uint8_t* occluded);
+
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+enum class BlockCompressionFormat : uint32_t
+{
+	// 8 byte blocks, opaque RGB
+	BLOCK_COMPRESSION_FORMAT_BC1,
+	// 16 byte blocks, BC1 color with a separately interpolated alpha channel
+	BLOCK_COMPRESSION_FORMAT_BC3,
+	// 16 byte blocks, two independently interpolated channels (R and G), meant for normal maps
+	BLOCK_COMPRESSION_FORMAT_BC5,
+	// 16 byte blocks, RGBA, encoded with mode 6 only
+	BLOCK_COMPRESSION_FORMAT_BC7
+};
+
+class BlockCompression
+{
+public:
+	static uint32_t GetBlockByteSize(BlockCompressionFormat format);
+	/* Byte size of one compressed level, partial blocks on the right and bottom edge are padded to whole blocks */
+	static std::size_t GetCompressedByteSize(BlockCompressionFormat format, uint32_t width, uint32_t height);
+	/* Byte size of a compressed mip chain, levels are tightly packed from the largest to the smallest */
+	static std::size_t GetMipChainByteSize(BlockCompressionFormat format, uint32_t width, uint32_t height, uint32_t numMipLevels);
+
+	/* Compress the 4x4 block rows [firstBlockRow, firstBlockRow + numBlockRows) of one RGBA8 level into the compressed level,
+	   different block rows can be compressed on different threads. Texels outside the image are clamped to the edge */
+	static void CompressBlockRows(BlockCompressionFormat format, const unsigned char* pixels, uint32_t width, uint32_t height,
+		uint32_t firstBlockRow, uint32_t numBlockRows, unsigned char* output);
+	static void Compress(BlockCompressionFormat format, const unsigned char* pixels, uint32_t width, uint32_t height, unsigned char* output);
+	/* Decode one compressed level to RGBA8, BC5 decodes to (R, G, 0, 255) */
+	static void Decompress(BlockCompressionFormat format, const unsigned char* blocks, uint32_t width, uint32_t height, unsigned char* pixels);
+
+	/* Peak signal to noise ratio in dB over the first numChannels channels of two RGBA8 images, infinite for identical images */
+	static float MeasurePSNR(const unsigned char* reference, const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t numChannels = 4);
+
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include "ResourceLoader.h"
+
+class Buffer;
+class MemoryMappedFile;
+struct ModelData;
+
+/* Vertex or index data that is copied to its buffer in chunks through a bounded amount of upload memory */
+struct BufferUpload
+{
+	// Not used by the uploader, which only stages the data
+	std::shared_ptr<Buffer> Destination;
+	const unsigned char* Data = nullptr;
+	std::size_t ByteSize = 0;
+	std::size_t NumBytesSubmitted = 0;
+	// Chunks hold whole elements, the size of a vertex or an index
+	std::size_t ElementByteSize = 1;
+
+	// Vertices in one of the compact formats are encoded from the cooked vertices in the data as they are staged, with the quantization
+	// for VERTEX_FORMAT_QUANTIZED. Any other data is copied as is
+	VertexFormat EncodedFormat = VertexFormat::VERTEX_FORMAT_FLOAT;
+	PositionQuantization Quantization;
+
+	// Set when the data is a view of a mapped file, whose pages are released as soon as they are staged. Every release continues at
+	// the page the previous one stopped at, releasing the page a chunk ended in along with the next chunk. Releases that leave a
+	// page behind in between can keep the huge page mappings of the file cache around it resident
+	std::shared_ptr<MemoryMappedFile> MappedFile;
+	std::size_t ReleasedByteOffset = 0;
+};
+
+/* Part of an upload that is staged at an offset in the upload memory, after the previous chunks of the same upload */
+struct BufferUploadChunk
+{
+	uint32_t UploadIndex = 0;
+	std::size_t ByteSize = 0;
+	std::size_t UploadOffset = 0;
+};
+
+/*
+	Plans and stages the chunks of buffer uploads without touching the device. The resource loader copies the staged chunks to their
+	buffers, the tests stage through CPU memory to measure what a load keeps resident.
+*/
+class BufferUploader
+{
+public:
+	/* Uploads of the vertex and index buffer of a model, without a destination. Data that was read from the cooked file is staged
+	   from the mapped file */
+	static BufferUpload GetVertexBufferUpload(const ModelData& data, VertexFormat vertexFormat);
+	static BufferUpload GetIndexBufferUpload(const ModelData& data);
+
+	/* Plan the next chunks of the uploads in order, placed from uploadOffset on, as long as the upload memory that is in flight plus
+	   the planned chunks stays below maxUploadByteSize. Returns the upload offset after the last planned chunk */
+	static std::size_t PlanChunks(const std::vector<BufferUpload>& uploads, std::size_t numBytesInFlight, std::size_t uploadOffset,
+		std::size_t maxUploadByteSize, std::vector<BufferUploadChunk>& chunks);
+
+	/* Copy or encode the next numBytes of the upload into upload memory, returns the offset of the chunk in the buffer */
+	static std::size_t StageChunk(BufferUpload& upload, std::size_t numBytes, unsigned char* uploadMemory);
+
+	/* Stage every upload through one allocation of upload memory of at most maxUploadByteSize bytes, 0 stages all of them at once.
+	   copyChunk is called for every staged chunk with its offset in the buffer, and has to be done with its upload memory when it
+	   returns, since the next chunks are staged into the same memory */
+	static void StageUploads(std::vector<BufferUpload>& uploads, std::size_t maxUploadByteSize,
+		const std::function<unsigned char*(std::size_t)>& allocateUploadMemory,
+		const std::function<void(const BufferUploadChunk&, std::size_t)>& copyChunk);
+
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include "Util/MemoryMappedFile.h"
+
+class GLBContainer
+{
+public:
+	static bool IsGLB(const std::string& filepath);
+
+	/* Map a binary glTF file and locate its chunks, the chunk pointers stay valid while the container is open */
+	bool Open(const std::string& filepath);
+	void Close();
+
+	const char* GetJSON() const { return m_JSON; }
+	std::size_t GetJSONByteSize() const { return m_JSONByteSize; }
+	const unsigned char* GetBinary() const { return m_Binary; }
+	std::size_t GetBinaryByteSize() const { return m_BinaryByteSize; }
+
+private:
+	MemoryMappedFile m_File;
+
+	const char* m_JSON = nullptr;
+	std::size_t m_JSONByteSize = 0;
+	const unsigned char* m_Binary = nullptr;
+	std::size_t m_BinaryByteSize = 0;
+
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include "Resource/BVHBuilder.h"
+
+class ThreadPool;
+
+enum class MortonCodeWidth : uint32_t
+{
+	// 10 bits per axis, sorted in 4 radix passes. Triangles closer than 1/1024 of the model extent share a code
+	MORTON_CODE_WIDTH_30,
+	// 21 bits per axis, sorted in 8 radix passes
+	MORTON_CODE_WIDTH_63
+};
+
+struct LBVHBuildDesc
+{
+	MortonCodeWidth CodeWidth = MortonCodeWidth::MORTON_CODE_WIDTH_30;
+	// Subtrees with up to this many triangles are collapsed into a leaf when that lowers their SAH cost
+	uint32_t MaxLeafSize = 4;
+
+	// Restructure treelets of up to TreeletSize leaves into the topology with the lowest SAH cost, bottom up
+	bool OptimizeTreelets = false;
+	uint32_t TreeletSize = 7;
+	// Smaller subtrees are left as they are, they are many and each of them gains little
+	uint32_t MinTreeletTriangles = 16;
+
+	// Relative costs of visiting a node and of intersecting a triangle
+	float TraversalCost = 1.0f;
+	float IntersectionCost = 1.0f;
+};
+
+class LBVHBuilder
+{
+public:
+	/* Build a BVH over the triangles of every submesh from the Morton codes of their centroids, in the node format of BVHBuilder.
+	   Every stage is split into jobs on the thread pool, or runs on the calling thread without one. The result only depends on the
+	   input, not on the number of threads */
+	static BVHBuildStats Build(const Vertex* vertices, std::size_t numVertices, const void* indices, uint32_t indexByteSize,
+		const std::vector<Submesh>& submeshes, const LBVHBuildDesc& desc, ThreadPool* threadPool, BVH& bvh);
+
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include "ResourceLoader.h"
+
+struct MeshOptimizationStats
+{
+	std::size_t NumVerticesBefore = 0;
+	std::size_t NumVerticesAfter = 0;
+
+	// Mean absolute difference between consecutive indices, lower means closer vertex fetches
+	float AverageIndexDistanceBefore = 0.0f;
+	float AverageIndexDistanceAfter = 0.0f;
+};
+
+class MeshOptimizer
+{
+public:
+	/* Merge bit-identical vertices and remap the indices */
+	static void WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	/* Reorder triangles so consecutive triangles share vertices (Tipsify, Sander et al. 2007) */
+	static void OptimizeTriangleOrder(std::vector<uint32_t>& indices, std::size_t numVertices, uint32_t cacheSize = 16);
+
+	/* Reorder vertices by their first use in the index buffer, unreferenced vertices are removed */
+	static void OptimizeVertexOrder(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	static float ComputeAverageIndexDistance(const uint32_t* indices, std::size_t numIndices);
+
+	/* Weld, then reorder triangles, then reorder vertices */
+	static void Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, MeshOptimizationStats* stats = nullptr);
+
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include "ResourceLoader.h"
+
+struct MeshSimplificationDesc
+{
+	// Weights of the attribute error relative to the position error, positions are measured relative to the mesh extent
+	float TexCoordWeight = 0.5f;
+	float NormalWeight = 0.25f;
+	// Weight of the planes that keep open borders in place
+	float BorderWeight = 10.0f;
+	// No edge is collapsed above this error, relative to the mesh extent
+	float MaxError = 0.05f;
+};
+
+class MeshSimplifier
+{
+public:
+	/* Collapse edges in order of their quadric error (Garland and Heckbert 1997, with attributes after Hoppe 1999) until at most
+	   targetNumIndices are left or no collapse stays within the maximum error. Vertices are never moved, so the simplified indices
+	   reference the same vertices. Vertices on attribute seams stay in place and open borders only collapse along themselves.
+	   Returns the error of the simplified mesh in model space */
+	static float Simplify(const Vertex* vertices, std::size_t numVertices, const std::vector<uint32_t>& indices, std::size_t targetNumIndices,
+		std::vector<uint32_t>& result, const MeshSimplificationDesc& desc = MeshSimplificationDesc());
+
+};
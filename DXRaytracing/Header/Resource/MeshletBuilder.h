@@ -0,0 +1,40 @@
+#pragma once
+#include "ResourceLoader.h"
+
+struct MeshletBuildStats
+{
+	std::size_t NumMeshlets = 0;
+	std::size_t NumTriangles = 0;
+	// Vertices on the border of two meshlets are counted by both
+	std::size_t NumMeshletVertices = 0;
+
+	// Average fraction of the vertex and triangle limits a meshlet fills
+	float VertexFillRate = 0.0f;
+	float TriangleFillRate = 0.0f;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> Meshlets;
+	std::vector<uint32_t> Vertices;
+	std::vector<uint8_t> Triangles;
+};
+
+class MeshletBuilder
+{
+public:
+	/* Split a triangle list into meshlets and reorder its triangles meshlet by meshlet. Offsets of the meshlets are relative
+	   to the start of the indices and meshlet data, the result only depends on the input */
+	static void Build(const Vertex* vertices, std::size_t numVertices, std::vector<uint32_t>& indices, MeshletData& meshlets,
+		uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+	/* Bounding sphere and normal cone of a meshlet from its vertices and triangles */
+	static void ComputeBounds(const Vertex* vertices, const uint32_t* meshletVertices, const uint8_t* meshletTriangles, Meshlet& meshlet);
+
+	/* Every triangle of the meshlet faces away from the view position, so none of them can be seen from there */
+	static bool IsBackfacing(const Meshlet& meshlet, const glm::vec3& viewPosition);
+
+	static MeshletBuildStats ComputeStats(const std::vector<Meshlet>& meshlets, uint32_t maxVertices = MESHLET_MAX_VERTICES,
+		uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+};
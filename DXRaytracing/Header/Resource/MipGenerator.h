@@ -0,0 +1,39 @@
+#pragma once
+
+enum class MipFilter : uint32_t
+{
+	// 2x2 average, cheapest and softest
+	MIP_FILTER_BOX,
+	// Kaiser windowed sinc over 6x6 texels, keeps more detail in the lower mips
+	MIP_FILTER_KAISER
+};
+
+// Linear RGBA image with four floats per pixel
+struct MipImage
+{
+	std::vector<float> Pixels;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+};
+
+class MipGenerator
+{
+public:
+	/* Number of levels down to 1x1, every level is half the size of the previous one rounded down */
+	static uint32_t GetNumMipLevels(uint32_t width, uint32_t height);
+	/* Byte size of an RGBA8 mip chain, levels are tightly packed from the largest to the smallest */
+	static std::size_t GetMipChainByteSize(uint32_t width, uint32_t height, uint32_t numMipLevels);
+
+	/* Build the full mip chain of an RGBA8 image into output, mip 0 is copied as is.
+	   With sRGB set the color channels are filtered in linear space, alpha is always filtered as is */
+	static void GenerateMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, MipFilter filter, bool sRGB, unsigned char* output);
+
+	/* Halve the image with the given filter, samples outside the image are clamped to the edge */
+	static void Downsample(const MipImage& source, MipFilter filter, MipImage& output);
+	/* Reference implementation without SIMD */
+	static void DownsampleScalar(const MipImage& source, MipFilter filter, MipImage& output);
+
+	static void DecodeRGBA8(const unsigned char* pixels, uint32_t width, uint32_t height, bool sRGB, MipImage& output);
+	static void EncodeRGBA8(const MipImage& image, bool sRGB, unsigned char* output);
+
+};
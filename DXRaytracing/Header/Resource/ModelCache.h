@@ -0,0 +1,94 @@
+#pragma once
+#include "ResourceLoader.h"
+#include "Resource/BlockCompression.h"
+
+class MemoryMappedFile;
+
+enum class CookFlags : uint32_t
+{
+	COOK_FLAGS_NONE = 0,
+	COOK_FLAGS_OPTIMIZED_MESHES = (1 << 0),
+	COOK_FLAGS_MESHLETS = (1 << 1),
+	COOK_FLAGS_LODS = (1 << 2)
+};
+
+inline bool operator&(CookFlags lhs, CookFlags rhs)
+{
+	return static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs);
+}
+
+inline CookFlags operator|(CookFlags lhs, CookFlags rhs)
+{
+	return static_cast<CookFlags>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+}
+
+struct CookedMaterial
+{
+	int32_t BaseColorImage = -1;
+	int32_t NormalImage = -1;
+};
+
+struct CookedModelData
+{
+	const Vertex* Vertices = nullptr;
+	std::size_t NumVertices = 0;
+	// 16-bit indices when every index fits, 32-bit otherwise
+	const void* Indices = nullptr;
+	std::size_t NumIndices = 0;
+	uint32_t IndexByteSize = sizeof(uint32_t);
+
+	std::vector<Submesh> Submeshes;
+	std::vector<SubmeshLOD> LODs;
+	std::vector<CookedMaterial> Materials;
+
+	std::vector<Meshlet> Meshlets;
+	std::vector<uint32_t> MeshletVertices;
+	std::vector<uint8_t> MeshletTriangles;
+	std::vector<std::string> ImageURIs;
+
+	// Load options that changed the cooked data, a cooked model is only reused with the same options
+	CookFlags Flags = CookFlags::COOK_FLAGS_NONE;
+
+	// Source files the cooked data was built from, relative to the model directory
+	std::vector<std::string> Dependencies;
+	uint64_t SourceHash = 0;
+
+	// Keeps the vertex and index views valid when the data was read from a cooked file
+	std::shared_ptr<MemoryMappedFile> MappedFile;
+};
+
+struct CookedTextureData
+{
+	BlockCompressionFormat Format = BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t NumMipLevels = 1;
+
+	// Every mip level, tightly packed from the largest to the smallest
+	const unsigned char* Data = nullptr;
+	std::size_t ByteSize = 0;
+
+	// Keeps the data valid when the texture was read from a cooked file
+	std::shared_ptr<MemoryMappedFile> MappedFile;
+};
+
+class ModelCache
+{
+public:
+	static std::string GetCookedFilepath(const std::string& sourceFilepath);
+	static std::string GetDirectory(const std::string& filepath);
+	static bool ComputeSourceHash(const std::string& directory, const std::vector<std::string>& dependencies, uint64_t& hash);
+
+	/* Write the final vertex/index streams, meshlets, submesh, LOD and material tables next to the source model */
+	static bool Write(const std::string& cookedFilepath, const CookedModelData& data);
+
+	/* Map a cooked model, fails if the file is missing, malformed, from another version or out of date with its sources */
+	static bool Read(const std::string& cookedFilepath, CookedModelData& data);
+
+	/* Cooked textures are named after the hash of their source image combined with the options they were built with */
+	static std::string GetCookedTextureFilepath(const std::string& directory, uint64_t sourceHash);
+	static bool WriteTexture(const std::string& cookedFilepath, uint64_t sourceHash, const CookedTextureData& data);
+	/* Map a cooked texture, fails if the file is missing, malformed, from another version or built from another source */
+	static bool ReadTexture(const std::string& cookedFilepath, uint64_t sourceHash, CookedTextureData& data);
+
+};
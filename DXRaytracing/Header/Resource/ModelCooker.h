@@ -0,0 +1,71 @@
+#pragma once
+#include "ResourceLoader.h"
+#include "Resource/ModelCache.h"
+#include "Graphics/TextureFormat.h"
+
+struct ImageData
+{
+	const unsigned char* Pixels = nullptr;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t NumMipLevels = 1;
+	// RGBA8 or one of the block compressed formats
+	TextureFormat Format = TextureFormat::TEXTURE_FORMAT_RGBA8_UNORM;
+
+	// Owns the pixels, which are either decoded, generated or mapped from a cooked texture
+	std::shared_ptr<const void> Storage;
+};
+
+struct ModelTextureData
+{
+	// Shared with a loaded model through the texture cache, or created from the image
+	std::shared_ptr<Texture> Resource;
+	ImageData Image;
+
+	bool IsCacheable = false;
+	uint64_t ContentHash = 0;
+	// Texture with the same content and a lower index, which this one shares, -1 if it has its own
+	int32_t DuplicateOf = -1;
+};
+
+/*
+	Everything a model is created from. It is built without touching the device, so the parse, decode and cook stages can run on
+	any thread, and only the creation of its GPU resources has to run on the render thread.
+*/
+struct ModelData
+{
+	CookedModelData Cooked;
+	// Own the cooked vertices and indices of a model that was not read from its cooked file
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned char> Indices;
+
+	// Bounds the positions are quantized to for VERTEX_FORMAT_QUANTIZED, the vertices are encoded from the cooked ones as they are uploaded
+	PositionQuantization VertexQuantization;
+
+	std::vector<Material> Materials;
+	std::vector<ModelTextureData> Textures;
+	std::vector<StreamedTexture> StreamedTextures;
+};
+
+struct ModelCookCallbacks
+{
+	// Returns a live texture built from the same content hash, which the model shares instead of building the image again
+	std::function<std::shared_ptr<Texture>(uint64_t)> FindTexture;
+	// Called on the cooking thread for every texture whose image is ready, duplicates right after the texture they share
+	std::function<void(uint32_t)> OnTextureBuilt;
+};
+
+class ModelCooker
+{
+public:
+	/* Run the parse, assembly, decode and cook stages of a load without touching the device. An up to date cooked model is read
+	   instead, otherwise the cooked model and textures are written next to the source. Returns false if the model could not be
+	   parsed or the load was cancelled */
+	static bool Cook(const std::string& filepath, const ModelLoadDesc& loadDesc, const std::atomic_bool* isCancelled,
+		const ModelCookCallbacks& callbacks, ModelData& data);
+
+	/* Read back the cooked texture a load with texture compression wrote for the content hash of a texture, the image is a view
+	   of the mapped file */
+	static bool LoadCookedTexture(const std::string& directory, uint64_t contentHash, ImageData& image);
+
+};
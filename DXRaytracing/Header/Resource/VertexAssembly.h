@@ -0,0 +1,81 @@
+#pragma once
+#include "ResourceLoader.h"
+
+enum class VertexComponentType : uint32_t
+{
+	VERTEX_COMPONENT_TYPE_FLOAT,
+	VERTEX_COMPONENT_TYPE_INT8,
+	VERTEX_COMPONENT_TYPE_UINT8,
+	VERTEX_COMPONENT_TYPE_INT16,
+	VERTEX_COMPONENT_TYPE_UINT16,
+	VERTEX_COMPONENT_TYPE_UINT32
+};
+
+struct SparseAttributeValues
+{
+	// Strictly increasing vertex indices of the elements that are replaced
+	const unsigned char* Indices = nullptr;
+	VertexComponentType IndexComponentType = VertexComponentType::VERTEX_COMPONENT_TYPE_UINT32;
+	// Tightly packed elements with the component type of the stream they replace
+	const unsigned char* Values = nullptr;
+	std::size_t NumValues = 0;
+};
+
+struct VertexAttributeStream
+{
+	// Null for sparse accessors without a buffer view, whose elements are zero apart from the sparse values
+	const unsigned char* Data = nullptr;
+	std::size_t ByteStride = 0;
+
+	VertexComponentType ComponentType = VertexComponentType::VERTEX_COMPONENT_TYPE_FLOAT;
+	// Integer components are mapped to [0, 1] or [-1, 1] instead of being converted as is
+	bool Normalized = false;
+
+	// Written over the elements from Data, the source data itself is never modified or expanded
+	SparseAttributeValues Sparse;
+};
+
+struct VertexStreams
+{
+	VertexAttributeStream Position;
+	VertexAttributeStream TexCoord;
+	VertexAttributeStream Normal;
+
+	std::size_t NumVertices = 0;
+};
+
+struct IndexStream
+{
+	const unsigned char* Data = nullptr;
+	// Only the unsigned integer types are valid for indices
+	VertexComponentType ComponentType = VertexComponentType::VERTEX_COMPONENT_TYPE_UINT32;
+
+	std::size_t NumIndices = 0;
+};
+
+struct VertexBounds
+{
+	glm::vec3 Min = glm::vec3(0.0f);
+	glm::vec3 Max = glm::vec3(0.0f);
+	glm::vec3 SphereCenter = glm::vec3(0.0f);
+	float SphereRadius = 0.0f;
+};
+
+class VertexAssembly
+{
+public:
+	/* Interleave the attribute streams into output, which must have room for NumVertices vertices */
+	static void Assemble(const VertexStreams& streams, Vertex* output);
+
+	/* Reference implementation without SIMD, handles every component type */
+	static void AssembleScalar(const VertexStreams& streams, Vertex* output);
+
+	/* Widen or narrow the indices to outputIndexByteSize (2 or 4) bytes, adding baseVertex to every index */
+	static void AssembleIndices(const IndexStream& stream, uint32_t baseVertex, uint32_t outputIndexByteSize, void* output);
+
+	/* Bounding box of the assembled positions and the sphere around its center through the farthest vertex, 4 vertices at a time.
+	   With the min and max of the position accessor the sphere is centered on that box instead, so both take a single pass.
+	   Returns false if the box of the positions does not match the accessor bounds, the bounds are then computed from the positions alone */
+	static bool ComputeBounds(const Vertex* vertices, std::size_t numVertices, const VertexBounds* accessorBounds, VertexBounds& bounds);
+
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include "ResourceLoader.h"
+
+#include <glm/glm/gtc/packing.hpp>
+
+namespace VertexCompressionShared
+{
+	// Map the HLSL types and intrinsics used by the shared shader code onto glm
+	using glm::float2;
+	using glm::float3;
+	using glm::uint;
+	using uint2 = glm::uvec2;
+
+	inline uint f32tof16(float value) { return glm::packHalf1x16(value); }
+	inline float f16tof32(uint value) { return glm::unpackHalf1x16(static_cast<uint16_t>(value)); }
+
+#include "../../Resources/Shaders/Shared/VertexCompression.hlsli"
+}
+
+using VertexCompressionShared::CompactVertex;
+using VertexCompressionShared::QuantizedVertex;
+
+struct VertexCompressionError
+{
+	// Largest absolute difference on any axis
+	float MaxPositionError = 0.0f;
+	// Largest angle in radians between the original and decoded normal
+	float MaxNormalAngle = 0.0f;
+	// Largest difference on any axis relative to max(1, |texcoord|)
+	float MaxTexCoordError = 0.0f;
+};
+
+class VertexCompression
+{
+public:
+	static std::size_t GetVertexByteSize(VertexFormat format);
+
+	/* Bounds of all vertex positions, used to quantize positions for VERTEX_FORMAT_QUANTIZED */
+	static PositionQuantization ComputePositionQuantization(const Vertex* vertices, std::size_t numVertices);
+	/* Same from bounds that were gathered elsewhere, like over the chunks of a mapped vertex buffer */
+	static PositionQuantization ComputePositionQuantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	/* Encode the vertices into output, which must have room for numVertices vertices of the given format */
+	static void Compress(const Vertex* vertices, std::size_t numVertices, VertexFormat format, const PositionQuantization& quantization, void* output);
+	static void Decompress(const void* compressed, std::size_t numVertices, VertexFormat format, const PositionQuantization& quantization, Vertex* output);
+
+	/* Largest errors the encoding of a format may introduce, MeasureError stays within these for unit length normals */
+	static VertexCompressionError GetErrorBounds(VertexFormat format, const PositionQuantization& quantization);
+	static VertexCompressionError MeasureError(const Vertex* vertices, std::size_t numVertices, const void* compressed, VertexFormat format,
+		const PositionQuantization& quantization);
+
+};
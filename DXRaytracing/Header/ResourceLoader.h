@@ -1,18 +1,235 @@
 #pragma once
+#include "Resource/MipGenerator.h"
+#include "Resource/AssetRegistry.h"
 
 class Buffer;
 class Texture;
 
+struct Vertex
+{
+	glm::vec3 Position;
+	glm::vec2 TexCoord;
+	glm::vec3 Normal;
+};
+
+enum class VertexFormat : uint32_t
+{
+	// 32 byte Vertex at full precision
+	VERTEX_FORMAT_FLOAT,
+	// 20 byte CompactVertex with half precision texture coordinates and octahedral normals
+	VERTEX_FORMAT_COMPACT,
+	// 16 byte QuantizedVertex, like VERTEX_FORMAT_COMPACT but with positions quantized within the model bounds
+	VERTEX_FORMAT_QUANTIZED
+};
+
+struct PositionQuantization
+{
+	glm::vec3 Min = glm::vec3(0.0f);
+	// Never zero on any axis, so flat models still quantize
+	glm::vec3 Extent = glm::vec3(1.0f);
+};
+
+struct Submesh
+{
+	uint32_t IndexOffset = 0;
+	uint32_t NumIndices = 0;
+	// Indices are already rebased onto the model vertex buffer, the vertex range is where they point into
+	uint32_t VertexOffset = 0;
+	uint32_t NumVertices = 0;
+
+	uint32_t MaterialIndex = 0;
+	// 0.5 * log2(texture coordinate area / model space area) over all triangles, selects the texture mip level with ray cones
+	float TexCoordDensity = 0.0f;
+
+	// Range in Model::Meshlets, empty when the model was loaded without meshlets
+	uint32_t MeshletOffset = 0;
+	uint32_t NumMeshlets = 0;
+
+	// Range in Model::LODs, from the most to the least detailed simplification of the submesh
+	uint32_t LODOffset = 0;
+	uint32_t NumLODs = 0;
+
+	// Bounds of the submesh vertices in model space. The sphere is centered on the box and reaches the farthest vertex, so it is
+	// never larger than the sphere around the box
+	glm::vec3 BoundsMin = glm::vec3(0.0f);
+	glm::vec3 BoundsMax = glm::vec3(0.0f);
+	glm::vec3 BoundingSphereCenter = glm::vec3(0.0f);
+	float BoundingSphereRadius = 0.0f;
+};
+
+// Levels of detail per submesh, every level has at most half the triangles of the previous one
+constexpr uint32_t MAX_SUBMESH_LODS = 4;
+
+struct SubmeshLOD
+{
+	// Range in the model index buffer after the indices of all submeshes, indexing the same vertices as the submesh
+	uint32_t IndexOffset = 0;
+	uint32_t NumIndices = 0;
+	// Simplification error in model space, including the weighted attribute error, selects the level by its projected size
+	float Error = 0.0f;
+};
+
+// Size limits of every meshlet, meshlet triangles index their vertices with a byte so there can be at most 256 vertices
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+/*
+	A cluster of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles of one submesh.
+	The triangles of a meshlet are contiguous in the index buffer, so a meshlet is also a range of its submesh.
+*/
+struct Meshlet
+{
+	// Range in Model::MeshletVertices, which holds indices into the model vertex buffer
+	uint32_t VertexOffset = 0;
+	uint32_t NumVertices = 0;
+	// Range in Model::MeshletTriangles starting at TriangleOffset, three bytes per triangle that index the meshlet vertices
+	uint32_t TriangleOffset = 0;
+	uint32_t NumTriangles = 0;
+	// First index of the meshlet in the model index buffer
+	uint32_t IndexOffset = 0;
+
+	// Bounding sphere in model space
+	glm::vec3 Center = glm::vec3(0.0f);
+	float Radius = 0.0f;
+	// Every triangle normal lies within the cone around the axis, the cutoff is the sine of the cone half angle and 1 for
+	// meshlets that can never be culled as a whole
+	glm::vec3 ConeAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	float ConeCutoff = 1.0f;
+};
+
+struct Material
+{
+	// Index into Model::Textures, materials without a base color texture use a white texture
+	uint32_t BaseColorTexture = 0;
+};
+
+struct StreamedTexture
+{
+	// Index into Model::Textures, the texture is created without data and its mips are uploaded by the renderer
+	uint32_t TextureIndex = 0;
+	// Every mip from the largest to the smallest, tightly packed and kept alive by the storage
+	const void* MipData = nullptr;
+	std::shared_ptr<const void> Storage;
+};
+
 struct Model
 {
+	VertexFormat VertexBufferFormat = VertexFormat::VERTEX_FORMAT_FLOAT;
+	// Maps quantized positions in [0, 1] back to model space, only used by VERTEX_FORMAT_QUANTIZED
+	PositionQuantization VertexQuantization;
+
 	std::shared_ptr<Buffer> VertexBuffer;
 	std::shared_ptr<Buffer> IndexBuffer;
+
+	// One submesh per GLTF primitive, every submesh references one of the materials
+	std::vector<Submesh> Submeshes;
+	std::vector<Material> Materials;
 	std::vector<std::shared_ptr<Texture>> Textures;
+
+	std::vector<SubmeshLOD> LODs;
+
+	// CPU copy of the meshlets of every submesh, for culling and cluster based geometry
+	std::vector<Meshlet> Meshlets;
+	std::vector<uint32_t> MeshletVertices;
+	std::vector<uint8_t> MeshletTriangles;
+	// Only filled when textures are streamed, one entry per texture that still has to be uploaded
+	std::vector<StreamedTexture> StreamedTextures;
+};
+
+enum class TextureCompression : uint32_t
+{
+	// Textures are uploaded as RGBA8
+	TEXTURE_COMPRESSION_NONE,
+	// BC1 for opaque images and BC3 for images with alpha, 8x and 4x smaller than RGBA8 and the fastest to encode
+	TEXTURE_COMPRESSION_BC1_BC3,
+	// BC7 for every image, 4x smaller than RGBA8 at a higher quality than BC1
+	TEXTURE_COMPRESSION_BC7
+};
+
+struct ModelLoadDesc
+{
+	// Decode images on a worker pool instead of serially on the loading thread
+	bool ParallelImageDecode = true;
+	// Assemble the vertices and indices of each primitive on a worker pool
+	bool ParallelVertexAssembly = true;
+	// Weld duplicate vertices and reorder triangles and vertices of each primitive for fetch locality
+	bool OptimizeMeshes = false;
+	// Split every submesh into meshlets and reorder its triangles meshlet by meshlet. Nothing renders from meshlets yet, so only the
+	// asset cooker builds them, loads that do not ask for them still read its cooked models
+	bool BuildMeshlets = false;
+	// Simplify every submesh into a chain of levels of detail, appended to the index buffer. Nothing selects a level of detail yet,
+	// so like the meshlets they are only built by the asset cooker
+	bool GenerateLODs = false;
+	// Layout of the vertex buffer, the compact formats are encoded on upload and the cooked model stays at full precision
+	VertexFormat VertexBufferFormat = VertexFormat::VERTEX_FORMAT_FLOAT;
+	// Generate the full mip chain of every texture on the decode workers, filtered in linear space
+	bool GenerateMips = true;
+	MipFilter MipGenerationFilter = MipFilter::MIP_FILTER_KAISER;
+	// Block compress textures across the worker pool, compressed textures are cooked next to the model and only encoded once
+	TextureCompression TextureCompressionMode = TextureCompression::TEXTURE_COMPRESSION_BC7;
+	// Create textures without uploading them and leave their mips in Model::StreamedTextures, so loading does not wait on the copy queue
+	bool StreamTextures = false;
+	// Upload memory the vertex and index buffers are copied through, in chunks of at most this size. 0 copies each buffer at once
+	std::size_t MaxUploadByteSize = 64 * 1024 * 1024;
+	// Number of worker threads, 0 uses the number of hardware threads
+	uint32_t NumWorkerThreads = 0;
+};
+
+enum class ModelLoadStatus : uint32_t
+{
+	// Waiting for the loader thread, which starts the pending load with the highest priority first
+	MODEL_LOAD_STATUS_PENDING,
+	// Parsed, decoded and cooked on the loader thread and its worker pool
+	MODEL_LOAD_STATUS_LOADING,
+	// The GPU resources are created and their uploads are in flight on the copy queue
+	MODEL_LOAD_STATUS_UPLOADING,
+	MODEL_LOAD_STATUS_LOADED,
+	MODEL_LOAD_STATUS_CANCELLED,
+	MODEL_LOAD_STATUS_FAILED
+};
+
+struct ModelLoadRequest;
+
+/* Refers to an asynchronous load, copies of a handle refer to the same load */
+class ModelLoadHandle
+{
+public:
+	ModelLoadStatus GetStatus() const;
+	/* The load is loaded, cancelled or failed, and its future is ready */
+	bool IsDone() const;
+
+	/* A pending load is dropped right away, a running load stops after its current stage and never publishes its model */
+	void Cancel();
+	/* Higher priorities are loaded and uploaded first, running stages keep going */
+	void SetPriority(int32_t priority);
+
+	/* Becomes ready on the thread that calls ResourceLoader::Update, which therefore must never wait on it. Cancelled and failed
+	   loads get an empty model */
+	std::shared_future<Model> GetFuture() const;
+
+private:
+	friend class ResourceLoader;
+	std::shared_ptr<ModelLoadRequest> m_Request;
+
 };
 
 class ResourceLoader
 {
 public:
-	static Model LoadGLTF(const std::string& filepath);
+	static Model LoadGLTF(const std::string& filepath, const ModelLoadDesc& loadDesc = ModelLoadDesc());
+	/* Load on the loader thread instead of blocking, the GPU resources are created by Update and the model is published
+	   once their uploads completed */
+	static ModelLoadHandle LoadGLTFAsync(const std::string& filepath, const ModelLoadDesc& loadDesc = ModelLoadDesc(), int32_t priority = 0);
+
+	/* Create the GPU resources of loads that finished their CPU stages and publish loads whose uploads completed,
+	   call once per frame from the render thread */
+	static void Update();
+	/* Cancel every load, stop the loader thread and release the unreferenced assets, before the render backend is finalized */
+	static void Finalize();
+
+	/* Textures with identical source images and buffers with identical content are shared between all loaded models, and kept
+	   around after the last model using them is released for as long as they fit the budget */
+	static void SetAssetBudget(const AssetBudget& budget);
+	static AssetRegistryStats GetAssetRegistryStats();
 
 };
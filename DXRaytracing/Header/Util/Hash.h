@@ -0,0 +1,18 @@
+#pragma once
+
+class Hash
+{
+public:
+	/* 64-bit xxHash (XXH64) of a block of memory */
+	static uint64_t Hash64(const void* data, std::size_t byteSize, uint64_t seed = 0);
+
+	/* Hash the entire contents of a file, returns false if the file could not be opened */
+	static bool HashFile(const std::string& filepath, uint64_t& hash);
+
+	/* Mix a value into an existing hash, order dependent */
+	static inline uint64_t Combine(uint64_t hash, uint64_t value)
+	{
+		return hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2));
+	}
+
+};
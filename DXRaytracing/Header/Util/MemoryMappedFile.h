@@ -0,0 +1,34 @@
+#pragma once
+
+class MemoryMappedFile
+{
+public:
+	MemoryMappedFile() = default;
+	~MemoryMappedFile();
+
+	MemoryMappedFile(const MemoryMappedFile& other) = delete;
+	MemoryMappedFile& operator=(const MemoryMappedFile& other) = delete;
+
+	/* Map an entire file read-only into the address space */
+	bool Open(const std::string& filepath);
+	void Close();
+
+	/* Drop the pages of a byte range from the working set, they are read from the file again when they are accessed */
+	void ReleasePages(std::size_t byteOffset, std::size_t byteSize) const;
+	/* Granularity of the pages that are released */
+	static std::size_t GetPageSize();
+
+	bool IsOpen() const { return m_Data != nullptr; }
+	const unsigned char* GetData() const { return m_Data; }
+	std::size_t GetSize() const { return m_Size; }
+
+private:
+#ifdef _WIN32
+	HANDLE m_FileHandle = INVALID_HANDLE_VALUE;
+	HANDLE m_MappingHandle = nullptr;
+#endif
+
+	const unsigned char* m_Data = nullptr;
+	std::size_t m_Size = 0;
+
+};
@@ -3,7 +3,7 @@
 
 struct TimerResult
 {
-	const char* Name;
+	std::string Name;
 	float Duration;
 };
 
@@ -12,26 +12,34 @@ class Profiler
 public:
 	static Profiler& Get();
 
+	/* Thread-safe, results with the same name are accumulated */
 	void AddTimerResult(const TimerResult& result);
+	/* Thread-safe, counters keep the last value they were set to and are not cleared by Reset */
+	void SetCounter(const std::string& name, uint64_t value);
 	void Reset();
 
-	const std::unordered_map<const char*, TimerResult>& GetTimerResults() const { return m_TimerResults; }
+	/* Returns a copy, timers stop on any thread at any time */
+	std::unordered_map<std::string, TimerResult> GetTimerResults();
+	/* Returns a copy, counters are set from any thread at any time */
+	std::unordered_map<std::string, uint64_t> GetCounters();
 
 private:
-	std::unordered_map<const char*, TimerResult> m_TimerResults;
+	std::unordered_map<std::string, TimerResult> m_TimerResults;
+	std::unordered_map<std::string, uint64_t> m_Counters;
+	std::mutex m_Mutex;
 
 };
 
 class Timer
 {
 public:
-	Timer(const char* name);
+	Timer(const std::string& name);
 	~Timer();
 
 	void Stop();
 
 private:
-	const char* m_Name;
+	std::string m_Name;
 	std::chrono::time_point<std::chrono::steady_clock> m_StartTime;
 	bool m_IsStopped;
 
@@ -0,0 +1,32 @@
+#pragma once
+
+class ThreadPool
+{
+public:
+	/* Creates a pool with numThreads workers, 0 uses the number of hardware threads */
+	ThreadPool(uint32_t numThreads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool& other) = delete;
+	ThreadPool& operator=(const ThreadPool& other) = delete;
+
+	void Submit(std::function<void()> job);
+	void WaitIdle();
+
+	uint32_t GetNumThreads() const { return static_cast<uint32_t>(m_Threads.size()); }
+
+private:
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread> m_Threads;
+	std::queue<std::function<void()>> m_Jobs;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_JobAvailableCV;
+	std::condition_variable m_IdleCV;
+
+	uint32_t m_NumActiveJobs = 0;
+	bool m_Stop = false;
+
+};
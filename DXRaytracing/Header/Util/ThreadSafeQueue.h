@@ -8,8 +8,23 @@ public:
 
 	void Push(T value)
 	{
-		std::lock_guard<std::mutex> lock(m_QueueMutex);
-		m_InternalQueue.push(value);
+		{
+			std::lock_guard<std::mutex> lock(m_QueueMutex);
+			m_InternalQueue.push(value);
+		}
+
+		m_ValueAvailableCV.notify_one();
+	}
+
+	/* Blocks until a value is pushed when the queue is empty */
+	T Pop()
+	{
+		std::unique_lock<std::mutex> lock(m_QueueMutex);
+		m_ValueAvailableCV.wait(lock, [this]() { return !m_InternalQueue.empty(); });
+
+		T value = m_InternalQueue.front();
+		m_InternalQueue.pop();
+		return value;
 	}
 
 	bool TryPop(T& value)
@@ -38,5 +53,6 @@ public:
 private:
 	std::queue<T> m_InternalQueue;
 	mutable std::mutex m_QueueMutex;
+	std::condition_variable m_ValueAvailableCV;
 
 };
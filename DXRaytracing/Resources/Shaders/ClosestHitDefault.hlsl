@@ -1,3 +1,12 @@
+#include "Shared/VertexCompression.hlsli"
+
+cbuffer ViewCB : register(b0)
+{
+	matrix ViewProjAtOrigin;
+	float4 ViewOriginAndTanHalfFovY;
+	float2 Resolution;
+};
+
 struct DefaultRayPayload
 {
 	float3 Color;
@@ -10,14 +19,63 @@ struct Vertex
 	float3 Normal;
 };
 
+// The vertex layout is selected with VERTEX_FORMAT_COMPACT or VERTEX_FORMAT_QUANTIZED, matching the loaded model
+#if defined(VERTEX_FORMAT_QUANTIZED)
+StructuredBuffer<QuantizedVertex> vertexBuffer : register(t0, space1);
+#elif defined(VERTEX_FORMAT_COMPACT)
+StructuredBuffer<CompactVertex> vertexBuffer : register(t0, space1);
+#else
 StructuredBuffer<Vertex> vertexBuffer : register(t0, space1);
-StructuredBuffer<uint> indexBuffer : register(t0, space2);
-Texture2D baseColorTexture : register(t0, space3);
+#endif
+// Typed view, either R16_UINT or R32_UINT depending on the index size of the model
+Buffer<uint> indexBuffer : register(t0, space2);
+// Every texture SRV of the descriptor heap, indexed by its offset in the heap
+Texture2D textures[] : register(t0, space3);
+SamplerState linearWrapSampler : register(s0);
+// Most detailed resident mip of every streamed texture, finer mips are still being uploaded and must not be sampled
+StructuredBuffer<uint> textureResidentMips : register(t0, space4);
+
+// Hit group record constants of the submesh, every submesh is a separate geometry of the BLAS
+struct SubmeshConstants
+{
+	uint IndexOffset;
+	uint BaseColorTextureIndex;
+	// 0.5 * log2(texture coordinate area / model space area) of the submesh
+	float TexCoordDensity;
+	uint BaseColorResidencyIndex;
+};
+
+ConstantBuffer<SubmeshConstants> submesh : register(b0, space1);
 
 uint3 GetIndices(uint triangleIndex)
 {
-	uint baseIndex = (triangleIndex * 3);
-	return uint3(indexBuffer.Load(baseIndex), indexBuffer.Load(baseIndex + 1), indexBuffer.Load(baseIndex + 2));
+	// PrimitiveIndex() restarts at 0 for every geometry
+	uint baseIndex = submesh.IndexOffset + (triangleIndex * 3);
+	return uint3(indexBuffer[baseIndex], indexBuffer[baseIndex + 1], indexBuffer[baseIndex + 2]);
+}
+
+Vertex LoadVertex(uint index)
+{
+#if defined(VERTEX_FORMAT_QUANTIZED)
+	// Positions are not fetched, the hit position is reconstructed from the ray instead
+	QuantizedVertex packed = vertexBuffer[index];
+
+	Vertex vertex;
+	vertex.Position = float3(0.0f, 0.0f, 0.0f);
+	vertex.TexCoord = DecodeHalf2(packed.TexCoord);
+	vertex.Normal = DecodeOctahedralNormal(packed.Normal);
+	return vertex;
+#elif defined(VERTEX_FORMAT_COMPACT)
+	CompactVertex packed = vertexBuffer[index];
+
+	Vertex vertex;
+	vertex.Position = packed.Position;
+	vertex.TexCoord = DecodeHalf2(packed.TexCoord);
+	vertex.Normal = DecodeOctahedralNormal(packed.Normal);
+	return vertex;
+#else
+	return vertexBuffer.Load(index);
+#endif
 }
 
 [shader("closesthit")]
@@ -34,16 +92,28 @@ void main(inout DefaultRayPayload payload, BuiltInTriangleIntersectionAttributes
 
 	for (uint i = 0; i < 3; i++)
 	{
-		Vertex loadedVertex = vertexBuffer.Load(indices[i]);
+		Vertex loadedVertex = LoadVertex(indices[i]);
 		vertex.Position += loadedVertex.Position * weights[i];
 		vertex.TexCoord += loadedVertex.TexCoord * weights[i];
 		vertex.Normal += loadedVertex.Normal * weights[i];
 	}
+
+#if defined(VERTEX_FORMAT_QUANTIZED)
+	vertex.Position = ObjectRayOrigin() + ObjectRayDirection() * RayTCurrent();
+#endif
 	
-	// Mod the frag coord to imitate wrapping behaviour of samplers
-	vertex.TexCoord = fmod(vertex.TexCoord, 1.0f);
+	Texture2D baseColorTexture = textures[NonUniformResourceIndex(submesh.BaseColorTextureIndex)];
+
+	uint width, height;
+	baseColorTexture.GetDimensions(width, height);
+
+	// Ray cone mip selection, primary rays start with a zero width cone that widens by one pixel angle per unit distance
+	float spreadAngle = atan(2.0f * ViewOriginAndTanHalfFovY.w / Resolution.y);
+	float coneWidth = spreadAngle * RayTCurrent();
+	float cosHitAngle = max(abs(dot(normalize(vertex.Normal), normalize(ObjectRayDirection()))), 1e-3f);
+	float lod = submesh.TexCoordDensity + 0.5f * log2(float(width * height)) + log2(coneWidth / cosHitAngle);
 
-	int2 coord = floor(vertex.TexCoord * 2048);
-	float3 color = baseColorTexture.Load(int3(coord, 0)).rgb;
+	float residentMip = float(textureResidentMips[submesh.BaseColorResidencyIndex]);
+	float3 color = baseColorTexture.SampleLevel(linearWrapSampler, vertex.TexCoord, max(lod, residentMip)).rgb;
 	payload.Color = color;
 }
@@ -34,8 +34,9 @@ void main()
 
 	DefaultRayPayload payload = { float3(0.0f, 0.0f, 0.0f) };
 	
+	// Every geometry of the BLAS has its own hit group record
 	TraceRay(SceneBVH, RAY_FLAG_NONE, 0xFF,
-		0, 0, 0, ray, payload);
+		0, 1, 0, ray, payload);
 	
 	output[pixelIndex] = float4(payload.Color, 1.0f);
 
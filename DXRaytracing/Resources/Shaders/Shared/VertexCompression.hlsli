@@ -0,0 +1,94 @@
+#ifndef VERTEX_COMPRESSION_HLSLI
+#define VERTEX_COMPRESSION_HLSLI
+
+/*
+
+	Vertex encode and decode functions shared by the CPU loader and the shaders.
+	Only the subset of HLSL that also compiles as C++ on top of glm is used here,
+	see Header/Resource/VertexCompression.h for the C++ side.
+
+*/
+
+// 20 bytes: full precision position, half precision texture coordinate, octahedral normal
+struct CompactVertex
+{
+	float3 Position;
+	uint TexCoord;
+	uint Normal;
+};
+
+// 16 bytes: position quantized to 16 bits per axis within the model bounds, otherwise the same as CompactVertex
+struct QuantizedVertex
+{
+	uint2 Position;
+	uint TexCoord;
+	uint Normal;
+};
+
+inline float2 SignNotZero(float2 v)
+{
+	return float2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// Folds the lower hemisphere of the octahedron over the upper one
+inline float2 OctahedronWrap(float2 v)
+{
+	return (float2(1.0f, 1.0f) - abs(float2(v.y, v.x))) * SignNotZero(v);
+}
+
+// Two snorm16 components of the octahedral projection of the normal
+inline uint EncodeOctahedralNormal(float3 normal)
+{
+	float3 absNormal = abs(normal);
+	float sum = absNormal.x + absNormal.y + absNormal.z;
+	float3 n = sum > 0.0f ? normal / sum : float3(0.0f, 0.0f, 1.0f);
+
+	float2 p = float2(n.x, n.y);
+	if (n.z < 0.0f)
+		p = OctahedronWrap(p);
+
+	float2 q = round(clamp(p, float2(-1.0f, -1.0f), float2(1.0f, 1.0f)) * 32767.0f);
+	return (uint(int(q.x)) & 0xFFFF) | (uint(int(q.y)) << 16);
+}
+
+inline float3 DecodeOctahedralNormal(uint packed)
+{
+	// Sign extend both 16 bit components
+	float2 p = float2(float(int(packed << 16) >> 16), float(int(packed) >> 16)) / 32767.0f;
+	float2 absP = abs(p);
+	float3 n = float3(p.x, p.y, 1.0f - absP.x - absP.y);
+
+	if (n.z < 0.0f)
+	{
+		float2 wrapped = OctahedronWrap(p);
+		n.x = wrapped.x;
+		n.y = wrapped.y;
+	}
+
+	return normalize(n);
+}
+
+inline uint EncodeHalf2(float2 v)
+{
+	return f32tof16(v.x) | (f32tof16(v.y) << 16);
+}
+
+inline float2 DecodeHalf2(uint packed)
+{
+	return float2(f16tof32(packed & 0xFFFF), f16tof32(packed >> 16));
+}
+
+// Maps the position into [0, 1] within the bounds and stores 16 bits per axis, the fourth component is left at 0
+inline uint2 EncodeQuantizedPosition(float3 position, float3 boundsMin, float3 boundsExtent)
+{
+	float3 q = round(saturate((position - boundsMin) / boundsExtent) * 65535.0f);
+	return uint2(uint(q.x) | (uint(q.y) << 16), uint(q.z));
+}
+
+inline float3 DecodeQuantizedPosition(uint2 packed, float3 boundsMin, float3 boundsExtent)
+{
+	float3 q = float3(float(packed.x & 0xFFFF), float(packed.x >> 16), float(packed.y & 0xFFFF));
+	return boundsMin + (q / 65535.0f) * boundsExtent;
+}
+
+#endif
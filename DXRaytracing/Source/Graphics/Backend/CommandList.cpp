@@ -121,22 +121,44 @@ void CommandList::CopyBufferRegion(Buffer& intermediateBuffer, std::size_t inter
 }
 
 void CommandList::CopyTexture(Buffer& intermediateBuffer, Texture& destTexture, const void* textureData)
+{
+	CopyTextureMips(intermediateBuffer, 0, destTexture, 0, destTexture.GetTextureDesc().MipLevels, textureData);
+}
+
+void CommandList::CopyTextureMips(Buffer& intermediateBuffer, std::size_t intermediateOffset, Texture& destTexture, uint32_t firstMip, uint32_t numMips, const void* mipData)
 {
 	TextureDesc textureDesc = destTexture.GetTextureDesc();
+	ASSERT(firstMip + numMips <= textureDesc.MipLevels, "Mip range is out of bounds of the destination texture");
 
-	if (textureData != nullptr)
+	if (mipData != nullptr && numMips > 0)
 	{
-		D3D12_SUBRESOURCE_DATA subresourceData = {};
-		subresourceData.pData = textureData;
-		subresourceData.RowPitch = static_cast<std::size_t>(textureDesc.Width * 4);
-		subresourceData.SlicePitch = subresourceData.RowPitch * textureDesc.Height;
+		// Mip levels follow each other in the mip data without any padding
+		std::vector<D3D12_SUBRESOURCE_DATA> subresourceData(numMips);
+		const unsigned char* data = static_cast<const unsigned char*>(mipData);
+		uint32_t mipWidth = std::max(1u, textureDesc.Width >> firstMip), mipHeight = std::max(1u, textureDesc.Height >> firstMip);
+
+		for (auto& mip : subresourceData)
+		{
+			mip.pData = data;
+			mip.RowPitch = GetTextureRowPitch(textureDesc.Format, mipWidth);
+			mip.SlicePitch = mip.RowPitch * GetTextureNumRows(textureDesc.Format, mipHeight);
+
+			data += mip.SlicePitch;
+			mipWidth = std::max(1u, mipWidth / 2);
+			mipHeight = std::max(1u, mipHeight / 2);
+		}
 
 		UpdateSubresources(m_d3d12CommandList.Get(), destTexture.GetD3D12Resource().Get(),
-			intermediateBuffer.GetD3D12Resource().Get(), 0, 0, 1, &subresourceData);
+			intermediateBuffer.GetD3D12Resource().Get(), intermediateOffset, firstMip, numMips, subresourceData.data());
 
-		CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(destTexture.GetD3D12Resource().Get(),
-			D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON);
-		ResourceBarrier(1, &barrier);
+		// Only the copied mips were promoted to COPY_DEST, the others may be in use by earlier work
+		std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+		for (uint32_t mip = firstMip; mip < firstMip + numMips; ++mip)
+		{
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(destTexture.GetD3D12Resource().Get(),
+				D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON, mip));
+		}
+		ResourceBarrier(static_cast<uint32_t>(barriers.size()), barriers.data());
 
 		TrackObject(intermediateBuffer.GetD3D12Resource());
 		TrackObject(destTexture.GetD3D12Resource());
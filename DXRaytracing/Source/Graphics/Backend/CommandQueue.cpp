@@ -59,6 +59,11 @@ bool CommandQueue::IsFenceComplete() const
     return m_d3d12Fence->GetCompletedValue() >= m_FenceValue;
 }
 
+bool CommandQueue::IsFenceComplete(uint64_t fenceValue) const
+{
+    return m_d3d12Fence->GetCompletedValue() >= fenceValue;
+}
+
 void CommandQueue::WaitForFenceValue(uint64_t fenceValue) const
 {
     if (!IsFenceComplete())
@@ -16,7 +16,7 @@ PipelineState::PipelineState(const std::string& name, const D3D12_SHADER_BYTECOD
 {
 	CreateRootSignatures();
 	CreateStateObject(name, rayGenByteCode, missByteCode, closestHitByteCode);
-	CreateShaderTable();
+	CreateShaderTable({ HitGroupConstants() }, 0);
 }
 
 PipelineState::~PipelineState()
@@ -50,15 +50,21 @@ void PipelineState::CreateRootSignatures()
 		CD3DX12_DESCRIPTOR_RANGE descriptorRanges[6] = {};
 		descriptorRanges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, 1); // View constant buffer
 		descriptorRanges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0, 3); // Output
-		descriptorRanges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, 11); // Acceleration structure
+		descriptorRanges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, 4); // Acceleration structure
 		descriptorRanges[3].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 1, 5); // Vertex buffer
 		descriptorRanges[4].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 2, 6); // Index buffer
-		descriptorRanges[5].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 3, 4); // Base color texture
+		descriptorRanges[5].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 3, 0); // Textures, indexed by their offset in the descriptor heap
 		
-		CD3DX12_ROOT_PARAMETER rootParameters[1] = {};
+		CD3DX12_ROOT_PARAMETER rootParameters[3] = {};
 		rootParameters[0].InitAsDescriptorTable(6, &descriptorRanges[0]);
+		rootParameters[1].InitAsConstants(sizeof(HitGroupConstants) / sizeof(uint32_t), 0, 1); // Hit group constants
+		rootParameters[2].InitAsShaderResourceView(0, 4); // Texture residency buffer
 
-		CD3DX12_ROOT_SIGNATURE_DESC localRootSignatureDesc(ARRAYSIZE(rootParameters), rootParameters);
+		// Trilinear sampler for the mipmapped textures, wrapping like glTF samplers do by default
+		CD3DX12_STATIC_SAMPLER_DESC staticSamplers[1] = {};
+		staticSamplers[0].Init(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR);
+
+		CD3DX12_ROOT_SIGNATURE_DESC localRootSignatureDesc(ARRAYSIZE(rootParameters), rootParameters, ARRAYSIZE(staticSamplers), staticSamplers);
 		localRootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE;
 
 		ComPtr<ID3DBlob> blob;
@@ -165,29 +171,39 @@ void PipelineState::CreateStateObject(const std::string& name, const D3D12_SHADE
 	DX_CALL(m_d3d12StateObject->QueryInterface(IID_PPV_ARGS(&m_d3d12StateProperties)));
 }
 
-void PipelineState::CreateShaderTable()
+void PipelineState::SetHitGroupRecords(const std::vector<HitGroupConstants>& hitGroupConstants, D3D12_GPU_VIRTUAL_ADDRESS textureResidencyBuffer)
+{
+	CreateShaderTable(hitGroupConstants, textureResidencyBuffer);
+}
+
+void PipelineState::CreateShaderTable(const std::vector<HitGroupConstants>& hitGroupConstants, D3D12_GPU_VIRTUAL_ADDRESS textureResidencyBuffer)
 {
 	/*
 		Shader table layout:
 		- ray generation shader
 		- miss shader
-		- closest hit shader
+		- closest hit shader, one record per geometry of the BLAS
 
 		All shader records in the shader table must have the same size.
 		32 bytes  - D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES
 		+ 8 bytes - CBV_SRV_UAV descriptor table pointer
-		= 40 bytes
+		+ 16 bytes - Hit group constants
+		+ 8 bytes - Texture residency buffer address, root descriptors are 8 byte aligned
+		= 64 bytes
 		Need to align this to 64 bytes, D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT.
 	*/
 
 	uint32_t shaderIdSize = D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
 	uint32_t shaderTableSize = 0;
 
-	m_ShaderTableRecordSize = shaderIdSize;
-	m_ShaderTableRecordSize += 8; // CBV_SRV_UAV descriptor heap
+	uint32_t constantsOffset = shaderIdSize + sizeof(D3D12_GPU_DESCRIPTOR_HANDLE);
+	uint32_t residencyBufferOffset = MathHelper::AlignUp(constantsOffset + static_cast<uint32_t>(sizeof(HitGroupConstants)), 8);
+
+	m_ShaderTableRecordSize = residencyBufferOffset + sizeof(D3D12_GPU_VIRTUAL_ADDRESS);
 	m_ShaderTableRecordSize = MathHelper::AlignUp(m_ShaderTableRecordSize, D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT);
 
-	shaderTableSize = m_ShaderTableRecordSize * 3;
+	m_NumHitGroupRecords = static_cast<uint32_t>(hitGroupConstants.size());
+	shaderTableSize = m_ShaderTableRecordSize * (2 + m_NumHitGroupRecords);
 	shaderTableSize = MathHelper::AlignUp(shaderTableSize, D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT);
 
 	uint32_t currentOffset = 0;
@@ -200,7 +216,12 @@ void PipelineState::CreateShaderTable()
 	currentOffset += m_ShaderTableRecordSize;
 	m_ShaderTable->SetBufferDataAtOffset(m_d3d12StateProperties->GetShaderIdentifier(L"MissShader_Default"), shaderIdSize, currentOffset);
 
-	currentOffset += m_ShaderTableRecordSize;
-	m_ShaderTable->SetBufferDataAtOffset(m_d3d12StateProperties->GetShaderIdentifier(L"HitGroupTriangle_Default"), shaderIdSize, currentOffset);
-	m_ShaderTable->SetBufferDataAtOffset(&gpuBaseDescriptor, sizeof(D3D12_GPU_DESCRIPTOR_HANDLE), currentOffset + shaderIdSize);
+	for (auto& constants : hitGroupConstants)
+	{
+		currentOffset += m_ShaderTableRecordSize;
+		m_ShaderTable->SetBufferDataAtOffset(m_d3d12StateProperties->GetShaderIdentifier(L"HitGroupTriangle_Default"), shaderIdSize, currentOffset);
+		m_ShaderTable->SetBufferDataAtOffset(&gpuBaseDescriptor, sizeof(D3D12_GPU_DESCRIPTOR_HANDLE), currentOffset + shaderIdSize);
+		m_ShaderTable->SetBufferDataAtOffset(&constants, sizeof(HitGroupConstants), currentOffset + constantsOffset);
+		m_ShaderTable->SetBufferDataAtOffset(&textureResidencyBuffer, sizeof(D3D12_GPU_VIRTUAL_ADDRESS), currentOffset + residencyBufferOffset);
+	}
 }
@@ -123,22 +123,20 @@ std::shared_ptr<CommandList> RenderBackend::GetCommandList(D3D12_COMMAND_LIST_TY
 	return nullptr;
 }
 
-void RenderBackend::ExecuteCommandList(std::shared_ptr<CommandList> commandList)
+uint64_t RenderBackend::ExecuteCommandList(std::shared_ptr<CommandList> commandList)
 {
 	switch (commandList->GetCommandListType())
 	{
 	case D3D12_COMMAND_LIST_TYPE_DIRECT:
-		s_Instance->m_CommandQueueDirect->ExecuteCommandList(commandList);
-		return;
+		return s_Instance->m_CommandQueueDirect->ExecuteCommandList(commandList);
 	case D3D12_COMMAND_LIST_TYPE_COMPUTE:
-		s_Instance->m_CommandQueueCompute->ExecuteCommandList(commandList);
-		return;
+		return s_Instance->m_CommandQueueCompute->ExecuteCommandList(commandList);
 	case D3D12_COMMAND_LIST_TYPE_COPY:
-		s_Instance->m_CommandQueueCopy->ExecuteCommandList(commandList);
-		return;
+		return s_Instance->m_CommandQueueCopy->ExecuteCommandList(commandList);
 	}
 
 	ASSERT(false, "Tried to execute command list on a command queue type that is not supported.");
+	return 0;
 }
 
 void RenderBackend::ExecuteCommandListAndWait(std::shared_ptr<CommandList> commandList)
@@ -163,3 +161,19 @@ void RenderBackend::ExecuteCommandListAndWait(std::shared_ptr<CommandList> comma
 
 	ASSERT(false, "Tried to execute command list on a command queue type that is not supported.");
 }
+
+bool RenderBackend::IsFenceComplete(D3D12_COMMAND_LIST_TYPE type, uint64_t fenceValue)
+{
+	switch (type)
+	{
+	case D3D12_COMMAND_LIST_TYPE_DIRECT:
+		return s_Instance->m_CommandQueueDirect->IsFenceComplete(fenceValue);
+	case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+		return s_Instance->m_CommandQueueCompute->IsFenceComplete(fenceValue);
+	case D3D12_COMMAND_LIST_TYPE_COPY:
+		return s_Instance->m_CommandQueueCopy->IsFenceComplete(fenceValue);
+	}
+
+	ASSERT(false, "Tried to query the fence of a command queue type that is not supported.");
+	return false;
+}
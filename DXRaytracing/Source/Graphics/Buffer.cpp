@@ -83,6 +83,11 @@ void Buffer::SetBufferDataAtOffset(const void* data, std::size_t byteSize, std::
 	}
 }
 
+void Buffer::CreateShaderResourceView(D3D12_CPU_DESCRIPTOR_HANDLE descriptor)
+{
+	RenderBackend::GetDevice()->CreateShaderResourceView(*this, GetShaderResourceViewDesc(), descriptor);
+}
+
 bool Buffer::IsValid() const
 {
 	return m_BufferDesc.Usage != BufferUsage::BUFFER_USAGE_NONE;
@@ -152,23 +157,8 @@ void Buffer::Create()
 
 void Buffer::CreateViews()
 {
-	if (m_BufferDesc.Usage & BufferUsage::BUFFER_USAGE_RAYTRACING_ACCELERATION_STRUCTURE)
-	{
-		auto& srv = m_DescriptorAllocations[DescriptorType::SRV];
-
-		// Create shader resource view (read-only)
-		if (srv.IsNull())
-			srv = RenderBackend::AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.RaytracingAccelerationStructure.Location = m_d3d12Resource->GetGPUVirtualAddress();
-
-		RenderBackend::GetDevice()->CreateShaderResourceView(*this, srvDesc, srv.GetCPUDescriptorHandle());
-	}
-	if (m_BufferDesc.Usage & BufferUsage::BUFFER_USAGE_READ || m_BufferDesc.Usage & BufferUsage::BUFFER_USAGE_CONSTANT)
+	if (m_BufferDesc.Usage & BufferUsage::BUFFER_USAGE_RAYTRACING_ACCELERATION_STRUCTURE || m_BufferDesc.Usage & BufferUsage::BUFFER_USAGE_READ ||
+		m_BufferDesc.Usage & BufferUsage::BUFFER_USAGE_CONSTANT)
 	{
 		auto& srv = m_DescriptorAllocations[DescriptorType::SRV];
 
@@ -176,16 +166,7 @@ void Buffer::CreateViews()
 		if (srv.IsNull())
 			srv = RenderBackend::AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
-		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Buffer.FirstElement = 0;
-		srvDesc.Buffer.NumElements = m_BufferDesc.NumElements;
-		srvDesc.Buffer.StructureByteStride = m_BufferDesc.ElementSize;
-		srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
-
-		RenderBackend::GetDevice()->CreateShaderResourceView(*this, srvDesc, srv.GetCPUDescriptorHandle());
+		CreateShaderResourceView(srv.GetCPUDescriptorHandle());
 	}
 	if (m_BufferDesc.Usage & BufferUsage::BUFFER_USAGE_WRITE)
 	{
@@ -220,3 +201,32 @@ void Buffer::CreateViews()
 		RenderBackend::GetDevice()->CreateConstantBufferView(*this, cbvDesc, cbv.GetCPUDescriptorHandle());
 	}
 }
+
+D3D12_SHADER_RESOURCE_VIEW_DESC Buffer::GetShaderResourceViewDesc() const
+{
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+	if (m_BufferDesc.Usage & BufferUsage::BUFFER_USAGE_RAYTRACING_ACCELERATION_STRUCTURE)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_RAYTRACING_ACCELERATION_STRUCTURE;
+		srvDesc.RaytracingAccelerationStructure.Location = m_d3d12Resource->GetGPUVirtualAddress();
+		return srvDesc;
+	}
+
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = m_BufferDesc.NumElements;
+	srvDesc.Buffer.StructureByteStride = m_BufferDesc.ElementSize;
+	srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+
+	// Index buffers get a typed view, so shaders read 16 and 32-bit indices the same way
+	if (m_BufferDesc.Usage & BufferUsage::BUFFER_USAGE_INDEX)
+	{
+		srvDesc.Format = m_BufferDesc.ElementSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		srvDesc.Buffer.StructureByteStride = 0;
+	}
+
+	return srvDesc;
+}
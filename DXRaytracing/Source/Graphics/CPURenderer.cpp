@@ -0,0 +1,508 @@
+#include "Pch.h"
+#include "Graphics/CPURenderer.h"
+#include "Graphics/ViewData.h"
+#include "Resource/BlockCompression.h"
+#include "Resource/BVHBuilder.h"
+#include "Resource/BVHTraversal.h"
+#include "Resource/ModelCooker.h"
+#include "Scene/Camera.h"
+#include "Util/ThreadPool.h"
+
+#include "tinygltf/stb_image_write.h"
+
+/* RGBA8 mip chain of a base color texture, the way the hit shader samples it */
+struct CPUTexture
+{
+	uint32_t Width = 1;
+	uint32_t Height = 1;
+	uint32_t NumMipLevels = 1;
+
+	// Every mip from the largest to the smallest, tightly packed
+	std::vector<uint8_t> Texels;
+	std::vector<std::size_t> MipOffsets;
+};
+
+// Tiles are small enough to balance uneven costs between workers, and wide enough for the packets of the traversal kernels
+static constexpr uint32_t TILE_SIZE = 16;
+
+/* Tiles a worker has left, with the front in the low and the back in the high 32 bits so the worker and thieves claim tiles with a
+   single compare and swap. The worker pops tiles from the front, thieves take half of the remaining tiles from the back */
+struct alignas(64) TileDeque
+{
+	std::atomic<uint64_t> Range{ 0 };
+};
+
+struct TileWorkerStats
+{
+	uint64_t BusyMicroseconds = 0;
+	uint32_t NumTiles = 0;
+	uint32_t NumSteals = 0;
+};
+
+struct CPURendererInternalData
+{
+	BVH SceneBVH;
+	// Submesh of every triangle of the BVH, in leaf order
+	std::vector<uint32_t> TriangleSubmeshes;
+
+	std::vector<Vertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<Submesh> Submeshes;
+	// Base color texture of every submesh, textures with the same content are decoded once
+	std::vector<std::shared_ptr<const CPUTexture>> SubmeshTextures;
+	bool IsModelLoaded = false;
+
+	ViewData View;
+	std::vector<uint8_t> Frame;
+
+	// No thread pool with a single worker, which renders on the calling thread
+	std::unique_ptr<ThreadPool> TileThreadPool;
+	std::vector<TileDeque> TileDeques;
+
+	struct Resolution
+	{
+		uint32_t x = 0;
+		uint32_t y = 0;
+	} Resolution;
+};
+
+static CPURendererInternalData s_Data;
+
+static BlockCompressionFormat TextureFormatToBlockCompressionFormat(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::TEXTURE_FORMAT_BC1_UNORM:
+		return BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1;
+	case TextureFormat::TEXTURE_FORMAT_BC3_UNORM:
+		return BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC3;
+	case TextureFormat::TEXTURE_FORMAT_BC5_UNORM:
+		return BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC5;
+	default:
+		return BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7;
+	}
+}
+
+/* Images without pixels become the white texture the resource loader creates for them, block compressed images are decoded */
+static std::shared_ptr<const CPUTexture> CreateTexture(const ImageData& image)
+{
+	auto texture = std::make_shared<CPUTexture>();
+	if (!image.Pixels)
+	{
+		texture->Texels.assign(4, 255);
+		texture->MipOffsets = { 0 };
+		return texture;
+	}
+
+	texture->Width = image.Width;
+	texture->Height = image.Height;
+	texture->NumMipLevels = image.NumMipLevels;
+	texture->Texels.resize(MipGenerator::GetMipChainByteSize(image.Width, image.Height, image.NumMipLevels));
+
+	bool isBlockCompressed = image.Format != TextureFormat::TEXTURE_FORMAT_RGBA8_UNORM;
+	BlockCompressionFormat blockFormat = TextureFormatToBlockCompressionFormat(image.Format);
+
+	const unsigned char* source = image.Pixels;
+	std::size_t offset = 0;
+	uint32_t width = image.Width, height = image.Height;
+
+	for (uint32_t mip = 0; mip < image.NumMipLevels; ++mip)
+	{
+		std::size_t mipByteSize = static_cast<std::size_t>(width) * height * 4;
+		texture->MipOffsets.push_back(offset);
+
+		if (isBlockCompressed)
+		{
+			BlockCompression::Decompress(blockFormat, source, width, height, texture->Texels.data() + offset);
+			source += BlockCompression::GetCompressedByteSize(blockFormat, width, height);
+		}
+		else
+		{
+			memcpy(texture->Texels.data() + offset, source, mipByteSize);
+			source += mipByteSize;
+		}
+
+		offset += mipByteSize;
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+
+	return texture;
+}
+
+static glm::vec4 LoadTexel(const CPUTexture& texture, uint32_t mip, uint32_t width, int32_t x, int32_t y)
+{
+	const uint8_t* texel = texture.Texels.data() + texture.MipOffsets[mip] + (static_cast<std::size_t>(y) * width + x) * 4;
+	return glm::vec4(texel[0], texel[1], texel[2], texel[3]) / 255.0f;
+}
+
+/* Bilinear filtering with wrapped texture coordinates, like the linear wrap sampler */
+static glm::vec4 SampleBilinear(const CPUTexture& texture, uint32_t mip, const glm::vec2& texCoord)
+{
+	int32_t width = static_cast<int32_t>(std::max(1u, texture.Width >> mip));
+	int32_t height = static_cast<int32_t>(std::max(1u, texture.Height >> mip));
+
+	// Wrapping first keeps the texel coordinates small for texture coordinates far outside [0, 1]
+	glm::vec2 position = glm::fract(texCoord) * glm::vec2(width, height) - 0.5f;
+	glm::vec2 base = glm::floor(position);
+	glm::vec2 weight = position - base;
+
+	int32_t x0 = (static_cast<int32_t>(base.x) + width) % width;
+	int32_t y0 = (static_cast<int32_t>(base.y) + height) % height;
+	int32_t x1 = (x0 + 1) % width;
+	int32_t y1 = (y0 + 1) % height;
+
+	glm::vec4 top = glm::mix(LoadTexel(texture, mip, width, x0, y0), LoadTexel(texture, mip, width, x1, y0), weight.x);
+	glm::vec4 bottom = glm::mix(LoadTexel(texture, mip, width, x0, y1), LoadTexel(texture, mip, width, x1, y1), weight.x);
+	return glm::mix(top, bottom, weight.y);
+}
+
+/* SampleLevel with linear filtering between mips, the level is clamped to the mip chain */
+static glm::vec4 SampleLevel(const CPUTexture& texture, const glm::vec2& texCoord, float lod)
+{
+	if (!std::isfinite(texCoord.x) || !std::isfinite(texCoord.y))
+		return LoadTexel(texture, 0, texture.Width, 0, 0);
+
+	lod = lod > 0.0f ? std::min(lod, static_cast<float>(texture.NumMipLevels - 1)) : 0.0f;
+	uint32_t mip = static_cast<uint32_t>(lod);
+	float weight = lod - mip;
+
+	glm::vec4 color = SampleBilinear(texture, mip, texCoord);
+	if (weight > 0.0f)
+		color = glm::mix(color, SampleBilinear(texture, mip + 1, texCoord), weight);
+
+	return color;
+}
+
+/* MissDefault.hlsl */
+static glm::vec3 Miss()
+{
+	return glm::vec3(1.0f, 0.0f, 1.0f);
+}
+
+/* ClosestHitDefault.hlsl, the model has the identity transform so object and world space are the same */
+static glm::vec3 ClosestHit(const BVHRay& ray, const BVHHit& hit)
+{
+	const Submesh& submesh = s_Data.Submeshes[s_Data.TriangleSubmeshes[hit.Triangle]];
+	const CPUTexture& baseColorTexture = *s_Data.SubmeshTextures[s_Data.TriangleSubmeshes[hit.Triangle]];
+
+	std::size_t baseIndex = static_cast<std::size_t>(s_Data.SceneBVH.TriangleIndices[hit.Triangle]) * 3;
+	glm::vec3 weights(1.0f - hit.Barycentrics.x - hit.Barycentrics.y, hit.Barycentrics.x, hit.Barycentrics.y);
+
+	// Get vertex attribs, the position is not needed for the color
+	glm::vec2 texCoord(0.0f);
+	glm::vec3 normal(0.0f);
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		const Vertex& loadedVertex = s_Data.Vertices[s_Data.Indices[baseIndex + i]];
+		texCoord += loadedVertex.TexCoord * weights[i];
+		normal += loadedVertex.Normal * weights[i];
+	}
+
+	// Ray cone mip selection, primary rays start with a zero width cone that widens by one pixel angle per unit distance
+	float spreadAngle = std::atan(2.0f * s_Data.View.ViewOriginAndTanHalfFovY.w / s_Data.View.Resolution.y);
+	float coneWidth = spreadAngle * hit.T;
+	float cosHitAngle = std::abs(glm::dot(glm::normalize(normal), glm::normalize(ray.Direction)));
+	// Also catches the NaN of a zero normal, like max does on the GPU
+	cosHitAngle = cosHitAngle > 1e-3f ? cosHitAngle : 1e-3f;
+
+	float lod = submesh.TexCoordDensity + 0.5f * std::log2(static_cast<float>(baseColorTexture.Width * baseColorTexture.Height)) +
+		std::log2(coneWidth / cosHitAngle);
+
+	// Every mip is resident, so the level is not clamped to a streamed mip
+	return glm::vec3(SampleLevel(baseColorTexture, texCoord, lod));
+}
+
+static BVHTraversalKernel GetFastestKernel()
+{
+	if (BVHTraversal::IsKernelSupported(BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_AVX2_8))
+		return BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_AVX2_8;
+	if (BVHTraversal::IsKernelSupported(BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SSE_4))
+		return BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SSE_4;
+
+	return BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SCALAR;
+}
+
+static uint64_t PackTileRange(uint32_t front, uint32_t back)
+{
+	return (static_cast<uint64_t>(back) << 32) | front;
+}
+
+static bool PopTile(TileDeque& deque, uint32_t& tile)
+{
+	uint64_t range = deque.Range.load();
+	while (true)
+	{
+		uint32_t front = static_cast<uint32_t>(range), back = static_cast<uint32_t>(range >> 32);
+		if (front >= back)
+			return false;
+
+		if (deque.Range.compare_exchange_weak(range, PackTileRange(front + 1, back)))
+		{
+			tile = front;
+			return true;
+		}
+	}
+}
+
+/* Takes the back half of the tiles of the victim, rounded up so its last tile can be stolen too */
+static bool StealTiles(TileDeque& victim, uint32_t& begin, uint32_t& end)
+{
+	uint64_t range = victim.Range.load();
+	while (true)
+	{
+		uint32_t front = static_cast<uint32_t>(range), back = static_cast<uint32_t>(range >> 32);
+		if (front >= back)
+			return false;
+
+		uint32_t numStolen = (back - front + 1) / 2;
+		if (victim.Range.compare_exchange_weak(range, PackTileRange(front, back - numStolen)))
+		{
+			begin = back - numStolen;
+			end = back;
+			return true;
+		}
+	}
+}
+
+/* Traces the primary rays of a tile with the given traversal kernel, then runs the hit or miss shader for every pixel */
+static void RenderTile(uint32_t tile, BVHTraversalKernel kernel, std::vector<BVHRay>& rays, std::vector<BVHHit>& hits)
+{
+	uint32_t numTilesX = (s_Data.Resolution.x + TILE_SIZE - 1) / TILE_SIZE;
+	uint32_t beginX = (tile % numTilesX) * TILE_SIZE;
+	uint32_t beginY = (tile / numTilesX) * TILE_SIZE;
+	uint32_t width = std::min(TILE_SIZE, s_Data.Resolution.x - beginX);
+	uint32_t height = std::min(TILE_SIZE, s_Data.Resolution.y - beginY);
+	std::size_t numRays = static_cast<std::size_t>(width) * height;
+
+	// Rays are laid out row by row, so the packets of the traversal kernels cover neighbouring pixels
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			BVHRay& ray = rays[y * width + x];
+			ray.Origin = s_Data.View.GetRayOrigin();
+			ray.Direction = s_Data.View.GetRayDirection(beginX + x, beginY + y);
+		}
+	}
+
+	// Frames trace an empty scene, and only hit the miss shader, until the model is set
+	if (s_Data.IsModelLoaded)
+		BVHTraversal::Intersect(s_Data.SceneBVH, rays.data(), numRays, kernel, hits.data());
+	else
+		std::fill_n(hits.begin(), numRays, BVHHit());
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		uint8_t* row = s_Data.Frame.data() + (static_cast<std::size_t>(beginY + y) * s_Data.Resolution.x + beginX) * 4;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			const BVHHit& hit = hits[y * width + x];
+			glm::vec3 color = hit.IsHit() ? ClosestHit(rays[y * width + x], hit) : Miss();
+			color = glm::clamp(color, 0.0f, 1.0f);
+
+			row[x * 4 + 0] = static_cast<uint8_t>(color.r * 255.0f + 0.5f);
+			row[x * 4 + 1] = static_cast<uint8_t>(color.g * 255.0f + 0.5f);
+			row[x * 4 + 2] = static_cast<uint8_t>(color.b * 255.0f + 0.5f);
+			row[x * 4 + 3] = 255;
+		}
+	}
+}
+
+/* Renders the tiles of its own deque and steals from the other workers when it runs out, until every deque is empty */
+static void RenderTiles(uint32_t worker, BVHTraversalKernel kernel, TileWorkerStats& stats)
+{
+	std::vector<BVHRay> rays(TILE_SIZE * TILE_SIZE);
+	std::vector<BVHHit> hits(TILE_SIZE * TILE_SIZE);
+
+	uint32_t numWorkers = static_cast<uint32_t>(s_Data.TileDeques.size());
+	TileDeque& deque = s_Data.TileDeques[worker];
+
+	while (true)
+	{
+		uint32_t tile = 0;
+		if (!PopTile(deque, tile))
+		{
+			// Victims are tried starting with the next worker, which spreads the thieves over the workers. Tiles that are being moved
+			// by another thief are missed, that thief renders them
+			bool hasStolen = false;
+			for (uint32_t i = 1; i < numWorkers && !hasStolen; ++i)
+			{
+				uint32_t begin = 0, end = 0;
+				hasStolen = StealTiles(s_Data.TileDeques[(worker + i) % numWorkers], begin, end);
+
+				if (hasStolen)
+				{
+					// Only this worker refills its deque, and nobody steals from an empty one
+					tile = begin;
+					deque.Range.store(PackTileRange(begin + 1, end));
+					stats.NumSteals++;
+				}
+			}
+
+			if (!hasStolen)
+				break;
+		}
+
+		auto startTime = std::chrono::steady_clock::now();
+		RenderTile(tile, kernel, rays, hits);
+
+		stats.BusyMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+		stats.NumTiles++;
+	}
+}
+
+void CPURenderer::Initialize(uint32_t resX, uint32_t resY, uint32_t numThreads)
+{
+	OnWindowResize(resX, resY);
+
+	uint32_t numWorkers = numThreads > 0 ? numThreads : std::max(1u, std::thread::hardware_concurrency());
+	if (numWorkers > 1)
+		s_Data.TileThreadPool = std::make_unique<ThreadPool>(numWorkers);
+
+	s_Data.TileDeques = std::vector<TileDeque>(numWorkers);
+}
+
+void CPURenderer::Finalize()
+{
+	s_Data = CPURendererInternalData();
+}
+
+void CPURenderer::SetModel(const ModelData& model)
+{
+	SCOPED_TIMER("CPURenderer::SetModel");
+	const CookedModelData& cooked = model.Cooked;
+
+	BVHBuildStats stats = BVHBuilder::Build(cooked.Vertices, cooked.NumVertices, cooked.Indices, cooked.IndexByteSize, cooked.Submeshes,
+		BVHBuildDesc(), s_Data.SceneBVH);
+	LOG_INFO("[CPURenderer] Built the BVH over " + std::to_string(stats.NumTriangles) + " triangles in " + std::to_string(stats.BuildDuration) + " ms");
+
+	s_Data.Vertices.assign(cooked.Vertices, cooked.Vertices + cooked.NumVertices);
+	s_Data.Indices.resize(cooked.NumIndices);
+	for (std::size_t i = 0; i < cooked.NumIndices; ++i)
+	{
+		s_Data.Indices[i] = cooked.IndexByteSize == sizeof(uint16_t) ? static_cast<const uint16_t*>(cooked.Indices)[i] :
+			static_cast<const uint32_t*>(cooked.Indices)[i];
+	}
+
+	// Triangles of the index stream map to their submesh, the BVH refers to them by the first index divided by 3
+	std::vector<uint32_t> indexTriangleSubmeshes(cooked.NumIndices / 3, 0);
+	for (uint32_t i = 0; i < cooked.Submeshes.size(); ++i)
+	{
+		uint32_t firstTriangle = cooked.Submeshes[i].IndexOffset / 3;
+		std::fill_n(indexTriangleSubmeshes.begin() + firstTriangle, cooked.Submeshes[i].NumIndices / 3, i);
+	}
+
+	s_Data.TriangleSubmeshes.resize(s_Data.SceneBVH.TriangleIndices.size());
+	for (std::size_t i = 0; i < s_Data.TriangleSubmeshes.size(); ++i)
+		s_Data.TriangleSubmeshes[i] = indexTriangleSubmeshes[s_Data.SceneBVH.TriangleIndices[i]];
+
+	std::vector<std::shared_ptr<const CPUTexture>> textures(model.Textures.size());
+	for (std::size_t i = 0; i < model.Textures.size(); ++i)
+	{
+		int32_t duplicateOf = model.Textures[i].DuplicateOf;
+		textures[i] = duplicateOf >= 0 ? textures[duplicateOf] : CreateTexture(model.Textures[i].Image);
+	}
+
+	s_Data.Submeshes = cooked.Submeshes;
+	s_Data.SubmeshTextures.clear();
+	for (auto& submesh : cooked.Submeshes)
+	{
+		uint32_t textureIndex = model.Materials[submesh.MaterialIndex].BaseColorTexture;
+		s_Data.SubmeshTextures.push_back(textureIndex < textures.size() ? textures[textureIndex] : CreateTexture(ImageData()));
+	}
+
+	s_Data.IsModelLoaded = true;
+}
+
+void CPURenderer::BeginScene(const Camera& sceneCamera)
+{
+	s_Data.View = ViewData::FromCamera(sceneCamera, glm::vec2(s_Data.Resolution.x, s_Data.Resolution.y));
+}
+
+/* Every worker starts with a contiguous band of tiles, so the tiles of a worker stay close together until it has to steal. Work
+   stealing keeps the workers busy when the bands differ in cost, like the sky and the curtains of Sponza */
+void CPURenderer::Render()
+{
+	SCOPED_TIMER("CPURenderer::Render");
+
+	BVHTraversalKernel kernel = GetFastestKernel();
+	uint32_t numWorkers = static_cast<uint32_t>(s_Data.TileDeques.size());
+	uint32_t numTiles = ((s_Data.Resolution.x + TILE_SIZE - 1) / TILE_SIZE) * ((s_Data.Resolution.y + TILE_SIZE - 1) / TILE_SIZE);
+
+	for (uint32_t i = 0; i < numWorkers; ++i)
+	{
+		uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(numTiles) * i / numWorkers);
+		uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(numTiles) * (i + 1) / numWorkers);
+		s_Data.TileDeques[i].Range.store(PackTileRange(begin, end));
+	}
+
+	std::vector<TileWorkerStats> stats(numWorkers);
+	auto startTime = std::chrono::steady_clock::now();
+
+	if (s_Data.TileThreadPool)
+	{
+		for (uint32_t i = 0; i < numWorkers; ++i)
+			s_Data.TileThreadPool->Submit([i, kernel, &stats]() { RenderTiles(i, kernel, stats[i]); });
+
+		s_Data.TileThreadPool->WaitIdle();
+	}
+	else
+	{
+		RenderTiles(0, kernel, stats[0]);
+	}
+
+	// Idle time covers waiting to be scheduled and waiting for the last tiles of the other workers
+	uint64_t frameMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	Profiler& profiler = Profiler::Get();
+
+	for (uint32_t i = 0; i < numWorkers; ++i)
+	{
+		std::string name = "CPURenderer::Thread " + std::to_string(i);
+		profiler.SetCounter(name + " busy us", stats[i].BusyMicroseconds);
+		profiler.SetCounter(name + " idle us", frameMicroseconds - std::min(stats[i].BusyMicroseconds, frameMicroseconds));
+		profiler.SetCounter(name + " tiles", stats[i].NumTiles);
+		profiler.SetCounter(name + " steals", stats[i].NumSteals);
+	}
+}
+
+void CPURenderer::OnWindowResize(uint32_t width, uint32_t height)
+{
+	s_Data.Resolution.x = std::max(1u, width);
+	s_Data.Resolution.y = std::max(1u, height);
+
+	s_Data.Frame.assign(static_cast<std::size_t>(s_Data.Resolution.x) * s_Data.Resolution.y * 4, 0);
+}
+
+bool CPURenderer::SaveFrame(const std::string& filepath)
+{
+	int width = static_cast<int>(s_Data.Resolution.x);
+	int height = static_cast<int>(s_Data.Resolution.y);
+
+	if (!stbi_write_png(filepath.c_str(), width, height, 4, s_Data.Frame.data(), width * 4))
+	{
+		LOG_ERR("[CPURenderer] Failed to write frame to " + filepath);
+		return false;
+	}
+
+	return true;
+}
+
+glm::vec2 CPURenderer::GetResolution()
+{
+	return glm::vec2(s_Data.Resolution.x, s_Data.Resolution.y);
+}
+
+const std::vector<uint8_t>& CPURenderer::GetFrame()
+{
+	return s_Data.Frame;
+}
+
+CPURenderer::CPURenderer()
+{
+}
+
+CPURenderer::~CPURenderer()
+{
+}
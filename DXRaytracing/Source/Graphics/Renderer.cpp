@@ -2,22 +2,23 @@
 #include "Graphics/Renderer.h"
 #include "Graphics/RenderPass.h"
 #include "Graphics/Buffer.h"
+#include "Graphics/ViewData.h"
+#include "Graphics/TextureStreamer.h"
 #include "Graphics/Backend/RenderBackend.h"
 #include "Graphics/Backend/SwapChain.h"
 #include "Graphics/Backend/CommandList.h"
 #include "Graphics/Backend/DescriptorHeap.h"
 #include "Graphics/Backend/Device.h"
+#include "Graphics/Backend/PipelineState.h"
 #include "Application.h"
 #include "Window.h"
 #include "Scene/Camera.h"
 
 #include "ResourceLoader.h"
 
-struct ViewData
+enum SceneDescriptor : uint32_t
 {
-	glm::mat4 ViewProjection;
-	glm::vec4 ViewOriginAndTanHalfFovY;
-	glm::vec2 Resolution;
+	SCENE_DESCRIPTOR_TLAS, SCENE_DESCRIPTOR_VERTEX_BUFFER, SCENE_DESCRIPTOR_INDEX_BUFFER, NUM_SCENE_DESCRIPTORS
 };
 
 struct RendererInternalData
@@ -31,13 +32,21 @@ struct RendererInternalData
 	// BLAS
 	std::unique_ptr<Buffer> BLASScratchBuffer;
 	std::unique_ptr<Buffer> BLASBuffer;
+	std::unique_ptr<Buffer> BLASTransformBuffer;
 
-	// Test Vertex and index buffer, texture
+	// Test Vertex and index buffer, textures
 	std::shared_ptr<Buffer> VertexBuffer;
 	std::shared_ptr<Buffer> IndexBuffer;
-	std::shared_ptr<Texture> BaseColorTexture;
+	std::vector<std::shared_ptr<Texture>> Textures;
+	VertexFormat VertexBufferFormat = VertexFormat::VERTEX_FORMAT_FLOAT;
 
 	std::unique_ptr<RenderPass> RenderPass;
+	std::unique_ptr<TextureStreamer> TextureStreamer;
+
+	// Views of the TLAS, vertex and index buffer at the offsets the local root signature expects, rewritten when the model is loaded
+	DescriptorAllocation SceneDescriptors;
+	ModelLoadHandle ModelLoad;
+	bool IsModelLoaded = false;
 
 	ViewData ViewData;
 	std::unique_ptr<Buffer> ViewConstantBuffer;
@@ -60,43 +69,62 @@ void Renderer::Initialize(uint32_t resX, uint32_t resY)
 
 	RenderBackend::Initialize(Application::Get().GetWindow().GetHandle(), s_Data.Resolution.x, s_Data.Resolution.y);
 
+	// Quantized positions are built into the BLAS as R16G16B16A16_UNORM, which requires raytracing tier 1.1
+	s_Data.VertexBufferFormat = RenderBackend::GetDevice()->GetRaytracingTier() >= D3D12_RAYTRACING_TIER_1_1 ?
+		VertexFormat::VERTEX_FORMAT_QUANTIZED : VertexFormat::VERTEX_FORMAT_COMPACT;
+
 	s_Data.ViewConstantBuffer = std::make_unique<Buffer>("View constant buffer", BufferDesc(BufferUsage::BUFFER_USAGE_CONSTANT, 1, sizeof(ViewData)));
 
 	CreateRenderPasses();
 
-	CreateBLAS();
+	// Allocated right after the render pass attachments, so the scene views stay at fixed offsets however many textures the model has
+	s_Data.SceneDescriptors = RenderBackend::AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, NUM_SCENE_DESCRIPTORS);
+	ASSERT(s_Data.SceneDescriptors.GetOffsetInDescriptorHeap() == 4, "Scene descriptors are not at the offset the local root signature expects");
+	s_Data.TextureStreamer = std::make_unique<TextureStreamer>(TextureStreamerDesc());
+
+	// Frames trace an empty TLAS, and only hit the miss shader, until the model is loaded
 	CreateTLAS();
+	s_Data.RenderPass->GetPipelineState().SetHitGroupRecords({}, s_Data.TextureStreamer->GetResidencyBufferAddress());
+
+	// Textures are streamed in over the first frames, smallest mips first
+	ModelLoadDesc loadDesc;
+	loadDesc.VertexBufferFormat = s_Data.VertexBufferFormat;
+	loadDesc.StreamTextures = true;
+	// Same cook options as the asset cooker, so a model cooked ahead of time is used as is
+	loadDesc.OptimizeMeshes = true;
+
+	s_Data.ModelLoad = ResourceLoader::LoadGLTFAsync("Resources/Models/DamagedHelmet/DamagedHelmet.gltf", loadDesc);
 }
 
 void Renderer::Finalize()
 {
+	ResourceLoader::Finalize();
 	RenderBackend::Finalize();
 }
 
 void Renderer::BeginScene(const Camera& sceneCamera)
 {
 	// Set view data and view constant buffer data
-	glm::mat4 viewAtOrigin = sceneCamera.GetViewMatrix();
-	s_Data.ViewData.ViewOriginAndTanHalfFovY = glm::vec4(viewAtOrigin[3][0],
-		viewAtOrigin[3][1], viewAtOrigin[3][2], 1.0f);
-
-	viewAtOrigin[3][0] = 0.0f;
-	viewAtOrigin[3][1] = 0.0f;
-	viewAtOrigin[3][2] = 0.0f;
-
-	glm::mat4 projection = sceneCamera.GetProjectionMatrix();
-	glm::mat4 projectionToWorld = projection * viewAtOrigin;
-
-	s_Data.ViewData.ViewProjection = projectionToWorld;
-	s_Data.ViewData.Resolution = glm::vec2(s_Data.Resolution.x, s_Data.Resolution.y);
-
+	s_Data.ViewData = ViewData::FromCamera(sceneCamera, glm::vec2(s_Data.Resolution.x, s_Data.Resolution.y));
 	s_Data.ViewConstantBuffer->SetBufferData(&s_Data.ViewData);
 }
 
 void Renderer::Render()
 {
+	// The model joins the scene on the first frame after its uploads completed, until then frames render without it
+	ResourceLoader::Update();
+
+	if (!s_Data.IsModelLoaded && s_Data.ModelLoad.GetStatus() == ModelLoadStatus::MODEL_LOAD_STATUS_LOADED)
+	{
+		SetModel(s_Data.ModelLoad.GetFuture().get());
+		s_Data.IsModelLoaded = true;
+	}
+
 	auto commandList = RenderBackend::GetCommandList(D3D12_COMMAND_LIST_TYPE_DIRECT);
 
+	// Upload this frame's share of the streamed texture mips, ahead of the dispatch that samples them
+	s_Data.TextureStreamer->Update(*commandList);
+
 	// Resource barrier to put output texture into UNORDERED_ACCESS state
 	CD3DX12_RESOURCE_BARRIER outputUAVBarrier = CD3DX12_RESOURCE_BARRIER::Transition(
 		s_Data.RenderPass->GetColorAttachment()->GetD3D12Resource().Get(),
@@ -120,7 +148,7 @@ void Renderer::Render()
 	desc.MissShaderTable.StrideInBytes = shaderTableRecordSize;
 
 	desc.HitGroupTable.StartAddress = shaderTable.GetD3D12Resource()->GetGPUVirtualAddress() + (shaderTableRecordSize * 2);
-	desc.HitGroupTable.SizeInBytes = shaderTableRecordSize;
+	desc.HitGroupTable.SizeInBytes = shaderTableRecordSize * pipelineState.GetNumHitGroupRecords();
 	desc.HitGroupTable.StrideInBytes = shaderTableRecordSize;
 
 	desc.Width = s_Data.Resolution.x;
@@ -152,6 +180,11 @@ void Renderer::OnWindowResize(uint32_t width, uint32_t height)
 	s_Data.RenderPass->ResizeAttachments(width, height);
 }
 
+void Renderer::SetTextureUploadBudget(std::size_t numBytesPerFrame)
+{
+	s_Data.TextureStreamer->SetUploadBudget(numBytesPerFrame);
+}
+
 void Renderer::ToggleVSync()
 {
 	s_Data.VSync = !s_Data.VSync;
@@ -184,6 +217,10 @@ void Renderer::CreateRenderPasses()
 	rpDesc.ShaderDesc[ShaderType::MISS] = sDesc;
 
 	sDesc.Filepath = "Resources/Shaders/ClosestHitDefault.hlsl";
+	if (s_Data.VertexBufferFormat == VertexFormat::VERTEX_FORMAT_COMPACT)
+		sDesc.Defines.push_back("VERTEX_FORMAT_COMPACT");
+	else if (s_Data.VertexBufferFormat == VertexFormat::VERTEX_FORMAT_QUANTIZED)
+		sDesc.Defines.push_back("VERTEX_FORMAT_QUANTIZED");
 	rpDesc.ShaderDesc[ShaderType::CLOSEST_HIT] = sDesc;
 
 	rpDesc.ColorAttachmentDesc = TextureDesc(TextureUsage::TEXTURE_USAGE_READ | TextureUsage::TEXTURE_USAGE_WRITE,
@@ -195,7 +232,25 @@ void Renderer::CreateRenderPasses()
 	s_Data.RenderPass = std::make_unique<RenderPass>(rpDesc);
 }
 
-void Renderer::CreateBLAS()
+void Renderer::SetModel(const Model& model)
+{
+	// Frames in flight still use the TLAS, descriptors and shader table that are replaced here
+	RenderBackend::Flush();
+
+	s_Data.VertexBuffer = model.VertexBuffer;
+	s_Data.IndexBuffer = model.IndexBuffer;
+	s_Data.Textures = model.Textures;
+
+	CreateBLAS(model);
+	CreateTLAS();
+
+	s_Data.VertexBuffer->CreateShaderResourceView(s_Data.SceneDescriptors.GetCPUDescriptorHandle(SCENE_DESCRIPTOR_VERTEX_BUFFER));
+	s_Data.IndexBuffer->CreateShaderResourceView(s_Data.SceneDescriptors.GetCPUDescriptorHandle(SCENE_DESCRIPTOR_INDEX_BUFFER));
+
+	CreateHitGroupRecords(model);
+}
+
+void Renderer::CreateBLAS(const Model& model)
 {
 	// Set test data for vertex and index buffer
 	/*glm::vec3 vertices[8] = {
@@ -228,12 +283,9 @@ void Renderer::CreateBLAS()
 	/*Model model = ResourceLoader::LoadGLTF("Resources/Models/Sponza_OLD/Sponza.gltf");
 	s_Data.VertexBuffer = model.VertexBuffer;
 	s_Data.IndexBuffer = model.IndexBuffer;
-	s_Data.BaseColorTexture = model.Textures[0];*/
+	s_Data.Textures = model.Textures;*/
 
-	Model model = ResourceLoader::LoadGLTF("Resources/Models/DamagedHelmet/DamagedHelmet.gltf");
-	s_Data.VertexBuffer = model.VertexBuffer;
-	s_Data.IndexBuffer = model.IndexBuffer;
-	s_Data.BaseColorTexture = model.Textures[0];
+	ASSERT(!model.Submeshes.empty(), "Model has no submeshes to build the BLAS from");
 
 	D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {};
 	geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
@@ -247,13 +299,45 @@ void Renderer::CreateBLAS()
 	geometryDesc.Triangles.Transform3x4 = 0;
 	geometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
 
+	if (model.VertexBufferFormat == VertexFormat::VERTEX_FORMAT_QUANTIZED)
+	{
+		// The quantized positions are read as UNORM in [0, 1], the transform scales them back into the model bounds
+		const PositionQuantization& quantization = model.VertexQuantization;
+		float transform[3][4] = {
+			{ quantization.Extent.x, 0.0f, 0.0f, quantization.Min.x },
+			{ 0.0f, quantization.Extent.y, 0.0f, quantization.Min.y },
+			{ 0.0f, 0.0f, quantization.Extent.z, quantization.Min.z }
+		};
+
+		s_Data.BLASTransformBuffer = std::make_unique<Buffer>("BLAS transform buffer", BufferDesc(BufferUsage::BUFFER_USAGE_UPLOAD, 1, sizeof(transform)));
+		s_Data.BLASTransformBuffer->SetBufferData(&transform);
+
+		geometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R16G16B16A16_UNORM;
+		geometryDesc.Triangles.Transform3x4 = s_Data.BLASTransformBuffer->GetD3D12Resource()->GetGPUVirtualAddress();
+	}
+
+	// One geometry per submesh, each with its own hit group record that selects the index range and base color texture
+	std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometryDescs;
+
+	uint32_t indexByteSize = s_Data.IndexBuffer->GetBufferDesc().ElementSize;
+
+	for (auto& submesh : model.Submeshes)
+	{
+		// The submesh indices are already rebased onto the model vertex buffer, so the geometry keeps its start
+		D3D12_RAYTRACING_GEOMETRY_DESC submeshGeometryDesc = geometryDesc;
+		submeshGeometryDesc.Triangles.VertexCount = submesh.VertexOffset + submesh.NumVertices;
+		submeshGeometryDesc.Triangles.IndexBuffer += static_cast<uint64_t>(submesh.IndexOffset) * indexByteSize;
+		submeshGeometryDesc.Triangles.IndexCount = submesh.NumIndices;
+		geometryDescs.push_back(submeshGeometryDesc);
+	}
+
 	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
 
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS ASInputs = {};
 	ASInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
 	ASInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-	ASInputs.pGeometryDescs = &geometryDesc;
-	ASInputs.NumDescs = 1;
+	ASInputs.pGeometryDescs = geometryDescs.data();
+	ASInputs.NumDescs = static_cast<uint32_t>(geometryDescs.size());
 	ASInputs.Flags = buildFlags;
 
 	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO ASPreBuildInfo = {};
@@ -287,6 +371,33 @@ void Renderer::CreateBLAS()
 	RenderBackend::ExecuteCommandList(commandList);
 }
 
+void Renderer::CreateHitGroupRecords(const Model& model)
+{
+	for (auto& streamedTexture : model.StreamedTextures)
+	{
+		s_Data.TextureStreamer->AddTexture(model.Textures[streamedTexture.TextureIndex],
+			streamedTexture.MipData, streamedTexture.Storage);
+	}
+
+	// One hit group record per submesh, in the same order as the BLAS geometries
+	std::vector<HitGroupConstants> hitGroupConstants;
+
+	for (auto& submesh : model.Submeshes)
+	{
+		const Material& material = model.Materials[submesh.MaterialIndex];
+		const Texture& baseColorTexture = *model.Textures[material.BaseColorTexture];
+
+		HitGroupConstants constants;
+		constants.IndexOffset = submesh.IndexOffset;
+		constants.BaseColorTextureIndex = baseColorTexture.GetDescriptorIndex(DescriptorType::SRV);
+		constants.TexCoordDensity = submesh.TexCoordDensity;
+		constants.BaseColorResidencyIndex = s_Data.TextureStreamer->GetResidencyIndex(baseColorTexture);
+		hitGroupConstants.push_back(constants);
+	}
+
+	s_Data.RenderPass->GetPipelineState().SetHitGroupRecords(hitGroupConstants, s_Data.TextureStreamer->GetResidencyBufferAddress());
+}
+
 void Renderer::CreateTLAS()
 {
 	// Describe the TLAS geometry instance(s)
@@ -295,7 +406,7 @@ void Renderer::CreateTLAS()
 	instanceDesc.InstanceContributionToHitGroupIndex = 0;
 	instanceDesc.InstanceMask = 0xFF;
 	instanceDesc.Transform[0][0] = instanceDesc.Transform[1][1] = instanceDesc.Transform[2][2] = 1;
-	instanceDesc.AccelerationStructure = s_Data.BLASBuffer->GetD3D12Resource()->GetGPUVirtualAddress();
+	instanceDesc.AccelerationStructure = s_Data.BLASBuffer ? s_Data.BLASBuffer->GetD3D12Resource()->GetGPUVirtualAddress() : 0;
 	instanceDesc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE;
 
 	s_Data.TLASInstanceBuffer = std::make_unique<Buffer>("TLAS instance buffer", BufferDesc(BufferUsage::BUFFER_USAGE_UPLOAD, 1, sizeof(instanceDesc)));
@@ -307,7 +418,7 @@ void Renderer::CreateTLAS()
 	ASInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
 	ASInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
 	ASInputs.InstanceDescs = s_Data.TLASInstanceBuffer->GetD3D12Resource()->GetGPUVirtualAddress();
-	ASInputs.NumDescs = 1;
+	ASInputs.NumDescs = s_Data.BLASBuffer ? 1 : 0;
 	ASInputs.Flags = buildFlags;
 
 	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO ASPreBuildInfo = {};
@@ -341,4 +452,6 @@ void Renderer::CreateTLAS()
 
 	commandList->ResourceBarrier(1, &uavBarrier);
 	RenderBackend::ExecuteCommandList(commandList);
+
+	s_Data.TLASBuffer->CreateShaderResourceView(s_Data.SceneDescriptors.GetCPUDescriptorHandle(SCENE_DESCRIPTOR_TLAS));
 }
@@ -30,13 +30,24 @@ void Shader::Compile()
     args.emplace_back(DXC_ARG_SKIP_OPTIMIZATIONS);
 #endif
 
+    // The wide strings have to outlive the compile call, since args only points into them
+    std::vector<std::wstring> defines;
+    defines.reserve(m_Desc.Defines.size());
+
+    for (auto& define : m_Desc.Defines)
+    {
+        defines.push_back(StringHelper::StringToWString(define));
+        args.emplace_back(L"-D");
+        args.emplace_back(defines.back().c_str());
+    }
+
     uint32_t codePage = 0;
     ComPtr<IDxcBlobEncoding> sourceBlob;
     DX_CALL(library->CreateBlobFromFile(StringHelper::StringToWString(m_Desc.Filepath).c_str(), &codePage, &sourceBlob));
 
-    // Include handler if necessary
-    //ComPtr<IDxcIncludeHandler> dxcIncludeHandler;
-    //DX_CALL(library->CreateIncludeHandler(&dxcIncludeHandler));
+    // Includes are resolved relative to the including shader, e.g. the shared headers in Resources/Shaders/Shared
+    ComPtr<IDxcIncludeHandler> dxcIncludeHandler;
+    DX_CALL(library->CreateIncludeHandler(&dxcIncludeHandler));
 
     ComPtr<IDxcOperationResult> result;
     HRESULT hr = compiler->Compile(
@@ -46,7 +57,7 @@ void Shader::Compile()
         StringHelper::StringToWString(m_Desc.Target).c_str(),
         args.data(), args.size(),
         NULL, 0,
-        NULL,
+        dxcIncludeHandler.Get(),
         &result
     );
 
@@ -13,12 +13,56 @@ DXGI_FORMAT TextureFormatToDXGIFormat(TextureFormat format)
 		return DXGI_FORMAT_R16G16B16A16_FLOAT;
 	case TextureFormat::TEXTURE_FORMAT_DEPTH32:
 		return DXGI_FORMAT_D32_FLOAT;
+	case TextureFormat::TEXTURE_FORMAT_BC1_UNORM:
+		return DXGI_FORMAT_BC1_UNORM;
+	case TextureFormat::TEXTURE_FORMAT_BC3_UNORM:
+		return DXGI_FORMAT_BC3_UNORM;
+	case TextureFormat::TEXTURE_FORMAT_BC5_UNORM:
+		return DXGI_FORMAT_BC5_UNORM;
+	case TextureFormat::TEXTURE_FORMAT_BC7_UNORM:
+		return DXGI_FORMAT_BC7_UNORM;
 	}
 
 	LOG_ERR("Texture format is not supported");
 	return DXGI_FORMAT_R8G8B8A8_UNORM;
 }
 
+bool IsBlockCompressed(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::TEXTURE_FORMAT_BC1_UNORM:
+	case TextureFormat::TEXTURE_FORMAT_BC3_UNORM:
+	case TextureFormat::TEXTURE_FORMAT_BC5_UNORM:
+	case TextureFormat::TEXTURE_FORMAT_BC7_UNORM:
+		return true;
+	}
+
+	return false;
+}
+
+std::size_t GetTextureRowPitch(TextureFormat format, uint32_t width)
+{
+	switch (format)
+	{
+	case TextureFormat::TEXTURE_FORMAT_RGBA16_FLOAT:
+		return static_cast<std::size_t>(width) * 8;
+	case TextureFormat::TEXTURE_FORMAT_BC1_UNORM:
+		return static_cast<std::size_t>((width + 3) / 4) * 8;
+	case TextureFormat::TEXTURE_FORMAT_BC3_UNORM:
+	case TextureFormat::TEXTURE_FORMAT_BC5_UNORM:
+	case TextureFormat::TEXTURE_FORMAT_BC7_UNORM:
+		return static_cast<std::size_t>((width + 3) / 4) * 16;
+	}
+
+	return static_cast<std::size_t>(width) * 4;
+}
+
+uint32_t GetTextureNumRows(TextureFormat format, uint32_t height)
+{
+	return IsBlockCompressed(format) ? (height + 3) / 4 : height;
+}
+
 D3D12_RESOURCE_STATES TextureUsageToDXGIResourceState(TextureUsage usage)
 {
 	switch (usage)
@@ -99,7 +143,7 @@ void Texture::SetName(const std::string& name)
 void Texture::Create()
 {
 	D3D12_RESOURCE_DESC d3d12ResourceDesc = {};
-	d3d12ResourceDesc.MipLevels = 1;
+	d3d12ResourceDesc.MipLevels = static_cast<UINT16>(m_TextureDesc.MipLevels);
 	d3d12ResourceDesc.Width = m_TextureDesc.Width;
 	d3d12ResourceDesc.Height = m_TextureDesc.Height;
 	d3d12ResourceDesc.DepthOrArraySize = 1;
@@ -143,7 +187,7 @@ void Texture::Create()
 	}
 
 	RenderBackend::GetDevice()->CreateTexture(*this, d3d12ResourceDesc, initialState, hasClearValue ? &clearValue : nullptr);
-	m_ByteSize = GetRequiredIntermediateSize(m_d3d12Resource.Get(), 0, 1);
+	m_ByteSize = GetRequiredIntermediateSize(m_d3d12Resource.Get(), 0, m_TextureDesc.MipLevels);
 }
 
 void Texture::CreateViews()
@@ -0,0 +1,126 @@
+#include "Pch.h"
+#include "Graphics/TextureResidency.h"
+
+uint32_t TextureResidency::AddTexture(const std::vector<std::size_t>& mipByteSizes, uint32_t numTailMips)
+{
+	ASSERT(!mipByteSizes.empty(), "Streamed texture has no mips");
+
+	uint32_t numMips = static_cast<uint32_t>(mipByteSizes.size());
+
+	TrackedTexture texture;
+	texture.MipByteSizes = mipByteSizes;
+	texture.MipStates.resize(numMips, MipResidency::MIP_RESIDENCY_QUEUED);
+	texture.MipFenceValues.resize(numMips, 0);
+	texture.NumTailMips = std::clamp(numTailMips, 1u, numMips);
+	texture.ScheduledMip = numMips;
+	texture.ResidentMip = numMips;
+
+	m_Textures.push_back(texture);
+	return static_cast<uint32_t>(m_Textures.size() - 1);
+}
+
+std::vector<MipUpload> TextureResidency::ScheduleUploads(std::size_t byteBudget, uint64_t fenceValue)
+{
+	std::vector<MipUpload> uploads;
+
+	// The mip tail goes first and does not count towards the budget, it is what textures are sampled from until the finer mips arrive
+	for (uint32_t i = 0; i < m_Textures.size(); ++i)
+	{
+		TrackedTexture& texture = m_Textures[i];
+		uint32_t firstTailMip = static_cast<uint32_t>(texture.MipStates.size()) - texture.NumTailMips;
+
+		while (texture.ScheduledMip > firstTailMip)
+			uploads.push_back(ScheduleNextMip(i, fenceValue));
+	}
+
+	// Smallest next mip first, which keeps all textures at a similar resolution while they refine
+	using Candidate = std::pair<std::size_t, uint32_t>;
+	std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+
+	for (uint32_t i = 0; i < m_Textures.size(); ++i)
+	{
+		const TrackedTexture& texture = m_Textures[i];
+		if (texture.ScheduledMip > 0)
+			candidates.push({ texture.MipByteSizes[texture.ScheduledMip - 1], i });
+	}
+
+	std::size_t numScheduledBytes = 0;
+	bool scheduledWithinBudget = false;
+
+	while (!candidates.empty())
+	{
+		Candidate candidate = candidates.top();
+		if (scheduledWithinBudget && numScheduledBytes + candidate.first > byteBudget)
+			break;
+
+		candidates.pop();
+		uploads.push_back(ScheduleNextMip(candidate.second, fenceValue));
+		numScheduledBytes += candidate.first;
+		scheduledWithinBudget = true;
+
+		const TrackedTexture& texture = m_Textures[candidate.second];
+		if (texture.ScheduledMip > 0)
+			candidates.push({ texture.MipByteSizes[texture.ScheduledMip - 1], candidate.second });
+	}
+
+	return uploads;
+}
+
+std::vector<uint32_t> TextureResidency::CompleteUploads(uint64_t completedFenceValue)
+{
+	std::vector<uint32_t> changedTextures;
+
+	for (uint32_t i = 0; i < m_Textures.size(); ++i)
+	{
+		TrackedTexture& texture = m_Textures[i];
+		uint32_t residentMip = texture.ResidentMip;
+
+		// Uploads are scheduled from the coarsest mip on with increasing fence values, so they also complete in that order
+		while (texture.ResidentMip > texture.ScheduledMip)
+		{
+			uint32_t mip = texture.ResidentMip - 1;
+			if (texture.MipFenceValues[mip] > completedFenceValue)
+				break;
+
+			texture.MipStates[mip] = MipResidency::MIP_RESIDENCY_RESIDENT;
+			texture.ResidentMip = mip;
+			m_NumUploadingBytes -= texture.MipByteSizes[mip];
+		}
+
+		if (texture.ResidentMip != residentMip)
+			changedTextures.push_back(i);
+	}
+
+	return changedTextures;
+}
+
+uint32_t TextureResidency::GetResidentMip(uint32_t textureIndex) const
+{
+	return m_Textures[textureIndex].ResidentMip;
+}
+
+MipResidency TextureResidency::GetMipResidency(uint32_t textureIndex, uint32_t mipLevel) const
+{
+	return m_Textures[textureIndex].MipStates[mipLevel];
+}
+
+bool TextureResidency::IsFullyResident(uint32_t textureIndex) const
+{
+	return m_Textures[textureIndex].ResidentMip == 0;
+}
+
+MipUpload TextureResidency::ScheduleNextMip(uint32_t textureIndex, uint64_t fenceValue)
+{
+	TrackedTexture& texture = m_Textures[textureIndex];
+	uint32_t mip = --texture.ScheduledMip;
+
+	texture.MipStates[mip] = MipResidency::MIP_RESIDENCY_UPLOADING;
+	texture.MipFenceValues[mip] = fenceValue;
+	m_NumUploadingBytes += texture.MipByteSizes[mip];
+
+	MipUpload upload;
+	upload.TextureIndex = textureIndex;
+	upload.MipLevel = mip;
+	upload.ByteSize = texture.MipByteSizes[mip];
+	return upload;
+}
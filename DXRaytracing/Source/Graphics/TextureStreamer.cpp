@@ -0,0 +1,127 @@
+#include "Pch.h"
+#include "Graphics/TextureStreamer.h"
+#include "Graphics/Buffer.h"
+#include "Graphics/Texture.h"
+#include "Graphics/Backend/CommandList.h"
+
+TextureStreamer::TextureStreamer(const TextureStreamerDesc& desc)
+	: m_Desc(desc)
+{
+	// Index 0 belongs to all textures that are not streamed, their most detailed mip is always resident
+	m_ResidentMips.resize(m_Desc.MaxTextures + 1, 0);
+	m_ResidencyBuffer = std::make_unique<Buffer>("Texture residency buffer", BufferDesc(BufferUsage::BUFFER_USAGE_READ,
+		m_ResidentMips.size(), sizeof(uint32_t)), m_ResidentMips.data());
+}
+
+TextureStreamer::~TextureStreamer()
+{
+}
+
+uint32_t TextureStreamer::AddTexture(const std::shared_ptr<Texture>& texture, const void* mipData, std::shared_ptr<const void> storage)
+{
+	ASSERT(m_Textures.size() < m_Desc.MaxTextures, "Texture streamer is out of residency buffer entries");
+
+	TextureDesc textureDesc = texture->GetTextureDesc();
+
+	PendingTexture pendingTexture;
+	pendingTexture.Resource = texture;
+	pendingTexture.MipData = static_cast<const unsigned char*>(mipData);
+	pendingTexture.Storage = storage;
+
+	std::vector<std::size_t> mipByteSizes;
+	uint32_t mipWidth = textureDesc.Width, mipHeight = textureDesc.Height;
+	uint32_t numTailMips = 0;
+	std::size_t mipOffset = 0;
+
+	for (uint32_t mip = 0; mip < textureDesc.MipLevels; ++mip)
+	{
+		std::size_t mipByteSize = GetTextureRowPitch(textureDesc.Format, mipWidth) * GetTextureNumRows(textureDesc.Format, mipHeight);
+		mipByteSizes.push_back(mipByteSize);
+		pendingTexture.MipOffsets.push_back(mipOffset);
+		mipOffset += mipByteSize;
+
+		if (std::max(mipWidth, mipHeight) <= m_Desc.MipTailSize)
+			numTailMips++;
+
+		mipWidth = std::max(1u, mipWidth / 2);
+		mipHeight = std::max(1u, mipHeight / 2);
+	}
+
+	uint32_t textureIndex = m_Residency.AddTexture(mipByteSizes, numTailMips);
+	m_Textures.push_back(pendingTexture);
+	m_NumStreamingTextures++;
+
+	uint32_t residencyIndex = textureIndex + 1;
+	m_ResidentMips[residencyIndex] = m_Residency.GetResidentMip(textureIndex);
+	m_ResidencyIndices[texture.get()] = residencyIndex;
+	m_IsResidencyDirty = true;
+
+	return residencyIndex;
+}
+
+uint32_t TextureStreamer::GetResidencyIndex(const Texture& texture) const
+{
+	auto iter = m_ResidencyIndices.find(&texture);
+	return iter != m_ResidencyIndices.end() ? iter->second : 0;
+}
+
+void TextureStreamer::Update(CommandList& commandList)
+{
+	if (m_NumStreamingTextures == 0)
+		return;
+
+	uint64_t fenceValue = ++m_NumUpdates;
+	std::vector<MipUpload> uploads = m_Residency.ScheduleUploads(m_Desc.UploadBudget, fenceValue);
+	if (uploads.empty() && !m_IsResidencyDirty)
+		return;
+
+	// All mips of this frame and the residency update share one upload buffer, which the command list keeps alive until it completes
+	std::vector<std::size_t> uploadOffsets;
+	std::size_t uploadBufferSize = 0;
+
+	for (auto& upload : uploads)
+	{
+		uploadBufferSize = MathHelper::AlignUp(uploadBufferSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		uploadOffsets.push_back(uploadBufferSize);
+		uploadBufferSize += GetRequiredIntermediateSize(m_Textures[upload.TextureIndex].Resource->GetD3D12Resource().Get(), upload.MipLevel, 1);
+	}
+
+	std::size_t residencyOffset = MathHelper::AlignUp(uploadBufferSize, sizeof(uint32_t));
+	std::size_t residencyByteSize = (m_Textures.size() + 1) * sizeof(uint32_t);
+	uploadBufferSize = residencyOffset + residencyByteSize;
+
+	Buffer uploadBuffer("Texture streaming upload buffer", BufferDesc(BufferUsage::BUFFER_USAGE_UPLOAD, 1, uploadBufferSize));
+
+	for (std::size_t i = 0; i < uploads.size(); ++i)
+	{
+		PendingTexture& texture = m_Textures[uploads[i].TextureIndex];
+		commandList.CopyTextureMips(uploadBuffer, uploadOffsets[i], *texture.Resource, uploads[i].MipLevel, 1,
+			texture.MipData + texture.MipOffsets[uploads[i].MipLevel]);
+	}
+
+	// The copies above execute before anything recorded after them on the same queue, so the new mips are resident from here on
+	std::vector<uint32_t> changedTextures = m_Residency.CompleteUploads(fenceValue);
+
+	for (uint32_t textureIndex : changedTextures)
+	{
+		m_ResidentMips[textureIndex + 1] = m_Residency.GetResidentMip(textureIndex);
+
+		if (m_Residency.IsFullyResident(textureIndex))
+		{
+			// Index 0 is fully resident as well, so textures looked up from now on do not need their own entry
+			PendingTexture& texture = m_Textures[textureIndex];
+			m_ResidencyIndices.erase(texture.Resource.get());
+			texture = PendingTexture();
+			m_NumStreamingTextures--;
+		}
+	}
+
+	uploadBuffer.SetBufferDataAtOffset(m_ResidentMips.data(), residencyByteSize, residencyOffset);
+	commandList.CopyBufferRegion(uploadBuffer, residencyOffset, *m_ResidencyBuffer, 0, residencyByteSize);
+	m_IsResidencyDirty = false;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS TextureStreamer::GetResidencyBufferAddress() const
+{
+	return m_ResidencyBuffer->GetD3D12Resource()->GetGPUVirtualAddress();
+}
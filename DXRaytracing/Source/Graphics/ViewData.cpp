@@ -0,0 +1,35 @@
+#include "Pch.h"
+#include "Graphics/ViewData.h"
+#include "Scene/Camera.h"
+
+ViewData ViewData::FromCamera(const Camera& camera, const glm::vec2& resolution)
+{
+	glm::mat4 viewAtOrigin = camera.GetViewMatrix();
+	glm::mat4 projection = camera.GetProjectionMatrix();
+
+	// The hit shader derives the ray cone spread angle from the vertical field of view
+	ViewData viewData;
+	viewData.ViewOriginAndTanHalfFovY = glm::vec4(viewAtOrigin[3][0],
+		viewAtOrigin[3][1], viewAtOrigin[3][2], 1.0f / projection[1][1]);
+
+	viewAtOrigin[3][0] = 0.0f;
+	viewAtOrigin[3][1] = 0.0f;
+	viewAtOrigin[3][2] = 0.0f;
+
+	viewData.ViewProjection = projection * viewAtOrigin;
+	viewData.Resolution = resolution;
+
+	return viewData;
+}
+
+glm::vec3 ViewData::GetRayDirection(uint32_t x, uint32_t y) const
+{
+	glm::vec2 screenPos = (glm::vec2(x, y) + 0.5f) / Resolution * 2.0f - 1.0f;
+	screenPos.y = -screenPos.y;
+
+	// The shader multiplies with the vector on the left, which glm does as well when the vector comes first
+	glm::vec4 world = glm::vec4(screenPos, 0.0f, 1.0f) * ViewProjection;
+	float aspectRatio = Resolution.x / Resolution.y;
+
+	return glm::normalize(glm::vec3(world.x * aspectRatio, world.y, world.z));
+}
@@ -26,6 +26,7 @@ bool InputHandler::IsKeyPressed(KeyCode key)
 	return m_KeyStates[key];
 }
 
+#ifdef _WIN32
 KeyCode InputHandler::WParamToKeyCode(WPARAM wParam)
 {
 	switch (wParam)
@@ -56,6 +57,7 @@ KeyCode InputHandler::WParamToKeyCode(WPARAM wParam)
 		return KeyCode::E;
 	}
 }
+#endif
 
 float InputHandler::GetInputAxis1D(KeyCode positiveX, KeyCode negativeX)
 {
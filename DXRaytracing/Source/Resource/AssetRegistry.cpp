@@ -0,0 +1,313 @@
+#include "Pch.h"
+#include "Resource/AssetRegistry.h"
+
+#include <list>
+
+struct AssetEntry
+{
+	std::shared_ptr<void> Resource;
+	std::size_t GPUByteSize = 0;
+	std::shared_ptr<const void> CPUData;
+	std::size_t CPUByteSize = 0;
+
+	AssetReloadFunction Reload;
+	bool IsReloadableFromSource = false;
+
+	// Every copy of the handle shares its reference count, so the asset is referenced until the handle expires
+	std::weak_ptr<void> Handle;
+	uint64_t HandleID = 0;
+
+	std::list<uint64_t>::iterator LRUPosition;
+};
+
+struct AssetRegistryData
+{
+	std::string Name;
+	AssetBudget Budget;
+
+	std::unordered_map<uint64_t, AssetEntry> Entries;
+	// Content hashes of every asset, from the least to the most recently used
+	std::list<uint64_t> LRU;
+	uint64_t NumHandles = 0;
+
+	std::size_t CPUByteSize = 0;
+	std::size_t GPUByteSize = 0;
+	AssetRegistryStats Stats;
+
+	std::mutex Mutex;
+};
+
+static bool CanReload(const AssetEntry& entry)
+{
+	return entry.Reload && (entry.CPUData || entry.IsReloadableFromSource);
+}
+
+static void Touch(AssetRegistryData& data, AssetEntry& entry)
+{
+	data.LRU.splice(data.LRU.end(), data.LRU, entry.LRUPosition);
+}
+
+static void PublishStats(AssetRegistryData& data)
+{
+	Profiler& profiler = Profiler::Get();
+	profiler.SetCounter(data.Name + " CPU bytes", data.CPUByteSize);
+	profiler.SetCounter(data.Name + " CPU budget", data.Budget.MaxCPUByteSize);
+	profiler.SetCounter(data.Name + " GPU bytes", data.GPUByteSize);
+	profiler.SetCounter(data.Name + " GPU budget", data.Budget.MaxGPUByteSize);
+	profiler.SetCounter(data.Name + " hits", data.Stats.NumHits);
+	profiler.SetCounter(data.Name + " misses", data.Stats.NumMisses);
+	profiler.SetCounter(data.Name + " reloads", data.Stats.NumReloads);
+	profiler.SetCounter(data.Name + " evictions", data.Stats.NumEvictions);
+	profiler.SetCounter(data.Name + " evicted bytes", data.Stats.NumBytesEvicted);
+}
+
+/* Evict the resources of unreferenced assets and the CPU data of any asset, least recently used first, until both fit their budget.
+   Evicted resources are moved out, so they are destroyed after the registry is unlocked */
+static void EnforceBudget(AssetRegistryData& data, std::vector<std::shared_ptr<void>>& evictedResources)
+{
+	for (auto iter = data.LRU.begin(); iter != data.LRU.end();)
+	{
+		if (data.GPUByteSize <= data.Budget.MaxGPUByteSize && data.CPUByteSize <= data.Budget.MaxCPUByteSize)
+			break;
+
+		AssetEntry& entry = data.Entries.at(*iter);
+
+		if (data.GPUByteSize > data.Budget.MaxGPUByteSize && entry.Resource && entry.Handle.expired())
+		{
+			evictedResources.push_back(std::move(entry.Resource));
+			data.GPUByteSize -= entry.GPUByteSize;
+			data.Stats.NumEvictions++;
+			data.Stats.NumBytesEvicted += entry.GPUByteSize;
+		}
+
+		// The CPU data is only needed again once the resource is evicted, so it goes first even for referenced assets
+		if (data.CPUByteSize > data.Budget.MaxCPUByteSize && entry.CPUData)
+		{
+			entry.CPUData = nullptr;
+			data.CPUByteSize -= entry.CPUByteSize;
+			data.Stats.NumEvictions++;
+			data.Stats.NumBytesEvicted += entry.CPUByteSize;
+		}
+
+		if (!entry.Resource && !CanReload(entry))
+		{
+			data.CPUByteSize -= entry.CPUData ? entry.CPUByteSize : 0;
+			data.Entries.erase(*iter);
+			iter = data.LRU.erase(iter);
+		}
+		else
+			++iter;
+	}
+}
+
+/* Copies of a handle share one reference to the resource, when the last copy is released the asset is handed back to the registry */
+struct AssetHandleRelease
+{
+	std::weak_ptr<AssetRegistryData> Data;
+	uint64_t ContentHash = 0;
+	uint64_t HandleID = 0;
+
+	void operator()(std::shared_ptr<void>* resource) const
+	{
+		std::vector<std::shared_ptr<void>> evictedResources;
+
+		if (std::shared_ptr<AssetRegistryData> data = Data.lock())
+		{
+			std::lock_guard<std::mutex> lock(data->Mutex);
+
+			// The asset might have been forgotten, or handed out under a new handle in the meantime
+			auto iter = data->Entries.find(ContentHash);
+			if (iter != data->Entries.end() && iter->second.HandleID == HandleID)
+			{
+				Touch(*data, iter->second);
+				EnforceBudget(*data, evictedResources);
+				PublishStats(*data);
+			}
+		}
+
+		delete resource;
+	}
+};
+
+static std::shared_ptr<void> GetHandle(const std::shared_ptr<AssetRegistryData>& data, uint64_t contentHash, AssetEntry& entry)
+{
+	std::shared_ptr<void> handle = entry.Handle.lock();
+	if (handle)
+		return handle;
+
+	entry.HandleID = ++data->NumHandles;
+
+	// The handle owns a reference of its own, so it stays valid after the registry forgot the asset
+	std::shared_ptr<void> reference(new std::shared_ptr<void>(entry.Resource), AssetHandleRelease{ data, contentHash, entry.HandleID });
+	handle = std::shared_ptr<void>(reference, entry.Resource.get());
+	entry.Handle = handle;
+
+	return handle;
+}
+
+AssetRegistry::AssetRegistry(const std::string& name, const AssetBudget& budget)
+	: m_Data(std::make_shared<AssetRegistryData>())
+{
+	m_Data->Name = name;
+	m_Data->Budget = budget;
+}
+
+std::shared_ptr<void> AssetRegistry::FindAsset(uint64_t contentHash, bool reload)
+{
+	std::vector<std::shared_ptr<void>> evictedResources;
+	AssetReloadFunction reloadFunction;
+	std::shared_ptr<const void> cpuData;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Data->Mutex);
+
+		auto iter = m_Data->Entries.find(contentHash);
+		if (iter != m_Data->Entries.end() && iter->second.Resource)
+		{
+			AssetEntry& entry = iter->second;
+			Touch(*m_Data, entry);
+
+			m_Data->Stats.NumHits++;
+			m_Data->Stats.NumBytesSaved += entry.GPUByteSize;
+			PublishStats(*m_Data);
+
+			return GetHandle(m_Data, contentHash, entry);
+		}
+
+		if (!reload || iter == m_Data->Entries.end() || !CanReload(iter->second))
+		{
+			m_Data->Stats.NumMisses++;
+			PublishStats(*m_Data);
+			return nullptr;
+		}
+
+		reloadFunction = iter->second.Reload;
+		cpuData = iter->second.CPUData;
+	}
+
+	// Reloads can take a while and create GPU resources, so they run without holding the registry
+	AssetDesc desc;
+	desc.Resource = reloadFunction(cpuData);
+
+	if (!desc.Resource)
+	{
+		std::lock_guard<std::mutex> lock(m_Data->Mutex);
+
+		// The source is gone, so the asset can only come back by being inserted again
+		auto iter = m_Data->Entries.find(contentHash);
+		if (iter != m_Data->Entries.end() && !iter->second.Resource)
+		{
+			m_Data->CPUByteSize -= iter->second.CPUData ? iter->second.CPUByteSize : 0;
+			m_Data->LRU.erase(iter->second.LRUPosition);
+			m_Data->Entries.erase(iter);
+		}
+
+		m_Data->Stats.NumMisses++;
+		PublishStats(*m_Data);
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Data->Mutex);
+
+	// Only the resource was evicted, the asset keeps its CPU data and the way to reload it. It might have been forgotten or
+	// inserted by another thread in the meantime
+	auto iter = m_Data->Entries.find(contentHash);
+	if (iter == m_Data->Entries.end())
+		return desc.Resource;
+
+	AssetEntry& entry = iter->second;
+	if (!entry.Resource)
+	{
+		entry.Resource = desc.Resource;
+		m_Data->GPUByteSize += entry.GPUByteSize;
+		m_Data->Stats.NumReloads++;
+	}
+
+	Touch(*m_Data, entry);
+	std::shared_ptr<void> handle = GetHandle(m_Data, contentHash, entry);
+
+	EnforceBudget(*m_Data, evictedResources);
+	PublishStats(*m_Data);
+
+	return handle;
+}
+
+std::shared_ptr<void> AssetRegistry::InsertAsset(uint64_t contentHash, const AssetDesc& desc)
+{
+	std::vector<std::shared_ptr<void>> evictedResources;
+	std::lock_guard<std::mutex> lock(m_Data->Mutex);
+
+	auto [iter, isInserted] = m_Data->Entries.try_emplace(contentHash);
+	AssetEntry& entry = iter->second;
+
+	if (isInserted)
+		entry.LRUPosition = m_Data->LRU.insert(m_Data->LRU.end(), contentHash);
+	else if (!entry.Resource)
+		m_Data->Stats.NumReloads++;
+
+	if (!entry.Resource)
+	{
+		if (entry.CPUData)
+			m_Data->CPUByteSize -= entry.CPUByteSize;
+
+		entry.Resource = desc.Resource;
+		entry.GPUByteSize = desc.GPUByteSize;
+		entry.CPUData = desc.CPUData;
+		entry.CPUByteSize = desc.CPUData ? desc.CPUByteSize : 0;
+		entry.Reload = desc.Reload;
+		entry.IsReloadableFromSource = desc.IsReloadableFromSource;
+
+		m_Data->GPUByteSize += entry.GPUByteSize;
+		m_Data->CPUByteSize += entry.CPUByteSize;
+	}
+
+	Touch(*m_Data, entry);
+	std::shared_ptr<void> handle = GetHandle(m_Data, contentHash, entry);
+
+	EnforceBudget(*m_Data, evictedResources);
+	PublishStats(*m_Data);
+
+	return handle;
+}
+
+void AssetRegistry::SetBudget(const AssetBudget& budget)
+{
+	std::vector<std::shared_ptr<void>> evictedResources;
+	std::lock_guard<std::mutex> lock(m_Data->Mutex);
+
+	m_Data->Budget = budget;
+	EnforceBudget(*m_Data, evictedResources);
+	PublishStats(*m_Data);
+}
+
+void AssetRegistry::Clear()
+{
+	std::unordered_map<uint64_t, AssetEntry> entries;
+	std::lock_guard<std::mutex> lock(m_Data->Mutex);
+
+	entries.swap(m_Data->Entries);
+	m_Data->LRU.clear();
+	m_Data->CPUByteSize = 0;
+	m_Data->GPUByteSize = 0;
+	m_Data->Stats = {};
+	PublishStats(*m_Data);
+}
+
+AssetRegistryStats AssetRegistry::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Data->Mutex);
+
+	AssetRegistryStats stats = m_Data->Stats;
+	stats.NumAssets = static_cast<uint32_t>(m_Data->Entries.size());
+	stats.CPUByteSize = m_Data->CPUByteSize;
+	stats.GPUByteSize = m_Data->GPUByteSize;
+	stats.Budget = m_Data->Budget;
+
+	for (auto& [contentHash, entry] : m_Data->Entries)
+	{
+		stats.NumResidentAssets += entry.Resource ? 1 : 0;
+		stats.NumReferencedAssets += entry.Handle.expired() ? 0 : 1;
+	}
+
+	return stats;
+}
@@ -0,0 +1,313 @@
+#include "Pch.h"
+#include "Resource/BVHBuilder.h"
+
+struct BVHBin
+{
+	BVHBounds Bounds;
+	uint32_t NumTriangles = 0;
+};
+
+struct BVHBuildTask
+{
+	uint32_t NodeIndex = 0;
+	uint32_t Begin = 0;
+	uint32_t End = 0;
+	uint32_t Depth = 0;
+};
+
+struct BVHSplit
+{
+	uint32_t Axis = 0;
+	// Bins up to and including the plane go to the left child
+	uint32_t Plane = 0;
+	float Cost = std::numeric_limits<float>::max();
+	BVHBounds LeftBounds;
+	BVHBounds RightBounds;
+};
+
+static uint32_t GetBin(float centroid, float centroidMin, float binScale, uint32_t numBins)
+{
+	return std::min(numBins - 1, static_cast<uint32_t>((centroid - centroidMin) * binScale));
+}
+
+static void SetNodeBounds(BVHNode& node, const BVHBounds& bounds)
+{
+	node.BoundsMin = bounds.Min;
+	node.BoundsMax = bounds.Max;
+}
+
+/* Levels of splits in half by count until no node holds more than maxLeafSize triangles */
+static uint32_t GetNumHalvingLevels(uint32_t count, uint32_t maxLeafSize)
+{
+	uint32_t numLevels = 0;
+	for (; count > maxLeafSize; count = count - count / 2)
+		numLevels++;
+
+	return numLevels;
+}
+
+/* Bin the triangles along all three axes in one pass, then sweep the bins of every axis for the split plane with the lowest SAH cost.
+   The cost is relative to the area of the node */
+static BVHSplit FindSplit(const std::vector<BVHBounds>& triangleBounds, const std::vector<glm::vec3>& centroids, const uint32_t* order,
+	uint32_t numTriangles, const BVHBounds& centroidBounds, const BVHBuildDesc& desc, std::vector<BVHBin>& bins, std::vector<float>& rightCosts,
+	std::vector<BVHBounds>& rightBounds)
+{
+	BVHSplit split;
+
+	glm::vec3 extent = centroidBounds.Max - centroidBounds.Min;
+	glm::vec3 binScale(0.0f);
+	for (uint32_t axis = 0; axis < 3; ++axis)
+		binScale[axis] = extent[axis] > 0.0f ? desc.NumBins / extent[axis] : 0.0f;
+
+	std::fill(bins.begin(), bins.end(), BVHBin());
+
+	for (uint32_t i = 0; i < numTriangles; ++i)
+	{
+		const BVHBounds& bounds = triangleBounds[order[i]];
+		const glm::vec3& centroid = centroids[order[i]];
+
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			BVHBin& bin = bins[axis * desc.NumBins + GetBin(centroid[axis], centroidBounds.Min[axis], binScale[axis], desc.NumBins)];
+			bin.Bounds.Grow(bounds);
+			bin.NumTriangles++;
+		}
+	}
+
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		if (extent[axis] <= 0.0f)
+			continue;
+
+		const BVHBin* axisBins = bins.data() + axis * desc.NumBins;
+
+		// Area times triangle count of everything right of each plane, swept from the last bin
+		BVHBounds right;
+		uint32_t numRight = 0;
+		for (uint32_t plane = desc.NumBins - 1; plane > 0; --plane)
+		{
+			right.Grow(axisBins[plane].Bounds);
+			numRight += axisBins[plane].NumTriangles;
+			rightCosts[plane - 1] = right.GetHalfArea() * numRight;
+			rightBounds[plane - 1] = right;
+		}
+
+		BVHBounds left;
+		uint32_t numLeft = 0;
+		for (uint32_t plane = 0; plane < desc.NumBins - 1; ++plane)
+		{
+			left.Grow(axisBins[plane].Bounds);
+			numLeft += axisBins[plane].NumTriangles;
+			if (numLeft == 0 || numLeft == numTriangles)
+				continue;
+
+			float cost = left.GetHalfArea() * numLeft + rightCosts[plane];
+			if (cost < split.Cost)
+			{
+				split.Axis = axis;
+				split.Plane = plane;
+				split.Cost = cost;
+				split.LeftBounds = left;
+				split.RightBounds = rightBounds[plane];
+			}
+		}
+	}
+
+	return split;
+}
+
+/*
+	Every node is binned along the axes of its triangle centroids, the split with the lowest SAH cost wins over a leaf when it is cheaper
+	or when the node holds more than the maximum leaf size. Triangles whose centroids all coincide cannot be binned and are split in half
+	by count instead, and so are nodes that the SAH could no longer bring down to the leaf size within the maximum depth. Children are
+	allocated as pairs in the order the nodes are split, depth first from the left.
+*/
+BVHBuildStats BVHBuilder::Build(const Vertex* vertices, std::size_t numVertices, const void* indices, uint32_t indexByteSize,
+	const std::vector<Submesh>& submeshes, const BVHBuildDesc& desc, BVH& bvh)
+{
+	ASSERT(desc.MaxLeafSize > 0 && desc.NumBins >= 2 && desc.MaxDepth <= BVH_MAX_DEPTH, "BVH build options are out of range");
+	ASSERT(indexByteSize == sizeof(uint16_t) || indexByteSize == sizeof(uint32_t), "BVH indices have to be 16 or 32 bit");
+
+	auto startTime = std::chrono::steady_clock::now();
+	bvh = BVH();
+
+	std::size_t numTriangles = 0;
+	for (auto& submesh : submeshes)
+		numTriangles += submesh.NumIndices / 3;
+
+	if (numTriangles == 0)
+		return BVHBuildStats();
+
+	auto getIndex = [indices, indexByteSize](std::size_t i) {
+		return indexByteSize == sizeof(uint16_t) ? static_cast<const uint16_t*>(indices)[i] : static_cast<const uint32_t*>(indices)[i];
+	};
+
+	std::vector<BVHTriangle> triangles(numTriangles);
+	std::vector<uint32_t> triangleIndices(numTriangles);
+	std::vector<BVHBounds> triangleBounds(numTriangles);
+	std::vector<glm::vec3> centroids(numTriangles);
+	BVHBounds rootBounds;
+
+	std::size_t t = 0;
+	for (auto& submesh : submeshes)
+	{
+		for (uint32_t i = 0; i + 3 <= submesh.NumIndices; i += 3, ++t)
+		{
+			std::size_t first = static_cast<std::size_t>(submesh.IndexOffset) + i;
+			uint32_t i0 = getIndex(first), i1 = getIndex(first + 1), i2 = getIndex(first + 2);
+			ASSERT(i0 < numVertices && i1 < numVertices && i2 < numVertices, "BVH triangle index is out of range");
+
+			triangles[t] = { vertices[i0].Position, vertices[i1].Position, vertices[i2].Position };
+			triangleIndices[t] = static_cast<uint32_t>(first / 3);
+
+			triangleBounds[t].Grow(triangles[t].V0);
+			triangleBounds[t].Grow(triangles[t].V1);
+			triangleBounds[t].Grow(triangles[t].V2);
+			centroids[t] = (triangleBounds[t].Min + triangleBounds[t].Max) * 0.5f;
+			rootBounds.Grow(triangleBounds[t]);
+		}
+	}
+
+	std::vector<uint32_t> order(numTriangles);
+	std::iota(order.begin(), order.end(), 0);
+
+	// A binary tree with at least one triangle per leaf never has more nodes than this
+	bvh.Nodes.reserve(numTriangles * 2 - 1);
+	bvh.Nodes.emplace_back();
+	SetNodeBounds(bvh.Nodes[0], rootBounds);
+
+	std::vector<BVHBin> bins(desc.NumBins * 3);
+	std::vector<float> rightCosts(desc.NumBins - 1);
+	std::vector<BVHBounds> rightBounds(desc.NumBins - 1);
+
+	std::vector<BVHBuildTask> stack;
+	stack.push_back({ 0, 0, static_cast<uint32_t>(numTriangles), 0 });
+
+	while (!stack.empty())
+	{
+		BVHBuildTask task = stack.back();
+		stack.pop_back();
+
+		uint32_t count = task.End - task.Begin;
+		uint32_t* nodeOrder = order.data() + task.Begin;
+		BVHBounds nodeBounds(bvh.Nodes[task.NodeIndex]);
+
+		BVHSplit split;
+		uint32_t middle = task.Begin;
+
+		if (count > 1 && task.Depth < desc.MaxDepth)
+		{
+			BVHBounds centroidBounds;
+			for (uint32_t i = 0; i < count; ++i)
+				centroidBounds.Grow(centroids[nodeOrder[i]]);
+
+			// From here on only splits in half are sure to reach the leaf size before the maximum depth
+			bool isNearMaxDepth = count > desc.MaxLeafSize && task.Depth + GetNumHalvingLevels(count, desc.MaxLeafSize) >= desc.MaxDepth;
+			if (!isNearMaxDepth)
+				split = FindSplit(triangleBounds, centroids, nodeOrder, count, centroidBounds, desc, bins, rightCosts, rightBounds);
+
+			// Costs are scaled by the area of the node, which keeps nodes of zero area comparable
+			float nodeArea = nodeBounds.GetHalfArea();
+			float leafCost = desc.IntersectionCost * count * nodeArea;
+			float splitCost = desc.TraversalCost * nodeArea + desc.IntersectionCost * split.Cost;
+
+			if (split.Cost < std::numeric_limits<float>::max() && (splitCost < leafCost || count > desc.MaxLeafSize))
+			{
+				float centroidMin = centroidBounds.Min[split.Axis];
+				float binScale = desc.NumBins / (centroidBounds.Max[split.Axis] - centroidMin);
+
+				uint32_t* partition = std::partition(nodeOrder, nodeOrder + count, [&](uint32_t triangle) {
+					return GetBin(centroids[triangle][split.Axis], centroidMin, binScale, desc.NumBins) <= split.Plane;
+				});
+				middle = task.Begin + static_cast<uint32_t>(partition - nodeOrder);
+			}
+			else if (count > desc.MaxLeafSize)
+			{
+				middle = task.Begin + count / 2;
+
+				// Halves along the longest axis of the centroids, ties are broken by triangle so the result only depends on the input
+				glm::vec3 extent = centroidBounds.Max - centroidBounds.Min;
+				uint32_t axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+				std::nth_element(nodeOrder, nodeOrder + count / 2, nodeOrder + count, [&centroids, axis](uint32_t lhs, uint32_t rhs) {
+					return centroids[lhs][axis] < centroids[rhs][axis] || (centroids[lhs][axis] == centroids[rhs][axis] && lhs < rhs);
+				});
+
+				split.LeftBounds = BVHBounds();
+				split.RightBounds = BVHBounds();
+
+				for (uint32_t i = task.Begin; i < task.End; ++i)
+					(i < middle ? split.LeftBounds : split.RightBounds).Grow(triangleBounds[order[i]]);
+			}
+		}
+
+		if (middle == task.Begin)
+		{
+			bvh.Nodes[task.NodeIndex].LeftFirst = task.Begin;
+			bvh.Nodes[task.NodeIndex].NumTriangles = count;
+			continue;
+		}
+
+		uint32_t leftIndex = static_cast<uint32_t>(bvh.Nodes.size());
+		bvh.Nodes[task.NodeIndex].LeftFirst = leftIndex;
+		bvh.Nodes.resize(bvh.Nodes.size() + 2);
+		SetNodeBounds(bvh.Nodes[leftIndex], split.LeftBounds);
+		SetNodeBounds(bvh.Nodes[leftIndex + 1], split.RightBounds);
+
+		stack.push_back({ leftIndex + 1, middle, task.End, task.Depth + 1 });
+		stack.push_back({ leftIndex, task.Begin, middle, task.Depth + 1 });
+	}
+
+	bvh.Triangles.resize(numTriangles);
+	bvh.TriangleIndices.resize(numTriangles);
+	for (std::size_t i = 0; i < numTriangles; ++i)
+	{
+		bvh.Triangles[i] = triangles[order[i]];
+		bvh.TriangleIndices[i] = triangleIndices[order[i]];
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+	BVHBuildStats stats = ComputeStats(bvh, desc);
+	stats.BuildDuration = elapsed.count();
+
+	return stats;
+}
+
+BVHBuildStats BVHBuilder::ComputeStats(const BVH& bvh, const BVHBuildDesc& desc)
+{
+	BVHBuildStats stats;
+	stats.NumNodes = bvh.Nodes.size();
+	stats.NumTriangles = bvh.Triangles.size();
+
+	if (bvh.Nodes.empty())
+		return stats;
+
+	float rootArea = BVHBounds(bvh.Nodes[0]).GetHalfArea();
+	std::vector<std::pair<uint32_t, uint32_t>> stack = { { 0, 0 } };
+
+	while (!stack.empty())
+	{
+		auto [nodeIndex, depth] = stack.back();
+		stack.pop_back();
+
+		const BVHNode& node = bvh.Nodes[nodeIndex];
+		float areaRatio = rootArea > 0.0f ? BVHBounds(node).GetHalfArea() / rootArea : 1.0f;
+		stats.MaxDepth = std::max(stats.MaxDepth, depth);
+
+		if (node.IsLeaf())
+		{
+			stats.NumLeaves++;
+			stats.MaxLeafSize = std::max(stats.MaxLeafSize, node.NumTriangles);
+			stats.SAHCost += desc.IntersectionCost * node.NumTriangles * areaRatio;
+		}
+		else
+		{
+			stats.SAHCost += desc.TraversalCost * areaRatio;
+			stack.push_back({ node.LeftFirst, depth + 1 });
+			stack.push_back({ node.LeftFirst + 1, depth + 1 });
+		}
+	}
+
+	stats.AverageLeafSize = static_cast<float>(stats.NumTriangles) / stats.NumLeaves;
+	return stats;
+}
@@ -0,0 +1,600 @@
+#include "Pch.h"
+#include "Resource/BVHTraversal.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define BVH_TRAVERSAL_SSE
+#include <immintrin.h>
+#endif
+
+#if defined(BVH_TRAVERSAL_SSE) && defined(__AVX2__)
+#define BVH_TRAVERSAL_AVX2
+#endif
+
+// A single ray pushes at most one node per level above the current one, a packet the sibling on every level and both children of the
+// last node it popped
+static constexpr uint32_t MAX_STACK_SIZE = BVH_MAX_DEPTH + 1;
+// Slab exit distances are scaled up by 2 gamma(3) so rounding never culls a box the ray touches
+static constexpr float ROBUST_EXIT_SCALE = 1.0000004f;
+
+/* Ray with everything the box and triangle tests need precomputed */
+struct TraversalRay
+{
+	glm::vec3 Origin = glm::vec3(0.0f);
+	glm::vec3 InvDirection = glm::vec3(0.0f);
+	float TMin = 0.0f;
+	float TMax = 0.0f;
+
+	// The watertight test shears triangles into a space where the ray runs along +Kz from the origin
+	uint32_t Kx = 0;
+	uint32_t Ky = 0;
+	uint32_t Kz = 0;
+	glm::vec3 Shear = glm::vec3(0.0f);
+};
+
+static float SafeReciprocal(float x)
+{
+	// Keeps slab distances finite for axis aligned rays, a box plane through the origin gives 0 instead of NaN
+	return std::abs(x) > 1e-30f ? 1.0f / x : std::copysign(1e+30f, x);
+}
+
+static TraversalRay PrepareRay(const BVHRay& ray)
+{
+	TraversalRay result;
+	result.Origin = ray.Origin;
+	result.InvDirection = glm::vec3(SafeReciprocal(ray.Direction.x), SafeReciprocal(ray.Direction.y), SafeReciprocal(ray.Direction.z));
+	result.TMin = ray.TMin;
+	result.TMax = ray.TMax;
+
+	glm::vec3 absDirection = glm::abs(ray.Direction);
+	result.Kz = absDirection.x > absDirection.y ? (absDirection.x > absDirection.z ? 0 : 2) : (absDirection.y > absDirection.z ? 1 : 2);
+	result.Kx = (result.Kz + 1) % 3;
+	result.Ky = (result.Kx + 1) % 3;
+
+	// Swapping the other two axes for a ray along -Kz keeps the winding, so the edge functions keep their signs
+	if (ray.Direction[result.Kz] < 0.0f)
+		std::swap(result.Kx, result.Ky);
+
+	result.Shear = glm::vec3(ray.Direction[result.Kx] / ray.Direction[result.Kz], ray.Direction[result.Ky] / ray.Direction[result.Kz],
+		1.0f / ray.Direction[result.Kz]);
+
+	return result;
+}
+
+/* Edge functions that come out as exactly 0 in single precision are recomputed in double precision, which is exact for products of
+   floats. Neighbouring triangles evaluate their shared edge with the same operands, so a ray through the edge hits one of them */
+static void ComputeEdgesExact(float ax, float ay, float bx, float by, float cx, float cy, float& u, float& v, float& w)
+{
+	u = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+	v = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+	w = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
+}
+
+/* Watertight ray triangle test of Woop, Benthin and Wald. Hits from both sides between TMin and tMax are accepted */
+static bool IntersectTriangle(const TraversalRay& ray, const BVHTriangle& triangle, float tMax, float& t, glm::vec2& barycentrics)
+{
+	glm::vec3 a = triangle.V0 - ray.Origin;
+	glm::vec3 b = triangle.V1 - ray.Origin;
+	glm::vec3 c = triangle.V2 - ray.Origin;
+
+	float ax = a[ray.Kx] - ray.Shear.x * a[ray.Kz];
+	float ay = a[ray.Ky] - ray.Shear.y * a[ray.Kz];
+	float bx = b[ray.Kx] - ray.Shear.x * b[ray.Kz];
+	float by = b[ray.Ky] - ray.Shear.y * b[ray.Kz];
+	float cx = c[ray.Kx] - ray.Shear.x * c[ray.Kz];
+	float cy = c[ray.Ky] - ray.Shear.y * c[ray.Kz];
+
+	float u = cx * by - cy * bx;
+	float v = ax * cy - ay * cx;
+	float w = bx * ay - by * ax;
+
+	if (u == 0.0f || v == 0.0f || w == 0.0f)
+		ComputeEdgesExact(ax, ay, bx, by, cx, cy, u, v, w);
+
+	if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+		return false;
+
+	float determinant = u + v + w;
+	if (determinant == 0.0f)
+		return false;
+
+	float az = ray.Shear.z * a[ray.Kz];
+	float bz = ray.Shear.z * b[ray.Kz];
+	float cz = ray.Shear.z * c[ray.Kz];
+
+	float tScaled = u * az + v * bz + w * cz;
+	float tHit = tScaled / determinant;
+	if (!(tHit >= ray.TMin && tHit < tMax))
+		return false;
+
+	t = tHit;
+	barycentrics = glm::vec2(v, w) / determinant;
+	return true;
+}
+
+static bool IntersectBox(const TraversalRay& ray, const BVHNode& node, float tMax, float& tEntry)
+{
+	glm::vec3 t0 = (node.BoundsMin - ray.Origin) * ray.InvDirection;
+	glm::vec3 t1 = (node.BoundsMax - ray.Origin) * ray.InvDirection;
+	glm::vec3 tNear = glm::min(t0, t1);
+	glm::vec3 tFar = glm::max(t0, t1);
+
+	tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, ray.TMin));
+	float tExit = std::min(std::min(std::min(tFar.x, tFar.y), tFar.z) * ROBUST_EXIT_SCALE, tMax);
+
+	return tEntry <= tExit;
+}
+
+/* Depth first, the nearer child is visited first and the other one waits on the stack with its entry distance. Nodes that moved
+   behind the closest hit while they waited are skipped */
+template<bool AnyHit>
+static bool TraverseRay(const BVH& bvh, const BVHRay& inputRay, BVHHit& hit)
+{
+	if (bvh.Nodes.empty())
+		return false;
+
+	TraversalRay ray = PrepareRay(inputRay);
+	float tMax = ray.TMax;
+	float tEntry = 0.0f;
+
+	if (!IntersectBox(ray, bvh.Nodes[0], tMax, tEntry))
+		return false;
+
+	uint32_t stackNodes[MAX_STACK_SIZE];
+	float stackEntries[MAX_STACK_SIZE];
+	uint32_t stackSize = 0;
+	uint32_t nodeIndex = 0;
+	bool isHit = false;
+
+	while (true)
+	{
+		const BVHNode& node = bvh.Nodes[nodeIndex];
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.NumTriangles; ++i)
+			{
+				float t = 0.0f;
+				glm::vec2 barycentrics;
+				if (!IntersectTriangle(ray, bvh.Triangles[i], tMax, t, barycentrics))
+					continue;
+
+				if constexpr (AnyHit)
+					return true;
+
+				tMax = t;
+				hit.T = t;
+				hit.Barycentrics = barycentrics;
+				hit.Triangle = i;
+				isHit = true;
+			}
+		}
+		else
+		{
+			float tLeft = 0.0f, tRight = 0.0f;
+			bool isLeftHit = IntersectBox(ray, bvh.Nodes[node.LeftFirst], tMax, tLeft);
+			bool isRightHit = IntersectBox(ray, bvh.Nodes[node.LeftFirst + 1], tMax, tRight);
+
+			if (isLeftHit && isRightHit)
+			{
+				ASSERT(stackSize < MAX_STACK_SIZE, "BVH is deeper than the traversal stack");
+				bool isLeftNearer = tLeft <= tRight;
+				stackNodes[stackSize] = isLeftNearer ? node.LeftFirst + 1 : node.LeftFirst;
+				stackEntries[stackSize++] = isLeftNearer ? tRight : tLeft;
+				nodeIndex = isLeftNearer ? node.LeftFirst : node.LeftFirst + 1;
+				continue;
+			}
+
+			if (isLeftHit || isRightHit)
+			{
+				nodeIndex = isLeftHit ? node.LeftFirst : node.LeftFirst + 1;
+				continue;
+			}
+		}
+
+		do
+		{
+			if (stackSize == 0)
+				return isHit;
+
+			nodeIndex = stackNodes[--stackSize];
+			tEntry = stackEntries[stackSize];
+		} while (tEntry > tMax);
+	}
+}
+
+#ifdef BVH_TRAVERSAL_SSE
+struct SIMD4
+{
+	using Float = __m128;
+	static constexpr uint32_t WIDTH = 4;
+
+	static Float Set(float x) { return _mm_set1_ps(x); }
+	static Float Load(const float* p) { return _mm_loadu_ps(p); }
+	static void Store(float* p, Float x) { _mm_storeu_ps(p, x); }
+
+	static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+	static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+	static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+
+	static Float Less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+	static Float LessEqual(Float a, Float b) { return _mm_cmple_ps(a, b); }
+	static Float Equal(Float a, Float b) { return _mm_cmpeq_ps(a, b); }
+	static Float NotEqual(Float a, Float b) { return _mm_cmpneq_ps(a, b); }
+
+	static Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+	static Float Or(Float a, Float b) { return _mm_or_ps(a, b); }
+	static Float AndNot(Float mask, Float a) { return _mm_andnot_ps(mask, a); }
+	static Float Select(Float mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	static uint32_t MoveMask(Float mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+};
+#endif
+
+#ifdef BVH_TRAVERSAL_AVX2
+struct SIMD8
+{
+	using Float = __m256;
+	static constexpr uint32_t WIDTH = 8;
+
+	static Float Set(float x) { return _mm256_set1_ps(x); }
+	static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+	static void Store(float* p, Float x) { _mm256_storeu_ps(p, x); }
+
+	static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+	static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+	static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+
+	static Float Less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static Float LessEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static Float Equal(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	static Float NotEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+
+	static Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+	static Float Or(Float a, Float b) { return _mm256_or_ps(a, b); }
+	static Float AndNot(Float mask, Float a) { return _mm256_andnot_ps(mask, a); }
+	static Float Select(Float mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+	static uint32_t MoveMask(Float mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+};
+#endif
+
+#ifdef BVH_TRAVERSAL_SSE
+/* Rays of a packet in structure of arrays layout, one lane per ray. Lanes without a ray and rays that are done have a TMax below their
+   TMin, so they miss every box and triangle */
+template<typename SIMD>
+struct RayPacket
+{
+	using Float = typename SIMD::Float;
+
+	Float Origin[3];
+	Float InvDirection[3];
+	Float TMin;
+	Float TMax;
+
+	// Shear of the watertight test, and per sheared axis the lanes that take it from y and from z of the triangle instead of x
+	Float Shear[3];
+	Float AxisFromY[3];
+	Float AxisFromZ[3];
+
+	// Sum of the directions, children are visited in the order most of the packet meets them
+	glm::vec3 DirectionSum = glm::vec3(0.0f);
+};
+
+template<typename SIMD>
+static RayPacket<SIMD> PreparePacket(const BVHRay* rays, uint32_t numRays)
+{
+	constexpr uint32_t W = SIMD::WIDTH;
+	float lanes[14][W];
+
+	RayPacket<SIMD> packet;
+	for (uint32_t i = 0; i < W; ++i)
+	{
+		TraversalRay ray = PrepareRay(i < numRays ? rays[i] : BVHRay());
+		if (i >= numRays)
+			ray.TMax = -1.0f;
+		else
+			packet.DirectionSum += rays[i].Direction;
+
+		uint32_t axes[3] = { ray.Kx, ray.Ky, ray.Kz };
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			lanes[axis][i] = ray.Origin[axis];
+			lanes[3 + axis][i] = ray.InvDirection[axis];
+			lanes[6 + axis][i] = ray.Shear[axis];
+			lanes[9 + axis][i] = static_cast<float>(axes[axis]);
+		}
+
+		lanes[12][i] = ray.TMin;
+		lanes[13][i] = ray.TMax;
+	}
+
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		packet.Origin[axis] = SIMD::Load(lanes[axis]);
+		packet.InvDirection[axis] = SIMD::Load(lanes[3 + axis]);
+		packet.Shear[axis] = SIMD::Load(lanes[6 + axis]);
+		packet.AxisFromY[axis] = SIMD::Equal(SIMD::Load(lanes[9 + axis]), SIMD::Set(1.0f));
+		packet.AxisFromZ[axis] = SIMD::Equal(SIMD::Load(lanes[9 + axis]), SIMD::Set(2.0f));
+	}
+
+	packet.TMin = SIMD::Load(lanes[12]);
+	packet.TMax = SIMD::Load(lanes[13]);
+	return packet;
+}
+
+template<typename SIMD>
+static typename SIMD::Float IntersectBox(const RayPacket<SIMD>& packet, const BVHNode& node)
+{
+	using Float = typename SIMD::Float;
+
+	Float tNear = packet.TMin;
+	Float tFar = SIMD::Set(std::numeric_limits<float>::max());
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		Float t0 = SIMD::Mul(SIMD::Sub(SIMD::Set(node.BoundsMin[axis]), packet.Origin[axis]), packet.InvDirection[axis]);
+		Float t1 = SIMD::Mul(SIMD::Sub(SIMD::Set(node.BoundsMax[axis]), packet.Origin[axis]), packet.InvDirection[axis]);
+		tNear = SIMD::Max(tNear, SIMD::Min(t0, t1));
+		tFar = SIMD::Min(tFar, SIMD::Max(t0, t1));
+	}
+
+	tFar = SIMD::Min(SIMD::Mul(tFar, SIMD::Set(ROBUST_EXIT_SCALE)), packet.TMax);
+	return SIMD::LessEqual(tNear, tFar);
+}
+
+/* One triangle against every ray of the packet, the same test as for a single ray. Returns the lanes that hit it */
+template<typename SIMD>
+static typename SIMD::Float IntersectTriangle(const RayPacket<SIMD>& packet, const BVHTriangle& triangle, typename SIMD::Float& t,
+	typename SIMD::Float& v, typename SIMD::Float& w)
+{
+	using Float = typename SIMD::Float;
+	constexpr uint32_t W = SIMD::WIDTH;
+
+	// Sheared x and y of each vertex, and its distance along the ray axis
+	Float x[3], y[3], z[3];
+	const glm::vec3* vertices[3] = { &triangle.V0, &triangle.V1, &triangle.V2 };
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		Float relative[3];
+		for (uint32_t axis = 0; axis < 3; ++axis)
+			relative[axis] = SIMD::Sub(SIMD::Set((*vertices[i])[axis]), packet.Origin[axis]);
+
+		Float permuted[3];
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			permuted[axis] = SIMD::Select(packet.AxisFromZ[axis], relative[2],
+				SIMD::Select(packet.AxisFromY[axis], relative[1], relative[0]));
+		}
+
+		x[i] = SIMD::Sub(permuted[0], SIMD::Mul(packet.Shear[0], permuted[2]));
+		y[i] = SIMD::Sub(permuted[1], SIMD::Mul(packet.Shear[1], permuted[2]));
+		z[i] = SIMD::Mul(packet.Shear[2], permuted[2]);
+	}
+
+	Float u = SIMD::Sub(SIMD::Mul(x[2], y[1]), SIMD::Mul(y[2], x[1]));
+	v = SIMD::Sub(SIMD::Mul(x[0], y[2]), SIMD::Mul(y[0], x[2]));
+	w = SIMD::Sub(SIMD::Mul(x[1], y[0]), SIMD::Mul(y[1], x[0]));
+
+	Float zero = SIMD::Set(0.0f);
+	uint32_t exactLanes = SIMD::MoveMask(SIMD::Or(SIMD::Or(SIMD::Equal(u, zero), SIMD::Equal(v, zero)), SIMD::Equal(w, zero)));
+	if (exactLanes != 0)
+	{
+		float lanes[9][W];
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			SIMD::Store(lanes[i * 2], x[i]);
+			SIMD::Store(lanes[i * 2 + 1], y[i]);
+		}
+
+		SIMD::Store(lanes[6], u);
+		SIMD::Store(lanes[7], v);
+		SIMD::Store(lanes[8], w);
+
+		for (uint32_t i = 0; i < W; ++i)
+		{
+			if (exactLanes & (1u << i))
+				ComputeEdgesExact(lanes[0][i], lanes[1][i], lanes[2][i], lanes[3][i], lanes[4][i], lanes[5][i], lanes[6][i], lanes[7][i], lanes[8][i]);
+		}
+
+		u = SIMD::Load(lanes[6]);
+		v = SIMD::Load(lanes[7]);
+		w = SIMD::Load(lanes[8]);
+	}
+
+	Float isNegative = SIMD::Or(SIMD::Or(SIMD::Less(u, zero), SIMD::Less(v, zero)), SIMD::Less(w, zero));
+	Float isPositive = SIMD::Or(SIMD::Or(SIMD::Less(zero, u), SIMD::Less(zero, v)), SIMD::Less(zero, w));
+
+	Float determinant = SIMD::Add(SIMD::Add(u, v), w);
+	Float tScaled = SIMD::Add(SIMD::Add(SIMD::Mul(u, z[0]), SIMD::Mul(v, z[1])), SIMD::Mul(w, z[2]));
+	t = SIMD::Div(tScaled, determinant);
+	v = SIMD::Div(v, determinant);
+	w = SIMD::Div(w, determinant);
+
+	Float isInRange = SIMD::And(SIMD::LessEqual(packet.TMin, t), SIMD::Less(t, packet.TMax));
+	return SIMD::AndNot(SIMD::And(isNegative, isPositive), SIMD::And(SIMD::NotEqual(determinant, zero), isInRange));
+}
+
+/* The packet visits every node any of its rays hits. Boxes are tested when a node is popped, against the hits found by then, and
+   children are pushed in the order of the packet's direction along the axis their centers are furthest apart on */
+template<typename SIMD, bool AnyHit>
+static void TracePacket(const BVH& bvh, const BVHRay* rays, uint32_t numRays, BVHHit* hits, uint8_t* occluded)
+{
+	using Float = typename SIMD::Float;
+	constexpr uint32_t W = SIMD::WIDTH;
+
+	RayPacket<SIMD> packet = PreparePacket<SIMD>(rays, numRays);
+	uint32_t activeLanes = (1u << numRays) - 1;
+	uint32_t hitLanes = 0;
+
+	uint32_t hitTriangles[W];
+	std::fill(hitTriangles, hitTriangles + W, BVHHit::INVALID_TRIANGLE);
+	Float hitV = SIMD::Set(0.0f);
+	Float hitW = SIMD::Set(0.0f);
+
+	uint32_t stack[MAX_STACK_SIZE];
+	uint32_t stackSize = 0;
+	if (!bvh.Nodes.empty())
+		stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVHNode& node = bvh.Nodes[stack[--stackSize]];
+		if (SIMD::MoveMask(IntersectBox(packet, node)) == 0)
+			continue;
+
+		if (!node.IsLeaf())
+		{
+			const BVHNode& left = bvh.Nodes[node.LeftFirst];
+			const BVHNode& right = bvh.Nodes[node.LeftFirst + 1];
+
+			glm::vec3 separation = (right.BoundsMin + right.BoundsMax) - (left.BoundsMin + left.BoundsMax);
+			glm::vec3 absSeparation = glm::abs(separation);
+			uint32_t axis = absSeparation.x > absSeparation.y ? (absSeparation.x > absSeparation.z ? 0 : 2) : (absSeparation.y > absSeparation.z ? 1 : 2);
+
+			bool isLeftNearer = separation[axis] * packet.DirectionSum[axis] >= 0.0f;
+			ASSERT(stackSize + 2 <= MAX_STACK_SIZE, "BVH is deeper than the traversal stack");
+			stack[stackSize++] = isLeftNearer ? node.LeftFirst + 1 : node.LeftFirst;
+			stack[stackSize++] = isLeftNearer ? node.LeftFirst : node.LeftFirst + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.NumTriangles; ++i)
+		{
+			Float t, v, w;
+			Float isHit = IntersectTriangle(packet, bvh.Triangles[i], t, v, w);
+
+			uint32_t lanes = SIMD::MoveMask(isHit);
+			if (lanes == 0)
+				continue;
+
+			hitLanes |= lanes;
+
+			if constexpr (AnyHit)
+			{
+				if (hitLanes == activeLanes)
+					break;
+
+				packet.TMax = SIMD::Select(isHit, SIMD::Set(-1.0f), packet.TMax);
+				packet.TMin = SIMD::Select(isHit, SIMD::Set(0.0f), packet.TMin);
+			}
+			else
+			{
+				packet.TMax = SIMD::Select(isHit, t, packet.TMax);
+				hitV = SIMD::Select(isHit, v, hitV);
+				hitW = SIMD::Select(isHit, w, hitW);
+
+				for (uint32_t lane = 0; lane < W; ++lane)
+				{
+					if (lanes & (1u << lane))
+						hitTriangles[lane] = i;
+				}
+			}
+		}
+
+		if (AnyHit && hitLanes == activeLanes)
+			break;
+	}
+
+	if constexpr (AnyHit)
+	{
+		for (uint32_t i = 0; i < numRays; ++i)
+			occluded[i] = (hitLanes >> i) & 1;
+	}
+	else
+	{
+		float tLanes[W], vLanes[W], wLanes[W];
+		SIMD::Store(tLanes, packet.TMax);
+		SIMD::Store(vLanes, hitV);
+		SIMD::Store(wLanes, hitW);
+
+		for (uint32_t i = 0; i < numRays; ++i)
+		{
+			hits[i] = BVHHit();
+			if (hitTriangles[i] == BVHHit::INVALID_TRIANGLE)
+				continue;
+
+			hits[i].T = tLanes[i];
+			hits[i].Barycentrics = glm::vec2(vLanes[i], wLanes[i]);
+			hits[i].Triangle = hitTriangles[i];
+		}
+	}
+}
+
+template<typename SIMD, bool AnyHit>
+static void TracePackets(const BVH& bvh, const BVHRay* rays, std::size_t numRays, BVHHit* hits, uint8_t* occluded)
+{
+	for (std::size_t i = 0; i < numRays; i += SIMD::WIDTH)
+	{
+		uint32_t numPacketRays = static_cast<uint32_t>(std::min<std::size_t>(SIMD::WIDTH, numRays - i));
+		TracePacket<SIMD, AnyHit>(bvh, rays + i, numPacketRays, AnyHit ? nullptr : hits + i, AnyHit ? occluded + i : nullptr);
+	}
+}
+#endif
+
+bool BVHTraversal::IsKernelSupported(BVHTraversalKernel kernel)
+{
+	switch (kernel)
+	{
+	case BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SCALAR:
+		return true;
+#ifdef BVH_TRAVERSAL_SSE
+	case BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SSE_4:
+		return true;
+#endif
+#ifdef BVH_TRAVERSAL_AVX2
+	case BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_AVX2_8:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+bool BVHTraversal::Intersect(const BVH& bvh, const BVHRay& ray, BVHHit& hit)
+{
+	hit = BVHHit();
+	return TraverseRay<false>(bvh, ray, hit);
+}
+
+bool BVHTraversal::IsOccluded(const BVH& bvh, const BVHRay& ray)
+{
+	BVHHit hit;
+	return TraverseRay<true>(bvh, ray, hit);
+}
+
+void BVHTraversal::Intersect(const BVH& bvh, const BVHRay* rays, std::size_t numRays, BVHTraversalKernel kernel, BVHHit* hits)
+{
+	ASSERT(IsKernelSupported(kernel), "BVH traversal kernel is not supported by this build");
+
+#ifdef BVH_TRAVERSAL_SSE
+	if (kernel == BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SSE_4)
+		return TracePackets<SIMD4, false>(bvh, rays, numRays, hits, nullptr);
+#endif
+#ifdef BVH_TRAVERSAL_AVX2
+	if (kernel == BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_AVX2_8)
+		return TracePackets<SIMD8, false>(bvh, rays, numRays, hits, nullptr);
+#endif
+
+	for (std::size_t i = 0; i < numRays; ++i)
+		Intersect(bvh, rays[i], hits[i]);
+}
+
+void BVHTraversal::IsOccluded(const BVH& bvh, const BVHRay* rays, std::size_t numRays, BVHTraversalKernel kernel, uint8_t* occluded)
+{
+	ASSERT(IsKernelSupported(kernel), "BVH traversal kernel is not supported by this build");
+
+#ifdef BVH_TRAVERSAL_SSE
+	if (kernel == BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SSE_4)
+		return TracePackets<SIMD4, true>(bvh, rays, numRays, nullptr, occluded);
+#endif
+#ifdef BVH_TRAVERSAL_AVX2
+	if (kernel == BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_AVX2_8)
+		return TracePackets<SIMD8, true>(bvh, rays, numRays, nullptr, occluded);
+#endif
+
+	for (std::size_t i = 0; i < numRays; ++i)
+		occluded[i] = IsOccluded(bvh, rays[i]);
+}
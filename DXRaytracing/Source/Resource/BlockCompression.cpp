@@ -0,0 +1,788 @@
+#include "Pch.h"
+#include "Resource/BlockCompression.h"
+
+/*
+
+	Every encoder fits the block endpoints along the principal axis of the texels, assigns each texel the palette entry
+	closest to its projection onto the endpoint line, and then refines the endpoints with a least squares fit to those
+	assignments. Palettes are kept sorted by their interpolation weight while encoding and only mapped onto the index
+	codes of the format when the block is written.
+
+*/
+
+static constexpr uint32_t BLOCK_DIMENSION = 4;
+static constexpr uint32_t NUM_BLOCK_TEXELS = BLOCK_DIMENSION * BLOCK_DIMENSION;
+static constexpr uint32_t NUM_REFINE_ITERATIONS = 2;
+
+// Interpolation weights of BC7 4-bit indices, out of 64
+static constexpr uint32_t BC7_INDEX_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct TexelBlock
+{
+	float Texels[NUM_BLOCK_TEXELS][4];
+};
+
+static void LoadBlock(const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, TexelBlock& block)
+{
+	for (uint32_t y = 0; y < BLOCK_DIMENSION; ++y)
+	{
+		uint32_t texelY = std::min(blockY * BLOCK_DIMENSION + y, height - 1);
+		for (uint32_t x = 0; x < BLOCK_DIMENSION; ++x)
+		{
+			uint32_t texelX = std::min(blockX * BLOCK_DIMENSION + x, width - 1);
+			const unsigned char* texel = pixels + (static_cast<std::size_t>(texelY) * width + texelX) * 4;
+
+			for (uint32_t c = 0; c < 4; ++c)
+				block.Texels[y * BLOCK_DIMENSION + x][c] = texel[c];
+		}
+	}
+}
+
+static void StoreBlock(const unsigned char decoded[NUM_BLOCK_TEXELS][4], uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, unsigned char* pixels)
+{
+	for (uint32_t y = 0; y < BLOCK_DIMENSION && blockY * BLOCK_DIMENSION + y < height; ++y)
+	{
+		for (uint32_t x = 0; x < BLOCK_DIMENSION && blockX * BLOCK_DIMENSION + x < width; ++x)
+		{
+			std::size_t texelIndex = static_cast<std::size_t>(blockY * BLOCK_DIMENSION + y) * width + blockX * BLOCK_DIMENSION + x;
+			memcpy(pixels + texelIndex * 4, decoded[y * BLOCK_DIMENSION + x], 4);
+		}
+	}
+}
+
+static inline float ClampChannel(float value)
+{
+	return std::min(std::max(value, 0.0f), 255.0f);
+}
+
+template<uint32_t NumChannels>
+static void FitEndpoints(const TexelBlock& block, float endpoint0[4], float endpoint1[4])
+{
+	float mean[4] = {};
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+	{
+		for (uint32_t c = 0; c < NumChannels; ++c)
+			mean[c] += block.Texels[i][c] / NUM_BLOCK_TEXELS;
+	}
+
+	float covariance[4][4] = {};
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+	{
+		for (uint32_t r = 0; r < NumChannels; ++r)
+		{
+			for (uint32_t c = 0; c < NumChannels; ++c)
+				covariance[r][c] += (block.Texels[i][r] - mean[r]) * (block.Texels[i][c] - mean[c]);
+		}
+	}
+
+	// Power iteration, starting from the row of the channel with the largest variance
+	uint32_t largestChannel = 0;
+	for (uint32_t c = 1; c < NumChannels; ++c)
+	{
+		if (covariance[c][c] > covariance[largestChannel][largestChannel])
+			largestChannel = c;
+	}
+
+	float axis[4] = {};
+	for (uint32_t c = 0; c < NumChannels; ++c)
+		axis[c] = covariance[largestChannel][c];
+
+	for (uint32_t iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[4] = {};
+		float largest = 0.0f;
+
+		for (uint32_t r = 0; r < NumChannels; ++r)
+		{
+			for (uint32_t c = 0; c < NumChannels; ++c)
+				next[r] += covariance[r][c] * axis[c];
+
+			largest = std::max(largest, std::abs(next[r]));
+		}
+
+		if (largest < 1e-12f)
+			break;
+
+		for (uint32_t c = 0; c < NumChannels; ++c)
+			axis[c] = next[c] / largest;
+	}
+
+	float minProjection = 0.0f, maxProjection = 0.0f;
+	float axisLengthSquared = 0.0f;
+	for (uint32_t c = 0; c < NumChannels; ++c)
+		axisLengthSquared += axis[c] * axis[c];
+
+	// Solid blocks have no principal axis and collapse onto the mean
+	if (axisLengthSquared > 1e-12f)
+	{
+		minProjection = std::numeric_limits<float>::max();
+		maxProjection = -std::numeric_limits<float>::max();
+
+		for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+		{
+			float projection = 0.0f;
+			for (uint32_t c = 0; c < NumChannels; ++c)
+				projection += (block.Texels[i][c] - mean[c]) * axis[c];
+
+			minProjection = std::min(minProjection, projection / axisLengthSquared);
+			maxProjection = std::max(maxProjection, projection / axisLengthSquared);
+		}
+	}
+
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		endpoint0[c] = c < NumChannels ? ClampChannel(mean[c] + axis[c] * minProjection) : 255.0f;
+		endpoint1[c] = c < NumChannels ? ClampChannel(mean[c] + axis[c] * maxProjection) : 255.0f;
+	}
+}
+
+/* Assign every texel the palette entry closest to it, palette entries are sorted by their weight towards the last entry
+   and roughly evenly spaced. Returns the summed squared error */
+template<uint32_t NumChannels>
+static float AssignIndices(const TexelBlock& block, const float palette[][4], uint32_t numEntries, uint32_t indices[NUM_BLOCK_TEXELS])
+{
+	const float* first = palette[0];
+	const float* last = palette[numEntries - 1];
+
+	float direction[4] = {};
+	float directionLengthSquared = 0.0f;
+	for (uint32_t c = 0; c < NumChannels; ++c)
+	{
+		direction[c] = last[c] - first[c];
+		directionLengthSquared += direction[c] * direction[c];
+	}
+
+	float totalError = 0.0f;
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+	{
+		const float* texel = block.Texels[i];
+
+		// The palette lies on a line, so the projection finds the closest entry up to the rounding of the interpolated entries
+		float projection = 0.0f;
+		if (directionLengthSquared > 0.0f)
+		{
+			for (uint32_t c = 0; c < NumChannels; ++c)
+				projection += (texel[c] - first[c]) * direction[c];
+
+			projection /= directionLengthSquared;
+		}
+
+		// Weights are close to evenly spaced, the neighbouring entries are checked against the actual palette below
+		float clampedProjection = std::min(std::max(projection, 0.0f), 1.0f);
+		uint32_t closest = static_cast<uint32_t>(clampedProjection * (numEntries - 1) + 0.5f);
+
+		float bestError = std::numeric_limits<float>::max();
+		uint32_t firstCandidate = closest > 0 ? closest - 1 : 0;
+		uint32_t lastCandidate = std::min(closest + 1, numEntries - 1);
+
+		for (uint32_t candidate = firstCandidate; candidate <= lastCandidate; ++candidate)
+		{
+			float error = 0.0f;
+			for (uint32_t c = 0; c < NumChannels; ++c)
+				error += (texel[c] - palette[candidate][c]) * (texel[c] - palette[candidate][c]);
+
+			if (error < bestError)
+			{
+				bestError = error;
+				indices[i] = candidate;
+			}
+		}
+
+		totalError += bestError;
+	}
+
+	return totalError;
+}
+
+/* Least squares endpoints for the given assignments, where each texel is (1 - weight) * endpoint0 + weight * endpoint1 */
+template<uint32_t NumChannels>
+static bool RefineEndpoints(const TexelBlock& block, const uint32_t indices[NUM_BLOCK_TEXELS], const float* weights, float endpoint0[4], float endpoint1[4])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+	{
+		float b = weights[indices[i]];
+		float a = 1.0f - b;
+
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+
+		for (uint32_t c = 0; c < NumChannels; ++c)
+		{
+			ax[c] += a * block.Texels[i][c];
+			bx[c] += b * block.Texels[i][c];
+		}
+	}
+
+	// Every texel on the same entry, the system has no unique solution
+	float determinant = aa * bb - ab * ab;
+	if (std::abs(determinant) < 1e-6f)
+		return false;
+
+	for (uint32_t c = 0; c < NumChannels; ++c)
+	{
+		endpoint0[c] = ClampChannel((ax[c] * bb - bx[c] * ab) / determinant);
+		endpoint1[c] = ClampChannel((bx[c] * aa - ax[c] * ab) / determinant);
+	}
+
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// BC1 color block
+// ---------------------------------------------------------------------------------------------------------------------
+
+static const float BC1_WEIGHTS[4] = { 0.0f, 1.0f / 3.0f, 2.0f / 3.0f, 1.0f };
+
+static uint16_t QuantizeRGB565(const float color[4])
+{
+	uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+	uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+	uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void DecodeRGB565(uint16_t packed, uint32_t color[3])
+{
+	uint32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static void GetBC1Palette(uint16_t packed0, uint16_t packed1, bool fourColors, uint32_t palette[4][3])
+{
+	DecodeRGB565(packed0, palette[0]);
+	DecodeRGB565(packed1, palette[1]);
+
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		if (fourColors)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+}
+
+static float EvaluateBC1(const TexelBlock& block, uint16_t packed0, uint16_t packed1, uint32_t indices[NUM_BLOCK_TEXELS])
+{
+	// Palette in weight order, which is index code 0, 2, 3, 1 of a four color block
+	uint32_t decoded[4][3] = {};
+	GetBC1Palette(packed0, packed1, true, decoded);
+
+	const uint32_t codes[4] = { 0, 2, 3, 1 };
+	float palette[4][4] = {};
+	for (uint32_t i = 0; i < 4; ++i)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+			palette[i][c] = static_cast<float>(decoded[codes[i]][c]);
+	}
+
+	return AssignIndices<3>(block, palette, 4, indices);
+}
+
+static void WriteBC1Block(uint16_t packed0, uint16_t packed1, const uint32_t indices[NUM_BLOCK_TEXELS], unsigned char* output)
+{
+	uint32_t weightToCode[4] = { 0, 2, 3, 1 };
+
+	// Four color blocks need the first endpoint to be the larger one, swapping the endpoints reverses the weights
+	if (packed0 < packed1)
+	{
+		std::swap(packed0, packed1);
+		std::swap(weightToCode[0], weightToCode[3]);
+		std::swap(weightToCode[1], weightToCode[2]);
+	}
+
+	uint32_t indexBits = 0;
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+	{
+		// Equal endpoints make every entry the same color, in either color mode
+		uint32_t code = packed0 == packed1 ? 0 : weightToCode[indices[i]];
+		indexBits |= code << (2 * i);
+	}
+
+	memcpy(output, &packed0, sizeof(uint16_t));
+	memcpy(output + 2, &packed1, sizeof(uint16_t));
+	memcpy(output + 4, &indexBits, sizeof(uint32_t));
+}
+
+static void EncodeBC1(const TexelBlock& block, unsigned char* output)
+{
+	float endpoint0[4], endpoint1[4];
+	FitEndpoints<3>(block, endpoint0, endpoint1);
+
+	uint16_t best0 = QuantizeRGB565(endpoint0), best1 = QuantizeRGB565(endpoint1);
+	uint32_t bestIndices[NUM_BLOCK_TEXELS] = {};
+	float bestError = EvaluateBC1(block, best0, best1, bestIndices);
+
+	for (uint32_t iteration = 0; iteration < NUM_REFINE_ITERATIONS; ++iteration)
+	{
+		if (!RefineEndpoints<3>(block, bestIndices, BC1_WEIGHTS, endpoint0, endpoint1))
+			break;
+
+		uint16_t packed0 = QuantizeRGB565(endpoint0), packed1 = QuantizeRGB565(endpoint1);
+		uint32_t indices[NUM_BLOCK_TEXELS] = {};
+		float error = EvaluateBC1(block, packed0, packed1, indices);
+
+		if (error >= bestError)
+			break;
+
+		best0 = packed0;
+		best1 = packed1;
+		bestError = error;
+		memcpy(bestIndices, indices, sizeof(indices));
+	}
+
+	WriteBC1Block(best0, best1, bestIndices, output);
+}
+
+static void DecodeBC1(const unsigned char* input, bool forceFourColors, unsigned char decoded[NUM_BLOCK_TEXELS][4])
+{
+	uint16_t packed0, packed1;
+	uint32_t indexBits;
+	memcpy(&packed0, input, sizeof(uint16_t));
+	memcpy(&packed1, input + 2, sizeof(uint16_t));
+	memcpy(&indexBits, input + 4, sizeof(uint32_t));
+
+	bool fourColors = forceFourColors || packed0 > packed1;
+
+	uint32_t palette[4][3] = {};
+	GetBC1Palette(packed0, packed1, fourColors, palette);
+
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+	{
+		uint32_t code = (indexBits >> (2 * i)) & 3;
+		for (uint32_t c = 0; c < 3; ++c)
+			decoded[i][c] = static_cast<unsigned char>(palette[code][c]);
+
+		decoded[i][3] = !fourColors && code == 3 ? 0 : 255;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// BC4 single channel block, used for the BC3 alpha and both BC5 channels
+// ---------------------------------------------------------------------------------------------------------------------
+
+static void GetBC4Palette(uint32_t value0, uint32_t value1, float palette[8])
+{
+	palette[0] = static_cast<float>(value0);
+	palette[1] = static_cast<float>(value1);
+
+	if (value0 > value1)
+	{
+		for (uint32_t i = 2; i < 8; ++i)
+			palette[i] = ((8 - i) * value0 + (i - 1) * value1) / 7.0f;
+	}
+	else
+	{
+		for (uint32_t i = 2; i < 6; ++i)
+			palette[i] = ((6 - i) * value0 + (i - 1) * value1) / 5.0f;
+
+		palette[6] = 0.0f;
+		palette[7] = 255.0f;
+	}
+}
+
+static void EncodeBC4(const TexelBlock& block, uint32_t channel, unsigned char* output)
+{
+	float minValue = 255.0f, maxValue = 0.0f;
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+	{
+		minValue = std::min(minValue, block.Texels[i][channel]);
+		maxValue = std::max(maxValue, block.Texels[i][channel]);
+	}
+
+	// Eight interpolated values between the extremes, the values of texels are whole numbers already
+	uint32_t value0 = static_cast<uint32_t>(maxValue), value1 = static_cast<uint32_t>(minValue);
+
+	float palette[8] = {};
+	GetBC4Palette(value0, value1, palette);
+
+	uint64_t indexBits = 0;
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS && value0 != value1; ++i)
+	{
+		uint64_t bestCode = 0;
+		float bestError = std::numeric_limits<float>::max();
+
+		for (uint32_t code = 0; code < 8; ++code)
+		{
+			float error = std::abs(block.Texels[i][channel] - palette[code]);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestCode = code;
+			}
+		}
+
+		indexBits |= bestCode << (3 * i);
+	}
+
+	output[0] = static_cast<unsigned char>(value0);
+	output[1] = static_cast<unsigned char>(value1);
+	for (uint32_t i = 0; i < 6; ++i)
+		output[2 + i] = static_cast<unsigned char>(indexBits >> (8 * i));
+}
+
+static void DecodeBC4(const unsigned char* input, uint32_t channel, unsigned char decoded[NUM_BLOCK_TEXELS][4])
+{
+	float palette[8] = {};
+	GetBC4Palette(input[0], input[1], palette);
+
+	uint64_t indexBits = 0;
+	for (uint32_t i = 0; i < 6; ++i)
+		indexBits |= static_cast<uint64_t>(input[2 + i]) << (8 * i);
+
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+		decoded[i][channel] = static_cast<unsigned char>(palette[(indexBits >> (3 * i)) & 7] + 0.5f);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// BC7 mode 6 block: one subset, 7-bit RGBA endpoints with a p-bit each and 4-bit indices
+// ---------------------------------------------------------------------------------------------------------------------
+
+static const float* GetBC7Weights()
+{
+	static const std::vector<float> weights = []() {
+		std::vector<float> values(16);
+		for (uint32_t i = 0; i < 16; ++i)
+			values[i] = BC7_INDEX_WEIGHTS[i] / 64.0f;
+		return values;
+	}();
+
+	return weights.data();
+}
+
+struct BC7Endpoints
+{
+	uint32_t Quantized[2][4] = {};
+	uint32_t PBits[2] = {};
+};
+
+static void QuantizeBC7Endpoint(const float endpoint[4], uint32_t pBit, uint32_t quantized[4])
+{
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		int32_t value = static_cast<int32_t>(std::floor((endpoint[c] - pBit) * 0.5f + 0.5f));
+		quantized[c] = static_cast<uint32_t>(std::min(std::max(value, 0), 127));
+	}
+}
+
+static void GetBC7Palette(const BC7Endpoints& endpoints, uint32_t palette[16][4])
+{
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		uint32_t value0 = (endpoints.Quantized[0][c] << 1) | endpoints.PBits[0];
+		uint32_t value1 = (endpoints.Quantized[1][c] << 1) | endpoints.PBits[1];
+
+		for (uint32_t i = 0; i < 16; ++i)
+			palette[i][c] = ((64 - BC7_INDEX_WEIGHTS[i]) * value0 + BC7_INDEX_WEIGHTS[i] * value1 + 32) >> 6;
+	}
+}
+
+static float EvaluateBC7(const TexelBlock& block, const BC7Endpoints& endpoints, uint32_t indices[NUM_BLOCK_TEXELS])
+{
+	uint32_t decoded[16][4] = {};
+	GetBC7Palette(endpoints, decoded);
+
+	float palette[16][4] = {};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			palette[i][c] = static_cast<float>(decoded[i][c]);
+	}
+
+	return AssignIndices<4>(block, palette, 16, indices);
+}
+
+/* Try every p-bit combination for the endpoints, keeps the best result if it improves on bestError */
+static bool QuantizeBC7Endpoints(const TexelBlock& block, const float endpoint0[4], const float endpoint1[4],
+	BC7Endpoints& bestEndpoints, uint32_t bestIndices[NUM_BLOCK_TEXELS], float& bestError)
+{
+	bool improved = false;
+
+	for (uint32_t pBits = 0; pBits < 4; ++pBits)
+	{
+		BC7Endpoints endpoints;
+		endpoints.PBits[0] = pBits & 1;
+		endpoints.PBits[1] = pBits >> 1;
+		QuantizeBC7Endpoint(endpoint0, endpoints.PBits[0], endpoints.Quantized[0]);
+		QuantizeBC7Endpoint(endpoint1, endpoints.PBits[1], endpoints.Quantized[1]);
+
+		uint32_t indices[NUM_BLOCK_TEXELS] = {};
+		float error = EvaluateBC7(block, endpoints, indices);
+
+		if (error < bestError)
+		{
+			bestError = error;
+			bestEndpoints = endpoints;
+			memcpy(bestIndices, indices, sizeof(indices));
+			improved = true;
+		}
+	}
+
+	return improved;
+}
+
+class BlockBitWriter
+{
+public:
+	BlockBitWriter(unsigned char* output)
+		: m_Output(output)
+	{
+		memset(m_Output, 0, 16);
+	}
+
+	void Write(uint32_t value, uint32_t numBits)
+	{
+		for (uint32_t i = 0; i < numBits; ++i, ++m_Position)
+			m_Output[m_Position >> 3] |= ((value >> i) & 1) << (m_Position & 7);
+	}
+
+private:
+	unsigned char* m_Output = nullptr;
+	uint32_t m_Position = 0;
+
+};
+
+class BlockBitReader
+{
+public:
+	BlockBitReader(const unsigned char* input)
+		: m_Input(input) {}
+
+	uint32_t Read(uint32_t numBits)
+	{
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < numBits; ++i, ++m_Position)
+			value |= ((m_Input[m_Position >> 3] >> (m_Position & 7)) & 1) << i;
+
+		return value;
+	}
+
+private:
+	const unsigned char* m_Input = nullptr;
+	uint32_t m_Position = 0;
+
+};
+
+static void WriteBC7Mode6Block(BC7Endpoints endpoints, uint32_t indices[NUM_BLOCK_TEXELS], unsigned char* output)
+{
+	// The first texel stores its index without the top bit, which has to be zero, swapping the endpoints inverts the indices
+	if (indices[0] >= 8)
+	{
+		std::swap(endpoints.Quantized[0], endpoints.Quantized[1]);
+		std::swap(endpoints.PBits[0], endpoints.PBits[1]);
+
+		for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+			indices[i] = 15 - indices[i];
+	}
+
+	BlockBitWriter writer(output);
+	writer.Write(1 << 6, 7);
+
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		writer.Write(endpoints.Quantized[0][c], 7);
+		writer.Write(endpoints.Quantized[1][c], 7);
+	}
+
+	writer.Write(endpoints.PBits[0], 1);
+	writer.Write(endpoints.PBits[1], 1);
+
+	writer.Write(indices[0], 3);
+	for (uint32_t i = 1; i < NUM_BLOCK_TEXELS; ++i)
+		writer.Write(indices[i], 4);
+}
+
+static void EncodeBC7(const TexelBlock& block, unsigned char* output)
+{
+	float endpoint0[4], endpoint1[4];
+	FitEndpoints<4>(block, endpoint0, endpoint1);
+
+	BC7Endpoints bestEndpoints;
+	uint32_t bestIndices[NUM_BLOCK_TEXELS] = {};
+	float bestError = std::numeric_limits<float>::max();
+	QuantizeBC7Endpoints(block, endpoint0, endpoint1, bestEndpoints, bestIndices, bestError);
+
+	for (uint32_t iteration = 0; iteration < NUM_REFINE_ITERATIONS && bestError > 0.0f; ++iteration)
+	{
+		if (!RefineEndpoints<4>(block, bestIndices, GetBC7Weights(), endpoint0, endpoint1) ||
+			!QuantizeBC7Endpoints(block, endpoint0, endpoint1, bestEndpoints, bestIndices, bestError))
+			break;
+	}
+
+	WriteBC7Mode6Block(bestEndpoints, bestIndices, output);
+}
+
+static void DecodeBC7(const unsigned char* input, unsigned char decoded[NUM_BLOCK_TEXELS][4])
+{
+	// Only mode 6 is decoded, which is the only mode the encoder writes
+	if ((input[0] & 0x7F) != (1 << 6))
+	{
+		memset(decoded, 0, NUM_BLOCK_TEXELS * 4);
+		return;
+	}
+
+	BlockBitReader reader(input);
+	reader.Read(7);
+
+	BC7Endpoints endpoints;
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		endpoints.Quantized[0][c] = reader.Read(7);
+		endpoints.Quantized[1][c] = reader.Read(7);
+	}
+
+	endpoints.PBits[0] = reader.Read(1);
+	endpoints.PBits[1] = reader.Read(1);
+
+	uint32_t palette[16][4] = {};
+	GetBC7Palette(endpoints, palette);
+
+	for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+	{
+		uint32_t index = reader.Read(i == 0 ? 3 : 4);
+		for (uint32_t c = 0; c < 4; ++c)
+			decoded[i][c] = static_cast<unsigned char>(palette[index][c]);
+	}
+}
+
+uint32_t BlockCompression::GetBlockByteSize(BlockCompressionFormat format)
+{
+	return format == BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1 ? 8 : 16;
+}
+
+std::size_t BlockCompression::GetCompressedByteSize(BlockCompressionFormat format, uint32_t width, uint32_t height)
+{
+	std::size_t numBlocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	std::size_t numBlocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+
+	return numBlocksX * numBlocksY * GetBlockByteSize(format);
+}
+
+std::size_t BlockCompression::GetMipChainByteSize(BlockCompressionFormat format, uint32_t width, uint32_t height, uint32_t numMipLevels)
+{
+	std::size_t byteSize = 0;
+	for (uint32_t mip = 0; mip < numMipLevels; ++mip)
+	{
+		byteSize += GetCompressedByteSize(format, width, height);
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+
+	return byteSize;
+}
+
+void BlockCompression::CompressBlockRows(BlockCompressionFormat format, const unsigned char* pixels, uint32_t width, uint32_t height,
+	uint32_t firstBlockRow, uint32_t numBlockRows, unsigned char* output)
+{
+	uint32_t numBlocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	uint32_t numBlocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	uint32_t blockByteSize = GetBlockByteSize(format);
+
+	TexelBlock block;
+	for (uint32_t blockY = firstBlockRow; blockY < std::min(firstBlockRow + numBlockRows, numBlocksY); ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < numBlocksX; ++blockX)
+		{
+			LoadBlock(pixels, width, height, blockX, blockY, block);
+			unsigned char* blockOutput = output + (static_cast<std::size_t>(blockY) * numBlocksX + blockX) * blockByteSize;
+
+			switch (format)
+			{
+			case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1:
+				EncodeBC1(block, blockOutput);
+				break;
+			case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC3:
+				EncodeBC4(block, 3, blockOutput);
+				EncodeBC1(block, blockOutput + 8);
+				break;
+			case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC5:
+				EncodeBC4(block, 0, blockOutput);
+				EncodeBC4(block, 1, blockOutput + 8);
+				break;
+			case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7:
+				EncodeBC7(block, blockOutput);
+				break;
+			}
+		}
+	}
+}
+
+void BlockCompression::Compress(BlockCompressionFormat format, const unsigned char* pixels, uint32_t width, uint32_t height, unsigned char* output)
+{
+	CompressBlockRows(format, pixels, width, height, 0, (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION, output);
+}
+
+void BlockCompression::Decompress(BlockCompressionFormat format, const unsigned char* blocks, uint32_t width, uint32_t height, unsigned char* pixels)
+{
+	uint32_t numBlocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	uint32_t numBlocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	uint32_t blockByteSize = GetBlockByteSize(format);
+
+	unsigned char decoded[NUM_BLOCK_TEXELS][4] = {};
+	for (uint32_t blockY = 0; blockY < numBlocksY; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < numBlocksX; ++blockX)
+		{
+			const unsigned char* block = blocks + (static_cast<std::size_t>(blockY) * numBlocksX + blockX) * blockByteSize;
+
+			switch (format)
+			{
+			case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1:
+				DecodeBC1(block, false, decoded);
+				break;
+			case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC3:
+				DecodeBC1(block + 8, true, decoded);
+				DecodeBC4(block, 3, decoded);
+				break;
+			case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC5:
+				DecodeBC4(block, 0, decoded);
+				DecodeBC4(block + 8, 1, decoded);
+				for (uint32_t i = 0; i < NUM_BLOCK_TEXELS; ++i)
+				{
+					decoded[i][2] = 0;
+					decoded[i][3] = 255;
+				}
+				break;
+			case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7:
+				DecodeBC7(block, decoded);
+				break;
+			}
+
+			StoreBlock(decoded, width, height, blockX, blockY, pixels);
+		}
+	}
+}
+
+float BlockCompression::MeasurePSNR(const unsigned char* reference, const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t numChannels)
+{
+	double squaredError = 0.0;
+	std::size_t numTexels = static_cast<std::size_t>(width) * height;
+
+	for (std::size_t i = 0; i < numTexels; ++i)
+	{
+		for (uint32_t c = 0; c < numChannels; ++c)
+		{
+			double difference = static_cast<double>(reference[i * 4 + c]) - pixels[i * 4 + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	if (squaredError == 0.0)
+		return std::numeric_limits<float>::infinity();
+
+	double meanSquaredError = squaredError / (numTexels * numChannels);
+	return static_cast<float>(10.0 * std::log10(255.0 * 255.0 / meanSquaredError));
+}
@@ -0,0 +1,155 @@
+#include "Pch.h"
+#include "Resource/BufferUploader.h"
+#include "Resource/ModelCooker.h"
+#include "Resource/VertexCompression.h"
+#include "Util/MemoryMappedFile.h"
+
+// Chunks are staged in blocks of about this size, so at most one block of the mapped data they are read from is resident at a time
+static constexpr std::size_t STAGING_BLOCK_SIZE = 1024 * 1024;
+
+static void SetMappedFile(BufferUpload& upload, const std::shared_ptr<MemoryMappedFile>& mappedFile)
+{
+	if (!mappedFile)
+		return;
+
+	// The first release starts at the page the data begins in
+	std::size_t pageSize = MemoryMappedFile::GetPageSize();
+	upload.MappedFile = mappedFile;
+	upload.ReleasedByteOffset = (upload.Data - mappedFile->GetData()) / pageSize * pageSize;
+}
+
+BufferUpload BufferUploader::GetVertexBufferUpload(const ModelData& data, VertexFormat vertexFormat)
+{
+	const CookedModelData& cooked = data.Cooked;
+
+	BufferUpload upload;
+	upload.Data = reinterpret_cast<const unsigned char*>(cooked.Vertices);
+	upload.ElementByteSize = VertexCompression::GetVertexByteSize(vertexFormat);
+	upload.ByteSize = cooked.NumVertices * upload.ElementByteSize;
+	upload.EncodedFormat = vertexFormat;
+	upload.Quantization = data.VertexQuantization;
+	SetMappedFile(upload, cooked.MappedFile);
+	return upload;
+}
+
+BufferUpload BufferUploader::GetIndexBufferUpload(const ModelData& data)
+{
+	const CookedModelData& cooked = data.Cooked;
+
+	BufferUpload upload;
+	upload.Data = static_cast<const unsigned char*>(cooked.Indices);
+	upload.ElementByteSize = cooked.IndexByteSize;
+	upload.ByteSize = cooked.NumIndices * cooked.IndexByteSize;
+	SetMappedFile(upload, cooked.MappedFile);
+	return upload;
+}
+
+std::size_t BufferUploader::PlanChunks(const std::vector<BufferUpload>& uploads, std::size_t numBytesInFlight, std::size_t uploadOffset,
+	std::size_t maxUploadByteSize, std::vector<BufferUploadChunk>& chunks)
+{
+	for (uint32_t i = 0; i < uploads.size(); ++i)
+	{
+		const BufferUpload& upload = uploads[i];
+		std::size_t numBytesPlanned = upload.NumBytesSubmitted;
+
+		while (numBytesPlanned < upload.ByteSize && numBytesInFlight + uploadOffset < maxUploadByteSize)
+		{
+			std::size_t numBytes = std::min(upload.ByteSize - numBytesPlanned, maxUploadByteSize - numBytesInFlight - uploadOffset);
+			numBytes -= numBytes % upload.ElementByteSize;
+
+			// An element that does not fit next to the memory in use waits for it, a limit below a single element still gets one through
+			if (numBytes == 0 && numBytesInFlight + uploadOffset > 0)
+				return uploadOffset;
+
+			numBytes = std::max(numBytes, upload.ElementByteSize);
+
+			BufferUploadChunk chunk;
+			chunk.UploadIndex = i;
+			chunk.ByteSize = numBytes;
+			chunk.UploadOffset = uploadOffset;
+			chunks.push_back(chunk);
+
+			numBytesPlanned += numBytes;
+			uploadOffset += numBytes;
+		}
+	}
+
+	return uploadOffset;
+}
+
+std::size_t BufferUploader::StageChunk(BufferUpload& upload, std::size_t numBytes, unsigned char* uploadMemory)
+{
+	std::size_t byteOffset = upload.NumBytesSubmitted;
+	ASSERT(numBytes <= upload.ByteSize - byteOffset && numBytes % upload.ElementByteSize == 0, "Buffer upload chunk is not made of whole elements of the upload");
+
+	bool isEncoded = upload.EncodedFormat != VertexFormat::VERTEX_FORMAT_FLOAT;
+	std::size_t blockByteSize = std::max(STAGING_BLOCK_SIZE - STAGING_BLOCK_SIZE % upload.ElementByteSize, upload.ElementByteSize);
+
+	for (std::size_t blockOffset = 0; blockOffset < numBytes; blockOffset += blockByteSize)
+	{
+		std::size_t numBlockBytes = std::min(numBytes - blockOffset, blockByteSize);
+		const unsigned char* source = upload.Data + byteOffset + blockOffset;
+		std::size_t sourceByteSize = numBlockBytes;
+
+		if (isEncoded)
+		{
+			const Vertex* vertices = reinterpret_cast<const Vertex*>(upload.Data) + (byteOffset + blockOffset) / upload.ElementByteSize;
+			std::size_t numVertices = numBlockBytes / upload.ElementByteSize;
+			VertexCompression::Compress(vertices, numVertices, upload.EncodedFormat, upload.Quantization, uploadMemory + blockOffset);
+
+			source = reinterpret_cast<const unsigned char*>(vertices);
+			sourceByteSize = numVertices * sizeof(Vertex);
+		}
+		else
+		{
+			std::memcpy(uploadMemory + blockOffset, source, numBlockBytes);
+		}
+
+		if (upload.MappedFile)
+		{
+			std::size_t pageSize = MemoryMappedFile::GetPageSize();
+			std::size_t releaseEnd = source + sourceByteSize - upload.MappedFile->GetData();
+			upload.MappedFile->ReleasePages(upload.ReleasedByteOffset, releaseEnd - upload.ReleasedByteOffset);
+			upload.ReleasedByteOffset = releaseEnd / pageSize * pageSize;
+		}
+	}
+
+	upload.NumBytesSubmitted += numBytes;
+	return byteOffset;
+}
+
+void BufferUploader::StageUploads(std::vector<BufferUpload>& uploads, std::size_t maxUploadByteSize,
+	const std::function<unsigned char*(std::size_t)>& allocateUploadMemory,
+	const std::function<void(const BufferUploadChunk&, std::size_t)>& copyChunk)
+{
+	std::size_t numRemainingBytes = 0;
+	std::size_t maxElementByteSize = 1;
+
+	for (auto& upload : uploads)
+	{
+		numRemainingBytes += upload.ByteSize - upload.NumBytesSubmitted;
+		maxElementByteSize = std::max(maxElementByteSize, upload.ElementByteSize);
+	}
+
+	if (numRemainingBytes == 0)
+		return;
+
+	// Consecutive uploads share the upload memory, which holds at least one element of each
+	std::size_t uploadMemorySize = maxUploadByteSize == 0 ? numRemainingBytes : std::min(numRemainingBytes, maxUploadByteSize);
+	uploadMemorySize = std::max(uploadMemorySize, maxElementByteSize);
+	unsigned char* uploadMemory = allocateUploadMemory(uploadMemorySize);
+
+	std::vector<BufferUploadChunk> chunks;
+	while (numRemainingBytes > 0)
+	{
+		chunks.clear();
+		PlanChunks(uploads, 0, 0, uploadMemorySize, chunks);
+
+		for (auto& chunk : chunks)
+		{
+			std::size_t byteOffset = StageChunk(uploads[chunk.UploadIndex], chunk.ByteSize, uploadMemory + chunk.UploadOffset);
+			copyChunk(chunk, byteOffset);
+			numRemainingBytes -= chunk.ByteSize;
+		}
+	}
+}
@@ -0,0 +1,113 @@
+#include "Pch.h"
+#include "Resource/GLBContainer.h"
+
+/*
+
+	Binary glTF layout:
+	- GLBHeader
+	- Chunks, each a GLBChunkHeader followed by ChunkLength bytes of data, padded to 4 bytes
+	- The first chunk is the JSON chunk, the optional second chunk is the binary buffer
+
+*/
+
+static constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+static constexpr uint32_t GLB_VERSION = 2;
+static constexpr uint32_t GLB_CHUNK_TYPE_JSON = 0x4E4F534A; // "JSON"
+static constexpr uint32_t GLB_CHUNK_TYPE_BIN = 0x004E4942; // "BIN\0"
+
+struct GLBHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t Length;
+};
+
+struct GLBChunkHeader
+{
+	uint32_t ChunkLength;
+	uint32_t ChunkType;
+};
+
+bool GLBContainer::IsGLB(const std::string& filepath)
+{
+	std::size_t extension = filepath.find_last_of('.');
+	if (extension == std::string::npos)
+		return false;
+
+	std::string extensionString = filepath.substr(extension + 1);
+	std::transform(extensionString.begin(), extensionString.end(), extensionString.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+	return extensionString == "glb";
+}
+
+bool GLBContainer::Open(const std::string& filepath)
+{
+	Close();
+
+	if (!m_File.Open(filepath))
+		return false;
+
+	const unsigned char* data = m_File.GetData();
+	std::size_t size = m_File.GetSize();
+
+	if (size < sizeof(GLBHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const GLBHeader* header = reinterpret_cast<const GLBHeader*>(data);
+	if (header->Magic != GLB_MAGIC || header->Version != GLB_VERSION || header->Length > size)
+	{
+		LOG_WARN("[GLBContainer] File is not a valid version 2 binary glTF: " + filepath);
+		Close();
+		return false;
+	}
+
+	std::size_t offset = sizeof(GLBHeader);
+	while (offset + sizeof(GLBChunkHeader) <= header->Length)
+	{
+		const GLBChunkHeader* chunkHeader = reinterpret_cast<const GLBChunkHeader*>(data + offset);
+		offset += sizeof(GLBChunkHeader);
+
+		if (chunkHeader->ChunkLength > header->Length - offset)
+		{
+			LOG_WARN("[GLBContainer] Chunk exceeds the file length: " + filepath);
+			Close();
+			return false;
+		}
+
+		if (chunkHeader->ChunkType == GLB_CHUNK_TYPE_JSON && !m_JSON)
+		{
+			m_JSON = reinterpret_cast<const char*>(data + offset);
+			m_JSONByteSize = chunkHeader->ChunkLength;
+		}
+		else if (chunkHeader->ChunkType == GLB_CHUNK_TYPE_BIN && m_JSON && !m_Binary)
+		{
+			m_Binary = data + offset;
+			m_BinaryByteSize = chunkHeader->ChunkLength;
+		}
+
+		// Unknown chunk types are skipped, as required by the specification
+		offset += MathHelper::AlignUp(chunkHeader->ChunkLength, 4);
+	}
+
+	if (!m_JSON)
+	{
+		LOG_WARN("[GLBContainer] File does not contain a JSON chunk: " + filepath);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void GLBContainer::Close()
+{
+	m_File.Close();
+
+	m_JSON = nullptr;
+	m_JSONByteSize = 0;
+	m_Binary = nullptr;
+	m_BinaryByteSize = 0;
+}
@@ -0,0 +1,706 @@
+#include "Pch.h"
+#include "Resource/LBVHBuilder.h"
+#include "Util/ThreadPool.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static constexpr uint32_t INVALID_INDEX = ~0u;
+static constexpr uint32_t RADIX_BITS = 8;
+static constexpr uint32_t RADIX_BUCKETS = 1 << RADIX_BITS;
+static constexpr uint32_t JOBS_PER_THREAD = 4;
+static constexpr uint32_t MIN_ITEMS_PER_JOB = 4096;
+static constexpr uint32_t MAX_TREELET_SIZE = 8;
+// Collapsed subtrees are walked with a fixed size stack, which never holds more nodes than the subtree has leaves
+static constexpr uint32_t MAX_LEAF_SIZE = 64;
+// The common prefix grows with every level of the Karras hierarchy, over at most 63 code bits and 32 index bits that break ties between
+// equal codes. Treelets are only rebuilt within what that leaves for their height, so the bound holds for the whole BVH
+static_assert(63 + 32 <= BVH_MAX_DEPTH, "LBVH hierarchy can be deeper than the traversal stacks allow");
+
+/* Internal node of the Karras hierarchy. Node ids below NumLeaves - 1 are internal nodes, leaf k has the id NumLeaves - 1 + k */
+struct LBVHNode
+{
+	BVHBounds Bounds;
+	uint32_t Left = 0;
+	uint32_t Right = 0;
+	uint32_t Parent = INVALID_INDEX;
+	uint32_t NumTriangles = 0;
+	// Nodes the subtree ends up with in the BVH, 1 when it is collapsed into a leaf
+	uint32_t NumOutputNodes = 0;
+	// SAH cost of the subtree, not yet divided by the area of the root
+	float Cost = 0.0f;
+	// Levels of internal nodes on the longest path down to a triangle, and the most that treelet restructuring may grow it to
+	uint32_t Height = 0;
+	uint32_t MaxHeight = 0;
+};
+
+struct LBVHBuildContext
+{
+	const LBVHBuildDesc* Desc = nullptr;
+	uint32_t NumLeaves = 0;
+
+	std::vector<LBVHNode> Nodes;
+	// Bounds and parent of every leaf, in Morton order
+	std::vector<BVHBounds> LeafBounds;
+	std::vector<uint32_t> LeafParents;
+
+	bool IsLeaf(uint32_t id) const { return id >= NumLeaves - 1; }
+	const BVHBounds& GetBounds(uint32_t id) const { return IsLeaf(id) ? LeafBounds[id - (NumLeaves - 1)] : Nodes[id].Bounds; }
+	uint32_t GetNumTriangles(uint32_t id) const { return IsLeaf(id) ? 1 : Nodes[id].NumTriangles; }
+	uint32_t GetNumOutputNodes(uint32_t id) const { return IsLeaf(id) ? 1 : Nodes[id].NumOutputNodes; }
+	uint32_t GetHeight(uint32_t id) const { return IsLeaf(id) ? 0 : Nodes[id].Height; }
+
+	float GetCost(uint32_t id) const
+	{
+		return IsLeaf(id) ? Desc->IntersectionCost * LeafBounds[id - (NumLeaves - 1)].GetHalfArea() : Nodes[id].Cost;
+	}
+
+	void SetParent(uint32_t id, uint32_t parent)
+	{
+		if (IsLeaf(id))
+			LeafParents[id - (NumLeaves - 1)] = parent;
+		else
+			Nodes[id].Parent = parent;
+	}
+};
+
+static uint32_t CountLeadingZeros(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	return _BitScanReverse64(&index, value) ? 63 - index : 64;
+#else
+	return value ? static_cast<uint32_t>(__builtin_clzll(value)) : 64;
+#endif
+}
+
+static uint32_t ExpandBits(uint32_t value)
+{
+	uint32_t v = value & 0x3ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8)) & 0x0300f00f;
+	v = (v | (v << 4)) & 0x030c30c3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+static uint64_t ExpandBits(uint64_t value)
+{
+	uint64_t v = value & 0x1fffff;
+	v = (v | (v << 32)) & 0x001f00000000ffffull;
+	v = (v | (v << 16)) & 0x001f0000ff0000ffull;
+	v = (v | (v << 8)) & 0x100f00f00f00f00full;
+	v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+	v = (v | (v << 2)) & 0x1249249249249249ull;
+	return v;
+}
+
+template<typename Key>
+static constexpr uint32_t GetMortonBitsPerAxis()
+{
+	return sizeof(Key) == sizeof(uint32_t) ? 10 : 21;
+}
+
+template<typename Key>
+static Key GetMortonCode(const glm::vec3& position, const glm::vec3& boundsMin, const glm::vec3& scale)
+{
+	constexpr float maxCoordinate = static_cast<float>((1u << GetMortonBitsPerAxis<Key>()) - 1);
+	glm::vec3 coordinates = glm::clamp((position - boundsMin) * scale, glm::vec3(0.0f), glm::vec3(maxCoordinate));
+
+	return (ExpandBits(static_cast<Key>(coordinates.x)) << 2) | (ExpandBits(static_cast<Key>(coordinates.y)) << 1) |
+		ExpandBits(static_cast<Key>(coordinates.z));
+}
+
+/* Number of jobs a stage over numItems is split into, at least one per thread so a thread that runs late does not hold up the rest */
+static uint32_t GetNumJobs(ThreadPool* threadPool, std::size_t numItems)
+{
+	if (!threadPool)
+		return 1;
+
+	std::size_t maxJobs = std::max<std::size_t>(1, numItems / MIN_ITEMS_PER_JOB);
+	return static_cast<uint32_t>(std::min<std::size_t>(threadPool->GetNumThreads() * JOBS_PER_THREAD, maxJobs));
+}
+
+static std::size_t GetJobBegin(std::size_t numItems, uint32_t numJobs, uint32_t job)
+{
+	return numItems * job / numJobs;
+}
+
+static void ParallelFor(ThreadPool* threadPool, uint32_t numJobs, const std::function<void(uint32_t)>& job)
+{
+	if (threadPool && numJobs > 1)
+	{
+		for (uint32_t i = 0; i < numJobs; ++i)
+			threadPool->Submit([&job, i]() { job(i); });
+
+		threadPool->WaitIdle();
+	}
+	else
+	{
+		for (uint32_t i = 0; i < numJobs; ++i)
+			job(i);
+	}
+}
+
+/* Least significant digit first, so every pass is stable. Each job counts the digits of its range, the counts are turned into the
+   offset of every digit and job, and each job scatters its range to those offsets. Passes whose digit is the same for every key are skipped */
+template<typename Key>
+static void RadixSort(std::vector<Key>& keys, std::vector<uint32_t>& values, ThreadPool* threadPool)
+{
+	std::size_t numItems = keys.size();
+	uint32_t numJobs = GetNumJobs(threadPool, numItems);
+
+	std::vector<Key> scratchKeys(numItems);
+	std::vector<uint32_t> scratchValues(numItems);
+	std::vector<uint32_t> histograms(static_cast<std::size_t>(numJobs) * RADIX_BUCKETS);
+
+	constexpr uint32_t numBits = GetMortonBitsPerAxis<Key>() * 3;
+	for (uint32_t shift = 0; shift < numBits; shift += RADIX_BITS)
+	{
+		std::fill(histograms.begin(), histograms.end(), 0);
+
+		ParallelFor(threadPool, numJobs, [&](uint32_t job) {
+			uint32_t* histogram = histograms.data() + static_cast<std::size_t>(job) * RADIX_BUCKETS;
+			for (std::size_t i = GetJobBegin(numItems, numJobs, job); i < GetJobBegin(numItems, numJobs, job + 1); ++i)
+				histogram[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+		});
+
+		bool isSorted = false;
+		uint32_t offset = 0;
+
+		for (uint32_t digit = 0; digit < RADIX_BUCKETS; ++digit)
+		{
+			uint32_t digitBegin = offset;
+			for (uint32_t job = 0; job < numJobs; ++job)
+			{
+				uint32_t& count = histograms[static_cast<std::size_t>(job) * RADIX_BUCKETS + digit];
+				uint32_t jobCount = count;
+				count = offset;
+				offset += jobCount;
+			}
+
+			isSorted |= offset - digitBegin == numItems;
+		}
+
+		if (isSorted)
+			continue;
+
+		ParallelFor(threadPool, numJobs, [&](uint32_t job) {
+			uint32_t* offsets = histograms.data() + static_cast<std::size_t>(job) * RADIX_BUCKETS;
+			for (std::size_t i = GetJobBegin(numItems, numJobs, job); i < GetJobBegin(numItems, numJobs, job + 1); ++i)
+			{
+				uint32_t destination = offsets[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+				scratchKeys[destination] = keys[i];
+				scratchValues[destination] = values[i];
+			}
+		});
+
+		keys.swap(scratchKeys);
+		values.swap(scratchValues);
+	}
+}
+
+/* Length of the common prefix of two sorted keys, or -1 when j is out of range. Duplicate keys are told apart by their index */
+template<typename Key>
+static int32_t GetCommonPrefix(const std::vector<Key>& keys, int64_t i, int64_t j)
+{
+	if (j < 0 || j >= static_cast<int64_t>(keys.size()))
+		return -1;
+
+	constexpr uint32_t keyBits = sizeof(Key) * 8;
+	if (keys[i] == keys[j])
+		return static_cast<int32_t>(keyBits + CountLeadingZeros(static_cast<uint64_t>(i ^ j)) - 32);
+
+	return static_cast<int32_t>(CountLeadingZeros(static_cast<uint64_t>(keys[i] ^ keys[j])) - (64 - keyBits));
+}
+
+/* Levels the Karras hierarchy can have below a node whose keys share this prefix. Every level lengthens the prefix, first over the rest
+   of the key bits and then, between equal keys, over the bits of their indices */
+template<typename Key>
+static uint32_t GetMaxHeight(int32_t prefix, uint32_t numIndexBits)
+{
+	constexpr int32_t keyBits = sizeof(Key) * 8;
+	if (prefix < keyBits)
+		return static_cast<uint32_t>(keyBits - prefix) + numIndexBits;
+
+	return static_cast<uint32_t>(keyBits + 32 - prefix);
+}
+
+/* Karras 2012: every internal node finds the range of keys it covers from the common prefixes with its neighbours, and splits it where
+   the common prefix of the range changes. Internal node i always starts or ends its range at key i, so every node is found on its own */
+template<typename Key>
+static void EmitHierarchy(const std::vector<Key>& keys, LBVHBuildContext& context, ThreadPool* threadPool)
+{
+	uint32_t numInternalNodes = context.NumLeaves - 1;
+	uint32_t numJobs = GetNumJobs(threadPool, numInternalNodes);
+	uint32_t numIndexBits = 64 - CountLeadingZeros(numInternalNodes);
+
+	ParallelFor(threadPool, numJobs, [&](uint32_t job) {
+		for (std::size_t node = GetJobBegin(numInternalNodes, numJobs, job); node < GetJobBegin(numInternalNodes, numJobs, job + 1); ++node)
+		{
+			int64_t i = static_cast<int64_t>(node);
+			int64_t direction = GetCommonPrefix(keys, i, i + 1) > GetCommonPrefix(keys, i, i - 1) ? 1 : -1;
+			int32_t minPrefix = GetCommonPrefix(keys, i, i - direction);
+
+			// Grow the range exponentially, then binary search its other end
+			int64_t maxLength = 2;
+			while (GetCommonPrefix(keys, i, i + maxLength * direction) > minPrefix)
+				maxLength *= 2;
+
+			int64_t length = 0;
+			for (int64_t step = maxLength / 2; step > 0; step /= 2)
+			{
+				if (GetCommonPrefix(keys, i, i + (length + step) * direction) > minPrefix)
+					length += step;
+			}
+
+			int64_t j = i + length * direction;
+			int32_t nodePrefix = GetCommonPrefix(keys, i, j);
+
+			// The split is the last key that shares more than the common prefix of the range with key i
+			int64_t split = 0;
+			int64_t step = length;
+			do
+			{
+				step = (step + 1) / 2;
+				if (GetCommonPrefix(keys, i, i + (split + step) * direction) > nodePrefix)
+					split += step;
+			} while (step > 1);
+
+			int64_t gamma = i + split * direction + std::min<int64_t>(direction, 0);
+			uint32_t left = static_cast<uint32_t>(std::min(i, j) == gamma ? numInternalNodes + gamma : gamma);
+			uint32_t right = static_cast<uint32_t>(std::max(i, j) == gamma + 1 ? numInternalNodes + gamma + 1 : gamma + 1);
+
+			LBVHNode& internalNode = context.Nodes[node];
+			internalNode.Left = left;
+			internalNode.Right = right;
+			internalNode.MaxHeight = GetMaxHeight<Key>(nodePrefix, numIndexBits);
+			context.SetParent(left, static_cast<uint32_t>(node));
+			context.SetParent(right, static_cast<uint32_t>(node));
+		}
+	});
+}
+
+/* Bounds, triangle count and SAH cost of a node from its children. A small subtree becomes a leaf when intersecting all of its
+   triangles is cheaper than traversing it */
+static void FinalizeNode(LBVHBuildContext& context, uint32_t id)
+{
+	const LBVHBuildDesc& desc = *context.Desc;
+	LBVHNode& node = context.Nodes[id];
+
+	node.Bounds = context.GetBounds(node.Left);
+	node.Bounds.Grow(context.GetBounds(node.Right));
+	node.NumTriangles = context.GetNumTriangles(node.Left) + context.GetNumTriangles(node.Right);
+	node.Height = 1 + std::max(context.GetHeight(node.Left), context.GetHeight(node.Right));
+
+	float area = node.Bounds.GetHalfArea();
+	float splitCost = desc.TraversalCost * area + context.GetCost(node.Left) + context.GetCost(node.Right);
+	float leafCost = desc.IntersectionCost * node.NumTriangles * area;
+
+	if (node.NumTriangles <= desc.MaxLeafSize && leafCost <= splitCost)
+	{
+		node.Cost = leafCost;
+		node.NumOutputNodes = 1;
+	}
+	else
+	{
+		node.Cost = splitCost;
+		node.NumOutputNodes = 1 + context.GetNumOutputNodes(node.Left) + context.GetNumOutputNodes(node.Right);
+	}
+}
+
+struct Treelet
+{
+	uint32_t Leaves[MAX_TREELET_SIZE] = {};
+	uint32_t NumLeaves = 0;
+	// Internal nodes below the treelet root, reused for the new topology
+	uint32_t Nodes[MAX_TREELET_SIZE] = {};
+	uint32_t NumNodes = 0;
+
+	float Costs[1 << MAX_TREELET_SIZE] = {};
+	uint8_t Partitions[1 << MAX_TREELET_SIZE] = {};
+	uint32_t Heights[1 << MAX_TREELET_SIZE] = {};
+};
+
+static uint32_t RebuildTreelet(LBVHBuildContext& context, Treelet& treelet, uint32_t subset, uint32_t root, uint32_t& numUsedNodes)
+{
+	if ((subset & (subset - 1)) == 0)
+	{
+		uint32_t leaf = 0;
+		while ((subset >> leaf) != 1)
+			leaf++;
+
+		return treelet.Leaves[leaf];
+	}
+
+	uint32_t node = numUsedNodes == 0 ? root : treelet.Nodes[numUsedNodes - 1];
+	numUsedNodes++;
+
+	uint32_t partition = treelet.Partitions[subset];
+	uint32_t left = RebuildTreelet(context, treelet, partition, root, numUsedNodes);
+	uint32_t right = RebuildTreelet(context, treelet, subset ^ partition, root, numUsedNodes);
+
+	context.Nodes[node].Left = left;
+	context.Nodes[node].Right = right;
+	context.SetParent(left, node);
+	context.SetParent(right, node);
+	FinalizeNode(context, node);
+
+	return node;
+}
+
+/*
+	Karras and Aila 2013: the treelet below a node is grown by expanding its leaf with the largest area, until it has TreeletSize leaves.
+	Every subset of the treelet leaves gets the topology with the lowest SAH cost from the best split into two smaller subsets, and the
+	treelet is rebuilt from the internal nodes it already had if the best topology of all its leaves beats the current one and stays within
+	the height the Karras hierarchy could have below the root, which keeps the whole BVH within the depth bound of the hierarchy.
+*/
+static void OptimizeTreelet(LBVHBuildContext& context, uint32_t root)
+{
+	const LBVHBuildDesc& desc = *context.Desc;
+	Treelet treelet;
+
+	treelet.Leaves[treelet.NumLeaves++] = context.Nodes[root].Left;
+	treelet.Leaves[treelet.NumLeaves++] = context.Nodes[root].Right;
+
+	while (treelet.NumLeaves < desc.TreeletSize)
+	{
+		uint32_t expanded = INVALID_INDEX;
+		float expandedArea = -1.0f;
+
+		for (uint32_t i = 0; i < treelet.NumLeaves; ++i)
+		{
+			float area = context.GetBounds(treelet.Leaves[i]).GetHalfArea();
+			if (!context.IsLeaf(treelet.Leaves[i]) && area > expandedArea)
+			{
+				expanded = i;
+				expandedArea = area;
+			}
+		}
+
+		if (expanded == INVALID_INDEX)
+			break;
+
+		uint32_t node = treelet.Leaves[expanded];
+		treelet.Nodes[treelet.NumNodes++] = node;
+		treelet.Leaves[expanded] = context.Nodes[node].Left;
+		treelet.Leaves[treelet.NumLeaves++] = context.Nodes[node].Right;
+	}
+
+	// Two or three leaves can only be arranged in ways that the current topology already compares with
+	if (treelet.NumLeaves < 4)
+		return;
+
+	BVHBounds subsetBounds[1 << MAX_TREELET_SIZE];
+	uint32_t subsetTriangles[1 << MAX_TREELET_SIZE] = {};
+	uint32_t allLeaves = (1u << treelet.NumLeaves) - 1;
+
+	// Subsets only split into numerically smaller subsets, so every cost they need is known by the time they are reached
+	for (uint32_t subset = 1; subset <= allLeaves; ++subset)
+	{
+		uint32_t lowestLeaf = subset & (~subset + 1);
+		if (subset == lowestLeaf)
+		{
+			uint32_t leaf = 0;
+			while ((lowestLeaf >> leaf) != 1)
+				leaf++;
+
+			subsetBounds[subset] = context.GetBounds(treelet.Leaves[leaf]);
+			subsetTriangles[subset] = context.GetNumTriangles(treelet.Leaves[leaf]);
+			treelet.Costs[subset] = context.GetCost(treelet.Leaves[leaf]);
+			treelet.Heights[subset] = context.GetHeight(treelet.Leaves[leaf]);
+			continue;
+		}
+
+		subsetBounds[subset] = subsetBounds[subset ^ lowestLeaf];
+		subsetBounds[subset].Grow(subsetBounds[lowestLeaf]);
+		subsetTriangles[subset] = subsetTriangles[subset ^ lowestLeaf] + subsetTriangles[lowestLeaf];
+
+		// Only partitions that hold the lowest leaf are tried, the others are the same splits mirrored
+		float bestCost = std::numeric_limits<float>::max();
+		for (uint32_t partition = (subset - 1) & subset; partition != 0; partition = (partition - 1) & subset)
+		{
+			if (!(partition & lowestLeaf))
+				continue;
+
+			float cost = treelet.Costs[partition] + treelet.Costs[subset ^ partition];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				treelet.Partitions[subset] = static_cast<uint8_t>(partition);
+			}
+		}
+
+		uint32_t partition = treelet.Partitions[subset];
+		treelet.Heights[subset] = 1 + std::max(treelet.Heights[partition], treelet.Heights[subset ^ partition]);
+
+		float area = subsetBounds[subset].GetHalfArea();
+		float splitCost = desc.TraversalCost * area + bestCost;
+		float leafCost = desc.IntersectionCost * subsetTriangles[subset] * area;
+		treelet.Costs[subset] = subsetTriangles[subset] <= desc.MaxLeafSize ? std::min(leafCost, splitCost) : splitCost;
+	}
+
+	// Rounding differs between the two ways of summing the costs, so only a clear gain is worth the rebuild
+	if (treelet.Costs[allLeaves] >= context.Nodes[root].Cost * 0.9999f || treelet.Heights[allLeaves] > context.Nodes[root].MaxHeight)
+		return;
+
+	uint32_t numUsedNodes = 0;
+	RebuildTreelet(context, treelet, allLeaves, root, numUsedNodes);
+}
+
+/* Walk up from every leaf, the second child to arrive at a node finalizes it and moves on, so every node is finalized exactly once
+   and after both of its children */
+static void BuildBottomUp(LBVHBuildContext& context, ThreadPool* threadPool)
+{
+	const LBVHBuildDesc& desc = *context.Desc;
+	uint32_t numJobs = GetNumJobs(threadPool, context.NumLeaves);
+	std::unique_ptr<std::atomic<uint32_t>[]> numArrivals(new std::atomic<uint32_t>[context.NumLeaves - 1]);
+
+	for (uint32_t i = 0; i < context.NumLeaves - 1; ++i)
+		numArrivals[i].store(0, std::memory_order_relaxed);
+
+	ParallelFor(threadPool, numJobs, [&](uint32_t job) {
+		for (std::size_t leaf = GetJobBegin(context.NumLeaves, numJobs, job); leaf < GetJobBegin(context.NumLeaves, numJobs, job + 1); ++leaf)
+		{
+			uint32_t node = context.LeafParents[leaf];
+			while (node != INVALID_INDEX && numArrivals[node].fetch_add(1, std::memory_order_acq_rel) == 1)
+			{
+				FinalizeNode(context, node);
+				if (desc.OptimizeTreelets && context.Nodes[node].NumTriangles >= desc.MinTreeletTriangles)
+					OptimizeTreelet(context, node);
+
+				node = context.Nodes[node].Parent;
+			}
+		}
+	});
+}
+
+struct EmitTask
+{
+	uint32_t Node = 0;
+	uint32_t OutputIndex = 0;
+	// The children of the node and their subtrees follow from here
+	uint32_t FirstChildIndex = 0;
+	uint32_t FirstTriangle = 0;
+};
+
+/* Emit one node and queue its children, a collapsed subtree writes its triangles in the order of its leaves */
+static void EmitNode(const LBVHBuildContext& context, const EmitTask& task, const std::vector<uint32_t>& sortedTriangles,
+	const std::vector<BVHTriangle>& triangles, const std::vector<uint32_t>& triangleIndices, BVH& bvh, std::vector<EmitTask>& tasks)
+{
+	BVHNode& output = bvh.Nodes[task.OutputIndex];
+	const BVHBounds& bounds = context.GetBounds(task.Node);
+	output.BoundsMin = bounds.Min;
+	output.BoundsMax = bounds.Max;
+
+	if (context.GetNumOutputNodes(task.Node) == 1)
+	{
+		output.LeftFirst = task.FirstTriangle;
+		output.NumTriangles = context.GetNumTriangles(task.Node);
+
+		uint32_t numEmitted = 0;
+		uint32_t stack[MAX_LEAF_SIZE];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = task.Node;
+
+		while (stackSize > 0)
+		{
+			uint32_t node = stack[--stackSize];
+			if (context.IsLeaf(node))
+			{
+				uint32_t triangle = sortedTriangles[node - (context.NumLeaves - 1)];
+				bvh.Triangles[task.FirstTriangle + numEmitted] = triangles[triangle];
+				bvh.TriangleIndices[task.FirstTriangle + numEmitted] = triangleIndices[triangle];
+				numEmitted++;
+			}
+			else
+			{
+				stack[stackSize++] = context.Nodes[node].Right;
+				stack[stackSize++] = context.Nodes[node].Left;
+			}
+		}
+
+		return;
+	}
+
+	uint32_t left = context.Nodes[task.Node].Left;
+	uint32_t right = context.Nodes[task.Node].Right;
+	output.LeftFirst = task.FirstChildIndex;
+	output.NumTriangles = 0;
+
+	uint32_t leftChildIndex = task.FirstChildIndex + 2;
+	uint32_t rightChildIndex = leftChildIndex + context.GetNumOutputNodes(left) - 1;
+	tasks.push_back({ right, task.FirstChildIndex + 1, rightChildIndex, task.FirstTriangle + context.GetNumTriangles(left) });
+	tasks.push_back({ left, task.FirstChildIndex, leftChildIndex, task.FirstTriangle });
+}
+
+/* Subtrees know how many nodes and triangles they end up with, so they are emitted to their own ranges of the BVH in parallel.
+   The top of the tree is emitted on the calling thread until there are enough subtrees for the jobs */
+static void EmitBVH(const LBVHBuildContext& context, const std::vector<uint32_t>& sortedTriangles, const std::vector<BVHTriangle>& triangles,
+	const std::vector<uint32_t>& triangleIndices, ThreadPool* threadPool, BVH& bvh)
+{
+	bvh.Nodes.resize(context.GetNumOutputNodes(0));
+	bvh.Triangles.resize(context.NumLeaves);
+	bvh.TriangleIndices.resize(context.NumLeaves);
+
+	uint32_t numJobs = GetNumJobs(threadPool, context.NumLeaves);
+	uint32_t maxSubtreeTriangles = std::max(1u, context.NumLeaves / numJobs);
+
+	std::vector<EmitTask> subtrees;
+	std::vector<EmitTask> tasks = { { 0, 0, 1, 0 } };
+
+	while (!tasks.empty())
+	{
+		EmitTask task = tasks.back();
+		tasks.pop_back();
+
+		if (numJobs > 1 && context.GetNumTriangles(task.Node) <= maxSubtreeTriangles)
+			subtrees.push_back(task);
+		else
+			EmitNode(context, task, sortedTriangles, triangles, triangleIndices, bvh, tasks);
+	}
+
+	ParallelFor(threadPool, static_cast<uint32_t>(subtrees.size()), [&](uint32_t subtree) {
+		std::vector<EmitTask> subtreeTasks = { subtrees[subtree] };
+		while (!subtreeTasks.empty())
+		{
+			EmitTask task = subtreeTasks.back();
+			subtreeTasks.pop_back();
+			EmitNode(context, task, sortedTriangles, triangles, triangleIndices, bvh, subtreeTasks);
+		}
+	});
+}
+
+template<typename Key>
+static void BuildHierarchy(const std::vector<glm::vec3>& centroids, const BVHBounds& centroidBounds, std::vector<uint32_t>& sortedTriangles,
+	LBVHBuildContext& context, ThreadPool* threadPool)
+{
+	std::size_t numTriangles = centroids.size();
+	uint32_t numJobs = GetNumJobs(threadPool, numTriangles);
+
+	glm::vec3 extent = centroidBounds.Max - centroidBounds.Min;
+	glm::vec3 scale(0.0f);
+	for (uint32_t axis = 0; axis < 3; ++axis)
+		scale[axis] = extent[axis] > 0.0f ? static_cast<float>(1u << GetMortonBitsPerAxis<Key>()) / extent[axis] : 0.0f;
+
+	std::vector<Key> keys(numTriangles);
+	ParallelFor(threadPool, numJobs, [&](uint32_t job) {
+		for (std::size_t i = GetJobBegin(numTriangles, numJobs, job); i < GetJobBegin(numTriangles, numJobs, job + 1); ++i)
+			keys[i] = GetMortonCode<Key>(centroids[i], centroidBounds.Min, scale);
+	});
+
+	RadixSort(keys, sortedTriangles, threadPool);
+	EmitHierarchy(keys, context, threadPool);
+}
+
+/*
+	Triangles are sorted along a Morton curve through their centroids, which puts the leaves of the hierarchy in order. The hierarchy
+	over the sorted leaves is emitted with one job per range of internal nodes, and finalized bottom up, where small subtrees collapse
+	into leaves and treelets are optionally restructured. Unlike the SAH build every stage runs in parallel, at the cost of a tree
+	that only follows the Morton order.
+*/
+BVHBuildStats LBVHBuilder::Build(const Vertex* vertices, std::size_t numVertices, const void* indices, uint32_t indexByteSize,
+	const std::vector<Submesh>& submeshes, const LBVHBuildDesc& desc, ThreadPool* threadPool, BVH& bvh)
+{
+	ASSERT(desc.MaxLeafSize > 0 && desc.MaxLeafSize <= MAX_LEAF_SIZE && desc.TreeletSize >= 2 && desc.TreeletSize <= MAX_TREELET_SIZE, "LBVH build options are out of range");
+	ASSERT(indexByteSize == sizeof(uint16_t) || indexByteSize == sizeof(uint32_t), "BVH indices have to be 16 or 32 bit");
+
+	auto startTime = std::chrono::steady_clock::now();
+	bvh = BVH();
+
+	// Triangle offset of every submesh, so each job finds the submesh its range starts in
+	std::vector<std::size_t> submeshTriangleOffsets(submeshes.size() + 1, 0);
+	for (std::size_t i = 0; i < submeshes.size(); ++i)
+		submeshTriangleOffsets[i + 1] = submeshTriangleOffsets[i] + submeshes[i].NumIndices / 3;
+
+	std::size_t numTriangles = submeshTriangleOffsets.back();
+	if (numTriangles == 0)
+		return BVHBuildStats();
+
+	auto getIndex = [indices, indexByteSize](std::size_t i) {
+		return indexByteSize == sizeof(uint16_t) ? static_cast<const uint16_t*>(indices)[i] : static_cast<const uint32_t*>(indices)[i];
+	};
+
+	std::vector<BVHTriangle> triangles(numTriangles);
+	std::vector<uint32_t> triangleIndices(numTriangles);
+	std::vector<BVHBounds> triangleBounds(numTriangles);
+	std::vector<glm::vec3> centroids(numTriangles);
+
+	uint32_t numJobs = GetNumJobs(threadPool, numTriangles);
+	std::vector<BVHBounds> jobCentroidBounds(numJobs);
+
+	ParallelFor(threadPool, numJobs, [&](uint32_t job) {
+		std::size_t begin = GetJobBegin(numTriangles, numJobs, job);
+		std::size_t submesh = std::upper_bound(submeshTriangleOffsets.begin(), submeshTriangleOffsets.end(), begin) - submeshTriangleOffsets.begin() - 1;
+
+		for (std::size_t t = begin; t < GetJobBegin(numTriangles, numJobs, job + 1); ++t)
+		{
+			while (t >= submeshTriangleOffsets[submesh + 1])
+				submesh++;
+
+			std::size_t first = submeshes[submesh].IndexOffset + (t - submeshTriangleOffsets[submesh]) * 3;
+			uint32_t i0 = getIndex(first), i1 = getIndex(first + 1), i2 = getIndex(first + 2);
+			ASSERT(i0 < numVertices && i1 < numVertices && i2 < numVertices, "BVH triangle index is out of range");
+
+			triangles[t] = { vertices[i0].Position, vertices[i1].Position, vertices[i2].Position };
+			triangleIndices[t] = static_cast<uint32_t>(first / 3);
+
+			triangleBounds[t].Grow(triangles[t].V0);
+			triangleBounds[t].Grow(triangles[t].V1);
+			triangleBounds[t].Grow(triangles[t].V2);
+			centroids[t] = (triangleBounds[t].Min + triangleBounds[t].Max) * 0.5f;
+			jobCentroidBounds[job].Grow(centroids[t]);
+		}
+	});
+
+	BVHBounds centroidBounds;
+	for (auto& bounds : jobCentroidBounds)
+		centroidBounds.Grow(bounds);
+
+	LBVHBuildContext context;
+	context.Desc = &desc;
+	context.NumLeaves = static_cast<uint32_t>(numTriangles);
+	context.Nodes.resize(numTriangles - 1);
+	context.LeafBounds.resize(numTriangles);
+	context.LeafParents.resize(numTriangles, INVALID_INDEX);
+
+	std::vector<uint32_t> sortedTriangles(numTriangles);
+	std::iota(sortedTriangles.begin(), sortedTriangles.end(), 0);
+
+	if (desc.CodeWidth == MortonCodeWidth::MORTON_CODE_WIDTH_63)
+		BuildHierarchy<uint64_t>(centroids, centroidBounds, sortedTriangles, context, threadPool);
+	else
+		BuildHierarchy<uint32_t>(centroids, centroidBounds, sortedTriangles, context, threadPool);
+
+	ParallelFor(threadPool, numJobs, [&](uint32_t job) {
+		for (std::size_t i = GetJobBegin(numTriangles, numJobs, job); i < GetJobBegin(numTriangles, numJobs, job + 1); ++i)
+			context.LeafBounds[i] = triangleBounds[sortedTriangles[i]];
+	});
+
+	if (numTriangles > 1)
+	{
+		BuildBottomUp(context, threadPool);
+		EmitBVH(context, sortedTriangles, triangles, triangleIndices, threadPool, bvh);
+	}
+	else
+	{
+		bvh.Nodes.resize(1);
+		bvh.Nodes[0].BoundsMin = triangleBounds[0].Min;
+		bvh.Nodes[0].BoundsMax = triangleBounds[0].Max;
+		bvh.Nodes[0].NumTriangles = 1;
+		bvh.Triangles = triangles;
+		bvh.TriangleIndices = triangleIndices;
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+	BVHBuildDesc statsDesc;
+	statsDesc.TraversalCost = desc.TraversalCost;
+	statsDesc.IntersectionCost = desc.IntersectionCost;
+
+	BVHBuildStats stats = BVHBuilder::ComputeStats(bvh, statsDesc);
+	stats.BuildDuration = elapsed.count();
+
+	return stats;
+}
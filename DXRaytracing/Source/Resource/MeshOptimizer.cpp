@@ -0,0 +1,202 @@
+#include "Pch.h"
+#include "Resource/MeshOptimizer.h"
+#include "Util/Hash.h"
+
+static constexpr uint32_t INVALID_INDEX = ~0u;
+
+void MeshOptimizer::WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	// Open addressing table of vertex indices, at most half full
+	std::size_t tableSize = 1;
+	while (tableSize < vertices.size() * 2)
+		tableSize <<= 1;
+
+	std::vector<uint32_t> table(tableSize, INVALID_INDEX);
+	std::vector<uint32_t> remap(vertices.size());
+	std::size_t numUniqueVertices = 0;
+
+	for (std::size_t i = 0; i < vertices.size(); ++i)
+	{
+		std::size_t slot = Hash::Hash64(&vertices[i], sizeof(Vertex)) & (tableSize - 1);
+
+		while (table[slot] != INVALID_INDEX && std::memcmp(&vertices[table[slot]], &vertices[i], sizeof(Vertex)) != 0)
+			slot = (slot + 1) & (tableSize - 1);
+
+		if (table[slot] == INVALID_INDEX)
+		{
+			vertices[numUniqueVertices] = vertices[i];
+			table[slot] = static_cast<uint32_t>(numUniqueVertices++);
+		}
+
+		remap[i] = table[slot];
+	}
+
+	vertices.resize(numUniqueVertices);
+
+	for (auto& index : indices)
+		index = remap[index];
+}
+
+/*
+	Tipsify fans around the most recently used vertex, emitting all of its remaining triangles.
+	The next fanning vertex is the candidate that is still in a FIFO cache of cacheSize entries after
+	its remaining triangles are emitted, preferring the oldest one. If there is no candidate the
+	most recent dead-end vertex with remaining triangles is used, or otherwise the next vertex in order.
+*/
+void MeshOptimizer::OptimizeTriangleOrder(std::vector<uint32_t>& indices, std::size_t numVertices, uint32_t cacheSize)
+{
+	std::size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0 || numVertices == 0)
+		return;
+
+	// Vertex to triangle adjacency, stored as offsets into a single array
+	std::vector<uint32_t> numLiveTriangles(numVertices, 0);
+	for (uint32_t index : indices)
+		numLiveTriangles[index]++;
+
+	std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+	for (std::size_t v = 0; v < numVertices; ++v)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + numLiveTriangles[v];
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (std::size_t t = 0; t < numTriangles; ++t)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+			adjacency[adjacencyFill[indices[t * 3 + c]]++] = static_cast<uint32_t>(t);
+	}
+
+	std::vector<uint32_t> cacheTimestamps(numVertices, 0);
+	std::vector<bool> emitted(numTriangles, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	uint32_t timestamp = cacheSize + 1;
+	std::size_t cursor = 0;
+	int64_t fanningVertex = 0;
+
+	while (fanningVertex >= 0)
+	{
+		candidates.clear();
+
+		for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; ++a)
+		{
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				uint32_t v = indices[triangle * 3 + c];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				numLiveTriangles[v]--;
+
+				if (timestamp - cacheTimestamps[v] > cacheSize)
+					cacheTimestamps[v] = timestamp++;
+			}
+
+			emitted[triangle] = true;
+		}
+
+		// Pick the next fanning vertex from the candidates
+		fanningVertex = -1;
+		int64_t bestPriority = -1;
+
+		for (uint32_t v : candidates)
+		{
+			if (numLiveTriangles[v] == 0)
+				continue;
+
+			int64_t priority = 0;
+			if (timestamp - cacheTimestamps[v] + 2 * numLiveTriangles[v] <= cacheSize)
+				priority = timestamp - cacheTimestamps[v];
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanningVertex = v;
+			}
+		}
+
+		if (fanningVertex >= 0)
+			continue;
+
+		// Skip dead ends
+		while (!deadEnds.empty())
+		{
+			uint32_t v = deadEnds.back();
+			deadEnds.pop_back();
+
+			if (numLiveTriangles[v] > 0)
+			{
+				fanningVertex = v;
+				break;
+			}
+		}
+
+		while (fanningVertex < 0 && cursor < numVertices)
+		{
+			if (numLiveTriangles[cursor] > 0)
+				fanningVertex = static_cast<int64_t>(cursor);
+			cursor++;
+		}
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexOrder(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), INVALID_INDEX);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (auto& index : indices)
+	{
+		if (remap[index] == INVALID_INDEX)
+		{
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
+
+float MeshOptimizer::ComputeAverageIndexDistance(const uint32_t* indices, std::size_t numIndices)
+{
+	if (numIndices < 2)
+		return 0.0f;
+
+	uint64_t totalDistance = 0;
+	for (std::size_t i = 1; i < numIndices; ++i)
+		totalDistance += indices[i] > indices[i - 1] ? indices[i] - indices[i - 1] : indices[i - 1] - indices[i];
+
+	return static_cast<float>(static_cast<double>(totalDistance) / (numIndices - 1));
+}
+
+void MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, MeshOptimizationStats* stats)
+{
+	if (stats)
+	{
+		stats->NumVerticesBefore = vertices.size();
+		stats->AverageIndexDistanceBefore = ComputeAverageIndexDistance(indices.data(), indices.size());
+	}
+
+	WeldVertices(vertices, indices);
+	OptimizeTriangleOrder(indices, vertices.size());
+	OptimizeVertexOrder(vertices, indices);
+
+	if (stats)
+	{
+		stats->NumVerticesAfter = vertices.size();
+		stats->AverageIndexDistanceAfter = ComputeAverageIndexDistance(indices.data(), indices.size());
+	}
+}
@@ -0,0 +1,526 @@
+#include "Pch.h"
+#include "Resource/MeshSimplifier.h"
+#include "Util/Hash.h"
+
+static constexpr uint32_t INVALID_INDEX = ~0u;
+// Texture coordinates and normal
+static constexpr uint32_t NUM_ATTRIBUTES = 5;
+
+enum class VertexKind : uint32_t
+{
+	// Collapses onto any neighbour
+	VERTEX_KIND_MANIFOLD,
+	// On an open border, only collapses along the border
+	VERTEX_KIND_BORDER,
+	// On a seam between two attribute charts, only collapses along the seam together with its sibling on the other chart
+	VERTEX_KIND_SEAM,
+	// Where more than two charts or a seam and a border meet, never collapses
+	VERTEX_KIND_LOCKED
+};
+
+/*
+	Squared distance to the planes of the triangles around a vertex, plus the squared difference between a vertex attribute
+	and the attribute interpolated across those triangles. Every triangle is weighted by its area. Both errors are quadratic
+	in the position, so the position terms share A, B and C and the attributes only add their gradients and offsets.
+*/
+struct Quadric
+{
+	// Symmetric 3x3 matrix
+	float A00 = 0.0f, A11 = 0.0f, A22 = 0.0f;
+	float A01 = 0.0f, A02 = 0.0f, A12 = 0.0f;
+	float B[3] = {};
+	float C = 0.0f;
+
+	float G[NUM_ATTRIBUTES][3] = {};
+	float D[NUM_ATTRIBUTES] = {};
+	float S[NUM_ATTRIBUTES] = {};
+
+	// Area of the triangles plus the weight of the border planes, normalizes the error
+	float Weight = 0.0f;
+};
+
+static void AddPlane(Quadric& q, const glm::vec3& normal, float distance, float weight)
+{
+	q.A00 += weight * normal.x * normal.x;
+	q.A11 += weight * normal.y * normal.y;
+	q.A22 += weight * normal.z * normal.z;
+	q.A01 += weight * normal.x * normal.y;
+	q.A02 += weight * normal.x * normal.z;
+	q.A12 += weight * normal.y * normal.z;
+
+	for (uint32_t i = 0; i < 3; ++i)
+		q.B[i] += weight * normal[i] * distance;
+
+	q.C += weight * distance * distance;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other)
+{
+	q.A00 += other.A00;
+	q.A11 += other.A11;
+	q.A22 += other.A22;
+	q.A01 += other.A01;
+	q.A02 += other.A02;
+	q.A12 += other.A12;
+
+	for (uint32_t i = 0; i < 3; ++i)
+		q.B[i] += other.B[i];
+
+	q.C += other.C;
+
+	for (uint32_t a = 0; a < NUM_ATTRIBUTES; ++a)
+	{
+		for (uint32_t i = 0; i < 3; ++i)
+			q.G[a][i] += other.G[a][i];
+
+		q.D[a] += other.D[a];
+		q.S[a] += other.S[a];
+	}
+
+	q.Weight += other.Weight;
+}
+
+static float EvaluateQuadric(const Quadric& q, const glm::vec3& p, const float* attributes)
+{
+	float error = p.x * p.x * q.A00 + p.y * p.y * q.A11 + p.z * p.z * q.A22 +
+		2.0f * (p.x * p.y * q.A01 + p.x * p.z * q.A02 + p.y * p.z * q.A12) +
+		2.0f * (p.x * q.B[0] + p.y * q.B[1] + p.z * q.B[2]) + q.C;
+
+	for (uint32_t a = 0; a < NUM_ATTRIBUTES; ++a)
+	{
+		float interpolated = p.x * q.G[a][0] + p.y * q.G[a][1] + p.z * q.G[a][2] + q.D[a];
+		error += attributes[a] * (q.S[a] * attributes[a] - 2.0f * interpolated);
+	}
+
+	// Rounding can make the error of an exact fit slightly negative
+	return std::abs(error) / std::max(q.Weight, std::numeric_limits<float>::min());
+}
+
+static void GetAttributes(const Vertex& vertex, float* attributes)
+{
+	attributes[0] = vertex.TexCoord.x;
+	attributes[1] = vertex.TexCoord.y;
+	attributes[2] = vertex.Normal.x;
+	attributes[3] = vertex.Normal.y;
+	attributes[4] = vertex.Normal.z;
+}
+
+/* Map every vertex to the first vertex that is equal to it */
+template<typename THash, typename TEqual>
+static std::vector<uint32_t> BuildRemap(std::size_t numVertices, const THash& hash, const TEqual& equal)
+{
+	// Open addressing table of vertex indices, at most half full
+	std::size_t tableSize = 1;
+	while (tableSize < numVertices * 2)
+		tableSize <<= 1;
+
+	std::vector<uint32_t> table(tableSize, INVALID_INDEX);
+	std::vector<uint32_t> remap(numVertices);
+
+	for (uint32_t v = 0; v < numVertices; ++v)
+	{
+		std::size_t slot = hash(v) & (tableSize - 1);
+		while (table[slot] != INVALID_INDEX && !equal(table[slot], v))
+			slot = (slot + 1) & (tableSize - 1);
+
+		if (table[slot] == INVALID_INDEX)
+			table[slot] = v;
+
+		remap[v] = table[slot];
+	}
+
+	return remap;
+}
+
+static uint64_t GetEdgeKey(uint32_t from, uint32_t to)
+{
+	return (static_cast<uint64_t>(from) << 32) | to;
+}
+
+/* Moving the vertex onto the collapse target neither flips nor degenerates the triangles around it that remain, counts the triangles that
+   collapse with the edge */
+static bool IsCollapseValid(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& adjacencyOffsets,
+	const std::vector<uint32_t>& adjacency, uint32_t from, uint32_t to, std::size_t& numSharedTriangles)
+{
+	std::size_t numEdgeTriangles = 0;
+
+	for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a)
+	{
+		const uint32_t* triangle = &indices[adjacency[a] * 3];
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+		{
+			numEdgeTriangles++;
+			continue;
+		}
+
+		glm::vec3 corners[3], movedCorners[3];
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			corners[c] = positions[triangle[c]];
+			movedCorners[c] = triangle[c] == from ? positions[to] : corners[c];
+		}
+
+		glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		glm::vec3 movedNormal = glm::cross(movedCorners[1] - movedCorners[0], movedCorners[2] - movedCorners[0]);
+		// Normals that turn by more than about 75 degrees are close to flipping
+		if (glm::dot(normal, movedNormal) <= 0.25f * glm::length(normal) * glm::length(movedNormal))
+			return false;
+	}
+
+	numSharedTriangles += numEdgeTriangles;
+	return numEdgeTriangles > 0;
+}
+
+float MeshSimplifier::Simplify(const Vertex* vertices, std::size_t numVertices, const std::vector<uint32_t>& indices, std::size_t targetNumIndices,
+	std::vector<uint32_t>& result, const MeshSimplificationDesc& desc)
+{
+	result = indices;
+	if (result.size() <= targetNumIndices || numVertices == 0)
+		return 0.0f;
+
+	// Errors are measured in a unit cube around the mesh, so the weights and the maximum error do not depend on its scale
+	glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+	for (uint32_t index : indices)
+	{
+		boundsMin = glm::min(boundsMin, vertices[index].Position);
+		boundsMax = glm::max(boundsMax, vertices[index].Position);
+	}
+
+	glm::vec3 size = boundsMax - boundsMin;
+	float extent = std::max(size.x, std::max(size.y, size.z));
+	float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+	std::vector<glm::vec3> positions(numVertices);
+	for (std::size_t v = 0; v < numVertices; ++v)
+		positions[v] = (vertices[v].Position - boundsMin) * scale;
+
+	// Collapses work on welded vertices, vertices that only share their position are on a seam
+	std::vector<uint32_t> vertexRemap = BuildRemap(numVertices,
+		[&](uint32_t v) { return Hash::Hash64(&vertices[v], sizeof(Vertex)); },
+		[&](uint32_t lhs, uint32_t rhs) { return std::memcmp(&vertices[lhs], &vertices[rhs], sizeof(Vertex)) == 0; });
+	std::vector<uint32_t> positionRemap = BuildRemap(numVertices,
+		[&](uint32_t v) { return Hash::Hash64(&vertices[v].Position, sizeof(glm::vec3)); },
+		[&](uint32_t lhs, uint32_t rhs) { return std::memcmp(&vertices[lhs].Position, &vertices[rhs].Position, sizeof(glm::vec3)) == 0; });
+
+	for (auto& index : result)
+		index = vertexRemap[index];
+
+	std::size_t numTriangles = result.size() / 3;
+	result.resize(numTriangles * 3);
+
+	// Welded vertices at each position, the two vertices at a position on a seam between two attribute charts are siblings
+	std::vector<uint32_t> numPositionVertices(numVertices, 0);
+	std::vector<uint32_t> firstPositionVertices(numVertices, INVALID_INDEX);
+	std::vector<uint32_t> siblings(numVertices, INVALID_INDEX);
+	std::vector<bool> isReferenced(numVertices, false);
+
+	for (uint32_t index : result)
+	{
+		if (isReferenced[index])
+			continue;
+
+		isReferenced[index] = true;
+		uint32_t position = positionRemap[index];
+		numPositionVertices[position]++;
+
+		if (firstPositionVertices[position] == INVALID_INDEX)
+		{
+			firstPositionVertices[position] = index;
+		}
+		else
+		{
+			siblings[index] = firstPositionVertices[position];
+			siblings[firstPositionVertices[position]] = index;
+		}
+	}
+
+	// Sorted directed edges between welded vertices and between positions, rebuilt whenever the triangles change
+	std::vector<uint64_t> edges, positionEdges;
+
+	auto buildEdges = [&]() {
+		edges.clear();
+		positionEdges.clear();
+
+		for (std::size_t i = 0; i < result.size(); i += 3)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				uint32_t from = result[i + c], to = result[i + (c + 1) % 3];
+				edges.push_back(GetEdgeKey(from, to));
+				positionEdges.push_back(GetEdgeKey(positionRemap[from], positionRemap[to]));
+			}
+		}
+
+		std::sort(edges.begin(), edges.end());
+		std::sort(positionEdges.begin(), positionEdges.end());
+	};
+
+	auto hasEdge = [](const std::vector<uint64_t>& sortedEdges, uint32_t from, uint32_t to) {
+		return std::binary_search(sortedEdges.begin(), sortedEdges.end(), GetEdgeKey(from, to));
+	};
+
+	// An edge used in one direction only has triangles on one side, between positions that is an open border and
+	// between welded vertices either an open border or a seam
+	auto isBorderEdge = [&](uint32_t v0, uint32_t v1) {
+		return hasEdge(positionEdges, positionRemap[v0], positionRemap[v1]) != hasEdge(positionEdges, positionRemap[v1], positionRemap[v0]);
+	};
+	auto isSeamEdge = [&](uint32_t v0, uint32_t v1) {
+		return hasEdge(edges, v0, v1) != hasEdge(edges, v1, v0) && !isBorderEdge(v0, v1);
+	};
+
+	buildEdges();
+
+	std::vector<VertexKind> kinds(numVertices, VertexKind::VERTEX_KIND_MANIFOLD);
+	std::vector<Quadric> quadrics(numVertices);
+	const float attributeWeights[NUM_ATTRIBUTES] = { desc.TexCoordWeight, desc.TexCoordWeight, desc.NormalWeight, desc.NormalWeight, desc.NormalWeight };
+
+	for (std::size_t i = 0; i < result.size(); i += 3)
+	{
+		const uint32_t triangle[3] = { result[i], result[i + 1], result[i + 2] };
+		const glm::vec3& p0 = positions[triangle[0]];
+		glm::vec3 edge1 = positions[triangle[1]] - p0, edge2 = positions[triangle[2]] - p0;
+		glm::vec3 normal = glm::cross(edge1, edge2);
+
+		float normalLength = glm::length(normal);
+		if (normalLength <= 0.0f)
+			continue;
+
+		float area = 0.5f * normalLength;
+		glm::vec3 unitNormal = normal / normalLength;
+
+		Quadric triangleQuadric;
+		AddPlane(triangleQuadric, unitNormal, -glm::dot(unitNormal, p0), area);
+		triangleQuadric.Weight = area;
+
+		// Gradient of each attribute within the triangle plane, the attribute at p is dot(gradient, p) + offset
+		float attributes[3][NUM_ATTRIBUTES] = {};
+		for (uint32_t c = 0; c < 3; ++c)
+			GetAttributes(vertices[triangle[c]], attributes[c]);
+
+		glm::vec3 gradientBasis1 = glm::cross(edge2, normal) / (normalLength * normalLength);
+		glm::vec3 gradientBasis2 = glm::cross(normal, edge1) / (normalLength * normalLength);
+
+		for (uint32_t a = 0; a < NUM_ATTRIBUTES; ++a)
+		{
+			glm::vec3 gradient = (attributes[1][a] - attributes[0][a]) * gradientBasis1 + (attributes[2][a] - attributes[0][a]) * gradientBasis2;
+			float offset = attributes[0][a] - glm::dot(gradient, p0);
+			float weight = area * attributeWeights[a];
+
+			float gradientLength = glm::length(gradient);
+			if (gradientLength > 0.0f)
+				AddPlane(triangleQuadric, gradient / gradientLength, offset / gradientLength, weight * gradientLength * gradientLength);
+			else
+				triangleQuadric.C += weight * offset * offset;
+
+			for (uint32_t j = 0; j < 3; ++j)
+				triangleQuadric.G[a][j] += weight * gradient[j];
+
+			triangleQuadric.D[a] += weight * offset;
+			triangleQuadric.S[a] += weight;
+		}
+
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			AddQuadric(quadrics[triangle[c]], triangleQuadric);
+
+			uint32_t from = triangle[c], to = triangle[(c + 1) % 3];
+			if (hasEdge(edges, to, from))
+				continue;
+
+			// A plane through border and seam edges, perpendicular to the triangle, keeps them from moving sideways
+			glm::vec3 edge = positions[to] - positions[from];
+			glm::vec3 borderNormal = glm::cross(edge, unitNormal);
+			float borderNormalLength = glm::length(borderNormal);
+
+			if (borderNormalLength > 0.0f)
+			{
+				borderNormal /= borderNormalLength;
+
+				Quadric borderQuadric;
+				borderQuadric.Weight = desc.BorderWeight * glm::dot(edge, edge);
+				AddPlane(borderQuadric, borderNormal, -glm::dot(borderNormal, positions[from]), borderQuadric.Weight);
+				AddQuadric(quadrics[from], borderQuadric);
+				AddQuadric(quadrics[to], borderQuadric);
+			}
+
+			if (isBorderEdge(from, to))
+			{
+				kinds[from] = VertexKind::VERTEX_KIND_BORDER;
+				kinds[to] = VertexKind::VERTEX_KIND_BORDER;
+			}
+		}
+	}
+
+	// Seams only collapse together with their siblings, which needs exactly one sibling away from open borders
+	for (std::size_t v = 0; v < numVertices; ++v)
+	{
+		uint32_t numSiblings = isReferenced[v] ? numPositionVertices[positionRemap[v]] : 0;
+		if (numSiblings > 2 || (numSiblings == 2 && kinds[v] == VertexKind::VERTEX_KIND_BORDER))
+			kinds[v] = VertexKind::VERTEX_KIND_LOCKED;
+		else if (numSiblings == 2)
+			kinds[v] = VertexKind::VERTEX_KIND_SEAM;
+	}
+
+	auto canCollapse = [&](uint32_t from, uint32_t to) {
+		switch (kinds[from])
+		{
+		case VertexKind::VERTEX_KIND_MANIFOLD:
+			return true;
+		case VertexKind::VERTEX_KIND_BORDER:
+			return (kinds[to] == VertexKind::VERTEX_KIND_BORDER || kinds[to] == VertexKind::VERTEX_KIND_LOCKED) && isBorderEdge(from, to);
+		case VertexKind::VERTEX_KIND_SEAM:
+			return kinds[to] == VertexKind::VERTEX_KIND_SEAM && isSeamEdge(from, to) &&
+				(hasEdge(edges, siblings[from], siblings[to]) || hasEdge(edges, siblings[to], siblings[from]));
+		default:
+			return false;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t From;
+		uint32_t To;
+		float Error;
+	};
+
+	float maxCollapseError = desc.MaxError * desc.MaxError;
+	float resultError = 0.0f;
+
+	std::vector<uint32_t> adjacencyOffsets(numVertices + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseRemap(numVertices);
+	std::vector<bool> isTouched(numVertices);
+	float attributes[NUM_ATTRIBUTES] = {};
+
+	// Every pass collapses a set of edges whose neighbourhoods do not overlap, cheapest first, until the target is reached
+	while (result.size() > targetNumIndices)
+	{
+		numTriangles = result.size() / 3;
+		buildEdges();
+
+		// Vertex to triangle adjacency, stored as offsets into a single array
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t index : result)
+			adjacencyOffsets[index + 1]++;
+
+		for (std::size_t v = 0; v < numVertices; ++v)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+		adjacency.resize(result.size());
+		std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (std::size_t t = 0; t < numTriangles; ++t)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+				adjacency[adjacencyFill[result[t * 3 + c]]++] = static_cast<uint32_t>(t);
+		}
+
+		collapses.clear();
+		for (std::size_t t = 0; t < numTriangles; ++t)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				uint32_t v0 = result[t * 3 + c], v1 = result[t * 3 + (c + 1) % 3];
+				if (canCollapse(v0, v1))
+					collapses.push_back({ v0, v1, 0.0f });
+				if (canCollapse(v1, v0))
+					collapses.push_back({ v1, v0, 0.0f });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+			return lhs.From != rhs.From ? lhs.From < rhs.From : lhs.To < rhs.To;
+		});
+		collapses.erase(std::unique(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+			return lhs.From == rhs.From && lhs.To == rhs.To;
+		}), collapses.end());
+
+		auto getCollapseError = [&](uint32_t from, uint32_t to) {
+			Quadric quadric = quadrics[from];
+			AddQuadric(quadric, quadrics[to]);
+
+			GetAttributes(vertices[to], attributes);
+			return EvaluateQuadric(quadric, positions[to], attributes);
+		};
+
+		for (auto& collapse : collapses)
+		{
+			collapse.Error = getCollapseError(collapse.From, collapse.To);
+			if (kinds[collapse.From] == VertexKind::VERTEX_KIND_SEAM)
+				collapse.Error += getCollapseError(siblings[collapse.From], siblings[collapse.To]);
+		}
+
+		// Ties are broken by vertex index, so the result does not depend on the sort implementation
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+			if (lhs.Error != rhs.Error)
+				return lhs.Error < rhs.Error;
+			return lhs.From != rhs.From ? lhs.From < rhs.From : lhs.To < rhs.To;
+		});
+
+		for (uint32_t v = 0; v < numVertices; ++v)
+			collapseRemap[v] = v;
+
+		std::fill(isTouched.begin(), isTouched.end(), false);
+
+		auto applyCollapse = [&](uint32_t from, uint32_t to) {
+			collapseRemap[from] = to;
+			AddQuadric(quadrics[to], quadrics[from]);
+
+			for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a)
+			{
+				for (uint32_t c = 0; c < 3; ++c)
+					isTouched[result[adjacency[a] * 3 + c]] = true;
+			}
+		};
+
+		std::size_t numTrianglesToRemove = (result.size() - targetNumIndices + 2) / 3;
+		std::size_t numRemovedTriangles = 0;
+		std::size_t numCollapses = 0;
+
+		for (auto& collapse : collapses)
+		{
+			if (collapse.Error > maxCollapseError || numRemovedTriangles >= numTrianglesToRemove)
+				break;
+
+			bool isSeam = kinds[collapse.From] == VertexKind::VERTEX_KIND_SEAM;
+			if (isTouched[collapse.From] || isTouched[collapse.To] || (isSeam && (isTouched[siblings[collapse.From]] || isTouched[siblings[collapse.To]])))
+				continue;
+
+			std::size_t numSharedTriangles = 0;
+			if (!IsCollapseValid(positions, result, adjacencyOffsets, adjacency, collapse.From, collapse.To, numSharedTriangles) ||
+				(isSeam && !IsCollapseValid(positions, result, adjacencyOffsets, adjacency, siblings[collapse.From], siblings[collapse.To], numSharedTriangles)))
+				continue;
+
+			applyCollapse(collapse.From, collapse.To);
+			if (isSeam)
+				applyCollapse(siblings[collapse.From], siblings[collapse.To]);
+
+			resultError = std::max(resultError, collapse.Error);
+			numRemovedTriangles += numSharedTriangles;
+			numCollapses++;
+		}
+
+		if (numCollapses == 0)
+			break;
+
+		std::size_t numIndices = 0;
+		for (std::size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32_t v0 = collapseRemap[result[i]], v1 = collapseRemap[result[i + 1]], v2 = collapseRemap[result[i + 2]];
+			if (v0 == v1 || v1 == v2 || v2 == v0)
+				continue;
+
+			result[numIndices++] = v0;
+			result[numIndices++] = v1;
+			result[numIndices++] = v2;
+		}
+
+		result.resize(numIndices);
+
+		// The remaining collapses are mostly above the maximum error, further passes would only remove a few more triangles each
+		if (numRemovedTriangles * 100 < numTriangles)
+			break;
+	}
+
+	return std::sqrt(resultError) * (extent > 0.0f ? extent : 1.0f);
+}
@@ -0,0 +1,270 @@
+#include "Pch.h"
+#include "Resource/MeshletBuilder.h"
+
+static constexpr uint32_t INVALID_INDEX = ~0u;
+
+/*
+	Meshlets are grown one triangle at a time, starting from the first triangle that is not part of a meshlet yet.
+	The next triangle is the neighbour of the meshlet that adds the fewest new vertices, ties go to the triangle
+	closest to the meshlet center and then to the lowest triangle index. Once a meshlet has no neighbours left it
+	continues with the next triangle in order if that one is close by, otherwise the meshlet is finished.
+*/
+void MeshletBuilder::Build(const Vertex* vertices, std::size_t numVertices, std::vector<uint32_t>& indices, MeshletData& meshlets,
+	uint32_t maxVertices, uint32_t maxTriangles)
+{
+	ASSERT(maxVertices >= 3 && maxVertices <= 256 && maxTriangles > 0, "Meshlet limits are out of range");
+
+	meshlets = MeshletData();
+
+	std::size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0 || numVertices == 0)
+		return;
+
+	// Vertex to triangle adjacency, stored as offsets into a single array
+	std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+	for (std::size_t i = 0; i < numTriangles * 3; ++i)
+		adjacencyOffsets[indices[i] + 1]++;
+
+	for (std::size_t v = 0; v < numVertices; ++v)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+	std::vector<uint32_t> adjacency(numTriangles * 3);
+	std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	std::vector<glm::vec3> centroids(numTriangles, glm::vec3(0.0f));
+
+	for (std::size_t t = 0; t < numTriangles; ++t)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			adjacency[adjacencyFill[indices[t * 3 + c]]++] = static_cast<uint32_t>(t);
+			centroids[t] += vertices[indices[t * 3 + c]].Position / 3.0f;
+		}
+	}
+
+	std::vector<bool> emitted(numTriangles, false);
+	// Meshlet that last used each vertex and its index within that meshlet
+	std::vector<uint32_t> vertexMeshlets(numVertices, INVALID_INDEX);
+	std::vector<uint8_t> localIndices(numVertices, 0);
+	// Meshlet that last added each triangle to its candidates, so candidates are unique
+	std::vector<uint32_t> candidateMeshlets(numTriangles, INVALID_INDEX);
+	std::vector<uint32_t> candidates;
+
+	std::vector<uint32_t> reordered;
+	reordered.reserve(indices.size());
+
+	Meshlet meshlet;
+	uint32_t meshletIndex = 0;
+	glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+	std::size_t cursor = 0;
+
+	auto countNewVertices = [&](uint32_t triangle) {
+		uint32_t numNewVertices = 0;
+		for (uint32_t c = 0; c < 3; ++c)
+			numNewVertices += vertexMeshlets[indices[triangle * 3 + c]] != meshletIndex;
+
+		return numNewVertices;
+	};
+
+	auto addTriangle = [&](uint32_t triangle) {
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			uint32_t v = indices[triangle * 3 + c];
+			if (vertexMeshlets[v] != meshletIndex)
+			{
+				vertexMeshlets[v] = meshletIndex;
+				localIndices[v] = static_cast<uint8_t>(meshlet.NumVertices++);
+				meshlets.Vertices.push_back(v);
+
+				boundsMin = glm::min(boundsMin, vertices[v].Position);
+				boundsMax = glm::max(boundsMax, vertices[v].Position);
+
+				for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+				{
+					if (!emitted[adjacency[a]] && candidateMeshlets[adjacency[a]] != meshletIndex)
+					{
+						candidateMeshlets[adjacency[a]] = meshletIndex;
+						candidates.push_back(adjacency[a]);
+					}
+				}
+			}
+
+			meshlets.Triangles.push_back(localIndices[v]);
+			reordered.push_back(v);
+		}
+
+		emitted[triangle] = true;
+		meshlet.NumTriangles++;
+	};
+
+	auto finishMeshlet = [&]() {
+		ComputeBounds(vertices, meshlets.Vertices.data() + meshlet.VertexOffset, meshlets.Triangles.data() + meshlet.TriangleOffset, meshlet);
+		meshlets.Meshlets.push_back(meshlet);
+
+		meshlet = Meshlet();
+		meshlet.VertexOffset = static_cast<uint32_t>(meshlets.Vertices.size());
+		meshlet.TriangleOffset = static_cast<uint32_t>(meshlets.Triangles.size());
+		meshlet.IndexOffset = static_cast<uint32_t>(reordered.size());
+		meshletIndex++;
+
+		boundsMin = glm::vec3(std::numeric_limits<float>::max());
+		boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+		candidates.clear();
+	};
+
+	for (std::size_t numEmitted = 0; numEmitted < numTriangles; ++numEmitted)
+	{
+		while (emitted[cursor])
+			cursor++;
+
+		uint32_t next = meshlet.NumTriangles == 0 ? static_cast<uint32_t>(cursor) : INVALID_INDEX;
+
+		if (next == INVALID_INDEX && meshlet.NumTriangles < maxTriangles)
+		{
+			glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+			uint32_t bestNewVertices = INVALID_INDEX;
+			float bestDistance = 0.0f;
+			std::size_t numCandidates = 0;
+
+			for (uint32_t triangle : candidates)
+			{
+				if (emitted[triangle])
+					continue;
+
+				candidates[numCandidates++] = triangle;
+
+				uint32_t numNewVertices = countNewVertices(triangle);
+				if (meshlet.NumVertices + numNewVertices > maxVertices)
+					continue;
+
+				glm::vec3 offset = centroids[triangle] - center;
+				float distance = glm::dot(offset, offset);
+
+				if (numNewVertices < bestNewVertices || (numNewVertices == bestNewVertices &&
+					(distance < bestDistance || (distance == bestDistance && triangle < next))))
+				{
+					next = triangle;
+					bestNewVertices = numNewVertices;
+					bestDistance = distance;
+				}
+			}
+
+			candidates.resize(numCandidates);
+
+			// Disconnected triangles only join the meshlet if they are within its extent, so the bounds stay tight
+			if (candidates.empty())
+			{
+				glm::vec3 size = boundsMax - boundsMin;
+				glm::vec3 extent = glm::vec3(std::max(size.x, std::max(size.y, size.z)));
+				bool isClose = glm::all(glm::greaterThanEqual(centroids[cursor], boundsMin - extent)) &&
+					glm::all(glm::lessThanEqual(centroids[cursor], boundsMax + extent));
+
+				if (isClose && meshlet.NumVertices + countNewVertices(static_cast<uint32_t>(cursor)) <= maxVertices)
+					next = static_cast<uint32_t>(cursor);
+			}
+		}
+
+		if (next == INVALID_INDEX)
+		{
+			finishMeshlet();
+			next = static_cast<uint32_t>(cursor);
+		}
+
+		addTriangle(next);
+	}
+
+	finishMeshlet();
+
+	// Indices that do not form a whole triangle stay at the end
+	reordered.insert(reordered.end(), indices.begin() + numTriangles * 3, indices.end());
+	indices.swap(reordered);
+}
+
+void MeshletBuilder::ComputeBounds(const Vertex* vertices, const uint32_t* meshletVertices, const uint8_t* meshletTriangles, Meshlet& meshlet)
+{
+	glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+	for (uint32_t i = 0; i < meshlet.NumVertices; ++i)
+	{
+		boundsMin = glm::min(boundsMin, vertices[meshletVertices[i]].Position);
+		boundsMax = glm::max(boundsMax, vertices[meshletVertices[i]].Position);
+	}
+
+	meshlet.Center = (boundsMin + boundsMax) * 0.5f;
+	meshlet.Radius = 0.0f;
+
+	for (uint32_t i = 0; i < meshlet.NumVertices; ++i)
+		meshlet.Radius = std::max(meshlet.Radius, glm::length(vertices[meshletVertices[i]].Position - meshlet.Center));
+
+	auto getTriangleNormal = [&](uint32_t triangle, glm::vec3& normal) {
+		const glm::vec3& p0 = vertices[meshletVertices[meshletTriangles[triangle * 3 + 0]]].Position;
+		const glm::vec3& p1 = vertices[meshletVertices[meshletTriangles[triangle * 3 + 1]]].Position;
+		const glm::vec3& p2 = vertices[meshletVertices[meshletTriangles[triangle * 3 + 2]]].Position;
+
+		normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length <= 0.0f)
+			return false;
+
+		normal /= length;
+		return true;
+	};
+
+	// The cone axis is the average triangle normal, degenerate triangles have no normal and do not constrain the cone
+	glm::vec3 axis(0.0f), normal(0.0f);
+	for (uint32_t t = 0; t < meshlet.NumTriangles; ++t)
+	{
+		if (getTriangleNormal(t, normal))
+			axis += normal;
+	}
+
+	meshlet.ConeAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.ConeCutoff = 1.0f;
+
+	float axisLength = glm::length(axis);
+	if (axisLength <= 0.0f)
+		return;
+
+	axis /= axisLength;
+	float minDot = 1.0f;
+
+	for (uint32_t t = 0; t < meshlet.NumTriangles; ++t)
+	{
+		if (getTriangleNormal(t, normal))
+			minDot = std::min(minDot, glm::dot(normal, axis));
+	}
+
+	meshlet.ConeAxis = axis;
+
+	// A cone of 90 degrees or wider contains opposite facing triangles, so the meshlet is never back facing as a whole
+	if (minDot > 0.0f)
+		meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+bool MeshletBuilder::IsBackfacing(const Meshlet& meshlet, const glm::vec3& viewPosition)
+{
+	if (meshlet.ConeCutoff >= 1.0f)
+		return false;
+
+	// Every direction from the view position into the bounding sphere has to be within 90 degrees of every normal in the cone
+	glm::vec3 direction = meshlet.Center - viewPosition;
+	return glm::dot(direction, meshlet.ConeAxis) >= meshlet.ConeCutoff * glm::length(direction) + meshlet.Radius;
+}
+
+MeshletBuildStats MeshletBuilder::ComputeStats(const std::vector<Meshlet>& meshlets, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	MeshletBuildStats stats;
+	stats.NumMeshlets = meshlets.size();
+
+	for (auto& meshlet : meshlets)
+	{
+		stats.NumTriangles += meshlet.NumTriangles;
+		stats.NumMeshletVertices += meshlet.NumVertices;
+	}
+
+	if (stats.NumMeshlets > 0)
+	{
+		stats.VertexFillRate = static_cast<float>(static_cast<double>(stats.NumMeshletVertices) / (stats.NumMeshlets * maxVertices));
+		stats.TriangleFillRate = static_cast<float>(static_cast<double>(stats.NumTriangles) / (stats.NumMeshlets * maxTriangles));
+	}
+
+	return stats;
+}
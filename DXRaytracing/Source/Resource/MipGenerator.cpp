@@ -0,0 +1,358 @@
+#include "Pch.h"
+#include "Resource/MipGenerator.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define MIP_GENERATOR_SSE2
+#include <immintrin.h>
+#endif
+
+static constexpr uint32_t MAX_FILTER_TAPS = 6;
+
+// Separable 2x decimation kernel, output texel x covers the source texels 2x + FirstOffset onwards
+struct DownsampleKernel
+{
+	int32_t FirstOffset = 0;
+	uint32_t NumTaps = 0;
+	float Weights[MAX_FILTER_TAPS] = {};
+};
+
+static float BesselI0(float x)
+{
+	// Power series, converges quickly for the small arguments of the Kaiser window
+	float sum = 1.0f, term = 1.0f;
+	for (uint32_t k = 1; k < 16; ++k)
+	{
+		term *= (x * 0.5f / k) * (x * 0.5f / k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+static DownsampleKernel CreateKaiserKernel()
+{
+	constexpr float radius = 3.0f;
+	constexpr float alpha = 4.0f;
+	constexpr float pi = 3.14159265358979f;
+
+	DownsampleKernel kernel;
+	kernel.FirstOffset = -2;
+	kernel.NumTaps = 6;
+
+	float sum = 0.0f;
+	for (uint32_t i = 0; i < kernel.NumTaps; ++i)
+	{
+		// Distance from the source texel center to the output texel center, which sits at 2x + 0.5 in source texels
+		float distance = static_cast<float>(kernel.FirstOffset + static_cast<int32_t>(i)) - 0.5f;
+
+		// Sinc with the cutoff at the new Nyquist frequency, windowed by a Kaiser window
+		float t = distance * 0.5f;
+		float sinc = std::sin(pi * t) / (pi * t);
+		float ratio = distance / radius;
+		float window = BesselI0(alpha * std::sqrt(std::max(0.0f, 1.0f - ratio * ratio))) / BesselI0(alpha);
+
+		kernel.Weights[i] = sinc * window;
+		sum += kernel.Weights[i];
+	}
+
+	for (uint32_t i = 0; i < kernel.NumTaps; ++i)
+		kernel.Weights[i] /= sum;
+
+	return kernel;
+}
+
+static const DownsampleKernel& GetKernel(MipFilter filter)
+{
+	static const DownsampleKernel boxKernel = { 0, 2, { 0.5f, 0.5f } };
+	static const DownsampleKernel kaiserKernel = CreateKaiserKernel();
+
+	return filter == MipFilter::MIP_FILTER_KAISER ? kaiserKernel : boxKernel;
+}
+
+static inline uint32_t ClampTexel(int32_t texel, uint32_t size)
+{
+	return static_cast<uint32_t>(std::min(std::max(texel, 0), static_cast<int32_t>(size) - 1));
+}
+
+template<bool UseSIMD>
+static void FilterRow(const DownsampleKernel& kernel, const float* const* rows, uint32_t rowStride, uint32_t numOutput,
+	const uint32_t* texelIndices, float* output)
+{
+	// Sums kernel.NumTaps weighted RGBA texels for every output texel, rows[i] and texelIndices give the texel of tap i
+	for (uint32_t x = 0; x < numOutput; ++x)
+	{
+		const uint32_t* taps = texelIndices + x * kernel.NumTaps;
+
+#ifdef MIP_GENERATOR_SSE2
+		if (UseSIMD)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t i = 0; i < kernel.NumTaps; ++i)
+			{
+				const float* texel = rows[i * rowStride] + taps[i] * 4;
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(texel), _mm_set1_ps(kernel.Weights[i])));
+			}
+
+			_mm_storeu_ps(output + x * 4, sum);
+			continue;
+		}
+#endif
+
+		float sum[4] = {};
+		for (uint32_t i = 0; i < kernel.NumTaps; ++i)
+		{
+			const float* texel = rows[i * rowStride] + taps[i] * 4;
+			for (uint32_t c = 0; c < 4; ++c)
+				sum[c] += texel[c] * kernel.Weights[i];
+		}
+
+		memcpy(output + x * 4, sum, sizeof(sum));
+	}
+}
+
+/* Downsample a source that is fetched row by row, only kernel.NumTaps + 2 horizontally filtered rows are kept at a time */
+template<bool UseSIMD>
+static void DownsampleRows(const std::function<const float*(uint32_t)>& getSourceRow, uint32_t sourceWidth, uint32_t sourceHeight,
+	MipFilter filter, float* output)
+{
+	const DownsampleKernel& kernel = GetKernel(filter);
+
+	uint32_t outputWidth = std::max(1u, sourceWidth / 2);
+	uint32_t outputHeight = std::max(1u, sourceHeight / 2);
+
+	// Horizontal taps are the same for every row, the source row pointer is repeated for each tap
+	std::vector<uint32_t> horizontalTaps(outputWidth * kernel.NumTaps);
+	for (uint32_t x = 0; x < outputWidth; ++x)
+	{
+		for (uint32_t i = 0; i < kernel.NumTaps; ++i)
+			horizontalTaps[x * kernel.NumTaps + i] = ClampTexel(2 * static_cast<int32_t>(x) + kernel.FirstOffset + i, sourceWidth);
+	}
+
+	std::vector<uint32_t> verticalTaps(outputWidth * kernel.NumTaps);
+	for (uint32_t x = 0; x < outputWidth; ++x)
+	{
+		for (uint32_t i = 0; i < kernel.NumTaps; ++i)
+			verticalTaps[x * kernel.NumTaps + i] = x;
+	}
+
+	// Ring of horizontally filtered rows, tagged with their source row
+	const uint32_t numCachedRows = kernel.NumTaps + 2;
+	std::vector<float> cachedRows(numCachedRows * outputWidth * 4);
+	std::vector<int64_t> cachedRowTags(numCachedRows, -1);
+
+	auto getFilteredRow = [&](uint32_t sourceRow) -> const float* {
+		uint32_t slot = sourceRow % numCachedRows;
+		float* row = cachedRows.data() + slot * outputWidth * 4;
+
+		if (cachedRowTags[slot] != sourceRow)
+		{
+			const float* source = getSourceRow(sourceRow);
+			const float* sourceRows[1] = { source };
+			FilterRow<UseSIMD>(kernel, sourceRows, 0, outputWidth, horizontalTaps.data(), row);
+			cachedRowTags[slot] = sourceRow;
+		}
+
+		return row;
+	};
+
+	for (uint32_t y = 0; y < outputHeight; ++y)
+	{
+		const float* rows[MAX_FILTER_TAPS] = {};
+		for (uint32_t i = 0; i < kernel.NumTaps; ++i)
+			rows[i] = getFilteredRow(ClampTexel(2 * static_cast<int32_t>(y) + kernel.FirstOffset + i, sourceHeight));
+
+		FilterRow<UseSIMD>(kernel, rows, 1, outputWidth, verticalTaps.data(), output + y * outputWidth * 4);
+	}
+}
+
+template<bool UseSIMD>
+static void DownsampleImage(const MipImage& source, MipFilter filter, MipImage& output)
+{
+	output.Width = std::max(1u, source.Width / 2);
+	output.Height = std::max(1u, source.Height / 2);
+	output.Pixels.resize(output.Width * output.Height * 4);
+
+	DownsampleRows<UseSIMD>([&source](uint32_t y) { return source.Pixels.data() + y * source.Width * 4; },
+		source.Width, source.Height, filter, output.Pixels.data());
+}
+
+static const float* GetSRGBToLinearTable()
+{
+	static const std::vector<float> table = []() {
+		std::vector<float> values(256);
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			float srgb = i / 255.0f;
+			values[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+		}
+		return values;
+	}();
+
+	return table.data();
+}
+
+static constexpr uint32_t SRGB_ENCODE_BUCKETS = 4096;
+
+struct LinearToSRGBTable
+{
+	// Linear values at the midpoints between consecutive 8-bit sRGB values, so encoding rounds to the nearest sRGB value
+	float Thresholds[256] = {};
+	// Number of thresholds below the start of each bucket, buckets are narrow enough to hold at most two thresholds
+	unsigned char BucketStart[SRGB_ENCODE_BUCKETS] = {};
+};
+
+static const LinearToSRGBTable& GetLinearToSRGBTable()
+{
+	static const LinearToSRGBTable table = []() {
+		LinearToSRGBTable values;
+		for (uint32_t i = 0; i < 255; ++i)
+		{
+			float srgb = (i + 0.5f) / 255.0f;
+			values.Thresholds[i] = srgb <= 0.04045f ? srgb / 12.92f : std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+		}
+		// Sentinel, never passed by values clamped to [0, 1]
+		values.Thresholds[255] = 2.0f;
+
+		for (uint32_t bucket = 0; bucket < SRGB_ENCODE_BUCKETS; ++bucket)
+		{
+			float bucketStart = static_cast<float>(bucket) / SRGB_ENCODE_BUCKETS;
+			values.BucketStart[bucket] = static_cast<unsigned char>(std::upper_bound(values.Thresholds, values.Thresholds + 255, bucketStart) - values.Thresholds);
+		}
+		return values;
+	}();
+
+	return table;
+}
+
+static inline float Saturate(float value)
+{
+	// Also maps NaN to 0
+	return value > 0.0f ? std::min(value, 1.0f) : 0.0f;
+}
+
+static inline unsigned char EncodeLinear(float value)
+{
+	return static_cast<unsigned char>(Saturate(value) * 255.0f + 0.5f);
+}
+
+static inline unsigned char EncodeSRGB(const LinearToSRGBTable& table, float value)
+{
+	value = Saturate(value);
+
+	uint32_t bucket = std::min(static_cast<uint32_t>(value * SRGB_ENCODE_BUCKETS), SRGB_ENCODE_BUCKETS - 1);
+	uint32_t srgb = table.BucketStart[bucket];
+	while (value >= table.Thresholds[srgb])
+		srgb++;
+
+	return static_cast<unsigned char>(srgb);
+}
+
+static void DecodeRGBA8Row(const unsigned char* pixels, uint32_t width, bool sRGB, float* output)
+{
+	const float* srgbToLinear = GetSRGBToLinearTable();
+
+	for (uint32_t x = 0; x < width * 4; x += 4)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+			output[x + c] = sRGB ? srgbToLinear[pixels[x + c]] : pixels[x + c] / 255.0f;
+
+		output[x + 3] = pixels[x + 3] / 255.0f;
+	}
+}
+
+uint32_t MipGenerator::GetNumMipLevels(uint32_t width, uint32_t height)
+{
+	uint32_t numMipLevels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		numMipLevels++;
+	}
+
+	return numMipLevels;
+}
+
+std::size_t MipGenerator::GetMipChainByteSize(uint32_t width, uint32_t height, uint32_t numMipLevels)
+{
+	std::size_t byteSize = 0;
+	for (uint32_t mip = 0; mip < numMipLevels; ++mip)
+	{
+		byteSize += static_cast<std::size_t>(width) * height * 4;
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+
+	return byteSize;
+}
+
+void MipGenerator::GenerateMipChain(const unsigned char* pixels, uint32_t width, uint32_t height, MipFilter filter, bool sRGB, unsigned char* output)
+{
+	uint32_t numMipLevels = GetNumMipLevels(width, height);
+
+	std::size_t mipByteSize = static_cast<std::size_t>(width) * height * 4;
+	memcpy(output, pixels, mipByteSize);
+
+	if (numMipLevels == 1)
+		return;
+
+	// Mip 1 is filtered straight from the 8-bit source, decoding one row at a time, so mip 0 is never held as floats
+	std::vector<float> decodedRow(width * 4);
+	auto getSourceRow = [&](uint32_t y) -> const float* {
+		DecodeRGBA8Row(pixels + static_cast<std::size_t>(y) * width * 4, width, sRGB, decodedRow.data());
+		return decodedRow.data();
+	};
+
+	MipImage current, next;
+	current.Width = std::max(1u, width / 2);
+	current.Height = std::max(1u, height / 2);
+	current.Pixels.resize(current.Width * current.Height * 4);
+
+	DownsampleRows<true>(getSourceRow, width, height, filter, current.Pixels.data());
+
+	output += mipByteSize;
+	EncodeRGBA8(current, sRGB, output);
+
+	for (uint32_t mip = 2; mip < numMipLevels; ++mip)
+	{
+		output += static_cast<std::size_t>(current.Width) * current.Height * 4;
+
+		Downsample(current, filter, next);
+		EncodeRGBA8(next, sRGB, output);
+		std::swap(current, next);
+	}
+}
+
+void MipGenerator::Downsample(const MipImage& source, MipFilter filter, MipImage& output)
+{
+	DownsampleImage<true>(source, filter, output);
+}
+
+void MipGenerator::DownsampleScalar(const MipImage& source, MipFilter filter, MipImage& output)
+{
+	DownsampleImage<false>(source, filter, output);
+}
+
+void MipGenerator::DecodeRGBA8(const unsigned char* pixels, uint32_t width, uint32_t height, bool sRGB, MipImage& output)
+{
+	output.Width = width;
+	output.Height = height;
+	output.Pixels.resize(static_cast<std::size_t>(width) * height * 4);
+
+	for (uint32_t y = 0; y < height; ++y)
+		DecodeRGBA8Row(pixels + static_cast<std::size_t>(y) * width * 4, width, sRGB, output.Pixels.data() + static_cast<std::size_t>(y) * width * 4);
+}
+
+void MipGenerator::EncodeRGBA8(const MipImage& image, bool sRGB, unsigned char* output)
+{
+	const LinearToSRGBTable& table = GetLinearToSRGBTable();
+	std::size_t numValues = image.Pixels.size();
+
+	for (std::size_t i = 0; i < numValues; i += 4)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+			output[i + c] = sRGB ? EncodeSRGB(table, image.Pixels[i + c]) : EncodeLinear(image.Pixels[i + c]);
+
+		output[i + 3] = EncodeLinear(image.Pixels[i + 3]);
+	}
+}
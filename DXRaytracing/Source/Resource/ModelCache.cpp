@@ -0,0 +1,468 @@
+#include "Pch.h"
+#include "Resource/ModelCache.h"
+#include "Util/Hash.h"
+#include "Util/MemoryMappedFile.h"
+
+#include <random>
+
+/*
+
+	Cooked model layout:
+	- CookedModelHeader
+	- CookedSection[NumSections]
+	- Section data, every section starts at a COOKED_SECTION_ALIGNMENT aligned offset
+
+	String sections are stored as a sequence of null terminated strings.
+
+	Cooked texture layout:
+	- CookedTextureHeader
+	- Mip chain data at a COOKED_SECTION_ALIGNMENT aligned offset
+
+*/
+
+static constexpr uint32_t COOKED_MODEL_MAGIC = 0x43525844; // "DXRC"
+static constexpr uint32_t COOKED_MODEL_VERSION = 8;
+static constexpr std::size_t COOKED_SECTION_ALIGNMENT = 16;
+
+static constexpr uint32_t COOKED_TEXTURE_MAGIC = 0x54525844; // "DXRT"
+static constexpr uint32_t COOKED_TEXTURE_VERSION = 1;
+
+enum class CookedSectionType : uint32_t
+{
+	VERTICES,
+	INDICES,
+	SUBMESHES,
+	MATERIALS,
+	IMAGE_URIS,
+	DEPENDENCIES,
+	MESHLETS,
+	MESHLET_VERTICES,
+	MESHLET_TRIANGLES,
+	LODS,
+	NUM_SECTION_TYPES
+};
+
+struct CookedModelHeader
+{
+	uint32_t Magic = COOKED_MODEL_MAGIC;
+	uint32_t Version = COOKED_MODEL_VERSION;
+	uint64_t SourceHash = 0;
+	uint32_t NumSections = 0;
+	CookFlags Flags = CookFlags::COOK_FLAGS_NONE;
+};
+
+struct CookedTextureHeader
+{
+	uint32_t Magic = COOKED_TEXTURE_MAGIC;
+	uint32_t Version = COOKED_TEXTURE_VERSION;
+	uint64_t SourceHash = 0;
+	BlockCompressionFormat Format = BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t NumMipLevels = 0;
+	uint64_t ByteSize = 0;
+};
+
+struct CookedSection
+{
+	CookedSectionType Type;
+	uint32_t ElementSize;
+	uint64_t Offset;
+	uint64_t NumElements;
+};
+
+struct SectionSource
+{
+	CookedSectionType Type;
+	uint32_t ElementSize;
+	const void* Data;
+	std::size_t NumElements;
+};
+
+/* Cooked files are written under a temporary name next to their final one and renamed over it when they are complete, so loads that
+   still map the previous file keep reading it instead of seeing it truncated. Writers of the same file each get their own name */
+static std::string GetTemporaryFilepath(const std::string& filepath)
+{
+	std::random_device random;
+	char suffix[32] = {};
+	snprintf(suffix, sizeof(suffix), ".%08x%08x.tmp", random(), random());
+
+	return filepath + suffix;
+}
+
+static bool ReplaceFile(const std::string& temporaryFilepath, const std::string& filepath)
+{
+#ifdef _WIN32
+	// Fails while another load maps the file, which keeps the previous file until a later load writes it again
+	bool result = MoveFileExA(temporaryFilepath.c_str(), filepath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool result = std::rename(temporaryFilepath.c_str(), filepath.c_str()) == 0;
+#endif
+
+	if (!result)
+		std::remove(temporaryFilepath.c_str());
+
+	return result;
+}
+
+static std::vector<char> PackStrings(const std::vector<std::string>& strings)
+{
+	std::vector<char> packed;
+	for (auto& string : strings)
+	{
+		packed.insert(packed.end(), string.begin(), string.end());
+		packed.push_back('\0');
+	}
+
+	return packed;
+}
+
+static std::vector<std::string> UnpackStrings(const char* packed, std::size_t byteSize)
+{
+	std::vector<std::string> strings;
+	std::size_t begin = 0;
+
+	for (std::size_t i = 0; i < byteSize; ++i)
+	{
+		if (packed[i] == '\0')
+		{
+			strings.emplace_back(packed + begin, i - begin);
+			begin = i + 1;
+		}
+	}
+
+	return strings;
+}
+
+std::string ModelCache::GetCookedFilepath(const std::string& sourceFilepath)
+{
+	std::size_t lastSeparator = sourceFilepath.find_last_of("/\\");
+	std::size_t extension = sourceFilepath.find_last_of('.');
+
+	if (extension == std::string::npos || (lastSeparator != std::string::npos && extension < lastSeparator))
+		return sourceFilepath + ".cooked";
+
+	return sourceFilepath.substr(0, extension) + ".cooked";
+}
+
+std::string ModelCache::GetDirectory(const std::string& filepath)
+{
+	std::size_t lastSeparator = filepath.find_last_of("/\\");
+	if (lastSeparator == std::string::npos)
+		return "";
+
+	return filepath.substr(0, lastSeparator + 1);
+}
+
+bool ModelCache::ComputeSourceHash(const std::string& directory, const std::vector<std::string>& dependencies, uint64_t& hash)
+{
+	hash = Hash::Hash64(&COOKED_MODEL_VERSION, sizeof(COOKED_MODEL_VERSION));
+
+	for (auto& dependency : dependencies)
+	{
+		uint64_t fileHash = 0;
+		if (!Hash::HashFile(directory + dependency, fileHash))
+			return false;
+
+		hash = Hash::Combine(hash, Hash::Hash64(dependency.data(), dependency.size()));
+		hash = Hash::Combine(hash, fileHash);
+	}
+
+	return true;
+}
+
+bool ModelCache::Write(const std::string& cookedFilepath, const CookedModelData& data)
+{
+	std::vector<char> imageURIs = PackStrings(data.ImageURIs);
+	std::vector<char> dependencies = PackStrings(data.Dependencies);
+
+	SectionSource sources[] = {
+		{ CookedSectionType::VERTICES, sizeof(Vertex), data.Vertices, data.NumVertices },
+		{ CookedSectionType::INDICES, data.IndexByteSize, data.Indices, data.NumIndices },
+		{ CookedSectionType::SUBMESHES, sizeof(Submesh), data.Submeshes.data(), data.Submeshes.size() },
+		{ CookedSectionType::MATERIALS, sizeof(CookedMaterial), data.Materials.data(), data.Materials.size() },
+		{ CookedSectionType::IMAGE_URIS, sizeof(char), imageURIs.data(), imageURIs.size() },
+		{ CookedSectionType::DEPENDENCIES, sizeof(char), dependencies.data(), dependencies.size() },
+		{ CookedSectionType::MESHLETS, sizeof(Meshlet), data.Meshlets.data(), data.Meshlets.size() },
+		{ CookedSectionType::MESHLET_VERTICES, sizeof(uint32_t), data.MeshletVertices.data(), data.MeshletVertices.size() },
+		{ CookedSectionType::MESHLET_TRIANGLES, sizeof(uint8_t), data.MeshletTriangles.data(), data.MeshletTriangles.size() },
+		{ CookedSectionType::LODS, sizeof(SubmeshLOD), data.LODs.data(), data.LODs.size() }
+	};
+	constexpr uint32_t numSections = sizeof(sources) / sizeof(sources[0]);
+
+	CookedModelHeader header = {};
+	header.SourceHash = data.SourceHash;
+	header.NumSections = numSections;
+	header.Flags = data.Flags;
+
+	CookedSection sections[numSections] = {};
+	std::size_t currentOffset = MathHelper::AlignUp(sizeof(CookedModelHeader) + sizeof(sections), COOKED_SECTION_ALIGNMENT);
+
+	for (uint32_t i = 0; i < numSections; ++i)
+	{
+		sections[i].Type = sources[i].Type;
+		sections[i].ElementSize = sources[i].ElementSize;
+		sections[i].Offset = currentOffset;
+		sections[i].NumElements = sources[i].NumElements;
+
+		currentOffset = MathHelper::AlignUp(currentOffset + sources[i].ElementSize * sources[i].NumElements, COOKED_SECTION_ALIGNMENT);
+	}
+
+	std::string temporaryFilepath = GetTemporaryFilepath(cookedFilepath);
+	std::ofstream file(temporaryFilepath, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(sections), sizeof(sections));
+
+	const char padding[COOKED_SECTION_ALIGNMENT] = {};
+	std::size_t writtenBytes = sizeof(header) + sizeof(sections);
+
+	for (uint32_t i = 0; i < numSections; ++i)
+	{
+		file.write(padding, sections[i].Offset - writtenBytes);
+		writtenBytes = sections[i].Offset;
+
+		std::size_t sectionByteSize = sources[i].ElementSize * sources[i].NumElements;
+		if (sectionByteSize > 0)
+			file.write(static_cast<const char*>(sources[i].Data), sectionByteSize);
+		writtenBytes += sectionByteSize;
+	}
+
+	file.close();
+	if (!file)
+	{
+		std::remove(temporaryFilepath.c_str());
+		return false;
+	}
+
+	return ReplaceFile(temporaryFilepath, cookedFilepath);
+}
+
+bool ModelCache::Read(const std::string& cookedFilepath, CookedModelData& data)
+{
+	auto file = std::make_shared<MemoryMappedFile>();
+	if (!file->Open(cookedFilepath))
+		return false;
+
+	const unsigned char* fileData = file->GetData();
+	std::size_t fileSize = file->GetSize();
+
+	if (fileSize < sizeof(CookedModelHeader))
+		return false;
+
+	const CookedModelHeader* header = reinterpret_cast<const CookedModelHeader*>(fileData);
+	if (header->Magic != COOKED_MODEL_MAGIC || header->Version != COOKED_MODEL_VERSION)
+	{
+		LOG_INFO("[ModelCache] Cooked model has a different version and will be rebuilt: " + cookedFilepath);
+		return false;
+	}
+
+	if (sizeof(CookedModelHeader) + header->NumSections * sizeof(CookedSection) > fileSize)
+		return false;
+
+	const CookedSection* sections = reinterpret_cast<const CookedSection*>(fileData + sizeof(CookedModelHeader));
+	const CookedSection* sectionsByType[static_cast<uint32_t>(CookedSectionType::NUM_SECTION_TYPES)] = {};
+
+	for (uint32_t i = 0; i < header->NumSections; ++i)
+	{
+		const CookedSection& section = sections[i];
+		if (section.Type >= CookedSectionType::NUM_SECTION_TYPES || section.ElementSize == 0 ||
+			section.Offset > fileSize || section.NumElements > (fileSize - section.Offset) / section.ElementSize)
+		{
+			LOG_WARN("[ModelCache] Cooked model is malformed: " + cookedFilepath);
+			return false;
+		}
+
+		sectionsByType[static_cast<uint32_t>(section.Type)] = &section;
+	}
+
+	// Indices are either 16 or 32-bit, the element size of the index section is checked separately
+	const uint32_t expectedElementSizes[] = { sizeof(Vertex), 0, sizeof(Submesh), sizeof(CookedMaterial), sizeof(char), sizeof(char),
+		sizeof(Meshlet), sizeof(uint32_t), sizeof(uint8_t), sizeof(SubmeshLOD) };
+	for (uint32_t i = 0; i < static_cast<uint32_t>(CookedSectionType::NUM_SECTION_TYPES); ++i)
+	{
+		bool validElementSize = sectionsByType[i] && (expectedElementSizes[i] == 0 || sectionsByType[i]->ElementSize == expectedElementSizes[i]);
+		if (!validElementSize)
+		{
+			LOG_WARN("[ModelCache] Cooked model is missing sections: " + cookedFilepath);
+			return false;
+		}
+	}
+
+	auto getSection = [&](CookedSectionType type) -> const CookedSection& {
+		return *sectionsByType[static_cast<uint32_t>(type)];
+	};
+
+	const CookedSection& dependencies = getSection(CookedSectionType::DEPENDENCIES);
+	data.Dependencies = UnpackStrings(reinterpret_cast<const char*>(fileData + dependencies.Offset), dependencies.NumElements);
+
+	uint64_t sourceHash = 0;
+	if (!ComputeSourceHash(GetDirectory(cookedFilepath), data.Dependencies, sourceHash) || sourceHash != header->SourceHash)
+	{
+		LOG_INFO("[ModelCache] Cooked model is out of date and will be rebuilt: " + cookedFilepath);
+		return false;
+	}
+
+	const CookedSection& vertices = getSection(CookedSectionType::VERTICES);
+	data.Vertices = reinterpret_cast<const Vertex*>(fileData + vertices.Offset);
+	data.NumVertices = vertices.NumElements;
+
+	const CookedSection& indices = getSection(CookedSectionType::INDICES);
+	if (indices.ElementSize != sizeof(uint16_t) && indices.ElementSize != sizeof(uint32_t))
+	{
+		LOG_WARN("[ModelCache] Cooked model has an invalid index size: " + cookedFilepath);
+		return false;
+	}
+
+	data.Indices = fileData + indices.Offset;
+	data.NumIndices = indices.NumElements;
+	data.IndexByteSize = indices.ElementSize;
+
+	const CookedSection& materials = getSection(CookedSectionType::MATERIALS);
+	const CookedMaterial* materialData = reinterpret_cast<const CookedMaterial*>(fileData + materials.Offset);
+	data.Materials.assign(materialData, materialData + materials.NumElements);
+
+	const CookedSection& submeshes = getSection(CookedSectionType::SUBMESHES);
+	const Submesh* submeshData = reinterpret_cast<const Submesh*>(fileData + submeshes.Offset);
+	data.Submeshes.assign(submeshData, submeshData + submeshes.NumElements);
+
+	const CookedSection& meshlets = getSection(CookedSectionType::MESHLETS);
+	const Meshlet* meshletData = reinterpret_cast<const Meshlet*>(fileData + meshlets.Offset);
+	data.Meshlets.assign(meshletData, meshletData + meshlets.NumElements);
+
+	const CookedSection& meshletVertices = getSection(CookedSectionType::MESHLET_VERTICES);
+	const uint32_t* meshletVertexData = reinterpret_cast<const uint32_t*>(fileData + meshletVertices.Offset);
+	data.MeshletVertices.assign(meshletVertexData, meshletVertexData + meshletVertices.NumElements);
+
+	const CookedSection& meshletTriangles = getSection(CookedSectionType::MESHLET_TRIANGLES);
+	const uint8_t* meshletTriangleData = reinterpret_cast<const uint8_t*>(fileData + meshletTriangles.Offset);
+	data.MeshletTriangles.assign(meshletTriangleData, meshletTriangleData + meshletTriangles.NumElements);
+
+	const CookedSection& lods = getSection(CookedSectionType::LODS);
+	const SubmeshLOD* lodData = reinterpret_cast<const SubmeshLOD*>(fileData + lods.Offset);
+	data.LODs.assign(lodData, lodData + lods.NumElements);
+
+	for (auto& submesh : data.Submeshes)
+	{
+		bool isValid = static_cast<uint64_t>(submesh.IndexOffset) + submesh.NumIndices <= data.NumIndices &&
+			static_cast<uint64_t>(submesh.VertexOffset) + submesh.NumVertices <= data.NumVertices && submesh.MaterialIndex < data.Materials.size() &&
+			static_cast<uint64_t>(submesh.MeshletOffset) + submesh.NumMeshlets <= data.Meshlets.size() &&
+			static_cast<uint64_t>(submesh.LODOffset) + submesh.NumLODs <= data.LODs.size();
+
+		for (uint32_t i = 0; isValid && i < submesh.NumLODs; ++i)
+			isValid = static_cast<uint64_t>(data.LODs[submesh.LODOffset + i].IndexOffset) + data.LODs[submesh.LODOffset + i].NumIndices <= data.NumIndices;
+
+		if (!isValid)
+		{
+			LOG_WARN("[ModelCache] Cooked model has an invalid submesh: " + cookedFilepath);
+			return false;
+		}
+	}
+
+	for (auto& meshlet : data.Meshlets)
+	{
+		bool isValid = meshlet.NumVertices <= 256 && static_cast<uint64_t>(meshlet.VertexOffset) + meshlet.NumVertices <= data.MeshletVertices.size() &&
+			static_cast<uint64_t>(meshlet.TriangleOffset) + meshlet.NumTriangles * 3ull <= data.MeshletTriangles.size() &&
+			static_cast<uint64_t>(meshlet.IndexOffset) + meshlet.NumTriangles * 3ull <= data.NumIndices;
+
+		for (uint32_t i = 0; isValid && i < meshlet.NumVertices; ++i)
+			isValid = data.MeshletVertices[meshlet.VertexOffset + i] < data.NumVertices;
+
+		for (uint32_t i = 0; isValid && i < meshlet.NumTriangles * 3; ++i)
+			isValid = data.MeshletTriangles[meshlet.TriangleOffset + i] < meshlet.NumVertices;
+
+		if (!isValid)
+		{
+			LOG_WARN("[ModelCache] Cooked model has an invalid meshlet: " + cookedFilepath);
+			return false;
+		}
+	}
+
+	const CookedSection& imageURIs = getSection(CookedSectionType::IMAGE_URIS);
+	data.ImageURIs = UnpackStrings(reinterpret_cast<const char*>(fileData + imageURIs.Offset), imageURIs.NumElements);
+
+	data.SourceHash = header->SourceHash;
+	data.Flags = header->Flags;
+	data.MappedFile = file;
+
+	return true;
+}
+
+std::string ModelCache::GetCookedTextureFilepath(const std::string& directory, uint64_t sourceHash)
+{
+	char name[17] = {};
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(sourceHash));
+
+	return directory + name + ".cookedtex";
+}
+
+bool ModelCache::WriteTexture(const std::string& cookedFilepath, uint64_t sourceHash, const CookedTextureData& data)
+{
+	CookedTextureHeader header = {};
+	header.SourceHash = sourceHash;
+	header.Format = data.Format;
+	header.Width = data.Width;
+	header.Height = data.Height;
+	header.NumMipLevels = data.NumMipLevels;
+	header.ByteSize = data.ByteSize;
+
+	std::string temporaryFilepath = GetTemporaryFilepath(cookedFilepath);
+	std::ofstream file(temporaryFilepath, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	const char padding[COOKED_SECTION_ALIGNMENT] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(padding, MathHelper::AlignUp(sizeof(header), COOKED_SECTION_ALIGNMENT) - sizeof(header));
+	file.write(reinterpret_cast<const char*>(data.Data), data.ByteSize);
+
+	file.close();
+	if (!file)
+	{
+		std::remove(temporaryFilepath.c_str());
+		return false;
+	}
+
+	return ReplaceFile(temporaryFilepath, cookedFilepath);
+}
+
+bool ModelCache::ReadTexture(const std::string& cookedFilepath, uint64_t sourceHash, CookedTextureData& data)
+{
+	auto file = std::make_shared<MemoryMappedFile>();
+	if (!file->Open(cookedFilepath))
+		return false;
+
+	const unsigned char* fileData = file->GetData();
+	std::size_t fileSize = file->GetSize();
+	std::size_t dataOffset = MathHelper::AlignUp(sizeof(CookedTextureHeader), COOKED_SECTION_ALIGNMENT);
+
+	if (fileSize < dataOffset)
+		return false;
+
+	const CookedTextureHeader* header = reinterpret_cast<const CookedTextureHeader*>(fileData);
+	if (header->Magic != COOKED_TEXTURE_MAGIC || header->Version != COOKED_TEXTURE_VERSION || header->SourceHash != sourceHash)
+	{
+		LOG_INFO("[ModelCache] Cooked texture has a different version or source and will be rebuilt: " + cookedFilepath);
+		return false;
+	}
+
+	if (header->Format > BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7 || header->Width == 0 || header->Height == 0 ||
+		header->NumMipLevels == 0 || header->NumMipLevels > 32 || header->ByteSize > fileSize - dataOffset ||
+		header->ByteSize != BlockCompression::GetMipChainByteSize(header->Format, header->Width, header->Height, header->NumMipLevels))
+	{
+		LOG_WARN("[ModelCache] Cooked texture is malformed: " + cookedFilepath);
+		return false;
+	}
+
+	data.Format = header->Format;
+	data.Width = header->Width;
+	data.Height = header->Height;
+	data.NumMipLevels = header->NumMipLevels;
+	data.Data = fileData + dataOffset;
+	data.ByteSize = header->ByteSize;
+	data.MappedFile = file;
+
+	return true;
+}
@@ -0,0 +1,1407 @@
+#include "Pch.h"
+#include "Resource/ModelCooker.h"
+#include "Resource/BlockCompression.h"
+#include "Resource/GLBContainer.h"
+#include "Resource/MeshOptimizer.h"
+#include "Resource/MeshletBuilder.h"
+#include "Resource/MeshSimplifier.h"
+#include "Resource/MipGenerator.h"
+#include "Resource/VertexAssembly.h"
+#include "Resource/VertexCompression.h"
+#include "Util/Hash.h"
+#include "Util/MemoryMappedFile.h"
+#include "Util/ThreadPool.h"
+#include "Util/ThreadSafeQueue.h"
+
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_USE_CPP14
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#ifdef _MSC_VER
+#define STBI_MSC_SECURE_CRT
+#endif
+#include "tinygltf/tiny_gltf.h"
+
+static ImageData DecodeImage(const std::string& name, const std::function<stbi_uc*(int*, int*)>& decode)
+{
+	Timer timer("ResourceLoader::DecodeImage " + name);
+	ImageData image;
+
+	int width = 0, height = 0;
+	stbi_uc* pixels = decode(&width, &height);
+	if (!pixels)
+	{
+		LOG_WARN("[ResourceManager] Failed to decode image: " + name);
+		return image;
+	}
+
+	image.Storage = std::shared_ptr<unsigned char>(pixels, stbi_image_free);
+	image.Pixels = pixels;
+	image.Width = static_cast<uint32_t>(width);
+	image.Height = static_cast<uint32_t>(height);
+	return image;
+}
+
+/* Replace the pixels of a decoded image with its full mip chain, base color images are always sRGB */
+static void GenerateMips(ImageData& image, MipFilter filter)
+{
+	if (!image.Pixels)
+		return;
+
+	Timer timer("ResourceLoader::GenerateMips");
+
+	uint32_t numMipLevels = MipGenerator::GetNumMipLevels(image.Width, image.Height);
+	std::shared_ptr<unsigned char> mipChain(new unsigned char[MipGenerator::GetMipChainByteSize(image.Width, image.Height, numMipLevels)],
+		std::default_delete<unsigned char[]>());
+
+	MipGenerator::GenerateMipChain(image.Pixels, image.Width, image.Height, filter, true, mipChain.get());
+
+	image.Storage = mipChain;
+	image.Pixels = mipChain.get();
+	image.NumMipLevels = numMipLevels;
+}
+
+static constexpr uint32_t BLOCK_ROWS_PER_COMPRESSION_JOB = 16;
+// 1 MB of cooked vertices, read at a time for the bounds the positions are quantized to
+static constexpr std::size_t VERTICES_PER_QUANTIZATION_CHUNK = 32 * 1024;
+
+static TextureFormat BlockCompressionFormatToTextureFormat(BlockCompressionFormat format)
+{
+	switch (format)
+	{
+	case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1:
+		return TextureFormat::TEXTURE_FORMAT_BC1_UNORM;
+	case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC3:
+		return TextureFormat::TEXTURE_FORMAT_BC3_UNORM;
+	case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC5:
+		return TextureFormat::TEXTURE_FORMAT_BC5_UNORM;
+	case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7:
+		return TextureFormat::TEXTURE_FORMAT_BC7_UNORM;
+	}
+
+	return TextureFormat::TEXTURE_FORMAT_UNSPECIFIED;
+}
+
+static BlockCompressionFormat SelectBlockCompressionFormat(const ImageData& image, TextureCompression compression)
+{
+	if (compression == TextureCompression::TEXTURE_COMPRESSION_BC7)
+		return BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7;
+
+	// BC1 is encoded without alpha, so any texel that is not fully opaque needs BC3
+	std::size_t numTexels = static_cast<std::size_t>(image.Width) * image.Height;
+	for (std::size_t i = 0; i < numTexels; ++i)
+	{
+		if (image.Pixels[i * 4 + 3] != 255)
+			return BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC3;
+	}
+
+	return BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1;
+}
+
+static ImageData CreateImageFromCookedTexture(const CookedTextureData& cooked)
+{
+	ImageData image;
+	image.Storage = std::shared_ptr<const void>(cooked.MappedFile, cooked.Data);
+	image.Pixels = cooked.Data;
+	image.Width = cooked.Width;
+	image.Height = cooked.Height;
+	image.NumMipLevels = cooked.NumMipLevels;
+	image.Format = BlockCompressionFormatToTextureFormat(cooked.Format);
+	return image;
+}
+
+/* Block compress every mip level of an RGBA8 image. The levels are split into jobs of a few block rows, so a single large
+   image still spreads over the whole pool, and onCompressed is called by whichever job finishes last */
+static void CompressImage(const ImageData& image, BlockCompressionFormat format, ThreadPool* threadPool, const std::function<void(const ImageData&)>& onCompressed)
+{
+	struct CompressionJob
+	{
+		const unsigned char* Pixels = nullptr;
+		unsigned char* Output = nullptr;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t FirstBlockRow = 0;
+	};
+
+	std::shared_ptr<unsigned char> blocks(new unsigned char[BlockCompression::GetMipChainByteSize(format, image.Width, image.Height, image.NumMipLevels)],
+		std::default_delete<unsigned char[]>());
+
+	auto compressed = std::make_shared<ImageData>();
+	compressed->Storage = blocks;
+	compressed->Pixels = blocks.get();
+	compressed->Width = image.Width;
+	compressed->Height = image.Height;
+	compressed->NumMipLevels = image.NumMipLevels;
+	compressed->Format = BlockCompressionFormatToTextureFormat(format);
+
+	std::vector<CompressionJob> jobs;
+	const unsigned char* mipPixels = image.Pixels;
+	unsigned char* mipBlocks = blocks.get();
+	uint32_t mipWidth = image.Width, mipHeight = image.Height;
+
+	for (uint32_t mip = 0; mip < image.NumMipLevels; ++mip)
+	{
+		uint32_t numBlockRows = (mipHeight + 3) / 4;
+		for (uint32_t blockRow = 0; blockRow < numBlockRows; blockRow += BLOCK_ROWS_PER_COMPRESSION_JOB)
+			jobs.push_back({ mipPixels, mipBlocks, mipWidth, mipHeight, blockRow });
+
+		mipPixels += static_cast<std::size_t>(mipWidth) * mipHeight * 4;
+		mipBlocks += BlockCompression::GetCompressedByteSize(format, mipWidth, mipHeight);
+		mipWidth = std::max(1u, mipWidth / 2);
+		mipHeight = std::max(1u, mipHeight / 2);
+	}
+
+	auto runJob = [format](const CompressionJob& job) {
+		BlockCompression::CompressBlockRows(format, job.Pixels, job.Width, job.Height, job.FirstBlockRow, BLOCK_ROWS_PER_COMPRESSION_JOB, job.Output);
+	};
+
+	if (!threadPool)
+	{
+		for (auto& job : jobs)
+			runJob(job);
+
+		onCompressed(*compressed);
+		return;
+	}
+
+	auto numPendingJobs = std::make_shared<std::atomic<std::size_t>>(jobs.size());
+	for (auto& job : jobs)
+	{
+		// Every job holds on to the source image, so its pixels stay alive until the last job is done
+		threadPool->Submit([image, compressed, job, runJob, numPendingJobs, onCompressed]() {
+			runJob(job);
+			if (numPendingJobs->fetch_sub(1) == 1)
+				onCompressed(*compressed);
+		});
+	}
+}
+
+struct EncodedImage
+{
+	const unsigned char* Data = nullptr;
+	std::size_t ByteSize = 0;
+
+	// Owns the bytes unless they are viewed in place, like images in a mapped GLB binary chunk
+	std::vector<unsigned char> Storage;
+};
+
+static ImageData DecodeImageFromMemory(const std::string& name, const EncodedImage& encoded)
+{
+	return DecodeImage(name, [&encoded](int* width, int* height) {
+		int components = 0;
+		return stbi_load_from_memory(encoded.Data, static_cast<int>(encoded.ByteSize), width, height, &components, 4);
+	});
+}
+
+static ImageData DecodeImageFromFile(const std::string& name, const std::string& filepath)
+{
+	return DecodeImage(name, [&filepath](int* width, int* height) {
+		int components = 0;
+		return stbi_load(filepath.c_str(), width, height, &components, 4);
+	});
+}
+
+/* Image loader callback for tinygltf that only keeps the encoded bytes, so images can be deduplicated and decoded later */
+static bool DeferImageDecode(tinygltf::Image* /*image*/, const int imageIndex, std::string* /*err*/, std::string* /*warn*/,
+	int /*reqWidth*/, int /*reqHeight*/, const unsigned char* bytes, int size, void* userData)
+{
+	auto& encodedImages = *static_cast<std::vector<EncodedImage>*>(userData);
+	if (static_cast<std::size_t>(imageIndex) >= encodedImages.size())
+		encodedImages.resize(imageIndex + 1);
+
+	// Already viewed in place, tinygltf only received a placeholder
+	EncodedImage& encodedImage = encodedImages[imageIndex];
+	if (encodedImage.Data)
+		return true;
+
+	encodedImage.Storage.assign(bytes, bytes + size);
+	encodedImage.Data = encodedImage.Storage.data();
+	encodedImage.ByteSize = encodedImage.Storage.size();
+	return true;
+}
+
+struct ImageSource
+{
+	// Hash of the encoded image, identical hashes share a single texture
+	std::function<bool(uint32_t, uint64_t&)> GetContentHash;
+	std::function<ImageData(uint32_t)> Decode;
+	// Block compressed textures are cooked into this directory, keyed by their content hash
+	std::string CookedTextureDirectory;
+};
+
+/* Find shared textures through the callbacks and build the images of all others on the decode pool. OnTextureBuilt is called on the
+   calling thread for every texture whose image is ready, duplicates right after the texture they share */
+static void BuildTextures(std::vector<ModelTextureData>& textures, const std::vector<int32_t>& textureImages, const ImageSource& imageSource,
+	const ModelLoadDesc& loadDesc, ThreadPool* decodeThreadPool, const std::atomic_bool* isCancelled, const ModelCookCallbacks& callbacks)
+{
+	auto startTime = std::chrono::steady_clock::now();
+	textures.resize(textureImages.size());
+
+	struct PendingDecode
+	{
+		uint32_t TextureIndex = 0;
+		uint32_t ImageIndex = 0;
+		// Other texture slots with the same content, they share the texture once it is created
+		std::vector<uint32_t> DuplicateTextureIndices;
+	};
+
+	std::vector<PendingDecode> pendingDecodes;
+	std::unordered_map<uint64_t, std::size_t> pendingDecodesByHash;
+
+	for (uint32_t i = 0; i < textureImages.size(); ++i)
+	{
+		// Textures without an image stay white
+		if (textureImages[i] < 0)
+			continue;
+
+		ModelTextureData& texture = textures[i];
+
+		PendingDecode decode;
+		decode.TextureIndex = i;
+		decode.ImageIndex = static_cast<uint32_t>(textureImages[i]);
+		texture.IsCacheable = imageSource.GetContentHash(decode.ImageIndex, texture.ContentHash);
+
+		// Textures built with different mip or compression options are not interchangeable
+		if (loadDesc.GenerateMips)
+			texture.ContentHash = Hash::Combine(texture.ContentHash, static_cast<uint64_t>(loadDesc.MipGenerationFilter) + 1);
+		if (loadDesc.TextureCompressionMode != TextureCompression::TEXTURE_COMPRESSION_NONE)
+			texture.ContentHash = Hash::Combine(texture.ContentHash, static_cast<uint64_t>(loadDesc.TextureCompressionMode) << 8);
+
+		if (texture.IsCacheable)
+		{
+			auto pending = pendingDecodesByHash.find(texture.ContentHash);
+			if (pending != pendingDecodesByHash.end())
+			{
+				pendingDecodes[pending->second].DuplicateTextureIndices.push_back(i);
+				continue;
+			}
+
+			if (callbacks.FindTexture)
+				texture.Resource = callbacks.FindTexture(texture.ContentHash);
+			if (texture.Resource)
+				continue;
+
+			pendingDecodesByHash.emplace(texture.ContentHash, pendingDecodes.size());
+		}
+
+		pendingDecodes.push_back(decode);
+	}
+
+	auto onTextureBuilt = [&callbacks](uint32_t textureIndex) {
+		if (callbacks.OnTextureBuilt)
+			callbacks.OnTextureBuilt(textureIndex);
+	};
+
+	auto onImageBuilt = [&textures, &onTextureBuilt](const PendingDecode& decode, const ImageData& image) {
+		textures[decode.TextureIndex].Image = image;
+		onTextureBuilt(decode.TextureIndex);
+
+		for (uint32_t duplicateIndex : decode.DuplicateTextureIndices)
+		{
+			textures[duplicateIndex].Image = image;
+			textures[duplicateIndex].DuplicateOf = static_cast<int32_t>(decode.TextureIndex);
+			onTextureBuilt(duplicateIndex);
+		}
+	};
+
+	// Decode an image, generate its mips and block compress it, or read it back from its cooked texture. Mips are generated
+	// on the decode worker and compression is split over the pool, onBuilt is called from the thread that finishes last
+	auto buildTexture = [&imageSource, &loadDesc, &textures, isCancelled](const PendingDecode& decode, ThreadPool* threadPool, const std::function<void(const ImageData&)>& onBuilt) {
+		// A cancelled load is thrown away, so the remaining images are not built at all
+		if (isCancelled && *isCancelled)
+		{
+			onBuilt(ImageData());
+			return;
+		}
+
+		const ModelTextureData& texture = textures[decode.TextureIndex];
+		bool compress = loadDesc.TextureCompressionMode != TextureCompression::TEXTURE_COMPRESSION_NONE;
+		std::string cookedFilepath = compress && texture.IsCacheable ?
+			ModelCache::GetCookedTextureFilepath(imageSource.CookedTextureDirectory, texture.ContentHash) : "";
+
+		CookedTextureData cooked;
+		if (!cookedFilepath.empty() && ModelCache::ReadTexture(cookedFilepath, texture.ContentHash, cooked))
+		{
+			onBuilt(CreateImageFromCookedTexture(cooked));
+			return;
+		}
+
+		ImageData image = imageSource.Decode(decode.ImageIndex);
+		if (loadDesc.GenerateMips)
+			GenerateMips(image, loadDesc.MipGenerationFilter);
+
+		if (!compress || !image.Pixels)
+		{
+			onBuilt(image);
+			return;
+		}
+
+		// Block compressed textures need the largest mip to be made of whole blocks
+		if (image.Width % 4 != 0 || image.Height % 4 != 0)
+		{
+			LOG_WARN("[ResourceManager] Image size is not a multiple of 4 and is uploaded uncompressed: " + std::to_string(image.Width) + "x" + std::to_string(image.Height));
+			onBuilt(image);
+			return;
+		}
+
+		BlockCompressionFormat format = SelectBlockCompressionFormat(image, loadDesc.TextureCompressionMode);
+		uint64_t contentHash = texture.ContentHash;
+
+		CompressImage(image, format, threadPool, [onBuilt, cookedFilepath, contentHash, format](const ImageData& compressed) {
+			if (!cookedFilepath.empty())
+			{
+				CookedTextureData cookedTexture;
+				cookedTexture.Format = format;
+				cookedTexture.Width = compressed.Width;
+				cookedTexture.Height = compressed.Height;
+				cookedTexture.NumMipLevels = compressed.NumMipLevels;
+				cookedTexture.Data = compressed.Pixels;
+				cookedTexture.ByteSize = BlockCompression::GetMipChainByteSize(format, compressed.Width, compressed.Height, compressed.NumMipLevels);
+
+				if (!ModelCache::WriteTexture(cookedFilepath, contentHash, cookedTexture))
+					LOG_WARN("[ResourceManager] Failed to write cooked texture: " + cookedFilepath);
+			}
+
+			onBuilt(compressed);
+		});
+	};
+
+	if (!decodeThreadPool)
+	{
+		for (auto& decode : pendingDecodes)
+			buildTexture(decode, nullptr, [&onImageBuilt, &decode](const ImageData& image) { onImageBuilt(decode, image); });
+
+		return;
+	}
+
+	struct DecodeResult
+	{
+		std::size_t DecodeIndex = 0;
+		ImageData Image;
+	};
+
+	ThreadSafeQueue<DecodeResult> decodeResults;
+
+	for (std::size_t i = 0; i < pendingDecodes.size(); ++i)
+	{
+		decodeThreadPool->Submit([&decodeResults, &buildTexture, &pendingDecodes, decodeThreadPool, i]() {
+			buildTexture(pendingDecodes[i], decodeThreadPool, [&decodeResults, i](const ImageData& image) { decodeResults.Push({ i, image }); });
+		});
+	}
+
+	// Hand out each image as soon as it is built, while the pool keeps decoding the others. The thread sleeps until the next one is done
+	for (std::size_t i = 0; i < pendingDecodes.size(); ++i)
+	{
+		DecodeResult result = decodeResults.Pop();
+		onImageBuilt(pendingDecodes[result.DecodeIndex], result.Image);
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+	LOG_INFO("[ResourceManager] Built " + std::to_string(pendingDecodes.size()) + " textures on " +
+		std::to_string(decodeThreadPool->GetNumThreads()) + " threads in " + std::to_string(elapsed.count()) + " ms");
+}
+
+/* The vertices themselves are encoded chunk by chunk as they are uploaded, only the quantization needs all of them up front. Mapped
+   vertices are read in chunks whose pages are released right away, like the upload reads them again later */
+static void ComputeVertexQuantization(ModelData& data, VertexFormat vertexFormat)
+{
+	const CookedModelData& cooked = data.Cooked;
+	if (vertexFormat != VertexFormat::VERTEX_FORMAT_QUANTIZED || cooked.NumVertices == 0)
+		return;
+
+	glm::vec3 boundsMin = cooked.Vertices[0].Position;
+	glm::vec3 boundsMax = cooked.Vertices[0].Position;
+
+	for (std::size_t firstVertex = 0; firstVertex < cooked.NumVertices; firstVertex += VERTICES_PER_QUANTIZATION_CHUNK)
+	{
+		std::size_t numVertices = std::min(cooked.NumVertices - firstVertex, VERTICES_PER_QUANTIZATION_CHUNK);
+		for (std::size_t i = firstVertex; i < firstVertex + numVertices; ++i)
+		{
+			boundsMin = glm::min(boundsMin, cooked.Vertices[i].Position);
+			boundsMax = glm::max(boundsMax, cooked.Vertices[i].Position);
+		}
+
+		if (cooked.MappedFile)
+			cooked.MappedFile->ReleasePages(reinterpret_cast<const unsigned char*>(cooked.Vertices + firstVertex) - cooked.MappedFile->GetData(),
+				numVertices * sizeof(Vertex));
+	}
+
+	data.VertexQuantization = VertexCompression::ComputePositionQuantization(boundsMin, boundsMax);
+}
+
+/* Resolve the materials to textures, build the texture images and quantize the vertex buffer, everything CreateModel needs */
+static void BuildModelData(ModelData& data, const ModelLoadDesc& loadDesc, const ImageSource& imageSource, ThreadPool* decodeThreadPool,
+	const std::atomic_bool* isCancelled, const ModelCookCallbacks& callbacks)
+{
+	// Base color image for each texture of the model, -1 for a white texture, materials sharing an image share the texture
+	std::vector<int32_t> textureImages;
+	std::unordered_map<int32_t, uint32_t> imageTextures;
+
+	for (auto& cookedMaterial : data.Cooked.Materials)
+	{
+		auto iter = imageTextures.find(cookedMaterial.BaseColorImage);
+		if (iter == imageTextures.end())
+		{
+			iter = imageTextures.emplace(cookedMaterial.BaseColorImage, static_cast<uint32_t>(textureImages.size())).first;
+			textureImages.push_back(cookedMaterial.BaseColorImage);
+		}
+
+		Material material;
+		material.BaseColorTexture = iter->second;
+		data.Materials.push_back(material);
+	}
+
+	BuildTextures(data.Textures, textureImages, imageSource, loadDesc, decodeThreadPool, isCancelled, callbacks);
+	ComputeVertexQuantization(data, loadDesc.VertexBufferFormat);
+}
+
+static bool IsDataURI(const std::string& uri)
+{
+	return uri.compare(0, 5, "data:") == 0;
+}
+
+/* Meshlets and levels of detail only add data to the cooked model, so a model cooked with them also serves loads that do not ask for
+   them. Optimized meshes change the vertices themselves and have to match */
+static bool IsCookedModelUsable(CookFlags cookedFlags, CookFlags cookFlags)
+{
+	for (CookFlags flag : { CookFlags::COOK_FLAGS_MESHLETS, CookFlags::COOK_FLAGS_LODS })
+	{
+		if ((cookFlags & flag) && !(cookedFlags & flag))
+			return false;
+	}
+
+	return (cookedFlags & CookFlags::COOK_FLAGS_OPTIMIZED_MESHES) == (cookFlags & CookFlags::COOK_FLAGS_OPTIMIZED_MESHES);
+}
+
+static bool LoadCookedGLTF(const std::string& filepath, CookFlags cookFlags, const ModelLoadDesc& loadDesc, ThreadPool* decodeThreadPool,
+	const std::atomic_bool* isCancelled, const ModelCookCallbacks& callbacks, ModelData& data)
+{
+	std::string cookedFilepath = ModelCache::GetCookedFilepath(filepath);
+
+	CookedModelData& cooked = data.Cooked;
+	if (!ModelCache::Read(cookedFilepath, cooked))
+		return false;
+
+	if (!IsCookedModelUsable(cooked.Flags, cookFlags))
+	{
+		LOG_INFO("[ResourceManager] Cooked model was built with different load options and will be rebuilt: " + cookedFilepath);
+		cooked = CookedModelData();
+		return false;
+	}
+
+	// Images are not part of the cooked data, so the referenced ones are decoded straight from their source files
+	std::string directory = ModelCache::GetDirectory(filepath);
+
+	ImageSource imageSource;
+	imageSource.GetContentHash = [&](uint32_t imageIndex, uint64_t& hash) {
+		return imageIndex < cooked.ImageURIs.size() && Hash::HashFile(directory + cooked.ImageURIs[imageIndex], hash);
+	};
+	imageSource.Decode = [&](uint32_t imageIndex) {
+		if (imageIndex >= cooked.ImageURIs.size())
+			return ImageData();
+
+		return DecodeImageFromFile(cooked.ImageURIs[imageIndex], directory + cooked.ImageURIs[imageIndex]);
+	};
+	imageSource.CookedTextureDirectory = directory;
+
+	BuildModelData(data, loadDesc, imageSource, decodeThreadPool, isCancelled, callbacks);
+
+	LOG_INFO("[ResourceManager] Loaded cooked model: " + cookedFilepath);
+	return true;
+}
+
+static void WriteCookedGLTF(const std::string& filepath, const tinygltf::Model& tinygltf, CookedModelData& cooked)
+{
+	std::string directory = ModelCache::GetDirectory(filepath);
+	cooked.Dependencies.push_back(filepath.substr(directory.size()));
+
+	for (auto& buffer : tinygltf.buffers)
+	{
+		if (!buffer.uri.empty() && !IsDataURI(buffer.uri))
+			cooked.Dependencies.push_back(buffer.uri);
+	}
+
+	// Cooked models reference images by file, embedded images would have to be stored in the cooked data itself
+	for (auto& image : tinygltf.images)
+	{
+		if (image.uri.empty() || IsDataURI(image.uri))
+		{
+			LOG_INFO("[ResourceManager] Model contains embedded images and will not be cooked: " + filepath);
+			return;
+		}
+
+		cooked.ImageURIs.push_back(image.uri);
+	}
+
+	std::string cookedFilepath = ModelCache::GetCookedFilepath(filepath);
+	if (!ModelCache::ComputeSourceHash(directory, cooked.Dependencies, cooked.SourceHash) || !ModelCache::Write(cookedFilepath, cooked))
+	{
+		LOG_WARN("[ResourceManager] Failed to write cooked model: " + cookedFilepath);
+		return;
+	}
+
+	LOG_INFO("[ResourceManager] Wrote cooked model: " + cookedFilepath);
+}
+
+struct BufferData
+{
+	const unsigned char* Data = nullptr;
+	std::size_t ByteSize = 0;
+};
+
+/* A single byte data URI, tinygltf requires every buffer and image to have some data */
+static const char* PLACEHOLDER_BUFFER_URI = "data:application/octet-stream;base64,AA==";
+static const char* PLACEHOLDER_IMAGE_URI = "data:image/png;base64,AA==";
+
+/*
+	tinygltf copies the entire binary chunk of a GLB and every external buffer file into Buffer::data. Instead, the JSON is rewritten
+	so those buffers and the images stored in them only carry a placeholder, and accessors and images read straight from the mapped
+	binary chunk and buffer files. Buffer files that cannot be mapped are left to tinygltf.
+*/
+static bool ParseGLTF(const std::string& filepath, const char* jsonData, std::size_t jsonByteSize, const unsigned char* binaryChunk, std::size_t binaryChunkByteSize,
+	tinygltf::TinyGLTF& loader, tinygltf::Model& tinygltf, std::vector<BufferData>& buffers, std::vector<std::unique_ptr<MemoryMappedFile>>& mappedBuffers,
+	std::vector<EncodedImage>& encodedImages, std::string& err, std::string& warn)
+{
+	nlohmann::json json = nlohmann::json::parse(jsonData, jsonData + jsonByteSize, nullptr, false);
+	if (json.is_discarded() || !json.is_object())
+	{
+		err = "Failed to parse the JSON of: " + filepath;
+		return false;
+	}
+
+	std::string directory = ModelCache::GetDirectory(filepath);
+
+	// Buffers that are read in place, and the URIs of the mapped buffer files so the cooked model still depends on them
+	std::vector<BufferData> mappedBufferData;
+	std::vector<std::string> mappedBufferURIs;
+
+	if (json.contains("buffers") && json["buffers"].is_array())
+	{
+		nlohmann::json& jsonBuffers = json["buffers"];
+		mappedBufferData.resize(jsonBuffers.size());
+		mappedBufferURIs.resize(jsonBuffers.size());
+
+		for (std::size_t i = 0; i < jsonBuffers.size(); ++i)
+		{
+			nlohmann::json& buffer = jsonBuffers[i];
+			if (!buffer.is_object())
+				continue;
+
+			std::size_t byteLength = buffer.value("byteLength", std::size_t(0));
+
+			// Only the first buffer of a GLB may omit its uri, in which case it refers to the binary chunk
+			if (i == 0 && binaryChunk && !buffer.contains("uri"))
+			{
+				if (byteLength > binaryChunkByteSize)
+				{
+					err = "Binary buffer exceeds the binary chunk size of: " + filepath;
+					return false;
+				}
+
+				mappedBufferData[i] = { binaryChunk, byteLength };
+			}
+			else if (buffer.contains("uri") && buffer["uri"].is_string() && !IsDataURI(buffer["uri"].get<std::string>()))
+			{
+				auto file = std::make_unique<MemoryMappedFile>();
+				if (!file->Open(directory + buffer["uri"].get<std::string>()) || file->GetSize() < byteLength)
+					continue;
+
+				mappedBufferData[i] = { file->GetData(), byteLength };
+				mappedBufferURIs[i] = buffer["uri"].get<std::string>();
+				mappedBuffers.push_back(std::move(file));
+			}
+			else
+			{
+				continue;
+			}
+
+			buffer["uri"] = PLACEHOLDER_BUFFER_URI;
+			buffer["byteLength"] = 1;
+		}
+	}
+
+	if (json.contains("images") && json["images"].is_array() && json.contains("bufferViews"))
+	{
+		nlohmann::json& images = json["images"];
+		const nlohmann::json& bufferViews = json["bufferViews"];
+		encodedImages.resize(images.size());
+
+		for (std::size_t i = 0; i < images.size(); ++i)
+		{
+			nlohmann::json& image = images[i];
+			if (!image.is_object() || !image.contains("bufferView"))
+				continue;
+
+			std::size_t bufferViewIndex = image["bufferView"].get<std::size_t>();
+			if (bufferViewIndex >= bufferViews.size())
+				continue;
+
+			const nlohmann::json& bufferView = bufferViews[bufferViewIndex];
+			std::size_t bufferIndex = bufferView.value("buffer", std::size_t(0));
+			if (bufferIndex >= mappedBufferData.size() || !mappedBufferData[bufferIndex].Data)
+				continue;
+
+			const BufferData& buffer = mappedBufferData[bufferIndex];
+			std::size_t byteOffset = bufferView.value("byteOffset", std::size_t(0));
+			std::size_t byteLength = bufferView.value("byteLength", std::size_t(0));
+
+			if (byteOffset > buffer.ByteSize || byteLength > buffer.ByteSize - byteOffset)
+			{
+				err = "Image buffer view exceeds the buffer size of: " + filepath;
+				return false;
+			}
+
+			encodedImages[i].Data = buffer.Data + byteOffset;
+			encodedImages[i].ByteSize = byteLength;
+
+			image.erase("bufferView");
+			image["uri"] = PLACEHOLDER_IMAGE_URI;
+		}
+	}
+
+	std::string jsonString = json.dump();
+	if (!loader.LoadASCIIFromString(&tinygltf, &err, &warn, jsonString.c_str(), static_cast<unsigned int>(jsonString.size()), directory))
+		return false;
+
+	for (uint32_t i = 0; i < tinygltf.buffers.size(); ++i)
+	{
+		if (i < mappedBufferData.size() && mappedBufferData[i].Data)
+		{
+			buffers.push_back(mappedBufferData[i]);
+			tinygltf.buffers[i].uri = mappedBufferURIs[i];
+			tinygltf.buffers[i].data.clear();
+		}
+		else
+		{
+			buffers.push_back({ tinygltf.buffers[i].data.data(), tinygltf.buffers[i].data.size() });
+		}
+	}
+
+	return true;
+}
+
+static VertexComponentType GLTFComponentTypeToVertexComponentType(int componentType)
+{
+	switch (componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_FLOAT:
+		return VertexComponentType::VERTEX_COMPONENT_TYPE_FLOAT;
+	case TINYGLTF_COMPONENT_TYPE_BYTE:
+		return VertexComponentType::VERTEX_COMPONENT_TYPE_INT8;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		return VertexComponentType::VERTEX_COMPONENT_TYPE_UINT8;
+	case TINYGLTF_COMPONENT_TYPE_SHORT:
+		return VertexComponentType::VERTEX_COMPONENT_TYPE_INT16;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		return VertexComponentType::VERTEX_COMPONENT_TYPE_UINT16;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+		return VertexComponentType::VERTEX_COMPONENT_TYPE_UINT32;
+	}
+
+	LOG_ERR("GLTF vertex attribute component type is not supported");
+	return VertexComponentType::VERTEX_COMPONENT_TYPE_FLOAT;
+}
+
+/* Component types the core spec and KHR_mesh_quantization allow for an attribute, quantized normals have to be normalized */
+static bool IsValidAttributeComponentType(const std::string& name, int componentType, bool normalized)
+{
+	if (componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+		return true;
+
+	if (name == "NORMAL")
+		return normalized && (componentType == TINYGLTF_COMPONENT_TYPE_BYTE || componentType == TINYGLTF_COMPONENT_TYPE_SHORT);
+
+	return componentType == TINYGLTF_COMPONENT_TYPE_BYTE || componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ||
+		componentType == TINYGLTF_COMPONENT_TYPE_SHORT || componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+}
+
+static SparseAttributeValues GetSparseAttributeValues(const tinygltf::Model& tinygltf, const std::vector<BufferData>& buffers, const tinygltf::Accessor& accessor,
+	const std::string& name)
+{
+	SparseAttributeValues sparse;
+
+	const tinygltf::BufferView& indicesView = tinygltf.bufferViews[accessor.sparse.indices.bufferView];
+	const tinygltf::BufferView& valuesView = tinygltf.bufferViews[accessor.sparse.values.bufferView];
+	const BufferData& indicesBuffer = buffers[indicesView.buffer];
+	const BufferData& valuesBuffer = buffers[valuesView.buffer];
+
+	int indexComponentType = accessor.sparse.indices.componentType;
+	ASSERT(indexComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE || indexComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ||
+		indexComponentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, "GLTF sparse indices of vertex attribute " + name + " have an invalid component type");
+
+	std::size_t numValues = static_cast<std::size_t>(std::max(accessor.sparse.count, 0));
+	std::size_t indicesByteOffset = indicesView.byteOffset + accessor.sparse.indices.byteOffset;
+	std::size_t valuesByteOffset = valuesView.byteOffset + accessor.sparse.values.byteOffset;
+	std::size_t elementByteSize = tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
+
+	// Sparse indices and values are always tightly packed
+	ASSERT(indicesByteOffset + numValues * tinygltf::GetComponentSizeInBytes(indexComponentType) <= indicesBuffer.ByteSize,
+		"Byte offset for sparse indices of vertex attribute " + name + " exceeded total buffer size");
+	ASSERT(valuesByteOffset + numValues * elementByteSize <= valuesBuffer.ByteSize,
+		"Byte offset for sparse values of vertex attribute " + name + " exceeded total buffer size");
+
+	sparse.Indices = indicesBuffer.Data + indicesByteOffset;
+	sparse.IndexComponentType = GLTFComponentTypeToVertexComponentType(indexComponentType);
+	sparse.Values = valuesBuffer.Data + valuesByteOffset;
+	sparse.NumValues = numValues;
+
+	// Assembly relies on the indices being sorted and in range to only write the vertices of the primitive
+	IndexStream indices;
+	indices.Data = sparse.Indices;
+	indices.ComponentType = sparse.IndexComponentType;
+	indices.NumIndices = numValues;
+
+	std::vector<uint32_t> vertexIndices(numValues);
+	VertexAssembly::AssembleIndices(indices, 0, sizeof(uint32_t), vertexIndices.data());
+
+	for (std::size_t i = 0; i < numValues; ++i)
+	{
+		if (vertexIndices[i] >= accessor.count || (i > 0 && vertexIndices[i] <= vertexIndices[i - 1]))
+		{
+			ASSERT(false, "GLTF sparse indices of vertex attribute " + name + " are out of range or not strictly increasing");
+			sparse.NumValues = 0;
+			break;
+		}
+	}
+
+	return sparse;
+}
+
+static VertexAttributeStream GetVertexAttributeStream(const tinygltf::Model& tinygltf, const std::vector<BufferData>& buffers, const tinygltf::Primitive& prim,
+	const std::string& name, int type, std::size_t& count)
+{
+	VertexAttributeStream stream;
+
+	auto attrib = prim.attributes.find(name);
+	ASSERT(attrib != prim.attributes.end(), "GLTF primitive does not contain vertex attribute " + name);
+
+	const tinygltf::Accessor& accessor = tinygltf.accessors[attrib->second];
+
+	ASSERT(accessor.type == type, "GLTF vertex attribute " + name + " has an unexpected type");
+	ASSERT(IsValidAttributeComponentType(name, accessor.componentType, accessor.normalized), "GLTF vertex attribute " + name + " has an invalid component type");
+
+	// Sparse accessors may leave out the buffer view, their other elements are zero
+	if (accessor.bufferView >= 0)
+	{
+		const tinygltf::BufferView& bufferView = tinygltf.bufferViews[accessor.bufferView];
+		const BufferData& buffer = buffers[bufferView.buffer];
+
+		int byteStride = accessor.ByteStride(bufferView);
+		ASSERT(byteStride > 0, "GLTF vertex attribute " + name + " has an invalid byte stride");
+
+		std::size_t byteOffset = bufferView.byteOffset + accessor.byteOffset;
+		std::size_t elementByteSize = tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
+		ASSERT(accessor.count == 0 || byteOffset + (accessor.count - 1) * byteStride + elementByteSize <= buffer.ByteSize,
+			"Byte offset for vertex attribute " + name + " exceeded total buffer size");
+
+		stream.Data = buffer.Data + byteOffset;
+		stream.ByteStride = static_cast<std::size_t>(byteStride);
+	}
+	else
+	{
+		ASSERT(accessor.sparse.isSparse, "GLTF vertex attribute " + name + " has neither a buffer view nor sparse values");
+	}
+
+	stream.ComponentType = GLTFComponentTypeToVertexComponentType(accessor.componentType);
+	stream.Normalized = accessor.normalized;
+
+	if (accessor.sparse.isSparse)
+		stream.Sparse = GetSparseAttributeValues(tinygltf, buffers, accessor, name);
+
+	count = accessor.count;
+	return stream;
+}
+
+/* The min and max of an accessor are in its component type, so they only match the converted positions when those are not normalized.
+   Sparse accessors include the sparse values in their min and max */
+static bool GetAccessorBounds(const tinygltf::Accessor& accessor, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	if (accessor.normalized || accessor.minValues.size() != 3 || accessor.maxValues.size() != 3)
+		return false;
+
+	boundsMin = glm::vec3(accessor.minValues[0], accessor.minValues[1], accessor.minValues[2]);
+	boundsMax = glm::vec3(accessor.maxValues[0], accessor.maxValues[1], accessor.maxValues[2]);
+	return glm::all(glm::lessThanEqual(boundsMin, boundsMax));
+}
+
+static IndexStream GetIndexStream(const tinygltf::Model& tinygltf, const std::vector<BufferData>& buffers, const tinygltf::Primitive& prim, std::size_t numVertices)
+{
+	IndexStream stream;
+	ASSERT(prim.indices >= 0, "GLTF primitive does not contain indices");
+
+	const tinygltf::Accessor& accessor = tinygltf.accessors[prim.indices];
+	const tinygltf::BufferView& bufferView = tinygltf.bufferViews[accessor.bufferView];
+	const BufferData& buffer = buffers[bufferView.buffer];
+
+	ASSERT(!accessor.sparse.isSparse, "GLTF index accessors with sparse values are not supported");
+	ASSERT(accessor.type == TINYGLTF_TYPE_SCALAR && (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ||
+		accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT || accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT),
+		"GLTF index accessor has an invalid component type");
+
+	// Index buffer views are tightly packed, glTF does not allow a byte stride on them
+	std::size_t byteOffset = bufferView.byteOffset + accessor.byteOffset;
+	ASSERT(byteOffset + accessor.count * tinygltf::GetComponentSizeInBytes(accessor.componentType) <= buffer.ByteSize,
+		"Byte offset for indices exceeded total buffer size");
+	ASSERT(accessor.maxValues.empty() || accessor.maxValues[0] < numVertices, "GLTF primitive indices exceed its vertex count");
+
+	stream.Data = buffer.Data + byteOffset;
+	stream.ComponentType = GLTFComponentTypeToVertexComponentType(accessor.componentType);
+	stream.NumIndices = accessor.count;
+
+	return stream;
+}
+
+template<typename TOptimizedPrimitive>
+static void LogMeshOptimizationStats(const std::vector<TOptimizedPrimitive>& optimizedPrimitives)
+{
+	std::size_t numVerticesBefore = 0, numVerticesAfter = 0;
+	double indexDistanceBefore = 0.0, indexDistanceAfter = 0.0;
+	std::size_t numIndexDistances = 0;
+
+	// Index distances are averaged per primitive, the jumps between primitives are not part of either order
+	for (auto& primitive : optimizedPrimitives)
+	{
+		std::size_t numDistances = primitive.Indices.size() > 1 ? primitive.Indices.size() - 1 : 0;
+
+		numVerticesBefore += primitive.Stats.NumVerticesBefore;
+		numVerticesAfter += primitive.Stats.NumVerticesAfter;
+		indexDistanceBefore += primitive.Stats.AverageIndexDistanceBefore * numDistances;
+		indexDistanceAfter += primitive.Stats.AverageIndexDistanceAfter * numDistances;
+		numIndexDistances += numDistances;
+	}
+
+	if (numIndexDistances > 0)
+	{
+		indexDistanceBefore /= numIndexDistances;
+		indexDistanceAfter /= numIndexDistances;
+	}
+
+	LOG_INFO("[ResourceManager] Mesh optimization: " + std::to_string(numVerticesBefore) + " -> " + std::to_string(numVerticesAfter) +
+		" vertices, average index distance " + std::to_string(indexDistanceBefore) + " -> " + std::to_string(indexDistanceAfter));
+}
+
+static float ComputeTexCoordDensity(const CookedModelData& data, const Submesh& submesh)
+{
+	double texCoordArea = 0.0, positionArea = 0.0;
+
+	for (uint32_t i = submesh.IndexOffset; i + 2 < submesh.IndexOffset + submesh.NumIndices; i += 3)
+	{
+		uint32_t triangle[3] = {};
+		for (uint32_t v = 0; v < 3; ++v)
+		{
+			triangle[v] = data.IndexByteSize == sizeof(uint16_t) ? static_cast<const uint16_t*>(data.Indices)[i + v] :
+				static_cast<const uint32_t*>(data.Indices)[i + v];
+		}
+
+		const Vertex& v0 = data.Vertices[triangle[0]];
+		const Vertex& v1 = data.Vertices[triangle[1]];
+		const Vertex& v2 = data.Vertices[triangle[2]];
+
+		glm::vec2 uv1 = v1.TexCoord - v0.TexCoord, uv2 = v2.TexCoord - v0.TexCoord;
+		texCoordArea += std::abs(uv1.x * uv2.y - uv1.y * uv2.x);
+		positionArea += glm::length(glm::cross(v1.Position - v0.Position, v2.Position - v0.Position));
+	}
+
+	// Degenerate or untextured submeshes always use the most detailed mip
+	if (texCoordArea <= 0.0 || positionArea <= 0.0)
+		return -std::numeric_limits<float>::max();
+
+	return static_cast<float>(0.5 * std::log2(texCoordArea / positionArea));
+}
+
+/* Indices of a submesh relative to its vertex range */
+static std::vector<uint32_t> ReadSubmeshIndices(const CookedModelData& cooked, const Submesh& submesh)
+{
+	std::vector<uint32_t> submeshIndices(submesh.NumIndices);
+	for (uint32_t i = 0; i < submesh.NumIndices; ++i)
+	{
+		std::size_t index = submesh.IndexOffset + i;
+		submeshIndices[i] = (cooked.IndexByteSize == sizeof(uint16_t) ? static_cast<const uint16_t*>(cooked.Indices)[index] :
+			static_cast<const uint32_t*>(cooked.Indices)[index]) - submesh.VertexOffset;
+	}
+
+	return submeshIndices;
+}
+
+/* Write indices relative to a vertex range to the index data, starting at indexOffset */
+static void WriteSubmeshIndices(const std::vector<uint32_t>& submeshIndices, uint32_t vertexOffset, uint32_t indexByteSize, std::size_t indexOffset,
+	std::vector<unsigned char>& indices)
+{
+	for (std::size_t i = 0; i < submeshIndices.size(); ++i)
+	{
+		if (indexByteSize == sizeof(uint16_t))
+			reinterpret_cast<uint16_t*>(indices.data())[indexOffset + i] = static_cast<uint16_t>(submeshIndices[i] + vertexOffset);
+		else
+			reinterpret_cast<uint32_t*>(indices.data())[indexOffset + i] = submeshIndices[i] + vertexOffset;
+	}
+}
+
+static void ForEachSubmesh(const CookedModelData& cooked, ThreadPool* threadPool, const std::function<void(std::size_t)>& job)
+{
+	if (threadPool)
+	{
+		for (std::size_t i = 0; i < cooked.Submeshes.size(); ++i)
+			threadPool->Submit([&job, i]() { job(i); });
+
+		threadPool->WaitIdle();
+	}
+	else
+	{
+		for (std::size_t i = 0; i < cooked.Submeshes.size(); ++i)
+			job(i);
+	}
+}
+
+/* Split every submesh into meshlets and reorder the triangles in the index data to match, submeshes are built in parallel
+   and concatenated in order */
+static void BuildMeshlets(CookedModelData& cooked, std::vector<unsigned char>& indices, ThreadPool* threadPool)
+{
+	SCOPED_TIMER("ResourceLoader::BuildMeshlets");
+
+	std::vector<MeshletData> submeshMeshlets(cooked.Submeshes.size());
+
+	ForEachSubmesh(cooked, threadPool, [&cooked, &indices, &submeshMeshlets](std::size_t i) {
+		const Submesh& submesh = cooked.Submeshes[i];
+		std::vector<uint32_t> submeshIndices = ReadSubmeshIndices(cooked, submesh);
+
+		MeshletBuilder::Build(cooked.Vertices + submesh.VertexOffset, submesh.NumVertices, submeshIndices, submeshMeshlets[i]);
+		WriteSubmeshIndices(submeshIndices, submesh.VertexOffset, cooked.IndexByteSize, submesh.IndexOffset, indices);
+	});
+
+	for (std::size_t i = 0; i < cooked.Submeshes.size(); ++i)
+	{
+		Submesh& submesh = cooked.Submeshes[i];
+		MeshletData& meshlets = submeshMeshlets[i];
+
+		submesh.MeshletOffset = static_cast<uint32_t>(cooked.Meshlets.size());
+		submesh.NumMeshlets = static_cast<uint32_t>(meshlets.Meshlets.size());
+
+		for (auto& meshlet : meshlets.Meshlets)
+		{
+			meshlet.VertexOffset += static_cast<uint32_t>(cooked.MeshletVertices.size());
+			meshlet.TriangleOffset += static_cast<uint32_t>(cooked.MeshletTriangles.size());
+			meshlet.IndexOffset += submesh.IndexOffset;
+			cooked.Meshlets.push_back(meshlet);
+		}
+
+		for (uint32_t vertex : meshlets.Vertices)
+			cooked.MeshletVertices.push_back(vertex + submesh.VertexOffset);
+
+		cooked.MeshletTriangles.insert(cooked.MeshletTriangles.end(), meshlets.Triangles.begin(), meshlets.Triangles.end());
+	}
+
+	MeshletBuildStats stats = MeshletBuilder::ComputeStats(cooked.Meshlets);
+	LOG_INFO("[ResourceManager] Built " + std::to_string(stats.NumMeshlets) + " meshlets, " + std::to_string(stats.VertexFillRate * 100.0f) +
+		"% vertex fill, " + std::to_string(stats.TriangleFillRate * 100.0f) + "% triangle fill");
+}
+
+/* Simplify every submesh into a chain of levels of detail, each from the previous one, and append their indices to the index data.
+   Submeshes are simplified in parallel and appended in order */
+static void BuildLODs(CookedModelData& cooked, std::vector<unsigned char>& indices, ThreadPool* threadPool)
+{
+	SCOPED_TIMER("ResourceLoader::BuildLODs");
+
+	// Submeshes this small are cheap enough at full detail
+	constexpr uint32_t minLODTriangles = 32;
+
+	struct LODData
+	{
+		std::vector<uint32_t> Indices;
+		float Error = 0.0f;
+	};
+
+	std::vector<std::vector<LODData>> submeshLODs(cooked.Submeshes.size());
+
+	ForEachSubmesh(cooked, threadPool, [&cooked, &submeshLODs](std::size_t i) {
+		const Submesh& submesh = cooked.Submeshes[i];
+		std::vector<uint32_t> lodIndices = ReadSubmeshIndices(cooked, submesh);
+		float error = 0.0f;
+
+		while (submeshLODs[i].size() < MAX_SUBMESH_LODS && lodIndices.size() / 3 >= minLODTriangles * 2)
+		{
+			LODData lod;
+			std::size_t targetNumIndices = lodIndices.size() / 6 * 3;
+			float lodError = MeshSimplifier::Simplify(cooked.Vertices + submesh.VertexOffset, submesh.NumVertices, lodIndices, targetNumIndices, lod.Indices);
+
+			// Seams, borders and the error limit can stop the simplification early, a level that barely simplifies is not worth its memory
+			if (lod.Indices.empty() || lod.Indices.size() > lodIndices.size() * 3 / 4)
+				break;
+
+			// Every level is simplified from the previous one, so their errors add up
+			error += lodError;
+			lod.Error = error;
+			lodIndices = lod.Indices;
+			submeshLODs[i].push_back(std::move(lod));
+		}
+	});
+
+	std::size_t numIndices = cooked.NumIndices;
+	for (auto& lods : submeshLODs)
+	{
+		for (auto& lod : lods)
+			numIndices += lod.Indices.size();
+	}
+
+	indices.resize(numIndices * cooked.IndexByteSize);
+	std::size_t indexOffset = cooked.NumIndices;
+
+	for (std::size_t i = 0; i < cooked.Submeshes.size(); ++i)
+	{
+		Submesh& submesh = cooked.Submeshes[i];
+		submesh.LODOffset = static_cast<uint32_t>(cooked.LODs.size());
+		submesh.NumLODs = static_cast<uint32_t>(submeshLODs[i].size());
+
+		for (auto& lod : submeshLODs[i])
+		{
+			WriteSubmeshIndices(lod.Indices, submesh.VertexOffset, cooked.IndexByteSize, indexOffset, indices);
+
+			SubmeshLOD submeshLOD;
+			submeshLOD.IndexOffset = static_cast<uint32_t>(indexOffset);
+			submeshLOD.NumIndices = static_cast<uint32_t>(lod.Indices.size());
+			submeshLOD.Error = lod.Error;
+			cooked.LODs.push_back(submeshLOD);
+
+			indexOffset += lod.Indices.size();
+		}
+	}
+
+	LOG_INFO("[ResourceManager] Generated " + std::to_string(cooked.LODs.size()) + " levels of detail, " +
+		std::to_string((numIndices - cooked.NumIndices) / 3) + " triangles on top of " + std::to_string(cooked.NumIndices / 3));
+
+	cooked.Indices = indices.data();
+	cooked.NumIndices = numIndices;
+}
+
+static bool IsLoadCancelled(const std::atomic_bool* isCancelled)
+{
+	return isCancelled && *isCancelled;
+}
+
+bool ModelCooker::Cook(const std::string& filepath, const ModelLoadDesc& loadDesc, const std::atomic_bool* isCancelled,
+	const ModelCookCallbacks& callbacks, ModelData& data)
+{
+	std::unique_ptr<ThreadPool> threadPool;
+	if (loadDesc.ParallelImageDecode || loadDesc.ParallelVertexAssembly)
+		threadPool = std::make_unique<ThreadPool>(loadDesc.NumWorkerThreads);
+
+	ThreadPool* decodeThreadPool = loadDesc.ParallelImageDecode ? threadPool.get() : nullptr;
+	ThreadPool* assemblyThreadPool = loadDesc.ParallelVertexAssembly ? threadPool.get() : nullptr;
+
+	CookFlags cookFlags = CookFlags::COOK_FLAGS_NONE;
+	if (loadDesc.OptimizeMeshes)
+		cookFlags = cookFlags | CookFlags::COOK_FLAGS_OPTIMIZED_MESHES;
+	if (loadDesc.BuildMeshlets)
+		cookFlags = cookFlags | CookFlags::COOK_FLAGS_MESHLETS;
+	if (loadDesc.GenerateLODs)
+		cookFlags = cookFlags | CookFlags::COOK_FLAGS_LODS;
+
+	if (LoadCookedGLTF(filepath, cookFlags, loadDesc, decodeThreadPool, isCancelled, callbacks, data))
+		return !IsLoadCancelled(isCancelled);
+
+	tinygltf::Model tinygltf;
+	tinygltf::TinyGLTF loader;
+	std::string err;
+	std::string warn;
+
+	// Encoded image bytes, decoded after the model is parsed so duplicate images are only decoded once
+	std::vector<EncodedImage> encodedImages;
+	loader.SetImageLoader(DeferImageDecode, &encodedImages);
+
+	// Data of every glTF buffer, accessors read through these instead of tinygltf::Buffer::data
+	std::vector<BufferData> buffers;
+	std::vector<std::unique_ptr<MemoryMappedFile>> mappedBuffers;
+	GLBContainer glb;
+	MemoryMappedFile jsonFile;
+
+	bool result = false;
+	if (GLBContainer::IsGLB(filepath))
+	{
+		result = glb.Open(filepath) && ParseGLTF(filepath, glb.GetJSON(), glb.GetJSONByteSize(), glb.GetBinary(), glb.GetBinaryByteSize(),
+			loader, tinygltf, buffers, mappedBuffers, encodedImages, err, warn);
+	}
+	else
+	{
+		result = jsonFile.Open(filepath) && ParseGLTF(filepath, reinterpret_cast<const char*>(jsonFile.GetData()), jsonFile.GetSize(), nullptr, 0,
+			loader, tinygltf, buffers, mappedBuffers, encodedImages, err, warn);
+	}
+
+	if (!warn.empty())
+		LOG_WARN(warn);
+	if (!err.empty())
+		LOG_ERR(err);
+
+	if (!result)
+	{
+		LOG_ERR("[ResourceManager] Failed to parse glTF model: " + filepath);
+		return false;
+	}
+
+	if (IsLoadCancelled(isCancelled))
+		return false;
+
+	Timer assemblyTimer("ResourceLoader::AssembleVertices");
+
+	// Every primitive is written to its own range of the combined vertex and index data, at the prefix sum of the preceding primitives
+	struct PrimitiveAssembly
+	{
+		VertexStreams Vertices;
+		IndexStream Indices;
+		uint32_t MaterialIndex = 0;
+
+		// Min and max of the position accessor, if it has them. The bounds are computed after assembly
+		VertexBounds AccessorBounds;
+		bool HasAccessorBounds = false;
+		VertexBounds Bounds;
+
+		std::size_t VertexOffset = 0;
+		std::size_t IndexOffset = 0;
+	};
+
+	// Primitives without a material use the GLTF default material, which is appended after the model materials
+	uint32_t defaultMaterialIndex = static_cast<uint32_t>(tinygltf.materials.size());
+	bool usesDefaultMaterial = false;
+
+	std::vector<PrimitiveAssembly> primitives;
+	std::size_t totalVertexCount = 0;
+	std::size_t totalIndexCount = 0;
+	// Vertex data of the glTF attributes, smaller than the assembled vertices for quantized models
+	std::size_t sourceVertexByteSize = 0;
+
+	for (auto& mesh : tinygltf.meshes)
+	{
+		for (auto& prim : mesh.primitives)
+		{
+			PrimitiveAssembly primitive;
+
+			std::size_t numPositions = 0, numTexCoords = 0, numNormals = 0;
+			primitive.Vertices.Position = GetVertexAttributeStream(tinygltf, buffers, prim, "POSITION", TINYGLTF_TYPE_VEC3, numPositions);
+			primitive.Vertices.TexCoord = GetVertexAttributeStream(tinygltf, buffers, prim, "TEXCOORD_0", TINYGLTF_TYPE_VEC2, numTexCoords);
+			primitive.Vertices.Normal = GetVertexAttributeStream(tinygltf, buffers, prim, "NORMAL", TINYGLTF_TYPE_VEC3, numNormals);
+
+			ASSERT(numTexCoords == numPositions && numNormals == numPositions, "GLTF primitive vertex attributes have different counts");
+			primitive.Vertices.NumVertices = numPositions;
+			primitive.HasAccessorBounds = GetAccessorBounds(tinygltf.accessors[prim.attributes.at("POSITION")], primitive.AccessorBounds.Min,
+				primitive.AccessorBounds.Max);
+
+			for (const char* attribute : { "POSITION", "TEXCOORD_0", "NORMAL" })
+			{
+				const tinygltf::Accessor& accessor = tinygltf.accessors[prim.attributes.at(attribute)];
+				sourceVertexByteSize += accessor.count * tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type);
+			}
+
+			primitive.Indices = GetIndexStream(tinygltf, buffers, prim, primitive.Vertices.NumVertices);
+
+			if (prim.material >= 0 && prim.material < static_cast<int>(tinygltf.materials.size()))
+			{
+				primitive.MaterialIndex = static_cast<uint32_t>(prim.material);
+			}
+			else
+			{
+				primitive.MaterialIndex = defaultMaterialIndex;
+				usesDefaultMaterial = true;
+			}
+
+			primitive.VertexOffset = totalVertexCount;
+			primitive.IndexOffset = totalIndexCount;
+			totalVertexCount += primitive.Vertices.NumVertices;
+			totalIndexCount += primitive.Indices.NumIndices;
+
+			primitives.push_back(primitive);
+		}
+	}
+
+	// Quantized attributes are widened to floats for processing, only a compact vertex buffer format keeps them small on the GPU
+	if (sourceVertexByteSize < totalVertexCount * sizeof(Vertex) && loadDesc.VertexBufferFormat == VertexFormat::VERTEX_FORMAT_FLOAT)
+		LOG_WARN("[ResourceManager] Model has quantized vertex attributes of " + std::to_string(sourceVertexByteSize / 1024) + " KB, the float vertex buffer expands them to " +
+			std::to_string(totalVertexCount * sizeof(Vertex) / 1024) + " KB");
+
+	auto forEachPrimitive = [&primitives, assemblyThreadPool](const std::function<void(std::size_t)>& job) {
+		if (assemblyThreadPool)
+		{
+			for (std::size_t i = 0; i < primitives.size(); ++i)
+				assemblyThreadPool->Submit([&job, i]() { job(i); });
+
+			assemblyThreadPool->WaitIdle();
+		}
+		else
+		{
+			for (std::size_t i = 0; i < primitives.size(); ++i)
+				job(i);
+		}
+	};
+
+	// Optimized primitives are assembled into their own arrays first, since welding changes their vertex counts
+	struct OptimizedPrimitive
+	{
+		std::vector<Vertex> Vertices;
+		std::vector<uint32_t> Indices;
+		MeshOptimizationStats Stats;
+	};
+
+	std::vector<OptimizedPrimitive> optimizedPrimitives;
+
+	if (loadDesc.OptimizeMeshes)
+	{
+		optimizedPrimitives.resize(primitives.size());
+
+		forEachPrimitive([&primitives, &optimizedPrimitives](std::size_t i) {
+			const PrimitiveAssembly& primitive = primitives[i];
+			OptimizedPrimitive& optimized = optimizedPrimitives[i];
+
+			optimized.Vertices.resize(primitive.Vertices.NumVertices);
+			optimized.Indices.resize(primitive.Indices.NumIndices);
+			VertexAssembly::Assemble(primitive.Vertices, optimized.Vertices.data());
+			VertexAssembly::AssembleIndices(primitive.Indices, 0, sizeof(uint32_t), optimized.Indices.data());
+
+			MeshOptimizer::Optimize(optimized.Vertices, optimized.Indices, &optimized.Stats);
+		});
+
+		totalVertexCount = 0;
+		for (std::size_t i = 0; i < primitives.size(); ++i)
+		{
+			primitives[i].VertexOffset = totalVertexCount;
+			totalVertexCount += optimizedPrimitives[i].Vertices.size();
+		}
+
+		LogMeshOptimizationStats(optimizedPrimitives);
+	}
+
+	// Indices are rebased onto the combined vertex data, so they only fit in 16 bits if the combined vertex count does
+	uint32_t indexByteSize = totalVertexCount <= std::numeric_limits<uint16_t>::max() + 1ull ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	std::vector<Vertex>& vertices = data.Vertices;
+	std::vector<unsigned char>& indices = data.Indices;
+	vertices.resize(totalVertexCount);
+	indices.resize(totalIndexCount * indexByteSize);
+
+	std::atomic<uint32_t> numMismatchedAccessorBounds{ 0 };
+
+	forEachPrimitive([&](std::size_t i) {
+		PrimitiveAssembly& primitive = primitives[i];
+		Vertex* primitiveVertices = vertices.data() + primitive.VertexOffset;
+		std::size_t numPrimitiveVertices = loadDesc.OptimizeMeshes ? optimizedPrimitives[i].Vertices.size() : primitive.Vertices.NumVertices;
+		unsigned char* primitiveIndices = indices.data() + primitive.IndexOffset * indexByteSize;
+
+		if (loadDesc.OptimizeMeshes)
+		{
+			const OptimizedPrimitive& optimized = optimizedPrimitives[i];
+			std::copy(optimized.Vertices.begin(), optimized.Vertices.end(), primitiveVertices);
+
+			IndexStream optimizedIndices;
+			optimizedIndices.Data = reinterpret_cast<const unsigned char*>(optimized.Indices.data());
+			optimizedIndices.ComponentType = VertexComponentType::VERTEX_COMPONENT_TYPE_UINT32;
+			optimizedIndices.NumIndices = optimized.Indices.size();
+			VertexAssembly::AssembleIndices(optimizedIndices, static_cast<uint32_t>(primitive.VertexOffset), indexByteSize, primitiveIndices);
+		}
+		else
+		{
+			VertexAssembly::Assemble(primitive.Vertices, primitiveVertices);
+			VertexAssembly::AssembleIndices(primitive.Indices, static_cast<uint32_t>(primitive.VertexOffset), indexByteSize, primitiveIndices);
+		}
+
+		// Welding never moves a vertex, so the accessor bounds still hold for optimized primitives
+		if (!VertexAssembly::ComputeBounds(primitiveVertices, numPrimitiveVertices, primitive.HasAccessorBounds ? &primitive.AccessorBounds : nullptr, primitive.Bounds))
+			numMismatchedAccessorBounds++;
+	});
+
+	assemblyTimer.Stop();
+
+	if (numMismatchedAccessorBounds > 0)
+		LOG_WARN("[ResourceManager] " + std::to_string(numMismatchedAccessorBounds) + " primitives have positions that do not match the min and max of their accessor: " + filepath);
+
+	// The assembled vertices and indices are all that is read from the buffer files from here on, images are read in again if needed
+	for (auto& mappedBuffer : mappedBuffers)
+		mappedBuffer->ReleasePages(0, mappedBuffer->GetSize());
+
+	if (IsLoadCancelled(isCancelled))
+		return false;
+
+	CookedModelData& cooked = data.Cooked;
+	cooked.Vertices = vertices.data();
+	cooked.NumVertices = vertices.size();
+	cooked.Indices = indices.data();
+	cooked.NumIndices = totalIndexCount;
+	cooked.IndexByteSize = indexByteSize;
+	cooked.Flags = cookFlags;
+
+	for (std::size_t i = 0; i < primitives.size(); ++i)
+	{
+		Submesh submesh;
+		submesh.IndexOffset = static_cast<uint32_t>(primitives[i].IndexOffset);
+		submesh.NumIndices = static_cast<uint32_t>(primitives[i].Indices.NumIndices);
+		submesh.VertexOffset = static_cast<uint32_t>(primitives[i].VertexOffset);
+		submesh.NumVertices = static_cast<uint32_t>(loadDesc.OptimizeMeshes ? optimizedPrimitives[i].Vertices.size() : primitives[i].Vertices.NumVertices);
+		submesh.MaterialIndex = primitives[i].MaterialIndex;
+		submesh.TexCoordDensity = ComputeTexCoordDensity(cooked, submesh);
+		submesh.BoundsMin = primitives[i].Bounds.Min;
+		submesh.BoundsMax = primitives[i].Bounds.Max;
+		submesh.BoundingSphereCenter = primitives[i].Bounds.SphereCenter;
+		submesh.BoundingSphereRadius = primitives[i].Bounds.SphereRadius;
+		cooked.Submeshes.push_back(submesh);
+	}
+
+	if (loadDesc.BuildMeshlets)
+		BuildMeshlets(cooked, indices, assemblyThreadPool);
+
+	if (loadDesc.GenerateLODs)
+		BuildLODs(cooked, indices, assemblyThreadPool);
+
+	if (IsLoadCancelled(isCancelled))
+		return false;
+
+	for (auto& material : tinygltf.materials)
+	{
+		int baseColorTextureIndex = material.pbrMetallicRoughness.baseColorTexture.index;
+		int normalTextureIndex = material.normalTexture.index;
+
+		CookedMaterial cookedMaterial;
+		cookedMaterial.BaseColorImage = baseColorTextureIndex >= 0 ? tinygltf.textures[baseColorTextureIndex].source : -1;
+		cookedMaterial.NormalImage = normalTextureIndex >= 0 ? tinygltf.textures[normalTextureIndex].source : -1;
+		cooked.Materials.push_back(cookedMaterial);
+	}
+
+	if (usesDefaultMaterial)
+		cooked.Materials.push_back(CookedMaterial());
+
+	auto hasEncodedImage = [&encodedImages](uint32_t imageIndex) {
+		return imageIndex < encodedImages.size() && encodedImages[imageIndex].Data;
+	};
+
+	ImageSource imageSource;
+	imageSource.GetContentHash = [&](uint32_t imageIndex, uint64_t& hash) {
+		if (!hasEncodedImage(imageIndex))
+			return false;
+
+		hash = Hash::Hash64(encodedImages[imageIndex].Data, encodedImages[imageIndex].ByteSize);
+		return true;
+	};
+	imageSource.Decode = [&](uint32_t imageIndex) {
+		if (!hasEncodedImage(imageIndex))
+			return ImageData();
+
+		const tinygltf::Image& image = tinygltf.images[imageIndex];
+		return DecodeImageFromMemory(image.uri.empty() ? image.name : image.uri, encodedImages[imageIndex]);
+	};
+	imageSource.CookedTextureDirectory = ModelCache::GetDirectory(filepath);
+
+	BuildModelData(data, loadDesc, imageSource, decodeThreadPool, isCancelled, callbacks);
+
+	// The textures a cancelled load skipped were never built, so neither the model nor the cooked data should be kept
+	if (IsLoadCancelled(isCancelled))
+		return false;
+
+	WriteCookedGLTF(filepath, tinygltf, cooked);
+
+	LOG_INFO("[ResourceManager] Loaded model: " + filepath);
+	return true;
+}
+
+bool ModelCooker::LoadCookedTexture(const std::string& directory, uint64_t contentHash, ImageData& image)
+{
+	CookedTextureData cooked;
+	if (!ModelCache::ReadTexture(ModelCache::GetCookedTextureFilepath(directory, contentHash), contentHash, cooked))
+		return false;
+
+	image = CreateImageFromCookedTexture(cooked);
+	return true;
+}
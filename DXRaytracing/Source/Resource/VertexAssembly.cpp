@@ -0,0 +1,330 @@
+#include "Pch.h"
+#include "Resource/VertexAssembly.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define VERTEX_ASSEMBLY_SSE2
+#include <immintrin.h>
+#endif
+
+template<typename T>
+static inline float NormalizeComponent(T value)
+{
+	// Signed integers map to [-1, 1], where both the minimum and the minimum + 1 map to -1
+	if (std::is_signed<T>::value)
+		return std::max(static_cast<float>(value) / static_cast<float>(std::numeric_limits<T>::max()), -1.0f);
+
+	return static_cast<float>(value) / static_cast<float>(std::numeric_limits<T>::max());
+}
+
+template<uint32_t NumComponents, typename T>
+static inline void ConvertElement(const unsigned char* element, bool normalized, float* output)
+{
+	T components[NumComponents];
+	std::memcpy(components, element, sizeof(components));
+
+	for (uint32_t c = 0; c < NumComponents; ++c)
+		output[c] = (std::is_floating_point<T>::value || !normalized) ? static_cast<float>(components[c]) : NormalizeComponent(components[c]);
+}
+
+static std::size_t ReadSparseIndex(const SparseAttributeValues& sparse, std::size_t i)
+{
+	switch (sparse.IndexComponentType)
+	{
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_UINT8:
+		return sparse.Indices[i];
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_UINT16:
+	{
+		uint16_t index;
+		std::memcpy(&index, sparse.Indices + i * sizeof(uint16_t), sizeof(uint16_t));
+		return index;
+	}
+	default:
+	{
+		uint32_t index;
+		std::memcpy(&index, sparse.Indices + i * sizeof(uint32_t), sizeof(uint32_t));
+		return index;
+	}
+	}
+}
+
+template<uint32_t NumComponents, typename T>
+static void AssembleAttribute(const VertexAttributeStream& stream, std::size_t firstVertex, std::size_t numVertices, float* output)
+{
+	constexpr std::size_t vertexStride = sizeof(Vertex) / sizeof(float);
+
+	if (stream.Data)
+	{
+		const unsigned char* element = stream.Data + firstVertex * stream.ByteStride;
+
+		for (std::size_t i = 0; i < numVertices; ++i)
+		{
+			ConvertElement<NumComponents, T>(element, stream.Normalized, output + i * vertexStride);
+			element += stream.ByteStride;
+		}
+	}
+	else
+	{
+		for (std::size_t i = 0; i < numVertices; ++i)
+			std::fill(output + i * vertexStride, output + i * vertexStride + NumComponents, 0.0f);
+	}
+
+	// Sparse indices are sorted, so only the values within the range of vertices are visited
+	const SparseAttributeValues& sparse = stream.Sparse;
+	std::size_t first = 0, last = sparse.NumValues;
+
+	while (first < last)
+	{
+		std::size_t middle = (first + last) / 2;
+		if (ReadSparseIndex(sparse, middle) < firstVertex)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	for (std::size_t i = first; i < sparse.NumValues; ++i)
+	{
+		std::size_t vertex = ReadSparseIndex(sparse, i);
+		if (vertex >= firstVertex + numVertices)
+			break;
+
+		ConvertElement<NumComponents, T>(sparse.Values + i * NumComponents * sizeof(T), stream.Normalized, output + (vertex - firstVertex) * vertexStride);
+	}
+}
+
+/* Write one attribute of numVertices vertices, output points to the attribute of the first vertex */
+template<uint32_t NumComponents>
+static void AssembleAttribute(const VertexAttributeStream& stream, std::size_t firstVertex, std::size_t numVertices, float* output)
+{
+	switch (stream.ComponentType)
+	{
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_FLOAT:
+		AssembleAttribute<NumComponents, float>(stream, firstVertex, numVertices, output);
+		break;
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_INT8:
+		AssembleAttribute<NumComponents, int8_t>(stream, firstVertex, numVertices, output);
+		break;
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_UINT8:
+		AssembleAttribute<NumComponents, uint8_t>(stream, firstVertex, numVertices, output);
+		break;
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_INT16:
+		AssembleAttribute<NumComponents, int16_t>(stream, firstVertex, numVertices, output);
+		break;
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_UINT16:
+		AssembleAttribute<NumComponents, uint16_t>(stream, firstVertex, numVertices, output);
+		break;
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_UINT32:
+		AssembleAttribute<NumComponents, uint32_t>(stream, firstVertex, numVertices, output);
+		break;
+	}
+}
+
+static void AssembleVerticesScalar(const VertexStreams& streams, std::size_t firstVertex, std::size_t numVertices, Vertex* output)
+{
+	AssembleAttribute<3>(streams.Position, firstVertex, numVertices, &output[firstVertex].Position.x);
+	AssembleAttribute<2>(streams.TexCoord, firstVertex, numVertices, &output[firstVertex].TexCoord.x);
+	AssembleAttribute<3>(streams.Normal, firstVertex, numVertices, &output[firstVertex].Normal.x);
+}
+
+template<typename TInput, typename TOutput>
+static void ConvertIndices(const IndexStream& stream, uint32_t baseVertex, TOutput* output)
+{
+	for (std::size_t i = 0; i < stream.NumIndices; ++i)
+	{
+		TInput index;
+		std::memcpy(&index, stream.Data + i * sizeof(TInput), sizeof(TInput));
+		output[i] = static_cast<TOutput>(baseVertex + index);
+	}
+}
+
+template<typename TOutput>
+static void AssembleIndicesAs(const IndexStream& stream, uint32_t baseVertex, TOutput* output)
+{
+	switch (stream.ComponentType)
+	{
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_UINT8:
+		ConvertIndices<uint8_t>(stream, baseVertex, output);
+		break;
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_UINT16:
+		ConvertIndices<uint16_t>(stream, baseVertex, output);
+		break;
+	case VertexComponentType::VERTEX_COMPONENT_TYPE_UINT32:
+		ConvertIndices<uint32_t>(stream, baseVertex, output);
+		break;
+	default:
+		LOG_ERR("Index component type is not supported");
+		break;
+	}
+}
+
+static bool IsDenseFloat(const VertexAttributeStream& stream)
+{
+	return stream.ComponentType == VertexComponentType::VERTEX_COMPONENT_TYPE_FLOAT && stream.Data && stream.Sparse.NumValues == 0;
+}
+
+/* Box of the positions and the largest squared distance of a position to the center, in a single pass */
+static void ScanPositions(const Vertex* vertices, std::size_t numVertices, const glm::vec3& center, glm::vec3& boundsMin, glm::vec3& boundsMax,
+	float& maxDistanceSquared)
+{
+	boundsMin = glm::vec3(std::numeric_limits<float>::max());
+	boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+	maxDistanceSquared = 0.0f;
+	std::size_t numSIMDVertices = 0;
+
+#ifdef VERTEX_ASSEMBLY_SSE2
+	// Four positions are transposed into x, y and z registers, the fourth float of each load is the texture coordinate u
+	numSIMDVertices = numVertices & ~std::size_t(3);
+
+	__m128 minX = _mm_set1_ps(boundsMin.x), minY = minX, minZ = minX;
+	__m128 maxX = _mm_set1_ps(boundsMax.x), maxY = maxX, maxZ = maxX;
+	__m128 centerX = _mm_set1_ps(center.x), centerY = _mm_set1_ps(center.y), centerZ = _mm_set1_ps(center.z);
+	__m128 maxDistance = _mm_setzero_ps();
+
+	for (std::size_t i = 0; i < numSIMDVertices; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&vertices[i].Position.x);
+		__m128 y = _mm_loadu_ps(&vertices[i + 1].Position.x);
+		__m128 z = _mm_loadu_ps(&vertices[i + 2].Position.x);
+		__m128 u = _mm_loadu_ps(&vertices[i + 3].Position.x);
+		_MM_TRANSPOSE4_PS(x, y, z, u);
+
+		minX = _mm_min_ps(minX, x);
+		minY = _mm_min_ps(minY, y);
+		minZ = _mm_min_ps(minZ, z);
+		maxX = _mm_max_ps(maxX, x);
+		maxY = _mm_max_ps(maxY, y);
+		maxZ = _mm_max_ps(maxZ, z);
+
+		__m128 dx = _mm_sub_ps(x, centerX);
+		__m128 dy = _mm_sub_ps(y, centerY);
+		__m128 dz = _mm_sub_ps(z, centerZ);
+		maxDistance = _mm_max_ps(maxDistance, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+	}
+
+	alignas(16) float lanes[7][4];
+	_mm_store_ps(lanes[0], minX);
+	_mm_store_ps(lanes[1], minY);
+	_mm_store_ps(lanes[2], minZ);
+	_mm_store_ps(lanes[3], maxX);
+	_mm_store_ps(lanes[4], maxY);
+	_mm_store_ps(lanes[5], maxZ);
+	_mm_store_ps(lanes[6], maxDistance);
+
+	for (uint32_t lane = 0; lane < 4; ++lane)
+	{
+		boundsMin = glm::min(boundsMin, glm::vec3(lanes[0][lane], lanes[1][lane], lanes[2][lane]));
+		boundsMax = glm::max(boundsMax, glm::vec3(lanes[3][lane], lanes[4][lane], lanes[5][lane]));
+		maxDistanceSquared = std::max(maxDistanceSquared, lanes[6][lane]);
+	}
+#endif
+
+	for (std::size_t i = numSIMDVertices; i < numVertices; ++i)
+	{
+		glm::vec3 offset = vertices[i].Position - center;
+		boundsMin = glm::min(boundsMin, vertices[i].Position);
+		boundsMax = glm::max(boundsMax, vertices[i].Position);
+		maxDistanceSquared = std::max(maxDistanceSquared, glm::dot(offset, offset));
+	}
+}
+
+void VertexAssembly::AssembleScalar(const VertexStreams& streams, Vertex* output)
+{
+	AssembleVerticesScalar(streams, 0, streams.NumVertices, output);
+}
+
+void VertexAssembly::AssembleIndices(const IndexStream& stream, uint32_t baseVertex, uint32_t outputIndexByteSize, void* output)
+{
+	if (outputIndexByteSize == sizeof(uint16_t))
+		AssembleIndicesAs(stream, baseVertex, static_cast<uint16_t*>(output));
+	else
+		AssembleIndicesAs(stream, baseVertex, static_cast<uint32_t*>(output));
+}
+
+void VertexAssembly::Assemble(const VertexStreams& streams, Vertex* output)
+{
+#ifdef VERTEX_ASSEMBLY_SSE2
+	static_assert(sizeof(Vertex) == 8 * sizeof(float), "SIMD vertex assembly expects a tightly packed 32 byte vertex");
+
+	// Quantized and sparse attributes take the scalar path
+	if (IsDenseFloat(streams.Position) && IsDenseFloat(streams.TexCoord) && IsDenseFloat(streams.Normal) && streams.NumVertices > 0)
+	{
+		const unsigned char* position = streams.Position.Data;
+		const unsigned char* texCoord = streams.TexCoord.Data;
+		const unsigned char* normal = streams.Normal.Data;
+		float* dest = &output[0].Position.x;
+
+		// Positions and normals are loaded as 4 floats, reading one float past the element.
+		// That float belongs to the next element for every vertex but the last, so the last vertex is assembled separately.
+		std::size_t numSIMDVertices = streams.NumVertices - 1;
+
+		for (std::size_t i = 0; i < numSIMDVertices; ++i)
+		{
+			__m128 pos = _mm_loadu_ps(reinterpret_cast<const float*>(position));
+			__m128 uv = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(texCoord)));
+			__m128 nrm = _mm_loadu_ps(reinterpret_cast<const float*>(normal));
+
+			// [px py pz u]
+			__m128 zu = _mm_shuffle_ps(pos, uv, _MM_SHUFFLE(0, 0, 2, 2));
+			__m128 lo = _mm_shuffle_ps(pos, zu, _MM_SHUFFLE(2, 0, 1, 0));
+			// [v nx ny nz]
+			__m128 vx = _mm_shuffle_ps(uv, nrm, _MM_SHUFFLE(0, 0, 1, 1));
+			__m128 hi = _mm_shuffle_ps(vx, nrm, _MM_SHUFFLE(2, 1, 2, 0));
+
+#ifdef __AVX__
+			_mm256_storeu_ps(dest, _mm256_set_m128(hi, lo));
+#else
+			_mm_storeu_ps(dest, lo);
+			_mm_storeu_ps(dest + 4, hi);
+#endif
+
+			position += streams.Position.ByteStride;
+			texCoord += streams.TexCoord.ByteStride;
+			normal += streams.Normal.ByteStride;
+			dest += 8;
+		}
+
+		AssembleVerticesScalar(streams, numSIMDVertices, 1, output);
+		return;
+	}
+#endif
+
+	AssembleScalar(streams, output);
+}
+
+bool VertexAssembly::ComputeBounds(const Vertex* vertices, std::size_t numVertices, const VertexBounds* accessorBounds, VertexBounds& bounds)
+{
+	bounds = VertexBounds();
+	if (numVertices == 0)
+		return true;
+
+	// The sphere is centered on the accessor box, so the box and the sphere radius come from the same pass
+	float maxDistanceSquared = 0.0f;
+	if (accessorBounds)
+	{
+		glm::vec3 center = (accessorBounds->Min + accessorBounds->Max) * 0.5f;
+		ScanPositions(vertices, numVertices, center, bounds.Min, bounds.Max, maxDistanceSquared);
+
+		// Accessor bounds are converted from JSON, so they may be rounded a little from the positions they were written for
+		glm::vec3 tolerance = (accessorBounds->Max - accessorBounds->Min) * 1e-4f + 1e-6f;
+		bool isMatch = glm::all(glm::lessThanEqual(glm::abs(bounds.Min - accessorBounds->Min), tolerance)) &&
+			glm::all(glm::lessThanEqual(glm::abs(bounds.Max - accessorBounds->Max), tolerance));
+
+		if (isMatch)
+		{
+			bounds.SphereCenter = center;
+			bounds.SphereRadius = std::sqrt(maxDistanceSquared);
+			return true;
+		}
+	}
+	else
+	{
+		ScanPositions(vertices, numVertices, glm::vec3(0.0f), bounds.Min, bounds.Max, maxDistanceSquared);
+	}
+
+	// The sphere is centered on the box of the positions, which takes a second pass
+	glm::vec3 boundsMin, boundsMax;
+	bounds.SphereCenter = (bounds.Min + bounds.Max) * 0.5f;
+	ScanPositions(vertices, numVertices, bounds.SphereCenter, boundsMin, boundsMax, maxDistanceSquared);
+	bounds.SphereRadius = std::sqrt(maxDistanceSquared);
+
+	return !accessorBounds;
+}
@@ -0,0 +1,200 @@
+#include "Pch.h"
+#include "Resource/VertexCompression.h"
+
+using namespace VertexCompressionShared;
+
+// Largest angle between a unit normal and its snorm16x2 octahedral encoding, 6.4e-5 measured over a dense sphere sampling
+static constexpr float OCTAHEDRAL_NORMAL_MAX_ANGLE = 1.0e-4f;
+// Renormalizing an already normalized float normal
+static constexpr float NORMALIZE_MAX_ANGLE = 1.0e-6f;
+// Half floats round to nearest with 10 explicit mantissa bits
+static constexpr float HALF_MAX_RELATIVE_ERROR = 1.0f / 2048.0f;
+
+template<typename TCompressedVertex>
+static void EncodeVertexAttributes(const Vertex& vertex, TCompressedVertex& output)
+{
+	output.TexCoord = EncodeHalf2(vertex.TexCoord);
+	output.Normal = EncodeOctahedralNormal(vertex.Normal);
+}
+
+template<typename TCompressedVertex>
+static void DecodeVertexAttributes(const TCompressedVertex& vertex, Vertex& output)
+{
+	output.TexCoord = DecodeHalf2(vertex.TexCoord);
+	output.Normal = DecodeOctahedralNormal(vertex.Normal);
+}
+
+std::size_t VertexCompression::GetVertexByteSize(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::VERTEX_FORMAT_FLOAT:
+		return sizeof(Vertex);
+	case VertexFormat::VERTEX_FORMAT_COMPACT:
+		return sizeof(CompactVertex);
+	case VertexFormat::VERTEX_FORMAT_QUANTIZED:
+		return sizeof(QuantizedVertex);
+	default:
+		ASSERT(false, "Unknown vertex format");
+		return 0;
+	}
+}
+
+PositionQuantization VertexCompression::ComputePositionQuantization(const Vertex* vertices, std::size_t numVertices)
+{
+	if (numVertices == 0)
+		return PositionQuantization();
+
+	glm::vec3 boundsMin = vertices[0].Position;
+	glm::vec3 boundsMax = vertices[0].Position;
+
+	for (std::size_t i = 1; i < numVertices; ++i)
+	{
+		boundsMin = glm::min(boundsMin, vertices[i].Position);
+		boundsMax = glm::max(boundsMax, vertices[i].Position);
+	}
+
+	return ComputePositionQuantization(boundsMin, boundsMax);
+}
+
+PositionQuantization VertexCompression::ComputePositionQuantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	PositionQuantization quantization;
+	quantization.Min = boundsMin;
+	quantization.Extent = boundsMax - boundsMin;
+
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		if (quantization.Extent[axis] <= 0.0f)
+			quantization.Extent[axis] = 1.0f;
+	}
+
+	return quantization;
+}
+
+void VertexCompression::Compress(const Vertex* vertices, std::size_t numVertices, VertexFormat format, const PositionQuantization& quantization, void* output)
+{
+	switch (format)
+	{
+	case VertexFormat::VERTEX_FORMAT_FLOAT:
+	{
+		memcpy(output, vertices, numVertices * sizeof(Vertex));
+		break;
+	}
+	case VertexFormat::VERTEX_FORMAT_COMPACT:
+	{
+		CompactVertex* compact = static_cast<CompactVertex*>(output);
+
+		for (std::size_t i = 0; i < numVertices; ++i)
+		{
+			compact[i].Position = vertices[i].Position;
+			EncodeVertexAttributes(vertices[i], compact[i]);
+		}
+		break;
+	}
+	case VertexFormat::VERTEX_FORMAT_QUANTIZED:
+	{
+		QuantizedVertex* quantized = static_cast<QuantizedVertex*>(output);
+
+		for (std::size_t i = 0; i < numVertices; ++i)
+		{
+			quantized[i].Position = EncodeQuantizedPosition(vertices[i].Position, quantization.Min, quantization.Extent);
+			EncodeVertexAttributes(vertices[i], quantized[i]);
+		}
+		break;
+	}
+	default:
+		ASSERT(false, "Unknown vertex format");
+	}
+}
+
+void VertexCompression::Decompress(const void* compressed, std::size_t numVertices, VertexFormat format, const PositionQuantization& quantization, Vertex* output)
+{
+	switch (format)
+	{
+	case VertexFormat::VERTEX_FORMAT_FLOAT:
+	{
+		memcpy(output, compressed, numVertices * sizeof(Vertex));
+		break;
+	}
+	case VertexFormat::VERTEX_FORMAT_COMPACT:
+	{
+		const CompactVertex* compact = static_cast<const CompactVertex*>(compressed);
+
+		for (std::size_t i = 0; i < numVertices; ++i)
+		{
+			output[i].Position = compact[i].Position;
+			DecodeVertexAttributes(compact[i], output[i]);
+		}
+		break;
+	}
+	case VertexFormat::VERTEX_FORMAT_QUANTIZED:
+	{
+		const QuantizedVertex* quantized = static_cast<const QuantizedVertex*>(compressed);
+
+		for (std::size_t i = 0; i < numVertices; ++i)
+		{
+			output[i].Position = DecodeQuantizedPosition(quantized[i].Position, quantization.Min, quantization.Extent);
+			DecodeVertexAttributes(quantized[i], output[i]);
+		}
+		break;
+	}
+	default:
+		ASSERT(false, "Unknown vertex format");
+	}
+}
+
+VertexCompressionError VertexCompression::GetErrorBounds(VertexFormat format, const PositionQuantization& quantization)
+{
+	VertexCompressionError bounds;
+	bounds.MaxNormalAngle = NORMALIZE_MAX_ANGLE;
+
+	if (format == VertexFormat::VERTEX_FORMAT_FLOAT)
+		return bounds;
+
+	bounds.MaxNormalAngle = OCTAHEDRAL_NORMAL_MAX_ANGLE;
+	bounds.MaxTexCoordError = HALF_MAX_RELATIVE_ERROR;
+
+	if (format == VertexFormat::VERTEX_FORMAT_QUANTIZED)
+	{
+		// Half a quantization step from rounding, the other half covers the float error of decoding
+		float maxExtent = std::max(quantization.Extent.x, std::max(quantization.Extent.y, quantization.Extent.z));
+		bounds.MaxPositionError = maxExtent / 65535.0f;
+	}
+
+	return bounds;
+}
+
+VertexCompressionError VertexCompression::MeasureError(const Vertex* vertices, std::size_t numVertices, const void* compressed, VertexFormat format,
+	const PositionQuantization& quantization)
+{
+	std::vector<Vertex> decompressed(numVertices);
+	Decompress(compressed, numVertices, format, quantization, decompressed.data());
+
+	VertexCompressionError error;
+
+	for (std::size_t i = 0; i < numVertices; ++i)
+	{
+		const Vertex& original = vertices[i];
+		const Vertex& decoded = decompressed[i];
+
+		glm::vec3 positionError = glm::abs(decoded.Position - original.Position);
+		error.MaxPositionError = std::max(error.MaxPositionError, std::max(positionError.x, std::max(positionError.y, positionError.z)));
+
+		glm::vec2 texCoordError = glm::abs(decoded.TexCoord - original.TexCoord) / glm::max(glm::abs(original.TexCoord), glm::vec2(1.0f));
+		error.MaxTexCoordError = std::max(error.MaxTexCoordError, std::max(texCoordError.x, texCoordError.y));
+
+		// Zero length normals have no direction to preserve
+		float normalLength = glm::length(original.Normal);
+		if (normalLength > 0.0f)
+		{
+			// atan2 stays accurate for the tiny angles where acos of the dot product would not
+			glm::vec3 originalNormal = original.Normal / normalLength;
+			glm::vec3 decodedNormal = glm::normalize(decoded.Normal);
+			float angle = std::atan2(glm::length(glm::cross(originalNormal, decodedNormal)), glm::dot(originalNormal, decodedNormal));
+			error.MaxNormalAngle = std::max(error.MaxNormalAngle, angle);
+		}
+	}
+
+	return error;
+}
@@ -1,175 +1,657 @@
 #include "Pch.h"
 #include "ResourceLoader.h"
+#include "Resource/AssetRegistry.h"
+#include "Resource/BufferUploader.h"
+#include "Resource/ModelCooker.h"
+#include "Resource/VertexCompression.h"
 #include "Graphics/Buffer.h"
 #include "Graphics/Texture.h"
+#include "Graphics/Backend/CommandList.h"
+#include "Graphics/Backend/RenderBackend.h"
+#include "Util/Hash.h"
 
-#define TINYGLTF_IMPLEMENTATION
-#define TINYGLTF_USE_CPP14
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#define STBI_MSC_SECURE_CRT
-#include "tinygltf/tiny_gltf.h"
+static AssetRegistry s_AssetRegistry("Assets");
 
-Model ResourceLoader::LoadGLTF(const std::string& filepath)
+/* Streamed textures are created without data, their mips are uploaded later from the image. Other textures record their upload
+   on the upload command list, or wait for it on the copy queue without one */
+static std::shared_ptr<Texture> CreateTexture(const ImageData& image, bool stream, CommandList* uploadCommandList)
 {
-	tinygltf::Model tinygltf;
-	tinygltf::TinyGLTF loader;
-	std::string err;
-	std::string warn;
+	TextureDesc textureDesc(TextureUsage::TEXTURE_USAGE_READ, image.Format, image.Width, image.Height, image.NumMipLevels);
+	const void* textureData = image.Pixels;
 
-	bool result = loader.LoadASCIIFromFile(&tinygltf, &err, &warn, filepath);
-	if (!warn.empty())
-		LOG_WARN(warn);
-	if (!err.empty())
-		LOG_ERR(err);
+	uint32_t whiteTextureData = 0xFFFFFFFF;
+	if (!image.Pixels)
+	{
+		textureDesc = TextureDesc(TextureUsage::TEXTURE_USAGE_READ, TextureFormat::TEXTURE_FORMAT_RGBA8_UNORM, 1, 1);
+		textureData = &whiteTextureData;
+	}
+
+	if (stream && image.Pixels)
+		return std::make_shared<Texture>("Albedo texture", textureDesc);
+
+	if (!uploadCommandList)
+		return std::make_shared<Texture>("Albedo texture", textureDesc, textureData);
+
+	auto texture = std::make_shared<Texture>("Albedo texture", textureDesc);
+	Buffer uploadBuffer(texture->GetName() + " - Upload buffer", BufferDesc(BufferUsage::BUFFER_USAGE_UPLOAD, 1, texture->GetByteSize()));
+	uploadCommandList->CopyTexture(uploadBuffer, *texture, textureData);
+
+	return texture;
+}
+
+static std::shared_ptr<Buffer> CreateBuffer(const std::string& name, const BufferDesc& bufferDesc, const void* bufferData, CommandList* uploadCommandList)
+{
+	if (!uploadCommandList)
+		return std::make_shared<Buffer>(name, bufferDesc, bufferData);
+
+	auto buffer = std::make_shared<Buffer>(name, bufferDesc);
+	Buffer uploadBuffer(name + " - Upload buffer", BufferDesc(BufferUsage::BUFFER_USAGE_UPLOAD, 1, buffer->GetByteSize()));
+	uploadCommandList->CopyBuffer(uploadBuffer, *buffer, bufferData);
+
+	return buffer;
+}
+
+/* Copy every buffer through a single upload buffer of at most maxUploadByteSize bytes, waiting for each chunk on the copy queue */
+static void SubmitBufferUploadsAndWait(std::vector<BufferUpload>& uploads, std::size_t maxUploadByteSize)
+{
+	std::unique_ptr<Buffer> uploadBuffer;
+
+	BufferUploader::StageUploads(uploads, maxUploadByteSize,
+		[&uploadBuffer](std::size_t byteSize) {
+			uploadBuffer = std::make_unique<Buffer>("Model upload buffer", BufferDesc(BufferUsage::BUFFER_USAGE_UPLOAD, 1, byteSize));
+			return static_cast<unsigned char*>(uploadBuffer->GetCPUPointer());
+		},
+		[&uploadBuffer, &uploads](const BufferUploadChunk& chunk, std::size_t byteOffset) {
+			RenderBackend::CopyBufferRegion(*uploadBuffer, chunk.UploadOffset, *uploads[chunk.UploadIndex].Destination, byteOffset, chunk.ByteSize);
+		});
+
+	uploads.clear();
+}
+
+/* Compressed textures are reloaded from their cooked texture, every compressed image of a cacheable texture was cooked. Other
+   textures keep the image they were created from as their CPU data */
+static AssetDesc CreateTextureAssetDesc(const std::shared_ptr<Texture>& texture, const ImageData& image, const std::string& directory, uint64_t contentHash)
+{
+	AssetDesc desc;
+	desc.Resource = texture;
+	desc.GPUByteSize = texture->GetByteSize();
+
+	if (IsBlockCompressed(image.Format))
+	{
+		desc.IsReloadableFromSource = true;
+		desc.Reload = [directory, contentHash](const std::shared_ptr<const void>&) -> std::shared_ptr<void> {
+			ImageData cookedImage;
+			if (!ModelCooker::LoadCookedTexture(directory, contentHash, cookedImage))
+				return nullptr;
+
+			return CreateTexture(cookedImage, false, nullptr);
+		};
+
+		return desc;
+	}
+
+	desc.CPUData = image.Storage;
+	desc.CPUByteSize = MipGenerator::GetMipChainByteSize(image.Width, image.Height, image.NumMipLevels);
+
+	// The pixels stay valid while the CPU data is passed in, the reload function itself must not keep the CPU data alive
+	ImageData imageView = image;
+	imageView.Storage = nullptr;
+	desc.Reload = [imageView](const std::shared_ptr<const void>& cpuData) -> std::shared_ptr<void> {
+		if (!cpuData)
+			return nullptr;
+
+		return CreateTexture(imageView, false, nullptr);
+	};
+
+	return desc;
+}
 
-	ASSERT(result, "Failed to parse glTF model: " + filepath);
+static void CreateModelTexture(ModelData& data, uint32_t textureIndex, const std::string& directory, const ModelLoadDesc& loadDesc,
+	CommandList* uploadCommandList)
+{
+	ModelTextureData& texture = data.Textures[textureIndex];
+	if (texture.Resource)
+		return;
+
+	if (texture.DuplicateOf >= 0)
+	{
+		// Counts towards the cache hits, like any other texture that is shared by content
+		if (texture.IsCacheable && texture.Image.Pixels)
+			texture.Resource = s_AssetRegistry.Find<Texture>(texture.ContentHash);
+		if (!texture.Resource)
+			texture.Resource = data.Textures[texture.DuplicateOf].Resource;
+		return;
+	}
+
+	bool stream = loadDesc.StreamTextures && texture.Image.Pixels;
+	std::shared_ptr<Texture> resource = CreateTexture(texture.Image, stream, uploadCommandList);
+	texture.Resource = resource;
+
+	// Failed decodes get a white texture, which should not be shared under the content hash of the image
+	if (texture.IsCacheable && texture.Image.Pixels)
+		texture.Resource = s_AssetRegistry.Insert<Texture>(texture.ContentHash, CreateTextureAssetDesc(resource, texture.Image, directory, texture.ContentHash));
+
+	// Another load can have created the same texture since the image was built, its mips are already on their way
+	if (stream && texture.Resource == resource)
+	{
+		StreamedTexture streamedTexture;
+		streamedTexture.TextureIndex = textureIndex;
+		streamedTexture.MipData = texture.Image.Pixels;
+		streamedTexture.Storage = texture.Image.Storage;
+		data.StreamedTextures.push_back(streamedTexture);
+	}
+}
+
+/* Content hashes the vertex and index buffers of a model are shared under */
+struct ModelBufferKeys
+{
+	uint64_t VertexBuffer = 0;
+	uint64_t IndexBuffer = 0;
+};
+
+/* Cooked models are keyed by the hash of their sources and the options they were cooked with, so their mapped vertices and indices
+   are not read in just to hash them. Other models hash their cooked vertices, which the vertices of every format are encoded from */
+static ModelBufferKeys GetModelBufferKeys(const ModelData& data, VertexFormat vertexFormat)
+{
+	const CookedModelData& cooked = data.Cooked;
+	ModelBufferKeys keys;
+
+	if (cooked.SourceHash != 0)
+	{
+		uint64_t modelHash = Hash::Combine(cooked.SourceHash, static_cast<uint64_t>(cooked.Flags));
+		keys.VertexBuffer = Hash::Combine(Hash::Combine(modelHash, 1), static_cast<uint64_t>(vertexFormat));
+		keys.IndexBuffer = Hash::Combine(modelHash, 2);
+		return keys;
+	}
+
+	keys.VertexBuffer = Hash::Combine(Hash::Hash64(cooked.Vertices, cooked.NumVertices * sizeof(Vertex)), static_cast<uint64_t>(vertexFormat));
+	keys.IndexBuffer = Hash::Combine(Hash::Hash64(cooked.Indices, cooked.NumIndices * cooked.IndexByteSize), cooked.IndexByteSize);
+	return keys;
+}
+
+/* Buffers are only shared once their uploads completed, so a load that finds them has nothing left to upload. Buffers have
+   no CPU copy and are forgotten when they are evicted */
+static void RegisterModelBuffers(Model& model, const ModelBufferKeys& bufferKeys)
+{
+	AssetDesc vertexBufferDesc;
+	vertexBufferDesc.Resource = model.VertexBuffer;
+	vertexBufferDesc.GPUByteSize = model.VertexBuffer->GetByteSize();
+	model.VertexBuffer = s_AssetRegistry.Insert<Buffer>(bufferKeys.VertexBuffer, vertexBufferDesc);
+
+	AssetDesc indexBufferDesc;
+	indexBufferDesc.Resource = model.IndexBuffer;
+	indexBufferDesc.GPUByteSize = model.IndexBuffer->GetByteSize();
+	model.IndexBuffer = s_AssetRegistry.Insert<Buffer>(bufferKeys.IndexBuffer, indexBufferDesc);
+}
 
+/* Create the GPU resources of a model on the render thread. Uploads are recorded on the upload command list, without one every
+   upload waits on the copy queue. Vertex and index buffers that are copied in chunks are added to the buffer uploads, which
+   copy from the model data, buffers with the same content as those of a loaded model are shared instead */
+static Model CreateModel(ModelData& data, const std::string& directory, const ModelLoadDesc& loadDesc, const ModelBufferKeys& bufferKeys,
+	CommandList* uploadCommandList, std::vector<BufferUpload>& bufferUploads)
+{
 	Model model;
+	model.Materials = data.Materials;
+	model.Submeshes = data.Cooked.Submeshes;
+	model.LODs = data.Cooked.LODs;
+	model.Meshlets = data.Cooked.Meshlets;
+	model.MeshletVertices = data.Cooked.MeshletVertices;
+	model.MeshletTriangles = data.Cooked.MeshletTriangles;
+
+	for (uint32_t i = 0; i < data.Textures.size(); ++i)
+	{
+		CreateModelTexture(data, i, directory, loadDesc, uploadCommandList);
+		model.Textures.push_back(data.Textures[i].Resource);
+	}
+
+	model.StreamedTextures = data.StreamedTextures;
+
+	model.VertexBufferFormat = loadDesc.VertexBufferFormat;
+	model.VertexQuantization = data.VertexQuantization;
+
+	const CookedModelData& cooked = data.Cooked;
+	BufferDesc vertexBufferDesc(BufferUsage::BUFFER_USAGE_VERTEX | BufferUsage::BUFFER_USAGE_READ, cooked.NumVertices,
+		VertexCompression::GetVertexByteSize(loadDesc.VertexBufferFormat));
+	BufferDesc indexBufferDesc(BufferUsage::BUFFER_USAGE_INDEX | BufferUsage::BUFFER_USAGE_READ, cooked.NumIndices, cooked.IndexByteSize);
+
+	// Vertices in the compact formats are encoded from the cooked vertices as they are staged
+	BufferUpload vertexUpload = BufferUploader::GetVertexBufferUpload(data, loadDesc.VertexBufferFormat);
+	BufferUpload indexUpload = BufferUploader::GetIndexBufferUpload(data);
 
-	for (uint32_t matIndex = 0; matIndex < tinygltf.materials.size(); ++matIndex)
+	model.VertexBuffer = s_AssetRegistry.Find<Buffer>(bufferKeys.VertexBuffer);
+	model.IndexBuffer = s_AssetRegistry.Find<Buffer>(bufferKeys.IndexBuffer);
+
+	if (loadDesc.MaxUploadByteSize == 0)
 	{
-		auto& material = tinygltf.materials[matIndex];
-		int baseColorTextureIndex = material.pbrMetallicRoughness.baseColorTexture.index;
-		int normalTextureIndex = material.normalTexture.index;
+		if (!model.VertexBuffer)
+		{
+			// Without a limit the whole vertex buffer is encoded at once
+			std::vector<unsigned char> encodedVertices;
+			const void* vertexData = cooked.Vertices;
+
+			if (vertexUpload.EncodedFormat != VertexFormat::VERTEX_FORMAT_FLOAT)
+			{
+				encodedVertices.resize(vertexUpload.ByteSize);
+				BufferUploader::StageChunk(vertexUpload, vertexUpload.ByteSize, encodedVertices.data());
+				vertexData = encodedVertices.data();
+			}
+
+			model.VertexBuffer = CreateBuffer("Vertex buffer", vertexBufferDesc, vertexData, uploadCommandList);
+		}
+
+		if (!model.IndexBuffer)
+			model.IndexBuffer = CreateBuffer("Index buffer", indexBufferDesc, cooked.Indices, uploadCommandList);
+		return model;
+	}
+
+	// The buffers are created empty and copied in chunks, by SubmitBufferUploadsAndWait or over the next updates of the loader
+	if (!model.VertexBuffer)
+	{
+		model.VertexBuffer = std::make_shared<Buffer>("Vertex buffer", vertexBufferDesc);
+		vertexUpload.Destination = model.VertexBuffer;
+		bufferUploads.push_back(vertexUpload);
+	}
+
+	if (!model.IndexBuffer)
+	{
+		model.IndexBuffer = std::make_shared<Buffer>("Index buffer", indexBufferDesc);
+		indexUpload.Destination = model.IndexBuffer;
+		bufferUploads.push_back(indexUpload);
+	}
+
+	return model;
+}
+
+static void LogAssetRegistryStats()
+{
+	AssetRegistryStats stats = s_AssetRegistry.GetStats();
+	LOG_INFO("[ResourceManager] Assets: " + std::to_string(stats.NumHits) + " hits, " + std::to_string(stats.NumMisses) + " misses, " +
+		std::to_string(stats.NumBytesSaved / (1024 * 1024)) + " MB saved, " + std::to_string(stats.NumReloads) + " reloads, " +
+		std::to_string(stats.NumEvictions) + " evictions, GPU " + std::to_string(stats.GPUByteSize / (1024 * 1024)) + "/" +
+		std::to_string(stats.Budget.MaxGPUByteSize / (1024 * 1024)) + " MB, CPU " + std::to_string(stats.CPUByteSize / (1024 * 1024)) + "/" +
+		std::to_string(stats.Budget.MaxCPUByteSize / (1024 * 1024)) + " MB");
+}
+
+void ResourceLoader::SetAssetBudget(const AssetBudget& budget)
+{
+	s_AssetRegistry.SetBudget(budget);
+}
+
+AssetRegistryStats ResourceLoader::GetAssetRegistryStats()
+{
+	return s_AssetRegistry.GetStats();
+}
+
+Model ResourceLoader::LoadGLTF(const std::string& filepath, const ModelLoadDesc& loadDesc)
+{
+	ModelData data;
+
+	std::string directory = ModelCache::GetDirectory(filepath);
+
+	// Textures are created as soon as their image is built, while the decode pool keeps building the others. Evicted textures
+	// are reloaded by the registry, since this thread creates the textures anyway
+	ModelCookCallbacks callbacks;
+	callbacks.FindTexture = [](uint64_t contentHash) { return s_AssetRegistry.Acquire<Texture>(contentHash); };
+	callbacks.OnTextureBuilt = [&data, &directory, &loadDesc](uint32_t textureIndex) { CreateModelTexture(data, textureIndex, directory, loadDesc, nullptr); };
+
+	bool result = ModelCooker::Cook(filepath, loadDesc, nullptr, callbacks, data);
+	ASSERT(result, "Failed to load glTF model: " + filepath);
+
+	ModelBufferKeys bufferKeys = GetModelBufferKeys(data, loadDesc.VertexBufferFormat);
+	std::vector<BufferUpload> bufferUploads;
+	Model model = CreateModel(data, directory, loadDesc, bufferKeys, nullptr, bufferUploads);
+	SubmitBufferUploadsAndWait(bufferUploads, loadDesc.MaxUploadByteSize);
+	RegisterModelBuffers(model, bufferKeys);
+	LogAssetRegistryStats();
+
+	return model;
+}
+
+struct ModelLoadRequest
+{
+	std::string Filepath;
+	ModelLoadDesc LoadDesc;
+	// Requests with the same priority are loaded in the order they were made
+	uint64_t RequestIndex = 0;
+
+	std::atomic<int32_t> Priority{ 0 };
+	std::atomic<ModelLoadStatus> Status{ ModelLoadStatus::MODEL_LOAD_STATUS_PENDING };
+	std::atomic_bool IsCancelled{ false };
+
+	// Written by the loader thread before it hands the request to Update, which releases it on the render thread
+	std::unique_ptr<ModelData> Data;
+	bool IsLoaded = false;
+	// Hashed on the loader thread, the buffers are registered under them once the model is published
+	ModelBufferKeys BufferKeys;
+	// Vertex and index buffer copies that were not submitted yet, they copy from the model data
+	std::vector<BufferUpload> BufferUploads;
+
+	Model Result;
+	uint64_t UploadFenceValue = 0;
+
+	std::promise<Model> Promise;
+	std::shared_future<Model> Future;
+};
+
+struct AsyncLoaderData
+{
+	std::thread Thread;
+	std::mutex Mutex;
+	std::condition_variable RequestAvailableCV;
+	bool Stop = false;
+
+	// Guarded by the mutex
+	std::vector<std::shared_ptr<ModelLoadRequest>> PendingRequests;
+	std::shared_ptr<ModelLoadRequest> LoadingRequest;
+	std::vector<std::shared_ptr<ModelLoadRequest>> LoadedRequests;
+
+	// Only used on the render thread
+	std::vector<std::shared_ptr<ModelLoadRequest>> UploadingRequests;
+	uint64_t NumRequests = 0;
+
+	// Upload memory of the buffer chunks in flight on the copy queue, with the fence value that releases it
+	std::vector<std::pair<uint64_t, std::size_t>> InFlightUploads;
+	std::size_t NumUploadBytesInFlight = 0;
+
+	~AsyncLoaderData()
+	{
+		ResourceLoader::Finalize();
+	}
+};
+
+static AsyncLoaderData s_AsyncLoader;
+
+ModelLoadStatus ModelLoadHandle::GetStatus() const
+{
+	return m_Request->Status;
+}
+
+bool ModelLoadHandle::IsDone() const
+{
+	ModelLoadStatus status = m_Request->Status;
+	return status == ModelLoadStatus::MODEL_LOAD_STATUS_LOADED || status == ModelLoadStatus::MODEL_LOAD_STATUS_CANCELLED ||
+		status == ModelLoadStatus::MODEL_LOAD_STATUS_FAILED;
+}
+
+void ModelLoadHandle::Cancel()
+{
+	m_Request->IsCancelled = true;
+}
+
+void ModelLoadHandle::SetPriority(int32_t priority)
+{
+	m_Request->Priority = priority;
+}
+
+std::shared_future<Model> ModelLoadHandle::GetFuture() const
+{
+	return m_Request->Future;
+}
+
+static bool HasHigherPriority(const std::shared_ptr<ModelLoadRequest>& lhs, const std::shared_ptr<ModelLoadRequest>& rhs)
+{
+	int32_t lhsPriority = lhs->Priority, rhsPriority = rhs->Priority;
+	return lhsPriority > rhsPriority || (lhsPriority == rhsPriority && lhs->RequestIndex < rhs->RequestIndex);
+}
+
+static void CompleteLoadRequest(ModelLoadRequest& request, ModelLoadStatus status)
+{
+	// Set before the future is ready, so a thread woken by the future sees the final status
+	request.Status = status;
+	request.Data.reset();
+	request.BufferUploads.clear();
+
+	if (status == ModelLoadStatus::MODEL_LOAD_STATUS_LOADED)
+		RegisterModelBuffers(request.Result, request.BufferKeys);
+
+	request.Promise.set_value(status == ModelLoadStatus::MODEL_LOAD_STATUS_LOADED ? request.Result : Model());
+	request.Result = Model();
+}
+
+static void AsyncLoaderLoop()
+{
+	while (true)
+	{
+		std::shared_ptr<ModelLoadRequest> request;
 
-		if (baseColorTextureIndex >= 0)
 		{
-			uint32_t baseColorImageIndex = tinygltf.textures[baseColorTextureIndex].source;
-			model.Textures.push_back(std::make_shared<Texture>("Albedo texture", TextureDesc(TextureUsage::TEXTURE_USAGE_READ, TextureFormat::TEXTURE_FORMAT_RGBA8_UNORM,
-				tinygltf.images[baseColorImageIndex].width, tinygltf.images[baseColorImageIndex].height), &tinygltf.images[baseColorImageIndex].image[0]));
+			std::unique_lock<std::mutex> lock(s_AsyncLoader.Mutex);
+			s_AsyncLoader.RequestAvailableCV.wait(lock, [] { return s_AsyncLoader.Stop || !s_AsyncLoader.PendingRequests.empty(); });
+
+			if (s_AsyncLoader.Stop)
+				return;
+
+			auto next = std::min_element(s_AsyncLoader.PendingRequests.begin(), s_AsyncLoader.PendingRequests.end(), HasHigherPriority);
+			request = *next;
+			s_AsyncLoader.PendingRequests.erase(next);
+			s_AsyncLoader.LoadingRequest = request;
 		}
-		else
+
+		// Cancelled requests are completed by Update, which also releases anything the load created
+		if (!request->IsCancelled)
 		{
-			uint32_t whiteTextureData = 0xFFFFFFFF;
-			model.Textures.push_back(std::make_shared<Texture>("Albedo texture", TextureDesc(TextureUsage::TEXTURE_USAGE_READ, TextureFormat::TEXTURE_FORMAT_RGBA8_UNORM,
-				1, 1), &whiteTextureData));
+			request->Status = ModelLoadStatus::MODEL_LOAD_STATUS_LOADING;
+
+			ModelCookCallbacks callbacks;
+			// Only resident textures are found, textures are created on the render thread so evicted ones are built again
+			callbacks.FindTexture = [](uint64_t contentHash) { return s_AssetRegistry.Find<Texture>(contentHash); };
+
+			request->Data = std::make_unique<ModelData>();
+			request->IsLoaded = ModelCooker::Cook(request->Filepath, request->LoadDesc, &request->IsCancelled, callbacks, *request->Data);
+			if (request->IsLoaded)
+				request->BufferKeys = GetModelBufferKeys(*request->Data, request->LoadDesc.VertexBufferFormat);
 		}
 
-		// Test
-		break;
+		std::lock_guard<std::mutex> lock(s_AsyncLoader.Mutex);
+		s_AsyncLoader.LoadedRequests.push_back(request);
+		s_AsyncLoader.LoadingRequest = nullptr;
 	}
+}
 
-	std::size_t totalVerticesCount = 0, totalIndicesCount = 0;
+/* Copy the next buffer chunks of the uploading loads, highest priority first, as long as the upload memory in flight stays within
+   the limit of the load */
+static void SubmitBufferUploads()
+{
+	auto& inFlightUploads = s_AsyncLoader.InFlightUploads;
+	std::size_t numCompleted = 0;
+
+	// Fence values complete in order, so the oldest chunks release their upload memory first
+	while (numCompleted < inFlightUploads.size() && RenderBackend::IsFenceComplete(D3D12_COMMAND_LIST_TYPE_COPY, inFlightUploads[numCompleted].first))
+		s_AsyncLoader.NumUploadBytesInFlight -= inFlightUploads[numCompleted++].second;
 
-	std::size_t totalVertexCount = 0;
-	std::size_t totalIndexCount = 0;
+	inFlightUploads.erase(inFlightUploads.begin(), inFlightUploads.begin() + numCompleted);
 
-	for (auto& mesh : tinygltf.meshes)
+	std::vector<std::shared_ptr<ModelLoadRequest>> requests;
+	for (auto& request : s_AsyncLoader.UploadingRequests)
 	{
-		for (auto& prim : mesh.primitives)
+		if (!request->Data)
+			continue;
+
+		// The buffers of a cancelled load are never used, so the rest of their data is not copied
+		if (request->IsCancelled)
 		{
-			uint32_t vertexPosIndex = prim.attributes.find("POSITION")->second;
-			const tinygltf::Accessor& vertexPosAccessor = tinygltf.accessors[vertexPosIndex];
-			totalVertexCount += vertexPosAccessor.count;
+			request->Data.reset();
+			request->BufferUploads.clear();
+		}
+		else
+			requests.push_back(request);
+	}
+
+	std::stable_sort(requests.begin(), requests.end(), HasHigherPriority);
+
+	// Chunks are planned first, so all of them share one upload buffer
+	std::vector<std::pair<ModelLoadRequest*, BufferUploadChunk>> chunks;
+	std::vector<BufferUploadChunk> requestChunks;
+	std::size_t uploadBufferSize = 0;
+
+	for (auto& request : requests)
+	{
+		requestChunks.clear();
+		uploadBufferSize = BufferUploader::PlanChunks(request->BufferUploads, s_AsyncLoader.NumUploadBytesInFlight, uploadBufferSize,
+			request->LoadDesc.MaxUploadByteSize, requestChunks);
+
+		for (auto& chunk : requestChunks)
+			chunks.emplace_back(request.get(), chunk);
+	}
 
-			uint32_t indicesIndex = prim.indices;
-			const tinygltf::Accessor& indexAccessor = tinygltf.accessors[indicesIndex];
-			totalIndexCount += indexAccessor.count;
+	if (chunks.empty())
+		return;
+
+	auto commandList = RenderBackend::GetCommandList(D3D12_COMMAND_LIST_TYPE_COPY);
+	Buffer uploadBuffer("Model upload buffer", BufferDesc(BufferUsage::BUFFER_USAGE_UPLOAD, 1, uploadBufferSize));
+	unsigned char* uploadMemory = static_cast<unsigned char*>(uploadBuffer.GetCPUPointer());
+
+	for (auto& [request, chunk] : chunks)
+	{
+		BufferUpload& upload = request->BufferUploads[chunk.UploadIndex];
+		std::size_t byteOffset = BufferUploader::StageChunk(upload, chunk.ByteSize, uploadMemory + chunk.UploadOffset);
+		commandList->CopyBufferRegion(uploadBuffer, chunk.UploadOffset, *upload.Destination, byteOffset, chunk.ByteSize);
+	}
+
+	uint64_t fenceValue = RenderBackend::ExecuteCommandList(commandList);
+	inFlightUploads.emplace_back(fenceValue, uploadBufferSize);
+	s_AsyncLoader.NumUploadBytesInFlight += uploadBufferSize;
+
+	for (auto& request : requests)
+	{
+		auto& uploads = request->BufferUploads;
+		bool hasSubmittedChunks = std::any_of(chunks.begin(), chunks.end(), [&request](const auto& chunk) { return chunk.first == request.get(); });
+		if (hasSubmittedChunks)
+			request->UploadFenceValue = fenceValue;
+
+		// The model data is only kept until the last chunk is copied out of it
+		if (std::all_of(uploads.begin(), uploads.end(), [](const BufferUpload& upload) { return upload.NumBytesSubmitted == upload.ByteSize; }))
+		{
+			request->Data.reset();
+			uploads.clear();
 		}
 	}
+}
+
+ModelLoadHandle ResourceLoader::LoadGLTFAsync(const std::string& filepath, const ModelLoadDesc& loadDesc, int32_t priority)
+{
+	auto request = std::make_shared<ModelLoadRequest>();
+	request->Filepath = filepath;
+	request->LoadDesc = loadDesc;
+	request->RequestIndex = s_AsyncLoader.NumRequests++;
+	request->Priority = priority;
+	request->Future = request->Promise.get_future().share();
 
-	struct Vertex
 	{
-		glm::vec3 Position;
-		glm::vec2 TexCoord;
-		glm::vec3 Normal;
-	};
+		std::lock_guard<std::mutex> lock(s_AsyncLoader.Mutex);
+		s_AsyncLoader.PendingRequests.push_back(request);
 
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
+		if (!s_AsyncLoader.Thread.joinable())
+		{
+			s_AsyncLoader.Stop = false;
+			s_AsyncLoader.Thread = std::thread(AsyncLoaderLoop);
+		}
+	}
+
+	s_AsyncLoader.RequestAvailableCV.notify_one();
+
+	ModelLoadHandle handle;
+	handle.m_Request = request;
+	return handle;
+}
 
-	vertices.reserve(totalVertexCount);
-	indices.reserve(totalIndexCount);
+void ResourceLoader::Update()
+{
+	std::vector<std::shared_ptr<ModelLoadRequest>> loadedRequests;
+
+	{
+		std::lock_guard<std::mutex> lock(s_AsyncLoader.Mutex);
+		loadedRequests.swap(s_AsyncLoader.LoadedRequests);
+
+		// Cancelled requests the loader thread did not get to yet are completed right away
+		auto& pendingRequests = s_AsyncLoader.PendingRequests;
+		auto cancelled = std::stable_partition(pendingRequests.begin(), pendingRequests.end(), [](const auto& request) { return !request->IsCancelled; });
+		loadedRequests.insert(loadedRequests.end(), cancelled, pendingRequests.end());
+		pendingRequests.erase(cancelled, pendingRequests.end());
+	}
+
+	// The most important model is created first, so its uploads are ahead of the others on the copy queue
+	std::stable_sort(loadedRequests.begin(), loadedRequests.end(), HasHigherPriority);
 
-	for (auto& mesh : tinygltf.meshes)
+	for (auto& request : loadedRequests)
 	{
-		for (auto& prim : mesh.primitives)
+		if (request->IsCancelled)
 		{
-			// Get vertex position data
-			auto vertexPosAttrib = prim.attributes.find("POSITION");
-			ASSERT(vertexPosAttrib != prim.attributes.end(), "GLTF primitive does not contain vertex attribute POSITION");
-
-			uint32_t vertexPosIndex = vertexPosAttrib->second;
-			const tinygltf::Accessor& vertexPosAccessor = tinygltf.accessors[vertexPosIndex];
-			const tinygltf::BufferView& vertexPosBufferView = tinygltf.bufferViews[vertexPosAccessor.bufferView];
-			const tinygltf::Buffer& vertexPosBuffer = tinygltf.buffers[vertexPosBufferView.buffer];
-
-			const float* pVertexPosData = reinterpret_cast<const float*>(&vertexPosBuffer.data[0] + vertexPosBufferView.byteOffset + vertexPosAccessor.byteOffset);
-			ASSERT(vertexPosAccessor.count * vertexPosAccessor.ByteStride(vertexPosBufferView) + vertexPosBufferView.byteOffset + vertexPosAccessor.byteOffset <= vertexPosBuffer.data.size(),
-				"Byte offset for vertex attribute POSITION exceeded total buffer size");
-
-			// Get vertex tex coord data
-			auto vertexTexCoordAttrib = prim.attributes.find("TEXCOORD_0");
-			ASSERT(vertexTexCoordAttrib != prim.attributes.end(), "GLTF primitive does not contain vertex attribute TEXCOORD_0");
-
-			uint32_t vertexTexCoordIndex = vertexTexCoordAttrib->second;
-			const tinygltf::Accessor& vertexTexCoordAccessor = tinygltf.accessors[vertexTexCoordIndex];
-			const tinygltf::BufferView& vertexTexCoordBufferView = tinygltf.bufferViews[vertexTexCoordAccessor.bufferView];
-			const tinygltf::Buffer& vertexTexCoordBuffer = tinygltf.buffers[vertexTexCoordBufferView.buffer];
-
-			const float* pVertexTexCoordData = reinterpret_cast<const float*>(&vertexTexCoordBuffer.data[0] + vertexTexCoordBufferView.byteOffset + vertexTexCoordAccessor.byteOffset);
-			ASSERT(vertexTexCoordAccessor.count* vertexTexCoordAccessor.ByteStride(vertexTexCoordBufferView) + vertexTexCoordBufferView.byteOffset + vertexTexCoordAccessor.byteOffset <= vertexTexCoordBuffer.data.size(),
-				"Byte offset for vertex attribute TEXCOORD_0 exceeded total buffer size");
-
-			// Get vertex normal data
-			auto vertexNormalAttrib = prim.attributes.find("NORMAL");
-			ASSERT(vertexNormalAttrib != prim.attributes.end(), "GLTF primitive does not contain vertex attribute NORMAL");
-
-			uint32_t vertexNormalIndex = vertexNormalAttrib->second;
-			const tinygltf::Accessor& vertexNormalAccessor = tinygltf.accessors[vertexNormalIndex];
-			const tinygltf::BufferView& vertexNormalBufferView = tinygltf.bufferViews[vertexNormalAccessor.bufferView];
-			const tinygltf::Buffer& vertexNormalBuffer = tinygltf.buffers[vertexNormalBufferView.buffer];
-
-			const float* pVertexNormalData = reinterpret_cast<const float*>(&vertexNormalBuffer.data[0] + vertexNormalBufferView.byteOffset + vertexNormalAccessor.byteOffset);
-			ASSERT(vertexNormalAccessor.count* vertexNormalAccessor.ByteStride(vertexNormalBufferView) + vertexNormalBufferView.byteOffset + vertexNormalAccessor.byteOffset <= vertexNormalBuffer.data.size(),
-				"Byte offset for vertex attribute NormalITION exceeded total buffer size");
-
-			// Set attribute indices
-			uint32_t posIndex = 0;
-			uint32_t texCoordIndex = 0;
-			uint32_t normalIndex = 0;
-
-			// Construct a vertex from the primitive attributes data and add it to all vertices
-			for (uint32_t i = 0; i < vertexPosAccessor.count; ++i)
-			{
-				Vertex v = {};
-				v.Position = glm::vec3(pVertexPosData[posIndex], pVertexPosData[posIndex + 1], pVertexPosData[posIndex + 2]);
-				v.TexCoord = glm::vec2(pVertexTexCoordData[texCoordIndex], pVertexTexCoordData[texCoordIndex + 1]);
-				v.Normal = glm::vec3(pVertexNormalData[normalIndex], pVertexNormalData[normalIndex + 1], pVertexNormalData[normalIndex + 2]);
-				vertices.push_back(v);
-				
-				posIndex += 3;
-				texCoordIndex += 2;
-				normalIndex += 3;
-			}
+			CompleteLoadRequest(*request, ModelLoadStatus::MODEL_LOAD_STATUS_CANCELLED);
+			continue;
+		}
 
-			// Get index data
-			uint32_t indicesIndex = prim.indices;
-			const tinygltf::Accessor& indexAccessor = tinygltf.accessors[indicesIndex];
-			const tinygltf::BufferView& indexBufferView = tinygltf.bufferViews[indexAccessor.bufferView];
-			const tinygltf::Buffer& indexBuffer = tinygltf.buffers[indexBufferView.buffer];
+		if (!request->IsLoaded)
+		{
+			CompleteLoadRequest(*request, ModelLoadStatus::MODEL_LOAD_STATUS_FAILED);
+			continue;
+		}
 
-			const WORD* pIndexData = reinterpret_cast<const WORD*>(&indexBuffer.data[0] + indexBufferView.byteOffset + indexAccessor.byteOffset);
-			ASSERT(indexAccessor.count * indexAccessor.ByteStride(indexBufferView) + indexBufferView.byteOffset + indexAccessor.byteOffset,
-				"Byte offset for indices exceeded total buffer size");
+		// Every upload of the model goes into one copy command list, so a single fence tells when all of them completed
+		auto commandList = RenderBackend::GetCommandList(D3D12_COMMAND_LIST_TYPE_COPY);
+		request->Result = CreateModel(*request->Data, ModelCache::GetDirectory(request->Filepath), request->LoadDesc, request->BufferKeys,
+			commandList.get(), request->BufferUploads);
+		request->UploadFenceValue = RenderBackend::ExecuteCommandList(commandList);
 
-			// Get indices for current primitive/mesh and add it to all indices
-			std::size_t numIndices = 0;
+		// Vertex and index buffers that are copied in chunks keep the model data until SubmitBufferUploads copied all of it
+		if (request->BufferUploads.empty())
+			request->Data.reset();
 
-			for (uint32_t i = 0; i < indexAccessor.count; ++i)
-			{
-				uint32_t index = static_cast<uint32_t>(pIndexData[i]);
-				indices.push_back(index);
-				numIndices++;
-			}
+		request->Status = ModelLoadStatus::MODEL_LOAD_STATUS_UPLOADING;
+		s_AsyncLoader.UploadingRequests.push_back(request);
+	}
+
+	SubmitBufferUploads();
+
+	auto& uploadingRequests = s_AsyncLoader.UploadingRequests;
+	for (auto iter = uploadingRequests.begin(); iter != uploadingRequests.end();)
+	{
+		ModelLoadRequest& request = **iter;
+		if (request.Data || !RenderBackend::IsFenceComplete(D3D12_COMMAND_LIST_TYPE_COPY, request.UploadFenceValue))
+		{
+			++iter;
+			continue;
+		}
+
+		CompleteLoadRequest(request, request.IsCancelled ? ModelLoadStatus::MODEL_LOAD_STATUS_CANCELLED : ModelLoadStatus::MODEL_LOAD_STATUS_LOADED);
+		if (request.Status == ModelLoadStatus::MODEL_LOAD_STATUS_LOADED)
+		{
+			LOG_INFO("[ResourceManager] Published model: " + request.Filepath);
+			LogAssetRegistryStats();
 		}
+
+		iter = uploadingRequests.erase(iter);
+	}
+}
+
+void ResourceLoader::Finalize()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_AsyncLoader.Mutex);
+		s_AsyncLoader.Stop = true;
+
+		// The running load stops after its current stage, so the loader thread does not keep Finalize waiting for the whole model
+		if (s_AsyncLoader.LoadingRequest)
+			s_AsyncLoader.LoadingRequest->IsCancelled = true;
 	}
 
-	model.VertexBuffer = std::make_shared<Buffer>("Vertex buffer", BufferDesc(BufferUsage::BUFFER_USAGE_VERTEX | BufferUsage::BUFFER_USAGE_READ, vertices.size(), sizeof(Vertex)), &vertices[0]);
-	model.IndexBuffer = std::make_shared<Buffer>("Index buffer", BufferDesc(BufferUsage::BUFFER_USAGE_INDEX | BufferUsage::BUFFER_USAGE_READ, indices.size(), sizeof(uint32_t)), &indices[0]);
+	s_AsyncLoader.RequestAvailableCV.notify_one();
+	if (s_AsyncLoader.Thread.joinable())
+		s_AsyncLoader.Thread.join();
 
-	LOG_INFO("[ResourceManager] Loaded model: " + filepath);
+	// The loader thread is gone, so whatever it left behind can be completed here
+	std::vector<std::shared_ptr<ModelLoadRequest>> requests;
+	requests.insert(requests.end(), s_AsyncLoader.PendingRequests.begin(), s_AsyncLoader.PendingRequests.end());
+	requests.insert(requests.end(), s_AsyncLoader.LoadedRequests.begin(), s_AsyncLoader.LoadedRequests.end());
+	requests.insert(requests.end(), s_AsyncLoader.UploadingRequests.begin(), s_AsyncLoader.UploadingRequests.end());
 
-	return model;
+	s_AsyncLoader.PendingRequests.clear();
+	s_AsyncLoader.LoadedRequests.clear();
+	s_AsyncLoader.UploadingRequests.clear();
+
+	for (auto& request : requests)
+		CompleteLoadRequest(*request, ModelLoadStatus::MODEL_LOAD_STATUS_CANCELLED);
+
+	// Unreferenced assets are released while the render backend is still around
+	s_AssetRegistry.Clear();
 }
@@ -1,8 +1,6 @@
 #include "Pch.h"
 #include "Scene/Camera.h"
 #include "InputHandler.h"
-#include "Application.h"
-#include "Window.h"
 
 Camera::Camera(const glm::vec3& pos, float fov, float width, float height, float near, float far)
 	: m_FOV(fov), m_Near(near), m_Far(far)
@@ -0,0 +1,136 @@
+#include "Pch.h"
+#include "Util/Hash.h"
+#include "Util/MemoryMappedFile.h"
+
+static constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+static constexpr uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+static constexpr uint64_t PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+static inline uint64_t RotateLeft(uint64_t value, uint32_t bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t Read64(const unsigned char* ptr)
+{
+	uint64_t value;
+	memcpy(&value, ptr, sizeof(uint64_t));
+	return value;
+}
+
+static inline uint32_t Read32(const unsigned char* ptr)
+{
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(uint32_t));
+	return value;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME64_2;
+	acc = RotateLeft(acc, 31);
+	return acc * PRIME64_1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, uint64_t value)
+{
+	acc ^= Round(0, value);
+	return acc * PRIME64_1 + PRIME64_4;
+}
+
+/* Hashing a mapped file releases its pages in chunks of this size behind the hashed data */
+static constexpr std::size_t HASH_FILE_CHUNK_SIZE = 4 * 1024 * 1024;
+
+static uint64_t HashData(const void* data, std::size_t byteSize, uint64_t seed, const MemoryMappedFile* file)
+{
+	const unsigned char* ptr = static_cast<const unsigned char*>(data);
+	const unsigned char* end = ptr + byteSize;
+	uint64_t hash = 0;
+
+	if (byteSize >= 32)
+	{
+		// Four independent lanes so the multiplies can overlap
+		const unsigned char* limit = end - 32;
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+
+		do
+		{
+			const unsigned char* chunkStart = ptr;
+			const unsigned char* chunkLimit = file ? ptr + std::min(static_cast<std::size_t>(limit - ptr), HASH_FILE_CHUNK_SIZE) : limit;
+
+			do
+			{
+				v1 = Round(v1, Read64(ptr)); ptr += 8;
+				v2 = Round(v2, Read64(ptr)); ptr += 8;
+				v3 = Round(v3, Read64(ptr)); ptr += 8;
+				v4 = Round(v4, Read64(ptr)); ptr += 8;
+			} while (ptr <= chunkLimit);
+
+			// Large files are hashed without keeping all of them resident
+			if (file)
+				file->ReleasePages(chunkStart - file->GetData(), ptr - chunkStart);
+		} while (ptr <= limit);
+
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+		hash = MergeRound(hash, v1);
+		hash = MergeRound(hash, v2);
+		hash = MergeRound(hash, v3);
+		hash = MergeRound(hash, v4);
+	}
+	else
+	{
+		hash = seed + PRIME64_5;
+	}
+
+	hash += static_cast<uint64_t>(byteSize);
+
+	while (ptr + 8 <= end)
+	{
+		hash ^= Round(0, Read64(ptr));
+		hash = RotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+		ptr += 8;
+	}
+
+	if (ptr + 4 <= end)
+	{
+		hash ^= static_cast<uint64_t>(Read32(ptr)) * PRIME64_1;
+		hash = RotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+		ptr += 4;
+	}
+
+	while (ptr < end)
+	{
+		hash ^= static_cast<uint64_t>(*ptr) * PRIME64_5;
+		hash = RotateLeft(hash, 11) * PRIME64_1;
+		ptr++;
+	}
+
+	// Final avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+uint64_t Hash::Hash64(const void* data, std::size_t byteSize, uint64_t seed)
+{
+	return HashData(data, byteSize, seed, nullptr);
+}
+
+bool Hash::HashFile(const std::string& filepath, uint64_t& hash)
+{
+	MemoryMappedFile file;
+	if (!file.Open(filepath))
+		return false;
+
+	hash = HashData(file.GetData(), file.GetSize(), 0, &file);
+	return true;
+}
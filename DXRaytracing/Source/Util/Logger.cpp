@@ -1,6 +1,10 @@
 #include "Pch.h"
 #include "Util/Logger.h"
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 void Logger::Log(const char* message, Severity severity)
 {
 	SetSeverityConsoleColor(severity);
@@ -8,7 +12,7 @@ void Logger::Log(const char* message, Severity severity)
 	std::string strMessage(message);
 	std::string fullMessage = SeverityToString(severity) + strMessage + "\n";
 
-	printf(fullMessage.c_str());
+	printf("%s", fullMessage.c_str());
 }
 
 void Logger::Log(const std::string& message, Severity severity)
@@ -17,7 +21,7 @@ void Logger::Log(const std::string& message, Severity severity)
 
 	std::string fullMessage = SeverityToString(severity) + message + "\n";
 
-	printf(fullMessage.c_str());
+	printf("%s", fullMessage.c_str());
 }
 
 const char* Logger::SeverityToString(Severity severity)
@@ -34,10 +38,13 @@ const char* Logger::SeverityToString(Severity severity)
 		return "[ERR] ";
 		break;
 	}
+
+	return "";
 }
 
 inline void Logger::SetSeverityConsoleColor(Severity severity)
 {
+#ifdef _WIN32
 	HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
 
 	switch (severity)
@@ -52,4 +59,22 @@ inline void Logger::SetSeverityConsoleColor(Severity severity)
 		SetConsoleTextAttribute(hConsole, 12);
 		break;
 	}
+#else
+	// Output that is redirected to a log file is left without escape codes
+	if (!isatty(fileno(stdout)))
+		return;
+
+	switch (severity)
+	{
+	case Severity::INFO:
+		printf("\033[0m");
+		break;
+	case Severity::WARN:
+		printf("\033[33m");
+		break;
+	case Severity::ERR:
+		printf("\033[91m");
+		break;
+	}
+#endif
 }
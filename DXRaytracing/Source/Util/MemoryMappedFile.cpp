@@ -0,0 +1,149 @@
+#include "Pch.h"
+#include "Util/MemoryMappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MemoryMappedFile::Open(const std::string& filepath)
+{
+	Close();
+
+	m_FileHandle = CreateFileW(StringHelper::StringToWString(filepath).c_str(), GENERIC_READ, FILE_SHARE_READ,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_FileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(m_FileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		// Empty files cannot be mapped
+		Close();
+		return false;
+	}
+
+	m_MappingHandle = CreateFileMappingW(m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_MappingHandle)
+	{
+		Close();
+		return false;
+	}
+
+	m_Data = static_cast<const unsigned char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (!m_Data)
+	{
+		Close();
+		return false;
+	}
+
+	m_Size = static_cast<std::size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_MappingHandle)
+		CloseHandle(m_MappingHandle);
+	if (m_FileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(m_FileHandle);
+
+	m_Data = nullptr;
+	m_MappingHandle = nullptr;
+	m_FileHandle = INVALID_HANDLE_VALUE;
+	m_Size = 0;
+}
+
+void MemoryMappedFile::ReleasePages(std::size_t byteOffset, std::size_t byteSize) const
+{
+	if (!m_Data || byteOffset >= m_Size)
+		return;
+
+	// Unlocking pages that were never locked removes them from the working set, the mapping keeps them backed by the file
+	VirtualUnlock(const_cast<unsigned char*>(m_Data) + byteOffset, std::min(byteSize, m_Size - byteOffset));
+}
+
+std::size_t MemoryMappedFile::GetPageSize()
+{
+	SYSTEM_INFO systemInfo = {};
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwPageSize;
+}
+
+#else
+
+bool MemoryMappedFile::Open(const std::string& filepath)
+{
+	Close();
+
+	int fileDescriptor = open(filepath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat fileStat = {};
+	if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		// Empty files cannot be mapped
+		close(fileDescriptor);
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file, so the descriptor is not needed after this
+	void* data = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	madvise(data, static_cast<std::size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+	m_Data = static_cast<const unsigned char*>(data);
+	m_Size = static_cast<std::size_t>(fileStat.st_size);
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (m_Data)
+		munmap(const_cast<unsigned char*>(m_Data), m_Size);
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+void MemoryMappedFile::ReleasePages(std::size_t byteOffset, std::size_t byteSize) const
+{
+	if (!m_Data || byteOffset >= m_Size)
+		return;
+
+	// Only whole pages can be released, the partial pages at either end of the range stay resident
+	std::size_t pageSize = GetPageSize();
+	std::size_t begin = MathHelper::AlignUp(byteOffset, pageSize);
+	std::size_t end = std::min(byteOffset + byteSize, m_Size);
+
+	if (end == m_Size)
+		end = MathHelper::AlignUp(end, pageSize);
+	else
+		end = end / pageSize * pageSize;
+
+	if (begin < end)
+		madvise(const_cast<unsigned char*>(m_Data) + begin, end - begin, MADV_DONTNEED);
+}
+
+std::size_t MemoryMappedFile::GetPageSize()
+{
+	return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+#endif
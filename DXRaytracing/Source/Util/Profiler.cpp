@@ -9,18 +9,39 @@ Profiler& Profiler::Get()
 
 void Profiler::AddTimerResult(const TimerResult& result)
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
 	if (m_TimerResults.find(result.Name) != m_TimerResults.end())
 		m_TimerResults.at(result.Name).Duration += result.Duration;
 	else
 		m_TimerResults[result.Name] = result;
 }
 
+void Profiler::SetCounter(const std::string& name, uint64_t value)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_Counters[name] = value;
+}
+
 void Profiler::Reset()
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
 	m_TimerResults.clear();
 }
 
-Timer::Timer(const char* name)
+std::unordered_map<std::string, TimerResult> Profiler::GetTimerResults()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_TimerResults;
+}
+
+std::unordered_map<std::string, uint64_t> Profiler::GetCounters()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Counters;
+}
+
+Timer::Timer(const std::string& name)
 	: m_Name(name), m_IsStopped(false)
 {
 	m_StartTime = std::chrono::steady_clock::now();
@@ -0,0 +1,74 @@
+#include "Pch.h"
+#include "Util/ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t numThreads)
+{
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	m_Threads.reserve(numThreads);
+	for (uint32_t i = 0; i < numThreads; ++i)
+		m_Threads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+
+	m_JobAvailableCV.notify_all();
+
+	for (auto& thread : m_Threads)
+	{
+		if (thread.joinable())
+			thread.join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Jobs.push(std::move(job));
+	}
+
+	m_JobAvailableCV.notify_one();
+}
+
+void ThreadPool::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_IdleCV.wait(lock, [this] { return m_Jobs.empty() && m_NumActiveJobs == 0; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_JobAvailableCV.wait(lock, [this] { return m_Stop || !m_Jobs.empty(); });
+
+			if (m_Stop && m_Jobs.empty())
+				return;
+
+			job = std::move(m_Jobs.front());
+			m_Jobs.pop();
+			m_NumActiveJobs++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_NumActiveJobs--;
+
+			if (m_Jobs.empty() && m_NumActiveJobs == 0)
+				m_IdleCV.notify_all();
+		}
+	}
+}
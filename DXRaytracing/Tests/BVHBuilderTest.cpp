@@ -0,0 +1,202 @@
+#include "Pch.h"
+#include "Resource/BVHBuilder.h"
+#include "Resource/LBVHBuilder.h"
+#include "Test.h"
+
+#include <random>
+
+struct TestMesh
+{
+	std::vector<Vertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<Submesh> Submeshes;
+};
+
+static void AddTriangle(TestMesh& mesh, const glm::vec3& center, float size)
+{
+	uint32_t firstVertex = static_cast<uint32_t>(mesh.Vertices.size());
+	const glm::vec3 corners[3] = { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+
+	for (auto& corner : corners)
+	{
+		Vertex vertex = {};
+		vertex.Position = center + corner * size;
+		mesh.Vertices.push_back(vertex);
+		mesh.Indices.push_back(firstVertex++);
+	}
+}
+
+static void FinishMesh(TestMesh& mesh)
+{
+	Submesh submesh;
+	submesh.NumIndices = static_cast<uint32_t>(mesh.Indices.size());
+	submesh.NumVertices = static_cast<uint32_t>(mesh.Vertices.size());
+	mesh.Submeshes = { submesh };
+}
+
+/* Small triangles at doubling distances along an axis. Every SAH split only cuts off the farthest triangles, so without
+   a depth limit the BVH degenerates into a long chain of small subtrees */
+static TestMesh CreateGeometricMesh(uint32_t numTriangles)
+{
+	TestMesh mesh;
+	for (uint32_t i = 0; i < numTriangles; ++i)
+		AddTriangle(mesh, glm::vec3(std::ldexp(1.0f, static_cast<int>(i)), 0.0f, 0.0f), 0.01f);
+
+	FinishMesh(mesh);
+	return mesh;
+}
+
+static TestMesh CreateRandomMesh(uint32_t numTriangles)
+{
+	std::mt19937 random(21);
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+
+	TestMesh mesh;
+	for (uint32_t i = 0; i < numTriangles; ++i)
+		AddTriangle(mesh, glm::vec3(position(random), position(random), position(random)), 0.5f);
+
+	FinishMesh(mesh);
+	return mesh;
+}
+
+static BVHBuildStats Build(const TestMesh& mesh, const BVHBuildDesc& desc, BVH& bvh)
+{
+	return BVHBuilder::Build(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), sizeof(uint32_t), mesh.Submeshes, desc, bvh);
+}
+
+/* Every triangle is in exactly one leaf and inside the bounds of the nodes above it */
+static void CheckStructure(const std::string& name, const BVH& bvh, std::size_t numTriangles)
+{
+	std::vector<uint32_t> numReferences(numTriangles, 0);
+	std::vector<uint32_t> stack = { 0 };
+	bool isContained = true;
+
+	while (!stack.empty())
+	{
+		const BVHNode& node = bvh.Nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = node.LeftFirst; i < node.LeftFirst + node.NumTriangles; ++i)
+			{
+				numReferences[bvh.TriangleIndices[i]]++;
+				for (const glm::vec3& vertex : { bvh.Triangles[i].V0, bvh.Triangles[i].V1, bvh.Triangles[i].V2 })
+					isContained &= glm::all(glm::greaterThanEqual(vertex, node.BoundsMin)) && glm::all(glm::lessThanEqual(vertex, node.BoundsMax));
+			}
+
+			continue;
+		}
+
+		for (uint32_t child = node.LeftFirst; child < node.LeftFirst + 2; ++child)
+		{
+			isContained &= glm::all(glm::greaterThanEqual(bvh.Nodes[child].BoundsMin, node.BoundsMin)) &&
+				glm::all(glm::lessThanEqual(bvh.Nodes[child].BoundsMax, node.BoundsMax));
+			stack.push_back(child);
+		}
+	}
+
+	CHECK(std::all_of(numReferences.begin(), numReferences.end(), [](uint32_t count) { return count == 1; }),
+		name + " does not reference every triangle exactly once");
+	CHECK(isContained, name + " has a node or triangle outside the bounds of its parent");
+}
+
+/* A degenerate input stops at the maximum depth, and is split in half close to it so the leaves still stay small */
+static void TestDegenerateInput()
+{
+	TestMesh mesh = CreateGeometricMesh(120);
+
+	BVHBuildDesc unlimitedDesc;
+	unlimitedDesc.MaxDepth = BVH_MAX_DEPTH;
+	BVH unlimitedBVH;
+	BVHBuildStats unlimitedStats = Build(mesh, unlimitedDesc, unlimitedBVH);
+	CHECK(unlimitedStats.MaxDepth > 24, "Geometric BVH is only " + std::to_string(unlimitedStats.MaxDepth) + " deep without a limit");
+
+	BVHBuildDesc desc;
+	desc.MaxDepth = 16;
+	BVH bvh;
+	BVHBuildStats stats = Build(mesh, desc, bvh);
+	CheckStructure("Geometric BVH", bvh, 120);
+
+	CHECK(stats.MaxDepth == desc.MaxDepth, "Geometric BVH is " + std::to_string(stats.MaxDepth) + " deep, not at the limit of " +
+		std::to_string(desc.MaxDepth));
+	CHECK(stats.MaxLeafSize <= desc.MaxLeafSize, "Geometric BVH has a leaf of " + std::to_string(stats.MaxLeafSize) + " triangles");
+}
+
+/* A depth that allows exactly enough halvings keeps the leaf size, a smaller one forces larger leaves but never a deeper tree */
+static void TestSmallMaxDepth()
+{
+	TestMesh mesh = CreateGeometricMesh(64);
+
+	for (uint32_t maxDepth : { 0u, 1u, 3u, 4u })
+	{
+		BVHBuildDesc desc;
+		desc.MaxDepth = maxDepth;
+
+		BVH bvh;
+		BVHBuildStats stats = Build(mesh, desc, bvh);
+		std::string name = "BVH with a maximum depth of " + std::to_string(maxDepth);
+		CheckStructure(name, bvh, 64);
+
+		CHECK(stats.MaxDepth <= maxDepth, name + " is " + std::to_string(stats.MaxDepth) + " deep");
+		// 64 triangles halve to leaves of 4 in 4 levels
+		uint32_t expectedLeafSize = 64 >> maxDepth;
+		CHECK(stats.MaxLeafSize <= std::max(expectedLeafSize, desc.MaxLeafSize), name + " has a leaf of " + std::to_string(stats.MaxLeafSize) + " triangles");
+	}
+}
+
+/* Inputs that never get close to the limit are built exactly like before it existed */
+static void TestUnaffectedBuild()
+{
+	TestMesh mesh = CreateRandomMesh(20000);
+
+	BVHBuildDesc desc;
+	BVH bvh;
+	BVHBuildStats stats = Build(mesh, desc, bvh);
+	CheckStructure("Random BVH", bvh, 20000);
+
+	BVHBuildDesc unlimitedDesc;
+	unlimitedDesc.MaxDepth = BVH_MAX_DEPTH;
+	BVH unlimitedBVH;
+	BVHBuildStats unlimitedStats = Build(mesh, unlimitedDesc, unlimitedBVH);
+
+	CHECK(stats.MaxDepth < desc.MaxDepth / 2, "Random BVH is " + std::to_string(stats.MaxDepth) + " deep");
+	CHECK(stats.NumNodes == unlimitedStats.NumNodes && stats.SAHCost == unlimitedStats.SAHCost, "Depth limit changed a BVH that stays far from it");
+}
+
+/* The LBVH stays within the depth bound of its Karras hierarchy, the code bits plus the bits of the triangle index, also where treelet
+   restructuring finds cheaper but taller topologies. Without collapsed leaves the depth of the hierarchy itself is measured */
+static void TestLBVHDepth()
+{
+	for (const TestMesh& mesh : { CreateGeometricMesh(120), CreateRandomMesh(20000) })
+	{
+		std::size_t numTriangles = mesh.Indices.size() / 3;
+		uint32_t maxDepth = 30 + static_cast<uint32_t>(std::ceil(std::log2(static_cast<double>(numTriangles))));
+
+		for (bool optimizeTreelets : { false, true })
+		{
+			LBVHBuildDesc desc;
+			desc.MaxLeafSize = 1;
+			desc.OptimizeTreelets = optimizeTreelets;
+			desc.MinTreeletTriangles = 4;
+
+			BVH bvh;
+			BVHBuildStats stats = LBVHBuilder::Build(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), sizeof(uint32_t),
+				mesh.Submeshes, desc, nullptr, bvh);
+
+			std::string name = "LBVH over " + std::to_string(numTriangles) + " triangles" + (optimizeTreelets ? " with treelets" : "");
+			CheckStructure(name, bvh, numTriangles);
+			CHECK(stats.MaxDepth <= maxDepth, name + " is " + std::to_string(stats.MaxDepth) + " deep, more than " + std::to_string(maxDepth));
+		}
+	}
+}
+
+int main()
+{
+	TestDegenerateInput();
+	TestSmallMaxDepth();
+	TestUnaffectedBuild();
+	TestLBVHDepth();
+
+	return Test::Finish("BVHBuilderTest");
+}
@@ -0,0 +1,224 @@
+#include "Pch.h"
+#include "Resource/BlockCompression.h"
+#include "Test.h"
+
+#include <random>
+
+struct TestImage
+{
+	std::string Name;
+	std::vector<unsigned char> Pixels;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+};
+
+struct CompressionCase
+{
+	const TestImage* Image = nullptr;
+	BlockCompressionFormat Format = BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1;
+	// Channels the format is meant to preserve, BC1 drops alpha and BC5 keeps R and G
+	uint32_t NumChannels = 3;
+	float MinPSNR = 0.0f;
+};
+
+static const char* GetFormatName(BlockCompressionFormat format)
+{
+	switch (format)
+	{
+	case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC3:
+		return "BC3";
+	case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC5:
+		return "BC5";
+	case BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7:
+		return "BC7";
+	default:
+		return "BC1";
+	}
+}
+
+static unsigned char ToByte(float value)
+{
+	return static_cast<unsigned char>(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+/* Smooth color gradients with fine noise and hard edged patches, like a painted albedo texture. The alpha channel holds a radial
+   gradient for the formats with alpha */
+static TestImage CreateAlbedoImage(uint32_t width, uint32_t height)
+{
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> noise(-0.03f, 0.03f);
+
+	TestImage image = { "albedo " + std::to_string(width) + "x" + std::to_string(height), std::vector<unsigned char>(width * height * 4), width, height };
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			glm::vec2 uv((x + 0.5f) / width, (y + 0.5f) / height);
+			glm::vec3 color(0.6f + 0.3f * std::sin(uv.x * 6.0f), 0.4f + 0.3f * uv.y, 0.3f + 0.2f * std::cos(uv.x * 4.0f + uv.y * 3.0f));
+
+			// Darker bricks with mortar lines every 32 texels
+			if ((x / 32 + y / 16) % 3 == 0)
+				color *= 0.55f;
+			if (x % 32 == 0 || y % 16 == 0)
+				color = glm::vec3(0.85f, 0.82f, 0.78f);
+
+			unsigned char* pixel = image.Pixels.data() + (static_cast<std::size_t>(y) * width + x) * 4;
+			pixel[0] = ToByte(color.r + noise(random));
+			pixel[1] = ToByte(color.g + noise(random));
+			pixel[2] = ToByte(color.b + noise(random));
+			pixel[3] = ToByte(1.0f - glm::length(uv - 0.5f) * 1.4f);
+		}
+	}
+
+	return image;
+}
+
+/* Tangent space normals of a sum of sines height field, with X and Y in R and G like the normal maps BC5 is meant for */
+static TestImage CreateNormalImage(uint32_t width, uint32_t height)
+{
+	TestImage image = { "normal " + std::to_string(width) + "x" + std::to_string(height), std::vector<unsigned char>(width * height * 4), width, height };
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			float dx = 0.6f * std::cos(x * 0.15f) + 0.3f * std::cos((x + y) * 0.05f);
+			float dy = 0.6f * std::sin(y * 0.11f) + 0.3f * std::cos((x + y) * 0.05f);
+			glm::vec3 normal = glm::normalize(glm::vec3(-dx, -dy, 1.0f)) * 0.5f + 0.5f;
+
+			unsigned char* pixel = image.Pixels.data() + (static_cast<std::size_t>(y) * width + x) * 4;
+			pixel[0] = ToByte(normal.x);
+			pixel[1] = ToByte(normal.y);
+			pixel[2] = ToByte(normal.z);
+			pixel[3] = 255;
+		}
+	}
+
+	return image;
+}
+
+static TestImage CreateSolidImage(uint32_t width, uint32_t height)
+{
+	TestImage image = { "solid " + std::to_string(width) + "x" + std::to_string(height), std::vector<unsigned char>(width * height * 4), width, height };
+	for (std::size_t i = 0; i < image.Pixels.size(); i += 4)
+	{
+		image.Pixels[i + 0] = 200;
+		image.Pixels[i + 1] = 120;
+		image.Pixels[i + 2] = 40;
+		image.Pixels[i + 3] = 255;
+	}
+
+	return image;
+}
+
+/* Compresses and decodes every case, checks the PSNR of the channels the format keeps and reports the single threaded encode throughput */
+static void TestQualityAndThroughput(const std::vector<CompressionCase>& cases)
+{
+	printf("\n%-18s  %-6s  %9s  %10s  %12s\n", "Image", "Format", "PSNR (dB)", "Min (dB)", "Encode MP/s");
+
+	for (auto& compressionCase : cases)
+	{
+		const TestImage& image = *compressionCase.Image;
+		std::string name = image.Name + " " + GetFormatName(compressionCase.Format);
+
+		std::vector<unsigned char> blocks(BlockCompression::GetCompressedByteSize(compressionCase.Format, image.Width, image.Height));
+		std::vector<unsigned char> decoded(image.Pixels.size());
+
+		// The fastest of a few runs, the first one also warms up the caches
+		float duration = std::numeric_limits<float>::max();
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+			BlockCompression::Compress(compressionCase.Format, image.Pixels.data(), image.Width, image.Height, blocks.data());
+			std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+			duration = std::min(duration, elapsed.count());
+		}
+
+		BlockCompression::Decompress(compressionCase.Format, blocks.data(), image.Width, image.Height, decoded.data());
+		float psnr = BlockCompression::MeasurePSNR(image.Pixels.data(), decoded.data(), image.Width, image.Height, compressionCase.NumChannels);
+		float throughput = duration > 0.0f ? image.Width * image.Height / (duration * 1000.0f) : 0.0f;
+
+		printf("%-18s  %-6s  %9.2f  %10.2f  %12.2f\n", image.Name.c_str(), GetFormatName(compressionCase.Format), psnr, compressionCase.MinPSNR, throughput);
+		CHECK(psnr >= compressionCase.MinPSNR, name + " PSNR " + std::to_string(psnr) + " dB is below " + std::to_string(compressionCase.MinPSNR) + " dB");
+	}
+
+	printf("\n");
+}
+
+static float MeasureRoundTripPSNR(BlockCompressionFormat format, const TestImage& image, uint32_t numChannels)
+{
+	std::vector<unsigned char> blocks(BlockCompression::GetCompressedByteSize(format, image.Width, image.Height));
+	std::vector<unsigned char> decoded(image.Pixels.size());
+
+	BlockCompression::Compress(format, image.Pixels.data(), image.Width, image.Height, blocks.data());
+	BlockCompression::Decompress(format, blocks.data(), image.Width, image.Height, decoded.data());
+	return BlockCompression::MeasurePSNR(image.Pixels.data(), decoded.data(), image.Width, image.Height, numChannels);
+}
+
+/* BC7 spends twice the bits of BC1 per block, so it has to be better on the color channels alone */
+static void TestBC7OverBC1(const TestImage& image)
+{
+	float bc1 = MeasureRoundTripPSNR(BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1, image, 3);
+	float bc7 = MeasureRoundTripPSNR(BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7, image, 3);
+	CHECK(bc7 > bc1 + 1.0f, image.Name + " BC7 RGB PSNR " + std::to_string(bc7) + " dB is not above BC1 " + std::to_string(bc1) + " dB");
+}
+
+/* Compressing a subset of block rows writes exactly those blocks, so block rows can be split across threads */
+static void TestBlockRows(const TestImage& image)
+{
+	for (BlockCompressionFormat format : { BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC3,
+		BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC5, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7 })
+	{
+		std::vector<unsigned char> whole(BlockCompression::GetCompressedByteSize(format, image.Width, image.Height));
+		std::vector<unsigned char> split(whole.size());
+		BlockCompression::Compress(format, image.Pixels.data(), image.Width, image.Height, whole.data());
+
+		uint32_t numBlockRows = (image.Height + 3) / 4;
+		for (uint32_t firstBlockRow = 0; firstBlockRow < numBlockRows; firstBlockRow += 3)
+		{
+			BlockCompression::CompressBlockRows(format, image.Pixels.data(), image.Width, image.Height, firstBlockRow,
+				std::min(3u, numBlockRows - firstBlockRow), split.data());
+		}
+
+		CHECK(whole == split, std::string(GetFormatName(format)) + " block rows compressed separately differ from the whole level");
+	}
+}
+
+static void TestByteSizes()
+{
+	CHECK(BlockCompression::GetBlockByteSize(BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1) == 8, "BC1 blocks are not 8 bytes");
+	CHECK(BlockCompression::GetBlockByteSize(BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7) == 16, "BC7 blocks are not 16 bytes");
+	// Partial blocks on the edges are padded to whole blocks
+	CHECK(BlockCompression::GetCompressedByteSize(BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1, 5, 3) == 2 * 8, "5x3 BC1 level is not 2 blocks");
+	CHECK(BlockCompression::GetMipChainByteSize(BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC3, 8, 8, 4) == (4 + 1 + 1 + 1) * 16,
+		"8x8 BC3 mip chain is not 7 blocks");
+}
+
+int main()
+{
+	TestImage albedo = CreateAlbedoImage(512, 512);
+	TestImage normal = CreateNormalImage(512, 512);
+	TestImage solid = CreateSolidImage(64, 64);
+	// Not a multiple of the block size, the edge blocks are clamped on encode and cropped on decode
+	TestImage oddAlbedo = CreateAlbedoImage(77, 45);
+
+	// The minimums are about a decibel below what the encoder reaches on these images, the noise of the albedo keeps them low
+	std::vector<CompressionCase> cases = {
+		{ &albedo, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1, 3, 35.0f },
+		{ &albedo, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC3, 4, 36.0f },
+		{ &albedo, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7, 4, 37.5f },
+		{ &normal, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC5, 2, 48.0f },
+		{ &normal, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1, 3, 36.5f },
+		{ &solid, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1, 3, 42.0f },
+		{ &solid, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7, 4, 52.0f },
+		{ &oddAlbedo, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC1, 3, 34.0f },
+		{ &oddAlbedo, BlockCompressionFormat::BLOCK_COMPRESSION_FORMAT_BC7, 4, 34.5f }
+	};
+
+	TestQualityAndThroughput(cases);
+	TestBC7OverBC1(albedo);
+	TestBlockRows(oddAlbedo);
+	TestByteSizes();
+
+	return Test::Finish("BlockCompressionTest");
+}
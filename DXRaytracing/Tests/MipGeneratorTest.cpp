@@ -0,0 +1,305 @@
+#include "Pch.h"
+#include "Resource/MipGenerator.h"
+#include "Test.h"
+
+#include <random>
+
+static const char* GetFilterName(MipFilter filter)
+{
+	return filter == MipFilter::MIP_FILTER_KAISER ? "Kaiser" : "box";
+}
+
+/* Weights of the 2x decimation kernels from their definition, in double precision */
+static std::vector<double> GetReferenceWeights(MipFilter filter, int32_t& firstOffset)
+{
+	if (filter == MipFilter::MIP_FILTER_BOX)
+	{
+		firstOffset = 0;
+		return { 0.5, 0.5 };
+	}
+
+	auto besselI0 = [](double x) {
+		double sum = 1.0, term = 1.0;
+		for (uint32_t k = 1; k < 32; ++k)
+		{
+			term *= (x * 0.5 / k) * (x * 0.5 / k);
+			sum += term;
+		}
+		return sum;
+	};
+
+	// Sinc with the cutoff at half the source frequency, windowed by a Kaiser window with alpha 4 and radius 3
+	constexpr double pi = 3.14159265358979323846;
+	firstOffset = -2;
+
+	std::vector<double> weights(6);
+	double sum = 0.0;
+	for (int32_t i = 0; i < 6; ++i)
+	{
+		double distance = firstOffset + i - 0.5;
+		double t = distance * 0.5;
+		double ratio = distance / 3.0;
+		weights[i] = std::sin(pi * t) / (pi * t) * besselI0(4.0 * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / besselI0(4.0);
+		sum += weights[i];
+	}
+
+	for (auto& weight : weights)
+		weight /= sum;
+
+	return weights;
+}
+
+/* Direct 2D convolution with the separable kernel, samples outside the image are clamped to the edge */
+static MipImage ReferenceDownsample(const MipImage& source, MipFilter filter)
+{
+	int32_t firstOffset = 0;
+	std::vector<double> weights = GetReferenceWeights(filter, firstOffset);
+
+	MipImage output;
+	output.Width = std::max(1u, source.Width / 2);
+	output.Height = std::max(1u, source.Height / 2);
+	output.Pixels.resize(output.Width * output.Height * 4);
+
+	auto clamp = [](int32_t texel, uint32_t size) { return static_cast<uint32_t>(std::min(std::max(texel, 0), static_cast<int32_t>(size) - 1)); };
+
+	for (uint32_t y = 0; y < output.Height; ++y)
+	{
+		for (uint32_t x = 0; x < output.Width; ++x)
+		{
+			double sum[4] = {};
+			for (std::size_t j = 0; j < weights.size(); ++j)
+			{
+				uint32_t sourceY = clamp(2 * static_cast<int32_t>(y) + firstOffset + static_cast<int32_t>(j), source.Height);
+				for (std::size_t i = 0; i < weights.size(); ++i)
+				{
+					uint32_t sourceX = clamp(2 * static_cast<int32_t>(x) + firstOffset + static_cast<int32_t>(i), source.Width);
+					const float* texel = source.Pixels.data() + (static_cast<std::size_t>(sourceY) * source.Width + sourceX) * 4;
+
+					for (uint32_t c = 0; c < 4; ++c)
+						sum[c] += weights[i] * weights[j] * texel[c];
+				}
+			}
+
+			for (uint32_t c = 0; c < 4; ++c)
+				output.Pixels[(y * output.Width + x) * 4 + c] = static_cast<float>(sum[c]);
+		}
+	}
+
+	return output;
+}
+
+static float GetMaxDifference(const MipImage& a, const MipImage& b)
+{
+	if (a.Width != b.Width || a.Height != b.Height || a.Pixels.size() != b.Pixels.size())
+		return std::numeric_limits<float>::max();
+
+	float maxDifference = 0.0f;
+	for (std::size_t i = 0; i < a.Pixels.size(); ++i)
+		maxDifference = std::max(maxDifference, std::abs(a.Pixels[i] - b.Pixels[i]));
+
+	return maxDifference;
+}
+
+static MipImage CreateRandomImage(uint32_t width, uint32_t height, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+	MipImage image;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(static_cast<std::size_t>(width) * height * 4);
+
+	for (auto& value : image.Pixels)
+		value = uniform(random);
+
+	return image;
+}
+
+/* The SIMD and scalar paths match the direct convolution on images with odd sizes and single rows or columns, where the edge clamping
+   and the ring of filtered rows come into play */
+static void TestDownsampleAgainstReference()
+{
+	std::mt19937 random(7);
+	const glm::uvec2 sizes[] = { glm::uvec2(64, 64), glm::uvec2(37, 21), glm::uvec2(5, 3), glm::uvec2(1, 16), glm::uvec2(16, 1), glm::uvec2(2, 2),
+		glm::uvec2(3, 3) };
+
+	for (MipFilter filter : { MipFilter::MIP_FILTER_BOX, MipFilter::MIP_FILTER_KAISER })
+	{
+		for (auto& size : sizes)
+		{
+			std::string name = std::string(GetFilterName(filter)) + " " + std::to_string(size.x) + "x" + std::to_string(size.y);
+			MipImage source = CreateRandomImage(size.x, size.y, random);
+
+			MipImage reference = ReferenceDownsample(source, filter);
+			MipImage simd, scalar;
+			MipGenerator::Downsample(source, filter, simd);
+			MipGenerator::DownsampleScalar(source, filter, scalar);
+
+			CHECK(GetMaxDifference(simd, reference) <= 1e-5f, name + " SIMD output differs from the reference by " + std::to_string(GetMaxDifference(simd, reference)));
+			CHECK(GetMaxDifference(scalar, reference) <= 1e-5f, name + " scalar output differs from the reference by " +
+				std::to_string(GetMaxDifference(scalar, reference)));
+			// Both paths sum the taps in the same order
+			CHECK(GetMaxDifference(simd, scalar) <= 1e-6f, name + " SIMD and scalar output differ by " + std::to_string(GetMaxDifference(simd, scalar)));
+		}
+	}
+}
+
+/* Both kernels are normalized and symmetric around the output texel, so constant images stay constant and linear ramps are reproduced
+   away from the edges */
+static void TestKernelProperties()
+{
+	for (MipFilter filter : { MipFilter::MIP_FILTER_BOX, MipFilter::MIP_FILTER_KAISER })
+	{
+		std::string name = GetFilterName(filter);
+
+		MipImage constant;
+		constant.Width = 16;
+		constant.Height = 16;
+		constant.Pixels.assign(16 * 16 * 4, 0.25f);
+
+		MipImage output;
+		MipGenerator::Downsample(constant, filter, output);
+		float maxError = 0.0f;
+		for (float value : output.Pixels)
+			maxError = std::max(maxError, std::abs(value - 0.25f));
+
+		CHECK(maxError <= 1e-6f, name + " filter changes a constant image by " + std::to_string(maxError));
+
+		MipImage ramp;
+		ramp.Width = 32;
+		ramp.Height = 4;
+		ramp.Pixels.resize(32 * 4 * 4);
+		for (uint32_t y = 0; y < ramp.Height; ++y)
+		{
+			for (uint32_t x = 0; x < ramp.Width; ++x)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+					ramp.Pixels[(y * ramp.Width + x) * 4 + c] = x / 32.0f;
+			}
+		}
+
+		MipGenerator::Downsample(ramp, filter, output);
+		maxError = 0.0f;
+		for (uint32_t x = 2; x < output.Width - 2; ++x)
+		{
+			// The output texel center is at 2x + 0.5 in source texels
+			maxError = std::max(maxError, std::abs(output.Pixels[x * 4] - (2.0f * x + 0.5f) / 32.0f));
+		}
+
+		CHECK(maxError <= 1e-5f, name + " filter bends a linear ramp by " + std::to_string(maxError));
+	}
+}
+
+/* Fixed mip chains of a 4x4 checkerboard of black and white with inverted alpha. Every 2x2 block averages to half intensity, which is
+   188 in sRGB and 128 in linear 8-bit, alpha is always filtered linearly */
+static void TestCheckerboardMipChain()
+{
+	unsigned char pixels[4 * 4 * 4];
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		bool isWhite = ((i % 4) + (i / 4)) % 2 == 0;
+		unsigned char value = isWhite ? 255 : 0;
+		pixels[i * 4 + 0] = value;
+		pixels[i * 4 + 1] = value;
+		pixels[i * 4 + 2] = value;
+		pixels[i * 4 + 3] = 255 - value;
+	}
+
+	CHECK(MipGenerator::GetNumMipLevels(4, 4) == 3, "A 4x4 image does not have 3 mips");
+	CHECK(MipGenerator::GetMipChainByteSize(4, 4, 3) == (16 + 4 + 1) * 4, "The mip chain of a 4x4 image has the wrong size");
+
+	const unsigned char sRGBMip[4] = { 188, 188, 188, 128 };
+	const unsigned char linearMip[4] = { 128, 128, 128, 128 };
+
+	for (bool sRGB : { true, false })
+	{
+		std::vector<unsigned char> chain(MipGenerator::GetMipChainByteSize(4, 4, 3));
+		MipGenerator::GenerateMipChain(pixels, 4, 4, MipFilter::MIP_FILTER_BOX, sRGB, chain.data());
+
+		CHECK(std::memcmp(chain.data(), pixels, sizeof(pixels)) == 0, "Mip 0 is not copied as is");
+
+		const unsigned char* expected = sRGB ? sRGBMip : linearMip;
+		for (std::size_t texel = 16; texel < 21; ++texel)
+		{
+			CHECK(std::memcmp(chain.data() + texel * 4, expected, 4) == 0, std::string(sRGB ? "sRGB" : "Linear") + " checkerboard texel " +
+				std::to_string(texel) + " is " + std::to_string(chain[texel * 4]) + ", " + std::to_string(chain[texel * 4 + 3]));
+		}
+	}
+}
+
+/* Mip 1 is filtered while decoding the 8-bit source row by row, the lower mips from the float image. Both match the float path */
+static void TestGenerateMipChain()
+{
+	std::mt19937 random(3);
+	std::uniform_int_distribution<int> byte(0, 255);
+
+	const uint32_t width = 45, height = 30;
+	std::vector<unsigned char> pixels(width * height * 4);
+	for (auto& value : pixels)
+		value = static_cast<unsigned char>(byte(random));
+
+	for (MipFilter filter : { MipFilter::MIP_FILTER_BOX, MipFilter::MIP_FILTER_KAISER })
+	{
+		for (bool sRGB : { true, false })
+		{
+			std::string name = std::string(GetFilterName(filter)) + (sRGB ? " sRGB" : " linear");
+			uint32_t numMipLevels = MipGenerator::GetNumMipLevels(width, height);
+
+			std::vector<unsigned char> chain(MipGenerator::GetMipChainByteSize(width, height, numMipLevels));
+			MipGenerator::GenerateMipChain(pixels.data(), width, height, filter, sRGB, chain.data());
+
+			MipImage current;
+			MipGenerator::DecodeRGBA8(pixels.data(), width, height, sRGB, current);
+			std::size_t offset = pixels.size();
+			uint32_t numMismatches = 0;
+
+			for (uint32_t mip = 1; mip < numMipLevels; ++mip)
+			{
+				MipImage next;
+				MipGenerator::Downsample(current, filter, next);
+
+				std::vector<unsigned char> expected(next.Pixels.size());
+				MipGenerator::EncodeRGBA8(next, sRGB, expected.data());
+				numMismatches += std::memcmp(chain.data() + offset, expected.data(), expected.size()) != 0;
+
+				offset += expected.size();
+				std::swap(current, next);
+			}
+
+			CHECK(numMismatches == 0, name + " mip chain differs from the float path in " + std::to_string(numMismatches) + " mips");
+			CHECK(offset == chain.size(), name + " mip chain has the wrong size");
+		}
+	}
+}
+
+/* Every 8-bit value survives a decode and encode, in sRGB and linear */
+static void TestRGBA8RoundTrip()
+{
+	unsigned char pixels[256 * 4];
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+			pixels[i * 4 + c] = static_cast<unsigned char>(i);
+	}
+
+	for (bool sRGB : { true, false })
+	{
+		MipImage image;
+		unsigned char encoded[256 * 4];
+		MipGenerator::DecodeRGBA8(pixels, 256, 1, sRGB, image);
+		MipGenerator::EncodeRGBA8(image, sRGB, encoded);
+
+		CHECK(std::memcmp(encoded, pixels, sizeof(pixels)) == 0, std::string(sRGB ? "sRGB" : "Linear") + " values change in a decode and encode");
+	}
+}
+
+int main()
+{
+	TestDownsampleAgainstReference();
+	TestKernelProperties();
+	TestCheckerboardMipChain();
+	TestGenerateMipChain();
+	TestRGBA8RoundTrip();
+
+	return Test::Finish("MipGeneratorTest");
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+	Checks for the tests, which are executables that CTest runs without a device. A failed check logs its message and location and
+	fails the test, the remaining checks still run so a single run reports every failure
+*/
+class Test
+{
+public:
+	static void Check(bool condition, const std::string& message, const char* file, int line)
+	{
+		s_NumChecks++;
+		if (condition)
+			return;
+
+		s_NumFailures++;
+		LOG_ERR(std::string(file) + "(" + std::to_string(line) + "): " + message);
+	}
+
+	/* Exit code of the test, 1 if any check failed */
+	static int Finish(const std::string& name)
+	{
+		if (s_NumFailures > 0)
+		{
+			LOG_ERR("[" + name + "] " + std::to_string(s_NumFailures) + " of " + std::to_string(s_NumChecks) + " checks failed");
+			return 1;
+		}
+
+		LOG_INFO("[" + name + "] All " + std::to_string(s_NumChecks) + " checks passed");
+		return 0;
+	}
+
+private:
+	static inline uint32_t s_NumChecks = 0;
+	static inline uint32_t s_NumFailures = 0;
+
+};
+
+#define CHECK(condition, message) Test::Check(condition, message, __FILE__, __LINE__)
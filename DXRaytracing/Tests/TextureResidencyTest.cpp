@@ -0,0 +1,162 @@
+#include "Pch.h"
+#include "Graphics/TextureResidency.h"
+#include "Test.h"
+
+/* Byte sizes of an RGBA8 mip chain, from the largest mip to 1x1 */
+static std::vector<std::size_t> GetMipByteSizes(uint32_t size)
+{
+	std::vector<std::size_t> mipByteSizes;
+	for (uint32_t mipSize = size; mipSize > 0; mipSize /= 2)
+		mipByteSizes.push_back(static_cast<std::size_t>(mipSize) * mipSize * 4);
+
+	return mipByteSizes;
+}
+
+/* The mip tail is scheduled right away even without budget, and every texture gets its mips from the coarsest to the finest */
+static void TestTailFirst()
+{
+	TextureResidency residency;
+	// 64x64 down to 1x1 forms the tail of a 256x256 texture, 7 of its 9 mips
+	uint32_t texture = residency.AddTexture(GetMipByteSizes(256), 7);
+
+	CHECK(residency.GetResidentMip(texture) == 9, "Texture without uploads has a resident mip");
+	CHECK(residency.GetMipResidency(texture, 8) == MipResidency::MIP_RESIDENCY_QUEUED, "Mip is not queued before it is scheduled");
+
+	std::vector<MipUpload> uploads = residency.ScheduleUploads(0, 1);
+	// The tail, plus a single mip over the budget since nothing else fit
+	CHECK(uploads.size() == 8, "Tail was not scheduled at once, " + std::to_string(uploads.size()) + " uploads");
+
+	for (std::size_t i = 0; i < uploads.size(); ++i)
+		CHECK(uploads[i].MipLevel == 8 - i, "Upload " + std::to_string(i) + " is mip " + std::to_string(uploads[i].MipLevel) + ", not the next coarsest");
+
+	CHECK(residency.GetMipResidency(texture, 1) == MipResidency::MIP_RESIDENCY_UPLOADING, "Scheduled mip is not uploading");
+	CHECK(residency.GetResidentMip(texture) == 9, "Mips are resident before their fence completed");
+
+	std::vector<uint32_t> changedTextures = residency.CompleteUploads(1);
+	CHECK(changedTextures.size() == 1 && changedTextures[0] == texture, "Completed texture is not reported as changed");
+	CHECK(residency.GetResidentMip(texture) == 1, "Resident mip is " + std::to_string(residency.GetResidentMip(texture)) + " instead of 1");
+}
+
+/* With a budget of one mip per texture and frame, textures of the same size refine together instead of one after the other */
+static void TestBudgetFairness()
+{
+	TextureResidency residency;
+	std::vector<std::size_t> mipByteSizes = GetMipByteSizes(1024);
+	const uint32_t numTextures = 4;
+
+	for (uint32_t i = 0; i < numTextures; ++i)
+		residency.AddTexture(mipByteSizes, 1);
+
+	// Every frame affords the next mip of every texture, the 1x1 tail of the first frame is outside the budget
+	for (uint64_t frame = 1; frame < mipByteSizes.size(); ++frame)
+	{
+		uint32_t nextMip = static_cast<uint32_t>(mipByteSizes.size() - 1 - frame);
+		std::size_t budget = mipByteSizes[nextMip] * numTextures;
+
+		std::vector<MipUpload> uploads = residency.ScheduleUploads(budget, frame);
+		residency.CompleteUploads(frame);
+
+		std::size_t numBudgetBytes = 0;
+		for (auto& upload : uploads)
+			numBudgetBytes += upload.MipLevel == mipByteSizes.size() - 1 ? 0 : upload.ByteSize;
+
+		CHECK(numBudgetBytes <= budget, "Frame " + std::to_string(frame) + " exceeds its budget");
+		for (uint32_t i = 0; i < numTextures; ++i)
+		{
+			CHECK(residency.GetResidentMip(i) == nextMip, "Texture " + std::to_string(i) + " is at mip " + std::to_string(residency.GetResidentMip(i)) +
+				" instead of " + std::to_string(nextMip) + " after frame " + std::to_string(frame));
+		}
+	}
+}
+
+/* A mip larger than the whole budget is uploaded on its own instead of stalling the texture */
+static void TestOversizedMip()
+{
+	TextureResidency residency;
+	uint32_t texture = residency.AddTexture({ 4096, 1024, 256 }, 1);
+	uint32_t smallTexture = residency.AddTexture({ 64, 16 }, 1);
+
+	residency.ScheduleUploads(0, 1);
+	residency.CompleteUploads(1);
+	CHECK(residency.IsFullyResident(smallTexture), "Small texture did not fit the first frame after its tail");
+
+	for (uint64_t frame = 2; frame < 4; ++frame)
+	{
+		std::vector<MipUpload> uploads = residency.ScheduleUploads(100, frame);
+		CHECK(uploads.size() == 1, "Frame " + std::to_string(frame) + " scheduled " + std::to_string(uploads.size()) + " mips over the budget");
+		residency.CompleteUploads(frame);
+	}
+
+	CHECK(residency.IsFullyResident(texture), "Mips over the budget did not become resident");
+}
+
+/* Fences are only seen completing some frames later, possibly several at once, and only the mips up to the completed fence become
+   resident. Finer mips scheduled before the coarser ones completed wait for them */
+static void TestDelayedFenceCompletion()
+{
+	TextureResidency residency;
+	uint32_t texture = residency.AddTexture({ 16384, 4096, 1024, 256, 64 }, 1);
+
+	// The tail and one mip over the budget with each fence value, the largest mip stays queued
+	for (uint64_t fenceValue = 1; fenceValue <= 3; ++fenceValue)
+		residency.ScheduleUploads(1, fenceValue);
+
+	CHECK(residency.CompleteUploads(0).empty(), "Uploads completed before their fence");
+	CHECK(residency.GetNumUploadingBytes() == 64 + 256 + 1024 + 4096, "Uploading bytes are " + std::to_string(residency.GetNumUploadingBytes()));
+
+	residency.CompleteUploads(1);
+	CHECK(residency.GetResidentMip(texture) == 3, "Resident mip is " + std::to_string(residency.GetResidentMip(texture)) + " instead of 3");
+	CHECK(residency.GetMipResidency(texture, 2) == MipResidency::MIP_RESIDENCY_UPLOADING, "Mip became resident before its fence");
+
+	// Fences 2 and 3 are seen completing together
+	CHECK(residency.CompleteUploads(3).size() == 1, "Texture is not reported as changed");
+	CHECK(residency.GetResidentMip(texture) == 1, "Resident mip is " + std::to_string(residency.GetResidentMip(texture)) + " instead of 1");
+	CHECK(residency.GetMipResidency(texture, 0) == MipResidency::MIP_RESIDENCY_QUEUED, "Unscheduled mip is not queued");
+	CHECK(residency.GetNumUploadingBytes() == 0, "Completed uploads still count as uploading");
+
+	// The same completed fence value again changes nothing
+	CHECK(residency.CompleteUploads(3).empty(), "Completing a fence twice changed the residency");
+
+	residency.ScheduleUploads(1, 4);
+	CHECK(residency.ScheduleUploads(1, 5).empty(), "Mips are scheduled twice");
+	CHECK(residency.CompleteUploads(5).size() == 1 && residency.IsFullyResident(texture), "Largest mip did not become resident");
+}
+
+/* Streaming many textures under a small budget ends with every mip resident and nothing left to schedule */
+static void TestFullResidency()
+{
+	TextureResidency residency;
+	for (uint32_t size = 1; size <= 2048; size *= 2)
+		residency.AddTexture(GetMipByteSizes(size), 3);
+
+	uint64_t fenceValue = 0;
+	while (fenceValue < 1000)
+	{
+		++fenceValue;
+		std::vector<MipUpload> uploads = residency.ScheduleUploads(256 * 1024, fenceValue);
+		residency.CompleteUploads(fenceValue);
+
+		if (uploads.empty())
+			break;
+	}
+
+	for (uint32_t i = 0; i < residency.GetNumTextures(); ++i)
+	{
+		CHECK(residency.IsFullyResident(i), "Texture " + std::to_string(i) + " is not fully resident after " + std::to_string(fenceValue) + " frames");
+		CHECK(residency.GetMipResidency(i, 0) == MipResidency::MIP_RESIDENCY_RESIDENT, "Largest mip of texture " + std::to_string(i) + " is not resident");
+	}
+
+	CHECK(residency.GetNumUploadingBytes() == 0, "Uploading bytes are left after every upload completed");
+	CHECK(residency.ScheduleUploads(256 * 1024, fenceValue + 1).empty(), "Fully resident textures are scheduled again");
+}
+
+int main()
+{
+	TestTailFirst();
+	TestBudgetFairness();
+	TestOversizedMip();
+	TestDelayedFenceCompletion();
+	TestFullResidency();
+
+	return Test::Finish("TextureResidencyTest");
+}
@@ -0,0 +1,342 @@
+#include "Pch.h"
+#include "Resource/BufferUploader.h"
+#include "Resource/ModelCooker.h"
+#include "Resource/VertexCompression.h"
+#include "Test.h"
+
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static constexpr std::size_t MB = 1024 * 1024;
+// 1M vertices and 2M triangles, 32 MB of cooked vertices and 24 MB of indices
+static constexpr uint32_t GRID_SIZE = 1024;
+// Resident memory a load may add on top of its upload memory, for the chunks of mapped data that are hashed or staged at a time and
+// the tables of the model. Loading the cooked grid peaks at about 9 MB, keeping all of its mapped data resident adds 56 MB
+static constexpr std::size_t MAX_RESIDENT_OVERHEAD = 12 * MB;
+// Printed by the measuring process in front of its results, the logs of its load are printed around it
+static const char* MEASUREMENT_MARKER = "UploadMemoryMeasurement";
+
+struct UploadMemoryMeasurement
+{
+	std::size_t StartPeakByteSize = 0;
+	std::size_t CookPeakByteSize = 0;
+	std::size_t UploadPeakByteSize = 0;
+	std::size_t UploadMemoryByteSize = 0;
+};
+
+/* Peak working set on Windows and maximum resident set size elsewhere, both since the process started */
+static std::size_t GetPeakResidentByteSize()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	// Kilobytes on Linux, bytes on macOS
+#ifdef __APPLE__
+	return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+	return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/* The options the renderer loads its model with */
+static ModelLoadDesc GetRendererLoadDesc(VertexFormat vertexFormat, std::size_t maxUploadByteSize)
+{
+	ModelLoadDesc loadDesc;
+	loadDesc.VertexBufferFormat = vertexFormat;
+	loadDesc.StreamTextures = true;
+	loadDesc.OptimizeMeshes = true;
+	loadDesc.MaxUploadByteSize = maxUploadByteSize;
+	return loadDesc;
+}
+
+/* Write a wavy grid with positions, normals, texture coordinates and 32-bit indices as a glTF model with an external buffer */
+static bool WriteGridModel(const std::string& directory)
+{
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> texCoords;
+	std::vector<uint32_t> indices;
+
+	for (uint32_t y = 0; y < GRID_SIZE; ++y)
+	{
+		for (uint32_t x = 0; x < GRID_SIZE; ++x)
+		{
+			glm::vec2 texCoord = glm::vec2(x, y) / static_cast<float>(GRID_SIZE - 1);
+			positions.push_back(glm::vec3(texCoord, 0.1f * std::sin(20.0f * texCoord.x) * std::cos(20.0f * texCoord.y)));
+			normals.push_back(glm::normalize(glm::vec3(-std::cos(20.0f * texCoord.x), std::sin(20.0f * texCoord.y), 1.0f)));
+			texCoords.push_back(texCoord);
+		}
+	}
+
+	for (uint32_t y = 0; y + 1 < GRID_SIZE; ++y)
+	{
+		for (uint32_t x = 0; x + 1 < GRID_SIZE; ++x)
+		{
+			uint32_t corner = y * GRID_SIZE + x;
+			indices.insert(indices.end(), { corner, corner + 1, corner + GRID_SIZE, corner + 1, corner + GRID_SIZE + 1, corner + GRID_SIZE });
+		}
+	}
+
+	std::size_t positionsByteSize = positions.size() * sizeof(glm::vec3);
+	std::size_t texCoordsByteSize = texCoords.size() * sizeof(glm::vec2);
+	std::size_t indicesByteSize = indices.size() * sizeof(uint32_t);
+
+	std::ofstream buffer(directory + "/Grid.bin", std::ios::binary | std::ios::trunc);
+	buffer.write(reinterpret_cast<const char*>(positions.data()), positionsByteSize);
+	buffer.write(reinterpret_cast<const char*>(normals.data()), positionsByteSize);
+	buffer.write(reinterpret_cast<const char*>(texCoords.data()), texCoordsByteSize);
+	buffer.write(reinterpret_cast<const char*>(indices.data()), indicesByteSize);
+	if (!buffer)
+		return false;
+
+	std::size_t numVertices = positions.size();
+	auto bufferView = [](std::size_t byteOffset, std::size_t byteSize) {
+		return "{ \"buffer\": 0, \"byteOffset\": " + std::to_string(byteOffset) + ", \"byteLength\": " + std::to_string(byteSize) + " }";
+	};
+	auto accessor = [](uint32_t bufferView, uint32_t componentType, std::size_t count, const std::string& type) {
+		return "{ \"bufferView\": " + std::to_string(bufferView) + ", \"componentType\": " + std::to_string(componentType) + ", \"count\": " +
+			std::to_string(count) + ", \"type\": \"" + type + "\"";
+	};
+
+	std::ofstream gltf(directory + "/Grid.gltf", std::ios::trunc);
+	gltf << "{\n\"asset\": { \"version\": \"2.0\" },\n\"scene\": 0,\n\"scenes\": [{ \"nodes\": [0] }],\n\"nodes\": [{ \"mesh\": 0 }],\n";
+	gltf << "\"meshes\": [{ \"primitives\": [{ \"attributes\": { \"POSITION\": 0, \"NORMAL\": 1, \"TEXCOORD_0\": 2 }, \"indices\": 3, \"material\": 0 }] }],\n";
+	gltf << "\"materials\": [{ \"pbrMetallicRoughness\": { \"baseColorFactor\": [1, 1, 1, 1] } }],\n";
+	gltf << "\"buffers\": [{ \"uri\": \"Grid.bin\", \"byteLength\": " << 2 * positionsByteSize + texCoordsByteSize + indicesByteSize << " }],\n";
+	gltf << "\"bufferViews\": [" << bufferView(0, positionsByteSize) << ", " << bufferView(positionsByteSize, positionsByteSize) << ", " <<
+		bufferView(2 * positionsByteSize, texCoordsByteSize) << ", " << bufferView(2 * positionsByteSize + texCoordsByteSize, indicesByteSize) << "],\n";
+	gltf << "\"accessors\": [" << accessor(0, 5126, numVertices, "VEC3") << ", \"min\": [0, 0, -0.1], \"max\": [1, 1, 0.1] }, " <<
+		accessor(1, 5126, numVertices, "VEC3") << " }, " << accessor(2, 5126, numVertices, "VEC2") << " }, " <<
+		accessor(3, 5125, indices.size(), "SCALAR") << " }]\n}\n";
+
+	return static_cast<bool>(gltf);
+}
+
+/* Chunks end on whole elements and keep the memory in flight below the limit, a limit below a single element still makes progress */
+static void TestChunkPlanning()
+{
+	BufferUpload upload;
+	upload.ByteSize = 160;
+	upload.ElementByteSize = 16;
+	std::vector<BufferUpload> uploads = { upload, upload };
+
+	std::vector<BufferUploadChunk> chunks;
+	std::size_t uploadOffset = BufferUploader::PlanChunks(uploads, 50, 0, 100, chunks);
+	CHECK(chunks.size() == 1 && chunks[0].ByteSize == 48 && uploadOffset == 48, "Chunk next to 50 bytes in flight is not 48 bytes");
+
+	chunks.clear();
+	uploadOffset = BufferUploader::PlanChunks(uploads, 90, 0, 100, chunks);
+	CHECK(chunks.empty() && uploadOffset == 0, "Chunk was planned with less than an element of room");
+
+	chunks.clear();
+	uploadOffset = BufferUploader::PlanChunks(uploads, 0, 0, 10, chunks);
+	CHECK(chunks.size() == 1 && chunks[0].ByteSize == 16, "Limit below an element does not get a single element through");
+
+	// The first upload ends inside the limit, so the second one continues in the same upload memory
+	uploads[0].NumBytesSubmitted = 128;
+	chunks.clear();
+	uploadOffset = BufferUploader::PlanChunks(uploads, 0, 0, 100, chunks);
+	CHECK(chunks.size() == 2 && chunks[1].UploadIndex == 1 && chunks[1].UploadOffset == 32 && chunks[1].ByteSize == 64 && uploadOffset == 96,
+		"Second upload does not continue after the end of the first");
+}
+
+/* Every format stages exactly the buffers that encoding the whole model at once gives, through chunks that stay within the limit */
+static void TestStagedContent(const std::string& filepath)
+{
+	const std::size_t maxUploadByteSize = 100003;
+
+	for (VertexFormat format : { VertexFormat::VERTEX_FORMAT_FLOAT, VertexFormat::VERTEX_FORMAT_COMPACT, VertexFormat::VERTEX_FORMAT_QUANTIZED })
+	{
+		std::string name = "Vertex format " + std::to_string(static_cast<uint32_t>(format));
+
+		ModelData data;
+		bool isCooked = ModelCooker::Cook(filepath, GetRendererLoadDesc(format, maxUploadByteSize), nullptr, ModelCookCallbacks(), data);
+		CHECK(isCooked, "Failed to load " + filepath);
+		if (!isCooked)
+			return;
+
+		const CookedModelData& cooked = data.Cooked;
+		if (format == VertexFormat::VERTEX_FORMAT_QUANTIZED)
+		{
+			PositionQuantization quantization = VertexCompression::ComputePositionQuantization(cooked.Vertices, cooked.NumVertices);
+			CHECK(quantization.Min == data.VertexQuantization.Min && quantization.Extent == data.VertexQuantization.Extent,
+				"Quantization of the chunks differs from that of all vertices");
+		}
+
+		std::vector<unsigned char> expectedVertices(cooked.NumVertices * VertexCompression::GetVertexByteSize(format));
+		VertexCompression::Compress(cooked.Vertices, cooked.NumVertices, format, data.VertexQuantization, expectedVertices.data());
+		const unsigned char* expectedIndices = static_cast<const unsigned char*>(cooked.Indices);
+
+		std::vector<BufferUpload> uploads = { BufferUploader::GetVertexBufferUpload(data, format), BufferUploader::GetIndexBufferUpload(data) };
+		std::vector<std::vector<unsigned char>> buffers = { std::vector<unsigned char>(uploads[0].ByteSize), std::vector<unsigned char>(uploads[1].ByteSize) };
+
+		std::vector<unsigned char> uploadMemory;
+		bool isWithinLimit = true;
+
+		BufferUploader::StageUploads(uploads, maxUploadByteSize,
+			[&uploadMemory](std::size_t byteSize) { uploadMemory.resize(byteSize); return uploadMemory.data(); },
+			[&](const BufferUploadChunk& chunk, std::size_t byteOffset) {
+				isWithinLimit &= chunk.UploadOffset + chunk.ByteSize <= uploadMemory.size();
+				std::memcpy(buffers[chunk.UploadIndex].data() + byteOffset, uploadMemory.data() + chunk.UploadOffset, chunk.ByteSize);
+			});
+
+		CHECK(uploadMemory.size() <= maxUploadByteSize && isWithinLimit, name + " staged beyond the upload memory of " + std::to_string(maxUploadByteSize) + " bytes");
+		CHECK(buffers[0] == expectedVertices, name + " staged other vertices than encoding all of them");
+		CHECK(std::memcmp(buffers[1].data(), expectedIndices, buffers[1].size()) == 0, name + " staged other indices than the cooked ones");
+	}
+}
+
+/* Runs in the measuring process, loads the model with the options of the renderer and stages its buffers through CPU memory in place
+   of the upload heap, then prints the measurement after the marker */
+static int MeasureLoad(const std::string& filepath, VertexFormat vertexFormat, std::size_t maxUploadByteSize)
+{
+	UploadMemoryMeasurement measurement;
+	measurement.StartPeakByteSize = GetPeakResidentByteSize();
+
+	ModelData data;
+	if (!ModelCooker::Cook(filepath, GetRendererLoadDesc(vertexFormat, maxUploadByteSize), nullptr, ModelCookCallbacks(), data))
+		return 1;
+
+	measurement.CookPeakByteSize = GetPeakResidentByteSize();
+
+	std::vector<BufferUpload> uploads = { BufferUploader::GetVertexBufferUpload(data, vertexFormat), BufferUploader::GetIndexBufferUpload(data) };
+	std::unique_ptr<unsigned char[]> uploadMemory;
+	uint64_t checksum = 0;
+
+	BufferUploader::StageUploads(uploads, maxUploadByteSize,
+		[&uploadMemory, &measurement](std::size_t byteSize) {
+			uploadMemory.reset(new unsigned char[byteSize]);
+			measurement.UploadMemoryByteSize = byteSize;
+			return uploadMemory.get();
+		},
+		// Stands in for the copy on the copy queue, which reads the staged chunk
+		[&uploadMemory, &checksum](const BufferUploadChunk& chunk, std::size_t) {
+			for (std::size_t i = 0; i < chunk.ByteSize; i += 4096)
+				checksum += uploadMemory[chunk.UploadOffset + i];
+		});
+
+	measurement.UploadPeakByteSize = GetPeakResidentByteSize();
+
+	printf("%s %zu %zu %zu %zu %llu\n", MEASUREMENT_MARKER, measurement.StartPeakByteSize, measurement.CookPeakByteSize,
+		measurement.UploadPeakByteSize, measurement.UploadMemoryByteSize, static_cast<unsigned long long>(checksum));
+	return 0;
+}
+
+/* Runs this executable on one vertex format and limit, since the peak resident size of a process never goes down, and reads the
+   measurement from its output */
+static bool RunMeasurement(const std::string& executable, const std::string& filepath, VertexFormat vertexFormat, std::size_t maxUploadByteSize,
+	UploadMemoryMeasurement& measurement)
+{
+	std::string command = "\"" + executable + "\" --measure " + std::to_string(static_cast<uint32_t>(vertexFormat)) + " " +
+		std::to_string(maxUploadByteSize) + " \"" + filepath + "\"";
+
+#ifdef _WIN32
+	// cmd.exe strips the outer quotes of the command, which keeps the ones around the paths
+	FILE* pipe = _popen(("\"" + command + "\"").c_str(), "r");
+#else
+	FILE* pipe = popen(command.c_str(), "r");
+#endif
+
+	if (!pipe)
+		return false;
+
+	bool isMeasured = false;
+	char line[1024];
+
+	while (std::fgets(line, sizeof(line), pipe))
+	{
+		const char* marker = std::strstr(line, MEASUREMENT_MARKER);
+		if (!marker)
+			continue;
+
+		unsigned long long checksum = 0;
+		isMeasured = std::sscanf(marker + std::strlen(MEASUREMENT_MARKER), "%zu %zu %zu %zu %llu", &measurement.StartPeakByteSize,
+			&measurement.CookPeakByteSize, &measurement.UploadPeakByteSize, &measurement.UploadMemoryByteSize, &checksum) == 5;
+	}
+
+#ifdef _WIN32
+	int status = _pclose(pipe);
+#else
+	int status = pclose(pipe);
+#endif
+
+	return isMeasured && status == 0;
+}
+
+/* A load with the options of the renderer stays within its upload limit plus a fixed overhead, for both vertex formats the renderer
+   uses. The peak grows with the limit, so the measurement does see the upload memory */
+static void TestPeakResidentSize(const std::string& executable, const std::string& filepath)
+{
+	for (VertexFormat format : { VertexFormat::VERTEX_FORMAT_COMPACT, VertexFormat::VERTEX_FORMAT_QUANTIZED })
+	{
+		std::vector<std::size_t> uploadPeakByteSizes;
+
+		for (std::size_t maxUploadByteSize : { 1 * MB, 4 * MB, 32 * MB })
+		{
+			std::string name = "Vertex format " + std::to_string(static_cast<uint32_t>(format)) + " with an upload limit of " +
+				std::to_string(maxUploadByteSize / MB) + " MB";
+
+			UploadMemoryMeasurement measurement;
+			bool isMeasured = RunMeasurement(executable, filepath, format, maxUploadByteSize, measurement);
+			CHECK(isMeasured, "Failed to measure " + name);
+			if (!isMeasured)
+				return;
+
+			std::size_t cookByteSize = measurement.CookPeakByteSize - measurement.StartPeakByteSize;
+			std::size_t uploadByteSize = measurement.UploadPeakByteSize - measurement.StartPeakByteSize;
+			uploadPeakByteSizes.push_back(measurement.UploadPeakByteSize);
+
+			LOG_INFO("[UploadMemoryTest] " + name + ": " + std::to_string(measurement.UploadMemoryByteSize / 1024) + " KB of upload memory, peak " +
+				std::to_string(cookByteSize / 1024) + " KB above the start after the cook, " + std::to_string(uploadByteSize / 1024) + " KB after the uploads");
+
+			CHECK(measurement.UploadMemoryByteSize <= maxUploadByteSize, name + " allocated " + std::to_string(measurement.UploadMemoryByteSize) + " bytes of upload memory");
+			CHECK(uploadByteSize <= maxUploadByteSize + MAX_RESIDENT_OVERHEAD, name + " peaked at " + std::to_string(uploadByteSize / 1024) +
+				" KB above the start");
+		}
+
+		CHECK(uploadPeakByteSizes.back() >= uploadPeakByteSizes.front() + 16 * MB, "Peak resident size of vertex format " +
+			std::to_string(static_cast<uint32_t>(format)) + " does not grow with the upload memory");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	// Set in the processes the test starts, which measure a single load
+	if (argc == 5 && std::string(argv[1]) == "--measure")
+		return MeasureLoad(argv[4], static_cast<VertexFormat>(std::stoul(argv[2])), static_cast<std::size_t>(std::stoull(argv[3])));
+
+	// The model and its cooked file are written to a scratch directory, so the models of the renderer are never cooked again
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "UploadMemoryTest";
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	std::string filepath = (directory / "Grid.gltf").string();
+
+	TestChunkPlanning();
+
+	bool isWritten = WriteGridModel(directory.string());
+	CHECK(isWritten, "Failed to write " + filepath);
+
+	if (isWritten)
+	{
+		// The first load cooks the model, the measured loads read its cooked file like the renderer reads a model cooked ahead of time
+		TestStagedContent(filepath);
+		TestPeakResidentSize(argv[0], filepath);
+	}
+
+	std::filesystem::remove_all(directory, error);
+	return Test::Finish("UploadMemoryTest");
+}
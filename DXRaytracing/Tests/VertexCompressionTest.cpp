@@ -0,0 +1,134 @@
+#include "Pch.h"
+#include "Resource/VertexCompression.h"
+#include "Test.h"
+
+#include <random>
+
+static const char* GetFormatName(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::VERTEX_FORMAT_COMPACT:
+		return "compact";
+	case VertexFormat::VERTEX_FORMAT_QUANTIZED:
+		return "quantized";
+	default:
+		return "float";
+	}
+}
+
+/* Unit normals spread over the sphere, texture coordinates outside [0, 1] and positions in a flat box, so every axis of the
+   quantization has a different extent. The axes and octant edges are added explicitly, octahedral encoding folds around them */
+static std::vector<Vertex> GenerateVertices(std::size_t numRandomVertices)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> texCoord(-4.0f, 4.0f);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+
+	std::vector<Vertex> vertices;
+	vertices.reserve(numRandomVertices + 16);
+
+	while (vertices.size() < numRandomVertices)
+	{
+		glm::vec3 normal(direction(random), direction(random), direction(random));
+		if (glm::length(normal) < 1e-3f)
+			continue;
+
+		Vertex vertex;
+		vertex.Position = glm::vec3(position(random), position(random), position(random) * 0.01f);
+		vertex.TexCoord = glm::vec2(texCoord(random), texCoord(random));
+		vertex.Normal = glm::normalize(normal);
+		vertices.push_back(vertex);
+	}
+
+	const glm::vec3 edgeNormals[] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::normalize(glm::vec3(1.0f, 0.0f, -1.0f)),
+		glm::normalize(glm::vec3(-1.0f, 1.0f, 0.0f)), glm::normalize(glm::vec3(0.0f, -1.0f, -1.0f)), glm::normalize(glm::vec3(-1.0f, -1.0f, -1.0f)) };
+
+	for (auto& normal : edgeNormals)
+	{
+		Vertex vertex;
+		vertex.Position = glm::vec3(0.0f);
+		vertex.TexCoord = glm::vec2(0.5f);
+		vertex.Normal = normal;
+		vertices.push_back(vertex);
+	}
+
+	return vertices;
+}
+
+/* Every format stays within the error bounds it reports, measured on the CPU encode and decode the hit shader shares */
+static void TestErrorBounds(const std::vector<Vertex>& vertices)
+{
+	PositionQuantization quantization = VertexCompression::ComputePositionQuantization(vertices.data(), vertices.size());
+
+	for (VertexFormat format : { VertexFormat::VERTEX_FORMAT_FLOAT, VertexFormat::VERTEX_FORMAT_COMPACT, VertexFormat::VERTEX_FORMAT_QUANTIZED })
+	{
+		std::string name = GetFormatName(format);
+
+		std::vector<unsigned char> compressed(vertices.size() * VertexCompression::GetVertexByteSize(format));
+		VertexCompression::Compress(vertices.data(), vertices.size(), format, quantization, compressed.data());
+
+		VertexCompressionError error = VertexCompression::MeasureError(vertices.data(), vertices.size(), compressed.data(), format, quantization);
+		VertexCompressionError bounds = VertexCompression::GetErrorBounds(format, quantization);
+
+		CHECK(error.MaxPositionError <= bounds.MaxPositionError, name + " position error " + std::to_string(error.MaxPositionError) +
+			" exceeds its bound " + std::to_string(bounds.MaxPositionError));
+		CHECK(error.MaxNormalAngle <= bounds.MaxNormalAngle, name + " normal angle " + std::to_string(error.MaxNormalAngle) +
+			" exceeds its bound " + std::to_string(bounds.MaxNormalAngle));
+		CHECK(error.MaxTexCoordError <= bounds.MaxTexCoordError, name + " texture coordinate error " + std::to_string(error.MaxTexCoordError) +
+			" exceeds its bound " + std::to_string(bounds.MaxTexCoordError));
+
+		LOG_INFO("[VertexCompressionTest] " + name + ": " + std::to_string(VertexCompression::GetVertexByteSize(format)) + " bytes, position " +
+			std::to_string(error.MaxPositionError) + ", normal " + std::to_string(error.MaxNormalAngle) + " rad, texture coordinate " +
+			std::to_string(error.MaxTexCoordError));
+	}
+}
+
+/* The compact formats are what halves the vertex buffer, and the float format is a plain copy */
+static void TestVertexByteSizes(const std::vector<Vertex>& vertices)
+{
+	CHECK(VertexCompression::GetVertexByteSize(VertexFormat::VERTEX_FORMAT_FLOAT) == sizeof(Vertex), "Float vertices are not stored as is");
+	CHECK(VertexCompression::GetVertexByteSize(VertexFormat::VERTEX_FORMAT_QUANTIZED) * 2 <= sizeof(Vertex), "Quantized vertices are not half the size");
+	CHECK(VertexCompression::GetVertexByteSize(VertexFormat::VERTEX_FORMAT_COMPACT) < sizeof(Vertex), "Compact vertices are not smaller");
+
+	PositionQuantization quantization;
+	std::vector<Vertex> decompressed(vertices.size());
+	VertexCompression::Compress(vertices.data(), vertices.size(), VertexFormat::VERTEX_FORMAT_FLOAT, quantization, decompressed.data());
+	CHECK(std::memcmp(decompressed.data(), vertices.data(), vertices.size() * sizeof(Vertex)) == 0, "Float vertices change when compressed");
+}
+
+/* Boxes that are flat on an axis still get a valid extent, and their corners decode back onto the box */
+static void TestPositionQuantization()
+{
+	Vertex corners[2] = {};
+	corners[0].Position = glm::vec3(-2.0f, 3.0f, 5.0f);
+	corners[1].Position = glm::vec3(6.0f, 3.0f, 9.0f);
+
+	PositionQuantization quantization = VertexCompression::ComputePositionQuantization(corners, 2);
+	CHECK(quantization.Extent.y > 0.0f, "Flat axis has no quantization extent");
+
+	QuantizedVertex quantized[2];
+	Vertex decoded[2];
+	VertexCompression::Compress(corners, 2, VertexFormat::VERTEX_FORMAT_QUANTIZED, quantization, quantized);
+	VertexCompression::Decompress(quantized, 2, VertexFormat::VERTEX_FORMAT_QUANTIZED, quantization, decoded);
+
+	float maxError = VertexCompression::GetErrorBounds(VertexFormat::VERTEX_FORMAT_QUANTIZED, quantization).MaxPositionError;
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		glm::vec3 error = glm::abs(decoded[i].Position - corners[i].Position);
+		CHECK(std::max(error.x, std::max(error.y, error.z)) <= maxError, "Corner " + std::to_string(i) + " of the quantization box moved");
+	}
+}
+
+int main()
+{
+	std::vector<Vertex> vertices = GenerateVertices(1000000);
+
+	TestErrorBounds(vertices);
+	TestVertexByteSizes(vertices);
+	TestPositionQuantization();
+
+	return Test::Finish("VertexCompressionTest");
+}
@@ -0,0 +1,235 @@
+#include "Pch.h"
+#include "AssetCooker.h"
+#include "Resource/ModelCooker.h"
+#include "Util/ThreadPool.h"
+
+#include <filesystem>
+#include <map>
+#include <unordered_set>
+
+static std::string GetLowercaseExtension(const std::filesystem::path& path)
+{
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+
+	return extension;
+}
+
+static bool IsModelFile(const std::filesystem::path& path)
+{
+	std::string extension = GetLowercaseExtension(path);
+	return extension == ".gltf" || extension == ".glb";
+}
+
+static bool IsGLBFile(const std::string& filepath)
+{
+	return GetLowercaseExtension(filepath) == ".glb";
+}
+
+static std::size_t GetFileByteSize(const std::string& filepath)
+{
+	std::error_code error;
+	std::uintmax_t byteSize = std::filesystem::file_size(filepath, error);
+
+	return error ? 0 : static_cast<std::size_t>(byteSize);
+}
+
+static const char* AssetCookStatusToString(AssetCookStatus status)
+{
+	switch (status)
+	{
+	case AssetCookStatus::ASSET_COOK_STATUS_UP_TO_DATE:
+		return "up to date";
+	case AssetCookStatus::ASSET_COOK_STATUS_COOKED:
+		return "cooked";
+	case AssetCookStatus::ASSET_COOK_STATUS_FAILED:
+		return "failed";
+	case AssetCookStatus::ASSET_COOK_STATUS_NOT_COOKED:
+		return "not cooked";
+	}
+
+	return "";
+}
+
+static AssetCookResult CookAsset(const std::string& filepath, const ModelLoadDesc& loadDesc)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	AssetCookResult result;
+	result.Filepath = filepath;
+
+	ModelData data;
+	if (ModelCooker::Cook(filepath, loadDesc, nullptr, ModelCookCallbacks(), data))
+	{
+		const CookedModelData& cooked = data.Cooked;
+		std::string directory = ModelCache::GetDirectory(filepath);
+
+		for (auto& dependency : cooked.Dependencies)
+			result.SourceByteSize += GetFileByteSize(directory + dependency);
+		for (auto& imageURI : cooked.ImageURIs)
+			result.SourceByteSize += GetFileByteSize(directory + imageURI);
+
+		// Only a cooked model that passed its hash check is mapped, a model that was cooked again owns its data
+		result.CookedByteSize = GetFileByteSize(ModelCache::GetCookedFilepath(filepath));
+		if (result.CookedByteSize == 0)
+			result.Status = AssetCookStatus::ASSET_COOK_STATUS_NOT_COOKED;
+		else
+			result.Status = cooked.MappedFile ? AssetCookStatus::ASSET_COOK_STATUS_UP_TO_DATE : AssetCookStatus::ASSET_COOK_STATUS_COOKED;
+
+		// Duplicate textures share the cooked texture of the first one
+		bool compress = loadDesc.TextureCompressionMode != TextureCompression::TEXTURE_COMPRESSION_NONE;
+		for (auto& texture : data.Textures)
+		{
+			if (compress && texture.IsCacheable && texture.DuplicateOf < 0)
+				result.CookedByteSize += GetFileByteSize(ModelCache::GetCookedTextureFilepath(directory, texture.ContentHash));
+		}
+
+		result.NumVertices = cooked.NumVertices;
+		for (auto& submesh : cooked.Submeshes)
+			result.NumTriangles += submesh.NumIndices / 3;
+
+		result.NumMeshlets = cooked.Meshlets.size();
+		result.NumLODs = cooked.LODs.size();
+		result.NumTextures = data.Textures.size();
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+	result.Duration = elapsed.count();
+
+	return result;
+}
+
+std::vector<AssetCookResult> AssetCooker::CookAll(const AssetCookerDesc& desc)
+{
+	std::map<std::string, std::vector<std::string>> directoryModels;
+
+	std::error_code error;
+	std::filesystem::recursive_directory_iterator iter(desc.ModelDirectory, error), end;
+
+	for (; !error && iter != end; iter.increment(error))
+	{
+		if (iter->is_regular_file() && IsModelFile(iter->path()))
+			directoryModels[iter->path().parent_path().generic_string()].push_back(iter->path().generic_string());
+	}
+
+	if (error)
+		LOG_ERR("[AssetCooker] Failed to search " + desc.ModelDirectory + " for models: " + error.message());
+
+	struct DirectoryJob
+	{
+		std::vector<std::string> Filepaths;
+		std::size_t ByteSize = 0;
+	};
+
+	std::vector<DirectoryJob> jobs;
+	for (auto& [directory, filepaths] : directoryModels)
+	{
+		DirectoryJob job;
+		job.Filepaths = filepaths;
+
+		// A .gltf and a .glb of the same name share their cooked filepath, the .gltf goes first since only models that reference
+		// their images by file can be cooked
+		std::sort(job.Filepaths.begin(), job.Filepaths.end(), [](const std::string& lhs, const std::string& rhs) {
+			return std::make_pair(ModelCache::GetCookedFilepath(lhs), IsGLBFile(lhs)) < std::make_pair(ModelCache::GetCookedFilepath(rhs), IsGLBFile(rhs));
+		});
+
+		for (auto& entry : std::filesystem::directory_iterator(directory, error))
+			job.ByteSize += entry.is_regular_file(error) ? GetFileByteSize(entry.path().string()) : 0;
+
+		jobs.push_back(job);
+	}
+
+	// The largest directories are started first, so a single large model does not end up cooking on its own at the end
+	std::stable_sort(jobs.begin(), jobs.end(), [](const DirectoryJob& lhs, const DirectoryJob& rhs) { return lhs.ByteSize > rhs.ByteSize; });
+
+	uint32_t numHardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	uint32_t numJobs = desc.NumJobs > 0 ? desc.NumJobs : numHardwareThreads;
+	numJobs = std::max(1u, std::min(numJobs, static_cast<uint32_t>(jobs.size())));
+
+	// The hardware threads are split between the jobs, so a single large model still builds its textures in parallel
+	ModelLoadDesc loadDesc = desc.LoadDesc;
+	if (loadDesc.NumWorkerThreads == 0)
+		loadDesc.NumWorkerThreads = std::max(1u, numHardwareThreads / numJobs);
+
+	LOG_INFO("[AssetCooker] Cooking " + std::to_string(jobs.size()) + " directories on " + std::to_string(numJobs) + " jobs with " +
+		std::to_string(loadDesc.NumWorkerThreads) + " worker threads each");
+
+	std::vector<AssetCookResult> results;
+	std::mutex resultsMutex;
+
+	ThreadPool threadPool(numJobs);
+	for (auto& job : jobs)
+	{
+		threadPool.Submit([&results, &resultsMutex, &loadDesc, &job]() {
+			// Models with the same cooked filepath would overwrite each other's cooked model
+			std::unordered_set<std::string> cookedFilepaths;
+
+			for (auto& filepath : job.Filepaths)
+			{
+				AssetCookResult result;
+				result.Filepath = filepath;
+
+				if (cookedFilepaths.insert(ModelCache::GetCookedFilepath(filepath)).second)
+				{
+					result = CookAsset(filepath, loadDesc);
+				}
+				else
+				{
+					LOG_WARN("[AssetCooker] Model has the same cooked filepath as another model and is not cooked: " + filepath);
+					result.Status = AssetCookStatus::ASSET_COOK_STATUS_NOT_COOKED;
+				}
+
+				std::lock_guard<std::mutex> lock(resultsMutex);
+				results.push_back(result);
+			}
+		});
+	}
+
+	threadPool.WaitIdle();
+
+	std::sort(results.begin(), results.end(), [](const AssetCookResult& lhs, const AssetCookResult& rhs) { return lhs.Filepath < rhs.Filepath; });
+	return results;
+}
+
+void AssetCooker::PrintReport(const std::vector<AssetCookResult>& results, float duration)
+{
+	int filepathWidth = static_cast<int>(strlen("Asset"));
+	for (auto& result : results)
+		filepathWidth = std::max(filepathWidth, static_cast<int>(result.Filepath.size()));
+
+	printf("\n%-*s  %-10s  %10s  %12s  %12s  %10s  %10s  %9s  %5s  %8s\n", filepathWidth, "Asset", "Status", "Time (ms)", "Source (KB)",
+		"Cooked (KB)", "Vertices", "Triangles", "Meshlets", "LODs", "Textures");
+
+	uint32_t statusCounts[4] = {};
+	std::size_t sourceByteSize = 0, cookedByteSize = 0;
+
+	for (auto& result : results)
+	{
+		printf("%-*s  %-10s  %10.1f  %12zu  %12zu  %10zu  %10zu  %9zu  %5zu  %8zu\n", filepathWidth, result.Filepath.c_str(),
+			AssetCookStatusToString(result.Status), result.Duration, result.SourceByteSize / 1024, result.CookedByteSize / 1024,
+			result.NumVertices, result.NumTriangles, result.NumMeshlets, result.NumLODs, result.NumTextures);
+
+		statusCounts[static_cast<uint32_t>(result.Status)]++;
+		sourceByteSize += result.SourceByteSize;
+		cookedByteSize += result.CookedByteSize;
+	}
+
+	printf("\n%zu assets in %.1f ms: %u cooked, %u up to date, %u not cooked, %u failed\n", results.size(), duration,
+		statusCounts[static_cast<uint32_t>(AssetCookStatus::ASSET_COOK_STATUS_COOKED)],
+		statusCounts[static_cast<uint32_t>(AssetCookStatus::ASSET_COOK_STATUS_UP_TO_DATE)],
+		statusCounts[static_cast<uint32_t>(AssetCookStatus::ASSET_COOK_STATUS_NOT_COOKED)],
+		statusCounts[static_cast<uint32_t>(AssetCookStatus::ASSET_COOK_STATUS_FAILED)]);
+	printf("Sources %.1f MB, cooked %.1f MB\n", sourceByteSize / (1024.0 * 1024.0), cookedByteSize / (1024.0 * 1024.0));
+
+	// Stages with a name per image or model are summed up under the name of the stage
+	std::map<std::string, float> stageDurations;
+	for (auto& [name, timerResult] : Profiler::Get().GetTimerResults())
+		stageDurations[name.substr(0, name.find(' '))] += timerResult.Duration;
+
+	if (stageDurations.empty())
+		return;
+
+	printf("\n%-*s  %10s\n", filepathWidth, "Stage, summed over all threads", "Time (ms)");
+	for (auto& [name, stageDuration] : stageDurations)
+		printf("%-*s  %10.1f\n", filepathWidth, name.c_str(), stageDuration);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "ResourceLoader.h"
+
+struct AssetCookerDesc
+{
+	// Searched recursively for .gltf and .glb models
+	std::string ModelDirectory = "Resources/Models";
+	// Number of directories cooked at the same time, 0 uses one per hardware thread up to the number of directories
+	uint32_t NumJobs = 0;
+	// Options every asset is cooked with, the cooked files are only used by loads with the same options
+	ModelLoadDesc LoadDesc;
+};
+
+enum class AssetCookStatus : uint32_t
+{
+	// The cooked model was up to date with the hashes of its sources and was only read back
+	ASSET_COOK_STATUS_UP_TO_DATE,
+	ASSET_COOK_STATUS_COOKED,
+	ASSET_COOK_STATUS_FAILED,
+	// The model loads but has no cooked file, because it embeds its images or has the cooked filepath of another model
+	ASSET_COOK_STATUS_NOT_COOKED
+};
+
+struct AssetCookResult
+{
+	std::string Filepath;
+	AssetCookStatus Status = AssetCookStatus::ASSET_COOK_STATUS_FAILED;
+	float Duration = 0.0f;
+
+	// Source files and images the cooked model depends on, and the cooked model with its cooked textures
+	std::size_t SourceByteSize = 0;
+	std::size_t CookedByteSize = 0;
+
+	std::size_t NumVertices = 0;
+	std::size_t NumTriangles = 0;
+	std::size_t NumMeshlets = 0;
+	std::size_t NumLODs = 0;
+	std::size_t NumTextures = 0;
+};
+
+/*
+	Cooks every model of a directory tree into the cooked model and texture files the runtime loads, without a window or a device.
+	Models are cooked with the same code as ResourceLoader, so assets whose cooked files are up to date are skipped by their hashes.
+*/
+class AssetCooker
+{
+public:
+	/* Directories are cooked in parallel and the models of one directory in order, since models in the same directory can share
+	   cooked textures. Results are sorted by filepath */
+	static std::vector<AssetCookResult> CookAll(const AssetCookerDesc& desc);
+
+	static void PrintReport(const std::vector<AssetCookResult>& results, float duration);
+
+};
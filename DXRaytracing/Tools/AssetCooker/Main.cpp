@@ -0,0 +1,78 @@
+#include "Pch.h"
+#include "AssetCooker.h"
+
+static void PrintUsage()
+{
+	printf("Usage: AssetCooker [model directory] [-j jobs] [-t worker threads per job] [--compression none|bc1|bc7]\n");
+	printf("Cooks every .gltf and .glb model below the directory, Resources/Models by default. Models whose cooked files are up to date\n");
+	printf("are skipped, the models are cooked with the default load options plus mesh optimization, meshlets and levels of detail\n");
+}
+
+static bool ParseCompression(const std::string& name, TextureCompression& compression)
+{
+	if (name == "none")
+		compression = TextureCompression::TEXTURE_COMPRESSION_NONE;
+	else if (name == "bc1")
+		compression = TextureCompression::TEXTURE_COMPRESSION_BC1_BC3;
+	else if (name == "bc7")
+		compression = TextureCompression::TEXTURE_COMPRESSION_BC7;
+	else
+		return false;
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	AssetCookerDesc desc;
+	// The renderer loads its models with optimized meshes, any other setting would make it cook the model again. Meshlets and levels
+	// of detail are only built ahead of time, the renderer reads the cooked model without asking for them
+	desc.LoadDesc.OptimizeMeshes = true;
+	desc.LoadDesc.BuildMeshlets = true;
+	desc.LoadDesc.GenerateLODs = true;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (argument == "-j" && hasValue)
+		{
+			desc.NumJobs = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (argument == "-t" && hasValue)
+		{
+			desc.LoadDesc.NumWorkerThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (argument == "--compression" && hasValue)
+		{
+			if (!ParseCompression(argv[++i], desc.LoadDesc.TextureCompressionMode))
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (argument[0] != '-')
+		{
+			desc.ModelDirectory = argument;
+		}
+		else
+		{
+			PrintUsage();
+			return argument == "-h" || argument == "--help" ? 0 : 1;
+		}
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	std::vector<AssetCookResult> results = AssetCooker::CookAll(desc);
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+	AssetCooker::PrintReport(results, elapsed.count());
+
+	// Build machines fail the step on a model that did not load
+	bool failed = std::any_of(results.begin(), results.end(), [](const AssetCookResult& result) {
+		return result.Status == AssetCookStatus::ASSET_COOK_STATUS_FAILED;
+	});
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,457 @@
+#include "Pch.h"
+#include "Graphics/ViewData.h"
+#include "Resource/BVHBuilder.h"
+#include "Resource/BVHTraversal.h"
+#include "Resource/LBVHBuilder.h"
+#include "Resource/ModelCooker.h"
+#include "Scene/Camera.h"
+#include "Util/ThreadPool.h"
+
+#include <random>
+
+enum class BVHBuilderType : uint32_t
+{
+	BVH_BUILDER_TYPE_SAH,
+	BVH_BUILDER_TYPE_LBVH
+};
+
+struct BVHBenchmarkDesc
+{
+	std::vector<std::string> ModelFilepaths;
+	std::vector<BVHBuilderType> Builders = { BVHBuilderType::BVH_BUILDER_TYPE_SAH, BVHBuilderType::BVH_BUILDER_TYPE_LBVH };
+	// Every model is built once per leaf size, and by the LBVH builder once per thread count as well. The SAH builder is single threaded
+	std::vector<uint32_t> LeafSizes = { 4 };
+	std::vector<uint32_t> ThreadCounts;
+	BVHBuildDesc BuildDesc;
+	LBVHBuildDesc LBVHDesc;
+	// Builds per configuration, the fastest one is reported
+	uint32_t NumRepetitions = 3;
+
+	// Traces primary and incoherent rays through the BVH of every builder and leaf size with each kernel, on the calling thread
+	bool TraceRays = false;
+	std::vector<BVHTraversalKernel> Kernels = { BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SCALAR, BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SSE_4,
+		BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_AVX2_8 };
+	// Camera of the default scene
+	glm::vec3 CameraPosition = glm::vec3(0.0f, 0.0f, 2.0f);
+	glm::uvec2 Resolution = glm::uvec2(1280, 720);
+};
+
+struct TraceResult
+{
+	std::string Model;
+	std::string Builder;
+	uint32_t LeafSize = 0;
+	const char* RaySet = "";
+	BVHTraversalKernel Kernel = BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SCALAR;
+	std::size_t NumRays = 0;
+	std::size_t NumHits = 0;
+	float ClosestHitDuration = 0.0f;
+	float AnyHitDuration = 0.0f;
+};
+
+static void PrintUsage()
+{
+	printf("Usage: BVHBenchmark [model files] [--builder sah|lbvh[,...]] [--leaf-size n[,n...]] [-t threads[,threads...]] [--bins n]\n");
+	printf("                    [--morton 30|63] [--treelets] [-r repetitions] [--trace] [--kernels scalar|sse4|avx2[,...]]\n");
+	printf("                    [--resolution WxH] [--camera x,y,z]\n");
+	printf("Builds a CPU BVH over the triangles of every model and reports the build time and throughput, node count and SAH cost. LBVH\n");
+	printf("builds run once per thread count, powers of two up to the number of hardware threads by default. The models are loaded with\n");
+	printf("the options of AssetCooker, so they are read from their cooked files when those are up to date\n");
+	printf("With --trace, the primary rays of the default camera and diffuse bounces off their hits are traced through every BVH with\n");
+	printf("each traversal kernel on a single thread, and the closest and any hit throughput is reported in Mrays/s\n");
+}
+
+static bool ParseList(const std::string& list, std::vector<uint32_t>& values)
+{
+	values.clear();
+
+	std::size_t begin = 0;
+	while (begin <= list.size())
+	{
+		std::size_t end = std::min(list.find(',', begin), list.size());
+		uint32_t value = static_cast<uint32_t>(std::strtoul(list.substr(begin, end - begin).c_str(), nullptr, 10));
+		if (value == 0)
+			return false;
+
+		values.push_back(value);
+		begin = end + 1;
+	}
+
+	return !values.empty();
+}
+
+static bool ParseBuilders(const std::string& list, std::vector<BVHBuilderType>& builders)
+{
+	builders.clear();
+
+	std::size_t begin = 0;
+	while (begin <= list.size())
+	{
+		std::size_t end = std::min(list.find(',', begin), list.size());
+		std::string name = list.substr(begin, end - begin);
+
+		if (name == "sah")
+			builders.push_back(BVHBuilderType::BVH_BUILDER_TYPE_SAH);
+		else if (name == "lbvh")
+			builders.push_back(BVHBuilderType::BVH_BUILDER_TYPE_LBVH);
+		else
+			return false;
+
+		begin = end + 1;
+	}
+
+	return !builders.empty();
+}
+
+static bool ParseKernels(const std::string& list, std::vector<BVHTraversalKernel>& kernels)
+{
+	kernels.clear();
+
+	std::size_t begin = 0;
+	while (begin <= list.size())
+	{
+		std::size_t end = std::min(list.find(',', begin), list.size());
+		std::string name = list.substr(begin, end - begin);
+
+		if (name == "scalar")
+			kernels.push_back(BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SCALAR);
+		else if (name == "sse4")
+			kernels.push_back(BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SSE_4);
+		else if (name == "avx2")
+			kernels.push_back(BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_AVX2_8);
+		else
+			return false;
+
+		begin = end + 1;
+	}
+
+	return !kernels.empty();
+}
+
+static std::vector<uint32_t> GetDefaultThreadCounts()
+{
+	uint32_t numHardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t numThreads = 1; numThreads < numHardwareThreads; numThreads *= 2)
+		threadCounts.push_back(numThreads);
+
+	threadCounts.push_back(numHardwareThreads);
+	return threadCounts;
+}
+
+static std::string GetBuilderName(BVHBuilderType builder, const BVHBenchmarkDesc& desc)
+{
+	if (builder == BVHBuilderType::BVH_BUILDER_TYPE_SAH)
+		return "SAH";
+
+	std::string name = desc.LBVHDesc.CodeWidth == MortonCodeWidth::MORTON_CODE_WIDTH_63 ? "LBVH-63" : "LBVH-30";
+	return desc.LBVHDesc.OptimizeTreelets ? name + "+treelets" : name;
+}
+
+static const char* GetKernelName(BVHTraversalKernel kernel)
+{
+	switch (kernel)
+	{
+	case BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SSE_4:
+		return "SSE 4-wide";
+	case BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_AVX2_8:
+		return "AVX2 8-wide";
+	default:
+		return "Scalar";
+	}
+}
+
+/* One ray per pixel in scanline order, from the view data the renderer uploads for the raygen shader */
+static std::vector<BVHRay> GeneratePrimaryRays(const BVHBenchmarkDesc& desc)
+{
+	glm::vec2 resolution(desc.Resolution);
+	Camera camera(desc.CameraPosition, 60.0f, resolution.x, resolution.y, 0.1f, 1000.0f);
+	ViewData viewData = ViewData::FromCamera(camera, resolution);
+
+	std::vector<BVHRay> rays(static_cast<std::size_t>(desc.Resolution.x) * desc.Resolution.y);
+	for (uint32_t y = 0; y < desc.Resolution.y; ++y)
+	{
+		for (uint32_t x = 0; x < desc.Resolution.x; ++x)
+		{
+			BVHRay& ray = rays[static_cast<std::size_t>(y) * desc.Resolution.x + x];
+			ray.Origin = viewData.GetRayOrigin();
+			ray.Direction = viewData.GetRayDirection(x, y);
+		}
+	}
+
+	return rays;
+}
+
+/* A cosine distributed bounce off the hit of every primary ray, and a uniformly distributed direction from the camera for the rays that
+   missed. Neighbouring rays start close to each other but head in unrelated directions */
+static std::vector<BVHRay> GenerateIncoherentRays(const BVH& bvh, const std::vector<BVHRay>& primaryRays, const std::vector<BVHHit>& primaryHits)
+{
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+	// Bounces start a little off the surface so they do not hit the triangle they leave from
+	glm::vec3 extent = bvh.Nodes.empty() ? glm::vec3(0.0f) : bvh.Nodes[0].BoundsMax - bvh.Nodes[0].BoundsMin;
+	float offset = glm::length(extent) * 1e-5f;
+
+	std::vector<BVHRay> rays(primaryRays.size());
+	for (std::size_t i = 0; i < rays.size(); ++i)
+	{
+		float u0 = uniform(random);
+		float u1 = uniform(random);
+		float phi = 2.0f * glm::pi<float>() * u1;
+
+		if (!primaryHits[i].IsHit())
+		{
+			float cosTheta = 1.0f - 2.0f * u0;
+			float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+
+			rays[i].Origin = primaryRays[i].Origin;
+			rays[i].Direction = glm::vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+			continue;
+		}
+
+		const BVHTriangle& triangle = bvh.Triangles[primaryHits[i].Triangle];
+		glm::vec3 normal = glm::cross(triangle.V1 - triangle.V0, triangle.V2 - triangle.V0);
+		normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : -primaryRays[i].Direction;
+		if (glm::dot(normal, primaryRays[i].Direction) > 0.0f)
+			normal = -normal;
+
+		glm::vec3 tangent = glm::normalize(glm::cross(std::abs(normal.x) > 0.9f ? WorldUp : WorldRight, normal));
+		glm::vec3 bitangent = glm::cross(normal, tangent);
+
+		float radius = std::sqrt(u0);
+		glm::vec3 direction = tangent * radius * std::cos(phi) + bitangent * radius * std::sin(phi) + normal * std::sqrt(1.0f - u0);
+
+		rays[i].Origin = primaryRays[i].Origin + primaryRays[i].Direction * primaryHits[i].T + normal * offset;
+		rays[i].Direction = glm::normalize(direction);
+	}
+
+	return rays;
+}
+
+static void TraceRays(const BVHBenchmarkDesc& desc, const std::string& model, const std::string& builder, uint32_t leafSize, const BVH& bvh,
+	std::vector<TraceResult>& results)
+{
+	std::vector<BVHRay> primaryRays = GeneratePrimaryRays(desc);
+	std::vector<BVHHit> primaryHits(primaryRays.size());
+	BVHTraversal::Intersect(bvh, primaryRays.data(), primaryRays.size(), BVHTraversalKernel::BVH_TRAVERSAL_KERNEL_SCALAR, primaryHits.data());
+
+	std::vector<BVHRay> incoherentRays = GenerateIncoherentRays(bvh, primaryRays, primaryHits);
+	std::pair<const char*, const std::vector<BVHRay>*> raySets[] = { { "Primary", &primaryRays }, { "Incoherent", &incoherentRays } };
+
+	for (auto& [raySetName, raySet] : raySets)
+	{
+		const std::vector<BVHRay>& rays = *raySet;
+		std::vector<BVHHit> hits(rays.size());
+		std::unique_ptr<uint8_t[]> occluded = std::make_unique<uint8_t[]>(rays.size());
+
+		for (BVHTraversalKernel kernel : desc.Kernels)
+		{
+			if (!BVHTraversal::IsKernelSupported(kernel))
+				continue;
+
+			TraceResult result;
+			result.Model = model;
+			result.Builder = builder;
+			result.LeafSize = leafSize;
+			result.RaySet = raySetName;
+			result.Kernel = kernel;
+			result.NumRays = rays.size();
+			result.ClosestHitDuration = std::numeric_limits<float>::max();
+			result.AnyHitDuration = std::numeric_limits<float>::max();
+
+			for (uint32_t i = 0; i < std::max(1u, desc.NumRepetitions); ++i)
+			{
+				auto startTime = std::chrono::steady_clock::now();
+				BVHTraversal::Intersect(bvh, rays.data(), rays.size(), kernel, hits.data());
+				auto closestHitTime = std::chrono::steady_clock::now();
+				BVHTraversal::IsOccluded(bvh, rays.data(), rays.size(), kernel, occluded.get());
+				auto anyHitTime = std::chrono::steady_clock::now();
+
+				result.ClosestHitDuration = std::min(result.ClosestHitDuration, std::chrono::duration<float, std::milli>(closestHitTime - startTime).count());
+				result.AnyHitDuration = std::min(result.AnyHitDuration, std::chrono::duration<float, std::milli>(anyHitTime - closestHitTime).count());
+			}
+
+			result.NumHits = std::count_if(hits.begin(), hits.end(), [](const BVHHit& hit) { return hit.IsHit(); });
+			results.push_back(result);
+		}
+	}
+}
+
+static void PrintTraceResults(const std::vector<TraceResult>& results)
+{
+	printf("\n%-48s  %-16s  %9s  %-10s  %-11s  %9s  %6s  %15s  %15s\n", "Model", "Builder", "Leaf size", "Rays", "Kernel", "Rays", "Hits",
+		"Closest Mrays/s", "Any hit Mrays/s");
+
+	for (auto& result : results)
+	{
+		auto getThroughput = [&result](float duration) { return duration > 0.0f ? result.NumRays / (duration * 1000.0f) : 0.0f; };
+		float hitPercentage = result.NumRays > 0 ? 100.0f * result.NumHits / result.NumRays : 0.0f;
+
+		printf("%-48s  %-16s  %9u  %-10s  %-11s  %9zu  %5.1f%%  %15.2f  %15.2f\n", result.Model.c_str(), result.Builder.c_str(), result.LeafSize,
+			result.RaySet, GetKernelName(result.Kernel), result.NumRays, hitPercentage, getThroughput(result.ClosestHitDuration),
+			getThroughput(result.AnyHitDuration));
+	}
+}
+
+static void RunBenchmark(const BVHBenchmarkDesc& desc)
+{
+	ModelLoadDesc loadDesc;
+	loadDesc.OptimizeMeshes = true;
+	loadDesc.BuildMeshlets = true;
+	loadDesc.GenerateLODs = true;
+
+	// Every model is loaded before the first build, so the load logs end up above the report
+	std::vector<std::pair<std::string, ModelData>> models;
+	for (auto& filepath : desc.ModelFilepaths)
+	{
+		ModelData data;
+		if (ModelCooker::Cook(filepath, loadDesc, nullptr, ModelCookCallbacks(), data))
+			models.emplace_back(filepath, std::move(data));
+		else
+			LOG_ERR("[BVHBenchmark] Failed to load " + filepath);
+	}
+
+	std::vector<TraceResult> traceResults;
+
+	printf("\n%-48s  %-16s  %7s  %9s  %10s  %9s  %10s  %9s  %9s  %6s  %9s  %9s\n", "Model", "Builder", "Threads", "Leaf size", "Triangles",
+		"Build (ms)", "Mtris/s", "Nodes", "Leaves", "Depth", "Avg leaf", "SAH cost");
+
+	for (auto& [filepath, data] : models)
+	{
+		const CookedModelData& cooked = data.Cooked;
+		for (BVHBuilderType builder : desc.Builders)
+		{
+			bool isSAHBuilder = builder == BVHBuilderType::BVH_BUILDER_TYPE_SAH;
+			const std::vector<uint32_t>& threadCounts = isSAHBuilder ? std::vector<uint32_t>{ 1 } : desc.ThreadCounts;
+
+			for (uint32_t numThreads : threadCounts)
+			{
+				// A single thread builds on the calling thread, without the overhead of handing out jobs
+				std::unique_ptr<ThreadPool> threadPool = numThreads > 1 ? std::make_unique<ThreadPool>(numThreads) : nullptr;
+
+				for (uint32_t leafSize : desc.LeafSizes)
+				{
+					BVH bvh;
+					BVHBuildStats stats;
+					float buildDuration = std::numeric_limits<float>::max();
+
+					for (uint32_t i = 0; i < std::max(1u, desc.NumRepetitions); ++i)
+					{
+						if (isSAHBuilder)
+						{
+							BVHBuildDesc buildDesc = desc.BuildDesc;
+							buildDesc.MaxLeafSize = leafSize;
+							stats = BVHBuilder::Build(cooked.Vertices, cooked.NumVertices, cooked.Indices, cooked.IndexByteSize, cooked.Submeshes,
+								buildDesc, bvh);
+						}
+						else
+						{
+							LBVHBuildDesc buildDesc = desc.LBVHDesc;
+							buildDesc.MaxLeafSize = leafSize;
+							stats = LBVHBuilder::Build(cooked.Vertices, cooked.NumVertices, cooked.Indices, cooked.IndexByteSize, cooked.Submeshes,
+								buildDesc, threadPool.get(), bvh);
+						}
+
+						buildDuration = std::min(buildDuration, stats.BuildDuration);
+					}
+
+					float throughput = buildDuration > 0.0f ? stats.NumTriangles / (buildDuration * 1000.0f) : 0.0f;
+					printf("%-48s  %-16s  %7u  %9u  %10zu  %10.2f  %9.2f  %9zu  %9zu  %6u  %9.2f  %9.2f\n", filepath.c_str(),
+						GetBuilderName(builder, desc).c_str(), numThreads, leafSize, stats.NumTriangles, buildDuration, throughput, stats.NumNodes,
+						stats.NumLeaves, stats.MaxDepth, stats.AverageLeafSize, stats.SAHCost);
+
+					// The BVH does not depend on the number of threads, so it is traced once
+					if (desc.TraceRays && numThreads == threadCounts.front())
+						TraceRays(desc, filepath, GetBuilderName(builder, desc), leafSize, bvh, traceResults);
+				}
+			}
+		}
+	}
+
+	if (desc.TraceRays)
+		PrintTraceResults(traceResults);
+}
+
+int main(int argc, char** argv)
+{
+	BVHBenchmarkDesc desc;
+	desc.ThreadCounts = GetDefaultThreadCounts();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+		bool isValid = true;
+
+		if (argument == "--builder" && hasValue)
+		{
+			isValid = ParseBuilders(argv[++i], desc.Builders);
+		}
+		else if (argument == "--leaf-size" && hasValue)
+		{
+			// The LBVH builder walks collapsed leaves with a fixed size stack
+			isValid = ParseList(argv[++i], desc.LeafSizes) && *std::max_element(desc.LeafSizes.begin(), desc.LeafSizes.end()) <= 64;
+		}
+		else if (argument == "-t" && hasValue)
+		{
+			isValid = ParseList(argv[++i], desc.ThreadCounts);
+		}
+		else if (argument == "--bins" && hasValue)
+		{
+			desc.BuildDesc.NumBins = std::max(2u, static_cast<uint32_t>(std::stoul(argv[++i])));
+		}
+		else if (argument == "--morton" && hasValue)
+		{
+			std::string width = argv[++i];
+			desc.LBVHDesc.CodeWidth = width == "63" ? MortonCodeWidth::MORTON_CODE_WIDTH_63 : MortonCodeWidth::MORTON_CODE_WIDTH_30;
+			isValid = width == "30" || width == "63";
+		}
+		else if (argument == "--treelets")
+		{
+			desc.LBVHDesc.OptimizeTreelets = true;
+		}
+		else if (argument == "-r" && hasValue)
+		{
+			desc.NumRepetitions = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (argument == "--trace")
+		{
+			desc.TraceRays = true;
+		}
+		else if (argument == "--kernels" && hasValue)
+		{
+			isValid = ParseKernels(argv[++i], desc.Kernels);
+		}
+		else if (argument == "--resolution" && hasValue)
+		{
+			isValid = std::sscanf(argv[++i], "%ux%u", &desc.Resolution.x, &desc.Resolution.y) == 2 && desc.Resolution.x > 0 && desc.Resolution.y > 0;
+		}
+		else if (argument == "--camera" && hasValue)
+		{
+			isValid = std::sscanf(argv[++i], "%f,%f,%f", &desc.CameraPosition.x, &desc.CameraPosition.y, &desc.CameraPosition.z) == 3;
+		}
+		else if (argument[0] != '-')
+		{
+			desc.ModelFilepaths.push_back(argument);
+		}
+		else
+		{
+			PrintUsage();
+			return argument == "-h" || argument == "--help" ? 0 : 1;
+		}
+
+		if (!isValid)
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (desc.ModelFilepaths.empty())
+		desc.ModelFilepaths = { "Resources/Models/DamagedHelmet/DamagedHelmet.gltf", "Resources/Models/Sponza_OLD/Sponza.gltf" };
+
+	RunBenchmark(desc);
+	return 0;
+}
@@ -0,0 +1,159 @@
+#include "Pch.h"
+#include "Graphics/CPURenderer.h"
+#include "Resource/BlockCompression.h"
+#include "Resource/ModelCooker.h"
+#include "Scene/Camera.h"
+
+#include "tinygltf/stb_image.h"
+
+struct CPURenderDesc
+{
+	std::string ModelFilepath = "Resources/Models/DamagedHelmet/DamagedHelmet.gltf";
+	std::string OutputFilepath = "CPURender.png";
+	// Window size and camera of the default scene
+	glm::uvec2 Resolution = glm::uvec2(1280, 720);
+	glm::vec3 CameraPosition = glm::vec3(0.0f, 0.0f, 2.0f);
+	// 0 uses the number of hardware threads
+	uint32_t NumThreads = 0;
+
+	// The frame is compared against the reference image when one is given, and fails below the minimum PSNR
+	std::string ReferenceFilepath;
+	float MinPSNR = 40.0f;
+};
+
+static void PrintUsage()
+{
+	printf("Usage: CPURender [model file] [-o output.png] [--resolution WxH] [--camera x,y,z] [-t threads] [--compare reference.png] [--min-psnr dB]\n");
+	printf("Renders a frame of the model with the shaders of the renderer mirrored on the CPU and writes it as a PNG. The model is loaded\n");
+	printf("with the options of the renderer, so it is read from its cooked files when those are up to date. With --compare the frame\n");
+	printf("is checked against a reference image, and the exit code is 1 when their PSNR is below the minimum, 40 dB by default.\n");
+	printf("The frame is split into tiles that -t threads render, every hardware thread by default\n");
+}
+
+/* Busy and idle time of every worker from the counters the renderer sets on the profiler */
+static void PrintThreadStats(uint32_t numThreads)
+{
+	std::unordered_map<std::string, uint64_t> counters = Profiler::Get().GetCounters();
+
+	printf("%-8s %8s %8s %12s %12s\n", "Thread", "Tiles", "Steals", "Busy (ms)", "Idle (ms)");
+	for (uint32_t i = 0; i < numThreads; ++i)
+	{
+		std::string name = "CPURenderer::Thread " + std::to_string(i);
+		printf("%-8u %8llu %8llu %12.2f %12.2f\n", i, static_cast<unsigned long long>(counters[name + " tiles"]),
+			static_cast<unsigned long long>(counters[name + " steals"]), counters[name + " busy us"] / 1000.0f, counters[name + " idle us"] / 1000.0f);
+	}
+}
+
+/* PSNR of the color channels, images of a different size never match */
+static bool CompareWithReference(const CPURenderDesc& desc)
+{
+	int width = 0, height = 0, numChannels = 0;
+	stbi_uc* reference = stbi_load(desc.ReferenceFilepath.c_str(), &width, &height, &numChannels, 4);
+	if (!reference)
+	{
+		LOG_ERR("[CPURender] Failed to load reference image " + desc.ReferenceFilepath);
+		return false;
+	}
+
+	bool isMatch = false;
+	if (static_cast<uint32_t>(width) == desc.Resolution.x && static_cast<uint32_t>(height) == desc.Resolution.y)
+	{
+		float psnr = BlockCompression::MeasurePSNR(reference, CPURenderer::GetFrame().data(), desc.Resolution.x, desc.Resolution.y, 3);
+		isMatch = psnr >= desc.MinPSNR;
+		printf("PSNR against %s: %.2f dB, %s\n", desc.ReferenceFilepath.c_str(), psnr, isMatch ? "passed" : "failed");
+	}
+	else
+	{
+		printf("Reference %s is %ix%i, the frame is %ux%u\n", desc.ReferenceFilepath.c_str(), width, height, desc.Resolution.x, desc.Resolution.y);
+	}
+
+	stbi_image_free(reference);
+	return isMatch;
+}
+
+int main(int argc, char** argv)
+{
+	CPURenderDesc desc;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+		bool isValid = true;
+
+		if (argument == "-o" && hasValue)
+		{
+			desc.OutputFilepath = argv[++i];
+		}
+		else if (argument == "--resolution" && hasValue)
+		{
+			isValid = std::sscanf(argv[++i], "%ux%u", &desc.Resolution.x, &desc.Resolution.y) == 2 && desc.Resolution.x > 0 && desc.Resolution.y > 0;
+		}
+		else if (argument == "--camera" && hasValue)
+		{
+			isValid = std::sscanf(argv[++i], "%f,%f,%f", &desc.CameraPosition.x, &desc.CameraPosition.y, &desc.CameraPosition.z) == 3;
+		}
+		else if (argument == "-t" && hasValue)
+		{
+			isValid = std::sscanf(argv[++i], "%u", &desc.NumThreads) == 1;
+		}
+		else if (argument == "--compare" && hasValue)
+		{
+			desc.ReferenceFilepath = argv[++i];
+		}
+		else if (argument == "--min-psnr" && hasValue)
+		{
+			desc.MinPSNR = std::stof(argv[++i]);
+		}
+		else if (argument[0] != '-')
+		{
+			desc.ModelFilepath = argument;
+		}
+		else
+		{
+			PrintUsage();
+			return argument == "-h" || argument == "--help" ? 0 : 1;
+		}
+
+		if (!isValid)
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	// Same cook options as the renderer, apart from streaming, which only changes how textures reach the GPU
+	ModelLoadDesc loadDesc;
+	loadDesc.OptimizeMeshes = true;
+
+	ModelData model;
+	if (!ModelCooker::Cook(desc.ModelFilepath, loadDesc, nullptr, ModelCookCallbacks(), model))
+	{
+		LOG_ERR("[CPURender] Failed to load " + desc.ModelFilepath);
+		return 1;
+	}
+
+	glm::vec2 resolution(desc.Resolution);
+	uint32_t numThreads = desc.NumThreads > 0 ? desc.NumThreads : std::max(1u, std::thread::hardware_concurrency());
+	CPURenderer::Initialize(desc.Resolution.x, desc.Resolution.y, numThreads);
+	CPURenderer::SetModel(model);
+
+	Camera camera(desc.CameraPosition, 60.0f, resolution.x, resolution.y, 0.1f, 1000.0f);
+	CPURenderer::BeginScene(camera);
+
+	auto startTime = std::chrono::steady_clock::now();
+	CPURenderer::Render();
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+	float numRays = resolution.x * resolution.y;
+	printf("Rendered %ux%u on %u threads in %.2f ms, %.2f Mrays/s\n", desc.Resolution.x, desc.Resolution.y, numThreads, elapsed.count(),
+		numRays / (elapsed.count() * 1000.0f));
+	PrintThreadStats(numThreads);
+
+	bool succeeded = CPURenderer::SaveFrame(desc.OutputFilepath);
+	if (succeeded && !desc.ReferenceFilepath.empty())
+		succeeded = CompareWithReference(desc);
+
+	CPURenderer::Finalize();
+	return succeeded ? 0 : 1;
+}
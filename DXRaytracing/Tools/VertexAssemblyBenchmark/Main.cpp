@@ -0,0 +1,278 @@
+#include "Pch.h"
+#include "Resource/VertexAssembly.h"
+#include "Util/ThreadPool.h"
+
+#include "tinygltf/tiny_gltf.h"
+
+struct VertexAssemblyBenchmarkDesc
+{
+	std::vector<std::string> ModelFilepaths;
+	// Threads of the parallel run, 0 uses the number of hardware threads
+	uint32_t NumThreads = 0;
+	// Runs per method, the fastest one is reported
+	uint32_t NumRepetitions = 20;
+};
+
+struct BenchmarkPrimitive
+{
+	VertexStreams Vertices;
+	std::size_t VertexOffset = 0;
+};
+
+struct AssemblyMethod
+{
+	const char* Name = "";
+	// The old loop reads tightly packed floats into an empty array that it grows, the other methods write to pre-sized output
+	bool IsOldLoop = false;
+	std::function<void(const std::vector<BenchmarkPrimitive>&, std::vector<Vertex>&)> Assemble;
+};
+
+static void PrintUsage()
+{
+	printf("Usage: VertexAssemblyBenchmark [model files] [-t threads] [-r repetitions]\n");
+	printf("Assembles the vertices of every primitive of each model with the loop LoadGLTF used before VertexAssembly, which builds every\n");
+	printf("vertex with push_back from tightly packed floats, and with the scalar, SIMD and parallel SIMD paths of VertexAssembly. Reports the\n");
+	printf("fastest of the repetitions, and checks every path against the scalar one. The old loop is skipped for models whose attributes\n");
+	printf("are not tightly packed floats, since it would read them wrong\n");
+}
+
+/* Images are not needed for the vertices, so they are neither decoded nor kept */
+static bool SkipImage(tinygltf::Image* /*image*/, const int /*imageIndex*/, std::string* /*err*/, std::string* /*warn*/, int /*reqWidth*/,
+	int /*reqHeight*/, const unsigned char* /*bytes*/, int /*size*/, void* /*userData*/)
+{
+	return true;
+}
+
+static bool GetAttributeStream(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const std::string& name, VertexAttributeStream& stream,
+	std::size_t& count)
+{
+	auto attribute = primitive.attributes.find(name);
+	if (attribute == primitive.attributes.end())
+		return false;
+
+	// Sparse accessors are left out, the old loop could not read them
+	const tinygltf::Accessor& accessor = model.accessors[attribute->second];
+	if (accessor.bufferView < 0 || accessor.sparse.isSparse)
+		return false;
+
+	const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+	switch (accessor.componentType)
+	{
+	case TINYGLTF_COMPONENT_TYPE_FLOAT:
+		stream.ComponentType = VertexComponentType::VERTEX_COMPONENT_TYPE_FLOAT;
+		break;
+	case TINYGLTF_COMPONENT_TYPE_BYTE:
+		stream.ComponentType = VertexComponentType::VERTEX_COMPONENT_TYPE_INT8;
+		break;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+		stream.ComponentType = VertexComponentType::VERTEX_COMPONENT_TYPE_UINT8;
+		break;
+	case TINYGLTF_COMPONENT_TYPE_SHORT:
+		stream.ComponentType = VertexComponentType::VERTEX_COMPONENT_TYPE_INT16;
+		break;
+	case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+		stream.ComponentType = VertexComponentType::VERTEX_COMPONENT_TYPE_UINT16;
+		break;
+	default:
+		return false;
+	}
+
+	stream.Data = model.buffers[bufferView.buffer].data.data() + bufferView.byteOffset + accessor.byteOffset;
+	stream.ByteStride = static_cast<std::size_t>(accessor.ByteStride(bufferView));
+	stream.Normalized = accessor.normalized;
+
+	count = accessor.count;
+	return stream.ByteStride > 0;
+}
+
+static bool IsPackedFloat(const VertexAttributeStream& stream, uint32_t numComponents)
+{
+	return stream.ComponentType == VertexComponentType::VERTEX_COMPONENT_TYPE_FLOAT && stream.ByteStride == numComponents * sizeof(float);
+}
+
+static bool LoadPrimitives(const std::string& filepath, tinygltf::Model& model, std::vector<BenchmarkPrimitive>& primitives, std::size_t& numVertices)
+{
+	tinygltf::TinyGLTF loader;
+	loader.SetImageLoader(SkipImage, nullptr);
+
+	std::string err, warn;
+	bool isBinary = filepath.size() >= 4 && filepath.compare(filepath.size() - 4, 4, ".glb") == 0;
+	bool result = isBinary ? loader.LoadBinaryFromFile(&model, &err, &warn, filepath) : loader.LoadASCIIFromFile(&model, &err, &warn, filepath);
+
+	if (!err.empty())
+		LOG_ERR(err);
+	if (!result)
+		return false;
+
+	numVertices = 0;
+	for (auto& mesh : model.meshes)
+	{
+		for (auto& gltfPrimitive : mesh.primitives)
+		{
+			BenchmarkPrimitive primitive;
+			std::size_t numPositions = 0, numTexCoords = 0, numNormals = 0;
+
+			if (!GetAttributeStream(model, gltfPrimitive, "POSITION", primitive.Vertices.Position, numPositions) ||
+				!GetAttributeStream(model, gltfPrimitive, "TEXCOORD_0", primitive.Vertices.TexCoord, numTexCoords) ||
+				!GetAttributeStream(model, gltfPrimitive, "NORMAL", primitive.Vertices.Normal, numNormals) ||
+				numTexCoords != numPositions || numNormals != numPositions)
+			{
+				LOG_WARN("[VertexAssemblyBenchmark] Skipped a primitive of " + filepath + " with missing or sparse attributes");
+				continue;
+			}
+
+			primitive.Vertices.NumVertices = numPositions;
+			primitive.VertexOffset = numVertices;
+			numVertices += numPositions;
+
+			primitives.push_back(primitive);
+		}
+	}
+
+	return true;
+}
+
+/* The assembly loop of LoadGLTF before VertexAssembly, which assumed strides of 3, 2 and 3 floats */
+static void AssembleOldLoop(const std::vector<BenchmarkPrimitive>& primitives, std::vector<Vertex>& vertices)
+{
+	vertices.clear();
+
+	for (auto& primitive : primitives)
+	{
+		const float* pVertexPosData = reinterpret_cast<const float*>(primitive.Vertices.Position.Data);
+		const float* pVertexTexCoordData = reinterpret_cast<const float*>(primitive.Vertices.TexCoord.Data);
+		const float* pVertexNormalData = reinterpret_cast<const float*>(primitive.Vertices.Normal.Data);
+
+		uint32_t posIndex = 0;
+		uint32_t texCoordIndex = 0;
+		uint32_t normalIndex = 0;
+
+		for (uint32_t i = 0; i < primitive.Vertices.NumVertices; ++i)
+		{
+			Vertex v = {};
+			v.Position = glm::vec3(pVertexPosData[posIndex], pVertexPosData[posIndex + 1], pVertexPosData[posIndex + 2]);
+			v.TexCoord = glm::vec2(pVertexTexCoordData[texCoordIndex], pVertexTexCoordData[texCoordIndex + 1]);
+			v.Normal = glm::vec3(pVertexNormalData[normalIndex], pVertexNormalData[normalIndex + 1], pVertexNormalData[normalIndex + 2]);
+			vertices.push_back(v);
+
+			posIndex += 3;
+			texCoordIndex += 2;
+			normalIndex += 3;
+		}
+	}
+}
+
+static void RunBenchmark(const VertexAssemblyBenchmarkDesc& desc)
+{
+	uint32_t numThreads = desc.NumThreads > 0 ? desc.NumThreads : std::max(1u, std::thread::hardware_concurrency());
+	ThreadPool threadPool(numThreads);
+	std::string parallelName = "SIMD, " + std::to_string(numThreads) + " threads";
+
+	std::vector<AssemblyMethod> methods = {
+		{ "Old loop", true, AssembleOldLoop },
+		{ "Scalar", false, [](const std::vector<BenchmarkPrimitive>& primitives, std::vector<Vertex>& vertices) {
+			for (auto& primitive : primitives)
+				VertexAssembly::AssembleScalar(primitive.Vertices, vertices.data() + primitive.VertexOffset);
+		} },
+		{ "SIMD", false, [](const std::vector<BenchmarkPrimitive>& primitives, std::vector<Vertex>& vertices) {
+			for (auto& primitive : primitives)
+				VertexAssembly::Assemble(primitive.Vertices, vertices.data() + primitive.VertexOffset);
+		} },
+		// Every primitive is a job that writes to its prefix sum offset, like the cooker assembles them
+		{ parallelName.c_str(), false, [&threadPool](const std::vector<BenchmarkPrimitive>& primitives, std::vector<Vertex>& vertices) {
+			for (auto& primitive : primitives)
+				threadPool.Submit([&primitive, &vertices]() { VertexAssembly::Assemble(primitive.Vertices, vertices.data() + primitive.VertexOffset); });
+
+			threadPool.WaitIdle();
+		} }
+	};
+
+	printf("\n%-48s  %10s  %10s  %-20s  %10s  %10s  %8s\n", "Model", "Primitives", "Vertices", "Method", "Time (ms)", "Mverts/s", "Matches");
+
+	for (auto& filepath : desc.ModelFilepaths)
+	{
+		tinygltf::Model model;
+		std::vector<BenchmarkPrimitive> primitives;
+		std::size_t numVertices = 0;
+
+		if (!LoadPrimitives(filepath, model, primitives, numVertices))
+		{
+			LOG_ERR("[VertexAssemblyBenchmark] Failed to load " + filepath);
+			continue;
+		}
+
+		bool isOldLoopValid = std::all_of(primitives.begin(), primitives.end(), [](const BenchmarkPrimitive& primitive) {
+			return IsPackedFloat(primitive.Vertices.Position, 3) && IsPackedFloat(primitive.Vertices.TexCoord, 2) && IsPackedFloat(primitive.Vertices.Normal, 3);
+		});
+
+		// Every method is checked against the scalar path, which handles every component type
+		std::vector<Vertex> reference(numVertices);
+		for (auto& primitive : primitives)
+			VertexAssembly::AssembleScalar(primitive.Vertices, reference.data() + primitive.VertexOffset);
+
+		for (auto& method : methods)
+		{
+			if (method.IsOldLoop && !isOldLoopValid)
+			{
+				printf("%-48s  %10zu  %10zu  %-20s  %10s  %10s  %8s\n", filepath.c_str(), primitives.size(), numVertices, method.Name, "n/a", "n/a", "n/a");
+				continue;
+			}
+
+			std::vector<Vertex> vertices(numVertices);
+			float duration = std::numeric_limits<float>::max();
+
+			for (uint32_t i = 0; i < std::max(1u, desc.NumRepetitions); ++i)
+			{
+				if (method.IsOldLoop)
+					vertices = std::vector<Vertex>();
+
+				auto startTime = std::chrono::steady_clock::now();
+				method.Assemble(primitives, vertices);
+				std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+
+				duration = std::min(duration, elapsed.count());
+			}
+
+			bool isMatch = vertices.size() == reference.size() && std::memcmp(vertices.data(), reference.data(), reference.size() * sizeof(Vertex)) == 0;
+			float throughput = duration > 0.0f ? numVertices / (duration * 1000.0f) : 0.0f;
+
+			printf("%-48s  %10zu  %10zu  %-20s  %10.3f  %10.2f  %8s\n", filepath.c_str(), primitives.size(), numVertices, method.Name, duration, throughput,
+				isMatch ? "yes" : "NO");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	VertexAssemblyBenchmarkDesc desc;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (argument == "-t" && hasValue)
+		{
+			desc.NumThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (argument == "-r" && hasValue)
+		{
+			desc.NumRepetitions = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (argument[0] != '-')
+		{
+			desc.ModelFilepaths.push_back(argument);
+		}
+		else
+		{
+			PrintUsage();
+			return argument == "-h" || argument == "--help" ? 0 : 1;
+		}
+	}
+
+	if (desc.ModelFilepaths.empty())
+		desc.ModelFilepaths = { "Resources/Models/Sponza_OLD/Sponza.gltf", "Resources/Models/DamagedHelmet/DamagedHelmet.gltf" };
+
+	RunBenchmark(desc);
+	return 0;
+}